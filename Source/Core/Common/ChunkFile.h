@@ -13,6 +13,7 @@
 // - Zero backwards/forwards compatibility
 // - Serialization code for anything complex has to be manually written.
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstring>
@@ -53,6 +54,19 @@
 #error No version of is_trivially_copyable
 #endif
 
+// Takes the output of a PointerWrap in MODE_WRITE piece by piece, so that the size doesn't need
+// to be measured first and the state doesn't need to fit in one buffer.
+class PointerWrapSink
+{
+public:
+  virtual ~PointerWrapSink() = default;
+  // Takes the current buffer, written up to `end` (null on the first call), and returns the next
+  // one, whose end is stored in `next_end`.
+  virtual u8* NextBuffer(u8* end, u8** next_end) = 0;
+  // Takes the last buffer, written up to `end`.
+  virtual void Finish(u8* end) = 0;
+};
+
 // Wrapper class
 class PointerWrap
 {
@@ -70,6 +84,20 @@ public:
 
 public:
   PointerWrap(u8** ptr_, Mode mode_) : ptr(ptr_), mode(mode_) {}
+  // Writes to the sink's buffers. Call Finish() when done.
+  explicit PointerWrap(PointerWrapSink* sink) : ptr(&m_stream_ptr), mode(MODE_WRITE), m_sink(sink)
+  {
+    m_stream_ptr = m_sink->NextBuffer(nullptr, &m_stream_end);
+  }
+  PointerWrap(const PointerWrap&) = delete;
+  PointerWrap& operator=(const PointerWrap&) = delete;
+
+  void Finish()
+  {
+    if (m_sink)
+      m_sink->Finish(m_stream_ptr);
+  }
+
   void SetMode(Mode mode_) { mode = mode_; }
   Mode GetMode() const { return mode; }
   template <typename K, class V>
@@ -281,6 +309,11 @@ private:
       break;
 
     case MODE_WRITE:
+      if (m_sink && size > static_cast<size_t>(m_stream_end - m_stream_ptr))
+      {
+        StreamVoid(data, size);
+        return;
+      }
       memcpy(*ptr, data, size);
       break;
 
@@ -296,4 +329,25 @@ private:
 
     *ptr += size;
   }
+
+  // Writes what doesn't fit in the sink's current buffer.
+  void StreamVoid(const void* data, u32 size)
+  {
+    const u8* src = static_cast<const u8*>(data);
+    while (true)
+    {
+      const u32 piece = static_cast<u32>(std::min<size_t>(size, m_stream_end - m_stream_ptr));
+      memcpy(m_stream_ptr, src, piece);
+      m_stream_ptr += piece;
+      src += piece;
+      size -= piece;
+      if (size == 0)
+        break;
+      m_stream_ptr = m_sink->NextBuffer(m_stream_ptr, &m_stream_end);
+    }
+  }
+
+  PointerWrapSink* m_sink = nullptr;
+  u8* m_stream_ptr = nullptr;
+  u8* m_stream_end = nullptr;
 };
@@ -0,0 +1,191 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+// An open addressing hash index from integer keys to buckets of values, kept in insertion order.
+// It replaces std::multimap where lookups are by exact key: the keys live in one flat array,
+// which keeps probing and full scans cache friendly, and the bucket vectors keep their
+// capacity when they are emptied or cleared, so a steady state doesn't allocate.
+//
+// With Ordered set, the distinct keys are also kept in a sorted array for range queries. That
+// makes inserting a new key and erasing the last value of one linear in the number of keys.
+//
+// Bucket pointers returned by Find() are invalidated by Insert() and Erase().
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+namespace Common
+{
+template <typename Key, typename Value, bool Ordered = false>
+class FlatHashIndex
+{
+public:
+  using Bucket = std::vector<Value>;
+
+  FlatHashIndex() { Rehash(MIN_CAPACITY); }
+
+  // Returns the values stored under key, or nullptr if there are none.
+  const Bucket* Find(Key key) const
+  {
+    for (size_t slot = Home(key);; slot = (slot + 1) & m_mask)
+    {
+      if (m_buckets[slot].empty())
+        return nullptr;
+      if (m_keys[slot] == key)
+        return &m_buckets[slot];
+    }
+  }
+
+  void Insert(Key key, Value value)
+  {
+    if ((m_used_slots + 1) * 4 > m_keys.size() * 3)
+      Rehash(m_keys.size() * 2);
+
+    size_t slot = Home(key);
+    while (!m_buckets[slot].empty() && m_keys[slot] != key)
+      slot = (slot + 1) & m_mask;
+
+    if (m_buckets[slot].empty())
+    {
+      m_keys[slot] = key;
+      m_used_slots++;
+      if (Ordered)
+      {
+        const auto position = std::lower_bound(m_sorted_keys.begin(), m_sorted_keys.end(), key);
+        m_sorted_keys.insert(position, key);
+      }
+    }
+    m_buckets[slot].push_back(std::move(value));
+    m_size++;
+  }
+
+  // Removes the first occurrence of value under key. Returns false if it wasn't found.
+  bool Erase(Key key, const Value& value)
+  {
+    size_t slot = Home(key);
+    for (; !m_buckets[slot].empty(); slot = (slot + 1) & m_mask)
+    {
+      if (m_keys[slot] == key)
+        break;
+    }
+
+    Bucket& bucket = m_buckets[slot];
+    const auto iter = std::find(bucket.begin(), bucket.end(), value);
+    if (iter == bucket.end())
+      return false;
+
+    bucket.erase(iter);
+    m_size--;
+    if (bucket.empty())
+    {
+      RemoveSlot(slot);
+      if (Ordered)
+        m_sorted_keys.erase(std::lower_bound(m_sorted_keys.begin(), m_sorted_keys.end(), key));
+    }
+    return true;
+  }
+
+  void Clear()
+  {
+    for (Bucket& bucket : m_buckets)
+      bucket.clear();
+    m_sorted_keys.clear();
+    m_used_slots = 0;
+    m_size = 0;
+  }
+
+  // The number of values, not keys.
+  size_t Size() const { return m_size; }
+  bool Empty() const { return m_size == 0; }
+
+  // Calls func(key, value) for every value, in no particular order of keys. Values of the same key
+  // are visited in insertion order.
+  template <typename Func>
+  void ForEach(Func func) const
+  {
+    for (size_t slot = 0; slot < m_keys.size(); slot++)
+    {
+      for (const Value& value : m_buckets[slot])
+        func(m_keys[slot], value);
+    }
+  }
+
+  // Like ForEach, but only for keys in [first, last], which are visited in ascending order. The
+  // index must not be changed by func.
+  template <typename Func>
+  void ForEachInRange(Key first, Key last, Func func) const
+  {
+    static_assert(Ordered, "Range queries need the sorted keys");
+    auto iter = std::lower_bound(m_sorted_keys.begin(), m_sorted_keys.end(), first);
+    for (; iter != m_sorted_keys.end() && *iter <= last; ++iter)
+    {
+      for (const Value& value : *Find(*iter))
+        func(*iter, value);
+    }
+  }
+
+private:
+  static constexpr size_t MIN_CAPACITY = 64;
+
+  size_t Home(Key key) const
+  {
+    return static_cast<size_t>((static_cast<u64>(key) * 0x9E3779B97F4A7C15ULL) >> m_shift);
+  }
+
+  // Backward shift deletion: pull later entries of the probe sequence into the hole, so lookups
+  // never need tombstones.
+  void RemoveSlot(size_t hole)
+  {
+    m_used_slots--;
+    for (size_t slot = (hole + 1) & m_mask; !m_buckets[slot].empty(); slot = (slot + 1) & m_mask)
+    {
+      const size_t home = Home(m_keys[slot]);
+      if (((slot - home) & m_mask) < ((slot - hole) & m_mask))
+        continue;
+
+      m_keys[hole] = m_keys[slot];
+      std::swap(m_buckets[hole], m_buckets[slot]);
+      hole = slot;
+    }
+  }
+
+  void Rehash(size_t capacity)
+  {
+    std::vector<Key> old_keys(capacity);
+    std::vector<Bucket> old_buckets(capacity);
+    std::swap(old_keys, m_keys);
+    std::swap(old_buckets, m_buckets);
+
+    m_mask = capacity - 1;
+    m_shift = 64;
+    for (size_t i = capacity; i > 1; i >>= 1)
+      m_shift--;
+
+    for (size_t i = 0; i < old_keys.size(); i++)
+    {
+      if (old_buckets[i].empty())
+        continue;
+      size_t slot = Home(old_keys[i]);
+      while (!m_buckets[slot].empty())
+        slot = (slot + 1) & m_mask;
+      m_keys[slot] = old_keys[i];
+      std::swap(m_buckets[slot], old_buckets[i]);
+    }
+  }
+
+  std::vector<Key> m_keys;
+  std::vector<Bucket> m_buckets;
+  std::vector<Key> m_sorted_keys;
+  size_t m_mask = 0;
+  int m_shift = 64;
+  size_t m_used_slots = 0;
+  size_t m_size = 0;
+};
+}  // namespace Common
@@ -8,6 +8,7 @@
 #include "Common/CPUDetect.h"
 #include "Common/CommonFuncs.h"
 #include "Common/Intrinsics.h"
+#include "Common/Swap.h"
 
 #ifdef _M_ARM_64
 #include <arm_acle.h>
@@ -612,6 +613,298 @@ u64 GetHashHiresTexture(const u8* src, u32 len, u32 samples)
 }
 #endif
 
+// XXH3, the 64-bit variant of xxHash 0.8 with the default secret and seed. The long input loop
+// has a scalar and an AVX2 version, which give the same result.
+namespace XXH3
+{
+constexpr u32 PRIME32_1 = 0x9E3779B1U;
+constexpr u32 PRIME32_2 = 0x85EBCA77U;
+constexpr u32 PRIME32_3 = 0xC2B2AE3DU;
+constexpr u64 PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr u64 PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr u64 PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr u64 PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr u64 PRIME64_5 = 0x27D4EB2F165667C5ULL;
+constexpr u64 PRIME_MX1 = 0x165667919E3779F9ULL;
+constexpr u64 PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+constexpr u32 STRIPE_LEN = 64;
+constexpr u32 SECRET_SIZE = 192;
+constexpr u32 STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE_LEN) / 8;
+
+alignas(64) static const u8 s_secret[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static u64 Read64(const u8* ptr)
+{
+  u64 value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+static u32 Read32(const u8* ptr)
+{
+  u32 value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+static u64 Rotl64(u64 value, int amount)
+{
+  return (value << amount) | (value >> (64 - amount));
+}
+
+// Multiplies to 128 bits and folds the halves together.
+static u64 Mul128Fold64(u64 lhs, u64 rhs)
+{
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+  return static_cast<u64>(product) ^ static_cast<u64>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X86_64)
+  u64 high;
+  const u64 low = _umul128(lhs, rhs, &high);
+  return low ^ high;
+#else
+  const u64 lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  const u64 hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  const u64 lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  const u64 hi_hi = (lhs >> 32) * (rhs >> 32);
+  const u64 cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  const u64 high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  const u64 low = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+  return low ^ high;
+#endif
+}
+
+static u64 Avalanche(u64 h)
+{
+  h ^= h >> 37;
+  h *= PRIME_MX1;
+  return h ^ (h >> 32);
+}
+
+static u64 XXH64Avalanche(u64 h)
+{
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  return h ^ (h >> 32);
+}
+
+static u64 RRMXMX(u64 h, u64 len)
+{
+  h ^= Rotl64(h, 49) ^ Rotl64(h, 24);
+  h *= PRIME_MX2;
+  h ^= (h >> 35) + len;
+  h *= PRIME_MX2;
+  return h ^ (h >> 28);
+}
+
+static u64 Mix16B(const u8* input, const u8* secret)
+{
+  return Mul128Fold64(Read64(input) ^ Read64(secret), Read64(input + 8) ^ Read64(secret + 8));
+}
+
+static u64 Hash0To16(const u8* input, u32 len)
+{
+  if (len > 8)
+  {
+    const u64 input_lo = Read64(input) ^ (Read64(s_secret + 24) ^ Read64(s_secret + 32));
+    const u64 input_hi = Read64(input + len - 8) ^ (Read64(s_secret + 40) ^ Read64(s_secret + 48));
+    const u64 acc = len + Common::swap64(input_lo) + input_hi + Mul128Fold64(input_lo, input_hi);
+    return Avalanche(acc);
+  }
+  if (len >= 4)
+  {
+    const u64 input64 = Read32(input + len - 4) + (static_cast<u64>(Read32(input)) << 32);
+    return RRMXMX(input64 ^ (Read64(s_secret + 8) ^ Read64(s_secret + 16)), len);
+  }
+  if (len > 0)
+  {
+    const u32 combined = (static_cast<u32>(input[0]) << 16) |
+                         (static_cast<u32>(input[len >> 1]) << 24) | input[len - 1] | (len << 8);
+    return XXH64Avalanche(combined ^ static_cast<u64>(Read32(s_secret) ^ Read32(s_secret + 4)));
+  }
+  return XXH64Avalanche(Read64(s_secret + 56) ^ Read64(s_secret + 64));
+}
+
+static u64 Hash17To128(const u8* input, u32 len)
+{
+  u64 acc = len * PRIME64_1;
+  if (len > 32)
+  {
+    if (len > 64)
+    {
+      if (len > 96)
+      {
+        acc += Mix16B(input + 48, s_secret + 96);
+        acc += Mix16B(input + len - 64, s_secret + 112);
+      }
+      acc += Mix16B(input + 32, s_secret + 64);
+      acc += Mix16B(input + len - 48, s_secret + 80);
+    }
+    acc += Mix16B(input + 16, s_secret + 32);
+    acc += Mix16B(input + len - 32, s_secret + 48);
+  }
+  acc += Mix16B(input, s_secret);
+  acc += Mix16B(input + len - 16, s_secret + 16);
+  return Avalanche(acc);
+}
+
+static u64 Hash129To240(const u8* input, u32 len)
+{
+  u64 acc = len * PRIME64_1;
+  const u32 rounds = len / 16;
+  for (u32 i = 0; i < 8; i++)
+    acc += Mix16B(input + 16 * i, s_secret + 16 * i);
+  acc = Avalanche(acc);
+  for (u32 i = 8; i < rounds; i++)
+    acc += Mix16B(input + 16 * i, s_secret + 16 * (i - 8) + 3);
+  acc += Mix16B(input + len - 16, s_secret + 136 - 17);
+  return Avalanche(acc);
+}
+
+// Accumulates count consecutive stripes.
+static void AccumulateScalar(u64* acc, const u8* input, u32 count, const u8* secret)
+{
+  for (u32 n = 0; n < count; n++)
+  {
+    for (int i = 0; i < 8; i++)
+    {
+      const u64 data = Read64(input + 8 * i);
+      const u64 key = data ^ Read64(secret + 8 * i);
+      acc[i ^ 1] += data;
+      acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+    }
+    input += STRIPE_LEN;
+    secret += 8;
+  }
+}
+
+static void ScrambleScalar(u64* acc, const u8* secret)
+{
+  for (int i = 0; i < 8; i++)
+  {
+    u64 value = acc[i];
+    value ^= value >> 47;
+    value ^= Read64(secret + 8 * i);
+    acc[i] = value * PRIME32_1;
+  }
+}
+
+#if defined(_M_X86)
+FUNCTION_TARGET_AVX2
+static void AccumulateAVX2(u64* acc, const u8* input, u32 count, const u8* secret)
+{
+  __m256i* acc_vec = reinterpret_cast<__m256i*>(acc);
+  __m256i sums[2];
+  for (int i = 0; i < 2; i++)
+    sums[i] = _mm256_loadu_si256(acc_vec + i);
+
+  for (u32 n = 0; n < count; n++)
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input) + i);
+      const __m256i key = _mm256_xor_si256(
+          data, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+      const __m256i product =
+          _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+      const __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+      sums[i] = _mm256_add_epi64(sums[i], _mm256_add_epi64(product, swapped));
+    }
+    input += STRIPE_LEN;
+    secret += 8;
+  }
+
+  for (int i = 0; i < 2; i++)
+    _mm256_storeu_si256(acc_vec + i, sums[i]);
+}
+
+FUNCTION_TARGET_AVX2
+static void ScrambleAVX2(u64* acc, const u8* secret)
+{
+  __m256i* acc_vec = reinterpret_cast<__m256i*>(acc);
+  const __m256i prime = _mm256_set1_epi32(PRIME32_1);
+  for (int i = 0; i < 2; i++)
+  {
+    __m256i value = _mm256_loadu_si256(acc_vec + i);
+    value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 47));
+    value = _mm256_xor_si256(value,
+                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+    const __m256i low = _mm256_mul_epu32(value, prime);
+    const __m256i high =
+        _mm256_mul_epu32(_mm256_shuffle_epi32(value, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+    _mm256_storeu_si256(acc_vec + i, _mm256_add_epi64(low, _mm256_slli_epi64(high, 32)));
+  }
+}
+#endif
+
+static void (*s_accumulate)(u64* acc, const u8* input, u32 count,
+                            const u8* secret) = AccumulateScalar;
+static void (*s_scramble)(u64* acc, const u8* secret) = ScrambleScalar;
+
+static u64 HashLong(const u8* input, u32 len)
+{
+  alignas(32) u64 acc[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+                            PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+
+  // The last stripe is always hashed separately, even if it overlaps the others.
+  u32 remaining = (len - 1) / STRIPE_LEN;
+  const u8* stripe = input;
+  while (remaining >= STRIPES_PER_BLOCK)
+  {
+    s_accumulate(acc, stripe, STRIPES_PER_BLOCK, s_secret);
+    s_scramble(acc, s_secret + SECRET_SIZE - STRIPE_LEN);
+    stripe += STRIPES_PER_BLOCK * STRIPE_LEN;
+    remaining -= STRIPES_PER_BLOCK;
+  }
+  s_accumulate(acc, stripe, remaining, s_secret);
+  s_accumulate(acc, input + len - STRIPE_LEN, 1, s_secret + SECRET_SIZE - STRIPE_LEN - 7);
+
+  u64 result = len * PRIME64_1;
+  for (int i = 0; i < 4; i++)
+  {
+    result += Mul128Fold64(acc[2 * i] ^ Read64(s_secret + 11 + 16 * i),
+                           acc[2 * i + 1] ^ Read64(s_secret + 11 + 16 * i + 8));
+  }
+  return Avalanche(result);
+}
+}  // namespace XXH3
+
+u64 GetXXH3Hash64(const u8* src, u32 len)
+{
+  if (len <= 16)
+    return XXH3::Hash0To16(src, len);
+  if (len <= 128)
+    return XXH3::Hash17To128(src, len);
+  if (len <= 240)
+    return XXH3::Hash129To240(src, len);
+  return XXH3::HashLong(src, len);
+}
+
+// XXH3 only keeps up with the CRC32 version when using AVX2 and hashing whole inputs. Sampled
+// hashes read the same scattered words either way, but XXH3 spends about twice as long on each.
+static u64 GetXXH3OrCRC32(const u8* src, u32 len, u32 samples)
+{
+  if (samples != 0 && len / sizeof(u64) > samples)
+    return GetCRC32(src, len, samples);
+  return GetXXH3Hash64(src, len);
+}
+
 u64 GetHash64(const u8* src, u32 len, u32 samples)
 {
   return ptrHashFunction(src, len, samples);
@@ -620,8 +913,17 @@ u64 GetHash64(const u8* src, u32 len, u32 samples)
 // sets the hash function used for the texture cache
 void SetHash64Function()
 {
+  XXH3::s_accumulate = XXH3::AccumulateScalar;
+  XXH3::s_scramble = XXH3::ScrambleScalar;
+
 #if defined(_M_X86_64) || defined(_M_X86)
-  if (cpu_info.bSSE4_2)  // sse crc32 version
+  if (cpu_info.bAVX2 && cpu_info.bSSE4_2)
+  {
+    XXH3::s_accumulate = XXH3::AccumulateAVX2;
+    XXH3::s_scramble = XXH3::ScrambleAVX2;
+    ptrHashFunction = &GetXXH3OrCRC32;
+  }
+  else if (cpu_info.bSSE4_2)  // sse crc32 version
   {
     ptrHashFunction = &GetCRC32;
   }
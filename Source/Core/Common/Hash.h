@@ -13,4 +13,6 @@ u32 HashAdler32(const u8* data, size_t len);         // Fairly accurate, slightl
 u32 HashEctor(const u8* ptr, int length);            // JUNK. DO NOT USE FOR NEW THINGS
 u64 GetHashHiresTexture(const u8* src, u32 len, u32 samples = 0);
 u64 GetHash64(const u8* src, u32 len, u32 samples);
+// XXH3-64 with the default secret. GetHash64 uses it for whole inputs on CPUs with AVX2.
+u64 GetXXH3Hash64(const u8* src, u32 len);
 void SetHash64Function();
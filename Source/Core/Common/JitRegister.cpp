@@ -6,8 +6,11 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Common/File.h"
@@ -20,6 +23,13 @@
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
 #if defined USE_OPROFILE && USE_OPROFILE
 #include <opagent.h>
 #endif
@@ -35,11 +45,196 @@ static op_agent_t s_agent = nullptr;
 
 static File::IOFile s_perf_map_file;
 
+#ifdef __linux__
+// Linux perf jitdump format, see tools/perf/Documentation/jitdump-specification.txt in the
+// kernel tree. Unlike the .map file, it has timestamps, so perf can tell which of several
+// blocks that were compiled to the same address a sample belongs to.
+namespace JitDump
+{
+constexpr u32 MAGIC = 0x4A695444;
+constexpr u32 VERSION = 1;
+
+enum RecordType : u32
+{
+  JIT_CODE_LOAD = 0,
+  JIT_CODE_MOVE = 1,
+  JIT_CODE_DEBUG_INFO = 2,
+  JIT_CODE_CLOSE = 3,
+};
+
+struct FileHeader
+{
+  u32 magic;
+  u32 version;
+  u32 total_size;
+  u32 elf_mach;
+  u32 pad1;
+  u32 pid;
+  u64 timestamp;
+  u64 flags;
+};
+
+struct RecordHeader
+{
+  u32 id;
+  u32 total_size;
+  u64 timestamp;
+};
+
+struct CodeLoad
+{
+  RecordHeader header;
+  u32 pid;
+  u32 tid;
+  u64 vma;
+  u64 code_addr;
+  u64 code_size;
+  u64 code_index;
+  // Followed by the null-terminated name and the code.
+};
+
+struct DebugInfo
+{
+  RecordHeader header;
+  u64 code_addr;
+  u64 nr_entry;
+  // Followed by the entries.
+};
+
+struct DebugEntry
+{
+  u64 code_addr;
+  u32 line;
+  u32 discrim;
+  // Followed by the null-terminated file name.
+};
+}  // namespace JitDump
+
+static File::IOFile s_jitdump_file;
+static void* s_jitdump_marker = nullptr;
+static u64 s_jitdump_code_index = 0;
+// Code is registered from both the CPU and the GPU thread.
+static std::mutex s_jitdump_lock;
+
+// perf record has to use the same clock (-k mono).
+static u64 GetJitDumpTimestamp()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<u64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+template <typename T>
+static void Append(std::vector<u8>* buffer, const T& value)
+{
+  const u8* data = reinterpret_cast<const u8*>(&value);
+  buffer->insert(buffer->end(), data, data + sizeof(T));
+}
+
+static void AppendString(std::vector<u8>* buffer, const std::string& str)
+{
+  buffer->insert(buffer->end(), str.begin(), str.end());
+  buffer->push_back(0);
+}
+
+// Records are written in one go with buffering disabled, so that they are complete even if we
+// crash.
+static void WriteRecord(std::vector<u8>* buffer, u32 id)
+{
+  JitDump::RecordHeader header = {id, static_cast<u32>(buffer->size()), GetJitDumpTimestamp()};
+  std::memcpy(buffer->data(), &header, sizeof(header));
+  s_jitdump_file.WriteBytes(buffer->data(), buffer->size());
+}
+
+static void OpenJitDump(const std::string& dir)
+{
+  std::string filename = StringFromFormat("%s/jit-%d.dump", dir.data(), getpid());
+  if (!s_jitdump_file.Open(filename, "w+b"))
+    return;
+  std::setvbuf(s_jitdump_file.GetHandle(), nullptr, _IONBF, 0);
+
+  // perf finds the file through an executable mapping of it in the recorded process.
+  const long page_size = sysconf(_SC_PAGESIZE);
+  s_jitdump_marker = mmap(nullptr, page_size, PROT_READ | PROT_EXEC, MAP_PRIVATE,
+                          fileno(s_jitdump_file.GetHandle()), 0);
+  if (s_jitdump_marker == MAP_FAILED)
+  {
+    s_jitdump_marker = nullptr;
+    s_jitdump_file.Close();
+    return;
+  }
+
+  JitDump::FileHeader header = {};
+  header.magic = JitDump::MAGIC;
+  header.version = JitDump::VERSION;
+  header.total_size = sizeof(header);
+#if defined(_M_X86_64)
+  header.elf_mach = EM_X86_64;
+#elif defined(_M_ARM_64)
+  header.elf_mach = EM_AARCH64;
+#endif
+  header.pid = static_cast<u32>(getpid());
+  header.timestamp = GetJitDumpTimestamp();
+  s_jitdump_file.WriteArray(&header, 1);
+  s_jitdump_code_index = 0;
+}
+
+static void CloseJitDump()
+{
+  if (!s_jitdump_file.IsOpen())
+    return;
+
+  std::vector<u8> buffer(sizeof(JitDump::RecordHeader));
+  WriteRecord(&buffer, JitDump::JIT_CODE_CLOSE);
+  munmap(s_jitdump_marker, sysconf(_SC_PAGESIZE));
+  s_jitdump_marker = nullptr;
+  s_jitdump_file.Close();
+}
+
+static void WriteJitDumpCode(const void* base_address, u32 code_size,
+                             const std::vector<JitRegister::SourceLine>& lines,
+                             const std::string& symbol_name)
+{
+  std::lock_guard<std::mutex> lk(s_jitdump_lock);
+  const u64 address = reinterpret_cast<u64>(base_address);
+  std::vector<u8> buffer;
+
+  // The line information has to precede the code it belongs to.
+  if (!lines.empty())
+  {
+    buffer.resize(sizeof(JitDump::DebugInfo));
+    for (const JitRegister::SourceLine& line : lines)
+    {
+      Append(&buffer, JitDump::DebugEntry{reinterpret_cast<u64>(line.address), line.line, 0});
+      AppendString(&buffer, line.file);
+    }
+    const u64 nr_entry = lines.size();
+    std::memcpy(buffer.data() + offsetof(JitDump::DebugInfo, code_addr), &address, sizeof(u64));
+    std::memcpy(buffer.data() + offsetof(JitDump::DebugInfo, nr_entry), &nr_entry, sizeof(u64));
+    WriteRecord(&buffer, JitDump::JIT_CODE_DEBUG_INFO);
+  }
+
+  JitDump::CodeLoad load = {};
+  load.pid = static_cast<u32>(getpid());
+  load.tid = static_cast<u32>(syscall(SYS_gettid));
+  load.vma = address;
+  load.code_addr = address;
+  load.code_size = code_size;
+  load.code_index = s_jitdump_code_index++;
+  buffer.clear();
+  Append(&buffer, load);
+  AppendString(&buffer, symbol_name);
+  const u8* code = static_cast<const u8*>(base_address);
+  buffer.insert(buffer.end(), code, code + code_size);
+  WriteRecord(&buffer, JitDump::JIT_CODE_LOAD);
+}
+#endif
+
 namespace JitRegister
 {
 static bool s_is_enabled = false;
 
-void Init(const std::string& perf_dir)
+void Init(const std::string& perf_dir, bool jitdump)
 {
 #if defined USE_OPROFILE && USE_OPROFILE
   s_agent = op_open_agent();
@@ -55,6 +250,11 @@ void Init(const std::string& perf_dir)
     // if the event of a crash:
     std::setvbuf(s_perf_map_file.GetHandle(), nullptr, _IONBF, 0);
     s_is_enabled = true;
+
+#ifdef __linux__
+    if (jitdump)
+      OpenJitDump(dir);
+#endif
   }
 }
 
@@ -72,6 +272,10 @@ void Shutdown()
   if (s_perf_map_file.IsOpen())
     s_perf_map_file.Close();
 
+#ifdef __linux__
+  CloseJitDump();
+#endif
+
   s_is_enabled = false;
 }
 
@@ -80,7 +284,8 @@ bool IsEnabled()
   return s_is_enabled;
 }
 
-void RegisterV(const void* base_address, u32 code_size, const char* format, va_list args)
+void RegisterV(const void* base_address, u32 code_size, const std::vector<SourceLine>& lines,
+               const char* format, va_list args)
 {
 #if !(defined USE_OPROFILE && USE_OPROFILE) && !defined(USE_VTUNE)
   if (!s_perf_map_file.IsOpen())
@@ -109,5 +314,10 @@ void RegisterV(const void* base_address, u32 code_size, const char* format, va_l
         StringFromFormat("%" PRIx64 " %x %s\n", (u64)base_address, code_size, symbol_name.data());
     s_perf_map_file.WriteBytes(entry.data(), entry.size());
   }
+
+#ifdef __linux__
+  if (s_jitdump_file.IsOpen())
+    WriteJitDumpCode(base_address, code_size, lines, symbol_name);
+#endif
 }
 }
@@ -5,20 +5,33 @@
 #pragma once
 #include <stdarg.h>
 #include <string>
+#include <vector>
 #include "Common/CommonTypes.h"
 
 namespace JitRegister
 {
-void Init(const std::string& perf_dir);
+// Maps the host code starting at address to a line of a (guest) source file. Only used by the
+// perf jitdump output.
+struct SourceLine
+{
+  const void* address;
+  std::string file;
+  u32 line;
+};
+
+// perf_dir enables the /tmp/perf-PID.map output, and jitdump the jit-PID.dump output in the same
+// directory, which perf inject --jit turns into ELF images with the code and line information.
+void Init(const std::string& perf_dir, bool jitdump = false);
 void Shutdown();
-void RegisterV(const void* base_address, u32 code_size, const char* format, va_list args);
+void RegisterV(const void* base_address, u32 code_size, const std::vector<SourceLine>& lines,
+               const char* format, va_list args);
 bool IsEnabled();
 
 inline void Register(const void* base_address, u32 code_size, const char* format, ...)
 {
   va_list args;
   va_start(args, format);
-  RegisterV(base_address, code_size, format, args);
+  RegisterV(base_address, code_size, {}, format, args);
   va_end(args);
 }
 
@@ -27,7 +40,16 @@ inline void Register(const void* start, const void* end, const char* format, ...
   va_list args;
   va_start(args, format);
   u32 code_size = (u32)((const char*)end - (const char*)start);
-  RegisterV(start, code_size, format, args);
+  RegisterV(start, code_size, {}, format, args);
+  va_end(args);
+}
+
+inline void Register(const void* base_address, u32 code_size,
+                     const std::vector<SourceLine>& lines, const char* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  RegisterV(base_address, code_size, lines, format, args);
   va_end(args);
 }
 }
@@ -7,10 +7,12 @@
 #include <set>
 #include <string>
 
+#include "Common/Align.h"
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
 #include "Common/MsgHandler.h"
 #include "Common/StringUtil.h"
 
@@ -52,8 +54,9 @@ static int AshmemCreateFileMapping(const char* name, size_t size)
 }
 #endif
 
-void MemArena::GrabSHMSegment(size_t size)
+void MemArena::GrabSHMSegment(size_t size, bool huge_pages)
 {
+  m_huge_pages = huge_pages;
 #ifdef _WIN32
   const std::string name = "dolphin-emu." + std::to_string(GetCurrentProcessId());
   hMemoryMapping = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
@@ -102,10 +105,13 @@ void* MemArena::CreateView(s64 offset, size_t size, void* base)
     NOTICE_LOG(MEMMAP, "mmap failed");
     return nullptr;
   }
-  else
-  {
-    return retval;
-  }
+
+#ifdef MADV_HUGEPAGE
+  // Whether this has an effect depends on /sys/kernel/mm/transparent_hugepage/shmem_enabled.
+  if (m_huge_pages && size >= Common::HUGE_PAGE_SIZE)
+    madvise(retval, size, MADV_HUGEPAGE);
+#endif
+  return retval;
 #endif
 }
 
@@ -144,13 +150,15 @@ u8* MemArena::FindMemoryBase()
 #else
   const int flags = MAP_ANON | MAP_PRIVATE;
 #endif
-  void* base = mmap(nullptr, memory_size, PROT_NONE, flags, -1, 0);
+  // The base is aligned to the huge page size, so that the views can use huge pages.
+  void* base = mmap(nullptr, memory_size + Common::HUGE_PAGE_SIZE, PROT_NONE, flags, -1, 0);
   if (base == MAP_FAILED)
   {
     PanicAlert("Failed to map enough memory space: %s", LastStrerrorString().c_str());
     return nullptr;
   }
-  munmap(base, memory_size);
-  return static_cast<u8*>(base);
+  munmap(base, memory_size + Common::HUGE_PAGE_SIZE);
+  return reinterpret_cast<u8*>(
+      Common::AlignUp(reinterpret_cast<uintptr_t>(base), Common::HUGE_PAGE_SIZE));
 #endif
 }
@@ -20,7 +20,10 @@
 class MemArena
 {
 public:
-  void GrabSHMSegment(size_t size);
+  // With huge_pages, views of at least Common::HUGE_PAGE_SIZE ask for transparent huge pages.
+  // Explicit huge pages can't be used here, since views of them would have to be aligned to the
+  // huge page size.
+  void GrabSHMSegment(size_t size, bool huge_pages = false);
   void ReleaseSHMSegment();
   void* CreateView(s64 offset, size_t size, void* base = nullptr);
   void ReleaseView(void* view, size_t size);
@@ -34,4 +37,5 @@ private:
 #else
   int fd;
 #endif
+  bool m_huge_pages = false;
 };
@@ -4,8 +4,11 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <map>
+#include <mutex>
 #include <string>
 
+#include "Common/Align.h"
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
@@ -33,13 +36,56 @@ namespace Common
 // This is purposely not a full wrapper for virtualalloc/mmap, but it
 // provides exactly the primitive operations that Dolphin needs.
 
-void* AllocateExecutableMemory(size_t size)
+#if !defined(_WIN32)
+// Mappings of explicit huge pages can only be unmapped as a whole, so their real size has to be
+// remembered. Address -> size
+static std::mutex s_huge_page_mappings_lock;
+static std::map<void*, size_t> s_huge_page_mappings;
+
+static void* AllocateHugePages(size_t size, int prot)
+{
+#ifdef MAP_HUGETLB
+  const size_t huge_size = AlignUp(size, HUGE_PAGE_SIZE);
+  void* ptr = mmap(nullptr, huge_size, prot, MAP_ANON | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+  if (ptr != MAP_FAILED)
+  {
+    std::lock_guard<std::mutex> lk(s_huge_page_mappings_lock);
+    s_huge_page_mappings.emplace(ptr, huge_size);
+    return ptr;
+  }
+#endif
+
+#ifdef MADV_HUGEPAGE
+  // No huge pages are reserved. Transparent huge pages need the mapping to be aligned.
+  u8* reserved = static_cast<u8*>(
+      mmap(nullptr, size + HUGE_PAGE_SIZE, prot, MAP_ANON | MAP_PRIVATE, -1, 0));
+  if (reserved == MAP_FAILED)
+    return nullptr;
+
+  u8* aligned =
+      reinterpret_cast<u8*>(AlignUp(reinterpret_cast<uintptr_t>(reserved), HUGE_PAGE_SIZE));
+  if (aligned != reserved)
+    munmap(reserved, aligned - reserved);
+  munmap(aligned + size, reserved + HUGE_PAGE_SIZE - aligned);
+  if (madvise(aligned, size, MADV_HUGEPAGE) != 0)
+    WARN_LOG(MEMMAP, "madvise(MADV_HUGEPAGE) failed: %s", LastStrerrorString().c_str());
+  return aligned;
+#else
+  return nullptr;
+#endif
+}
+#endif
+
+void* AllocateExecutableMemory(size_t size, bool huge_pages)
 {
 #if defined(_WIN32)
+  // Large pages need the SeLockMemoryPrivilege on Windows, which we can't expect to have.
   void* ptr = VirtualAlloc(nullptr, size, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
 #else
-  void* ptr =
-      mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE, -1, 0);
+  const int prot = PROT_READ | PROT_WRITE | PROT_EXEC;
+  void* ptr = huge_pages ? AllocateHugePages(size, prot) : nullptr;
+  if (!ptr)
+    ptr = mmap(nullptr, size, prot, MAP_ANON | MAP_PRIVATE, -1, 0);
 
   if (ptr == MAP_FAILED)
     ptr = nullptr;
@@ -92,6 +138,15 @@ void FreeMemoryPages(void* ptr, size_t size)
     if (!VirtualFree(ptr, 0, MEM_RELEASE))
       PanicAlert("FreeMemoryPages failed!\nVirtualFree: %s", GetLastErrorString().c_str());
 #else
+    {
+      std::lock_guard<std::mutex> lk(s_huge_page_mappings_lock);
+      const auto it = s_huge_page_mappings.find(ptr);
+      if (it != s_huge_page_mappings.end())
+      {
+        size = it->second;
+        s_huge_page_mappings.erase(it);
+      }
+    }
     if (munmap(ptr, size) != 0)
       PanicAlert("FreeMemoryPages failed!\nmunmap: %s", LastStrerrorString().c_str());
 #endif
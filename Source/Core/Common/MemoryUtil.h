@@ -9,7 +9,12 @@
 
 namespace Common
 {
-void* AllocateExecutableMemory(size_t size);
+constexpr size_t HUGE_PAGE_SIZE = 0x200000;
+
+// With huge_pages, the memory is backed by huge pages where the host allows it: explicitly
+// reserved ones (MAP_HUGETLB) if there are any, otherwise transparent huge pages. This is only a
+// hint; the allocation falls back to normal pages.
+void* AllocateExecutableMemory(size_t size, bool huge_pages = false);
 void* AllocateMemoryPages(size_t size);
 void FreeMemoryPages(void* ptr, size_t size);
 void* AllocateAlignedMemory(size_t size, size_t alignment);
@@ -0,0 +1,64 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Common/PerfEventCounter.h"
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Common/CommonFuncs.h"
+#include "Common/Logging/Log.h"
+
+namespace Common
+{
+#if defined(__linux__)
+PerfEventCounter::PerfEventCounter(Event event)
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  const u64 cache = event == Event::DataTLBMisses ? PERF_COUNT_HW_CACHE_DTLB :
+                                                    PERF_COUNT_HW_CACHE_ITLB;
+  attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  // The calling thread, on any CPU.
+  m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  if (m_fd < 0)
+    INFO_LOG(COMMON, "perf_event_open failed: %s", LastStrerrorString().c_str());
+}
+
+PerfEventCounter::~PerfEventCounter()
+{
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+u64 PerfEventCounter::Read() const
+{
+  u64 count = 0;
+  if (m_fd < 0 || read(m_fd, &count, sizeof(count)) != sizeof(count))
+    return 0;
+  return count;
+}
+#else
+PerfEventCounter::PerfEventCounter(Event event)
+{
+}
+
+PerfEventCounter::~PerfEventCounter() = default;
+
+u64 PerfEventCounter::Read() const
+{
+  return 0;
+}
+#endif
+}  // namespace Common
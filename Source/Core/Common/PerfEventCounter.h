@@ -0,0 +1,36 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+namespace Common
+{
+// Counts a hardware event for the calling thread using the kernel's perf events. Only supported
+// on Linux; elsewhere, or if the kernel or CPU doesn't expose the event, the counter is invalid
+// and always reads 0.
+class PerfEventCounter final
+{
+public:
+  enum class Event
+  {
+    DataTLBMisses,
+    InstructionTLBMisses,
+  };
+
+  explicit PerfEventCounter(Event event);
+  ~PerfEventCounter();
+
+  PerfEventCounter(const PerfEventCounter&) = delete;
+  PerfEventCounter& operator=(const PerfEventCounter&) = delete;
+
+  bool IsValid() const { return m_fd >= 0; }
+  // Returns the number of events since the counter was created.
+  u64 Read() const;
+
+private:
+  int m_fd = -1;
+};
+}  // namespace Common
@@ -40,7 +40,6 @@ public:
     m_wakeup.Set();
   }
 
-private:
   void Shutdown()
   {
     if (m_thread.joinable())
@@ -51,6 +50,7 @@ private:
     }
   }
 
+private:
   void ThreadLoop()
   {
     while (true)
@@ -64,7 +64,7 @@ private:
           std::unique_lock<std::mutex> lg(m_lock);
           if (m_items.empty())
             break;
-          item = m_items.front();
+          item = std::move(m_items.front());
           m_items.pop();
         }
         m_function(std::move(item));
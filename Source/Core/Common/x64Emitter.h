@@ -370,11 +370,13 @@ private:
   void WriteSSSE3Op(u8 opPrefix, u16 op, X64Reg regOp, const OpArg& arg, int extrabytes = 0);
   void WriteSSE41Op(u8 opPrefix, u16 op, X64Reg regOp, const OpArg& arg, int extrabytes = 0);
   void WriteVEXOp(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg, int W = 0,
-                  int extrabytes = 0);
+                  int extrabytes = 0, int L = 0);
   void WriteVEXOp4(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
                    X64Reg regOp3, int W = 0);
   void WriteAVXOp(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg, int W = 0,
-                  int extrabytes = 0);
+                  int extrabytes = 0, int L = 0);
+  void WriteAVX2Op(int bits, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
+                   int W = 0, int extrabytes = 0);
   void WriteAVXOp4(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
                    X64Reg regOp3, int W = 0);
   void WriteFMA3Op(u8 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg, int W = 0);
@@ -870,6 +872,7 @@ public:
   void BLENDPD(X64Reg dest, const OpArg& arg, u8 blend);
 
   // AVX
+  void VMULPS(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
   void VADDSD(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
   void VSUBSD(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
   void VMULSD(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
@@ -899,6 +902,26 @@ public:
   void VPOR(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
   void VPXOR(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
 
+  // VEX encoded moves, which don't mix legacy SSE into AVX code.
+  void VMOVD_xmm(X64Reg dest, const OpArg& arg);
+  void VMOVQ_xmm(X64Reg dest, const OpArg& arg);
+  void VMOVDQU(X64Reg dest, const OpArg& arg);
+  void VMOVSS(const OpArg& arg, X64Reg src);
+  void VMOVLPS(const OpArg& arg, X64Reg src);
+  void VMOVUPS(const OpArg& arg, X64Reg src);
+  void VEXTRACTPS(const OpArg& arg, X64Reg src, u8 subreg);
+  void VZEROUPPER();
+
+  // 256-bit instructions; bits selects between the 128-bit and the 256-bit form.
+  void VMULPS(int bits, X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
+  void VCVTDQ2PS(int bits, X64Reg regOp1, const OpArg& arg);
+
+  // AVX2
+  void VPSHUFB(int bits, X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
+  void VPSRAD(int bits, X64Reg regOp1, X64Reg regOp2, u8 shift);
+  void VINSERTI128(X64Reg regOp1, X64Reg regOp2, const OpArg& arg, u8 lane);
+  void VEXTRACTI128(const OpArg& arg, X64Reg src, u8 lane);
+
   // FMA3
   void VFMADD132PS(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
   void VFMADD213PS(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
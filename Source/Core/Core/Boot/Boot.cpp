@@ -23,6 +23,7 @@
 #include "Common/Config/Config.h"
 #include "Common/File.h"
 #include "Common/FileUtil.h"
+#include "Common/Hash.h"
 #include "Common/Logging/Log.h"
 #include "Common/MsgHandler.h"
 #include "Common/StringUtil.h"
@@ -41,10 +42,12 @@
 #include "Core/Host.h"
 #include "Core/IOS/IOS.h"
 #include "Core/PatchEngine.h"
+#include "Core/PowerPC/JitInterface.h"
 #include "Core/PowerPC/PPCAnalyst.h"
 #include "Core/PowerPC/PPCSymbolDB.h"
 #include "Core/PowerPC/PowerPC.h"
 
+#include "DiscIO/DiscExtractor.h"
 #include "DiscIO/Enums.h"
 #include "DiscIO/Volume.h"
 
@@ -275,6 +278,36 @@ bool CBoot::Load_BS2(const std::string& boot_rom_filename)
   return true;
 }
 
+// The JIT's hot block profile is only valid for the executable it was recorded with.
+static void LoadHotBlockProfile(const DiscIO::Volume& volume)
+{
+  const DiscIO::Partition partition = volume.GetGamePartition();
+  const std::optional<u64> dol_offset = DiscIO::GetBootDOLOffset(volume, partition);
+  if (!dol_offset)
+    return;
+  const std::optional<u32> dol_size = DiscIO::GetBootDOLSize(volume, partition, *dol_offset);
+  if (!dol_size)
+    return;
+
+  std::vector<u8> dol(*dol_size);
+  if (!volume.Read(*dol_offset, *dol_size, dol.data(), partition))
+    return;
+
+  JitInterface::LoadHotBlockProfile(SConfig::GetInstance().GetGameID(),
+                                    HashAdler32(dol.data(), dol.size()));
+}
+
+static void LoadHotBlockProfile(const std::string& executable_path)
+{
+  std::string executable;
+  if (!File::ReadFileToString(executable_path, executable))
+    return;
+
+  JitInterface::LoadHotBlockProfile(
+      SConfig::GetInstance().GetGameID(),
+      HashAdler32(reinterpret_cast<const u8*>(executable.data()), executable.size()));
+}
+
 static void SetDefaultDisc()
 {
   const SConfig& config = SConfig::GetInstance();
@@ -307,6 +340,9 @@ bool CBoot::BootUp(std::unique_ptr<BootParameters> boot)
       if (!EmulatedBS2(config.bWii, *volume))
         return false;
 
+      if (config.bJITHotBlockProfile)
+        LoadHotBlockProfile(*volume);
+
       // Try to load the symbol map if there is one, and then scan it for
       // and eventually replace code
       if (LoadMapFromFilename())
@@ -348,6 +384,9 @@ bool CBoot::BootUp(std::unique_ptr<BootParameters> boot)
 
       PC = executable.reader->GetEntryPoint();
 
+      if (config.bJITHotBlockProfile)
+        LoadHotBlockProfile(executable.path);
+
       if (executable.reader->LoadSymbols() || LoadMapFromFilename())
       {
         UpdateDebugger_MapLoaded();
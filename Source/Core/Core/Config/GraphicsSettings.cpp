@@ -138,6 +138,8 @@ const ConfigInfo<bool> GFX_HACK_COPY_EFB_ENABLED{{System::GFX, "Hacks", "EFBScal
 const ConfigInfo<bool> GFX_HACK_EFB_EMULATE_FORMAT_CHANGES{
     {System::GFX, "Hacks", "EFBEmulateFormatChanges"}, false};
 const ConfigInfo<bool> GFX_HACK_VERTEX_ROUDING{{System::GFX, "Hacks", "VertexRounding"}, false};
+const ConfigInfo<bool> GFX_HACK_DISPLAY_LIST_CACHE{{System::GFX, "Hacks", "DisplayListCache"},
+                                                  false};
 
 // Graphics.GameSpecific
 
@@ -104,6 +104,7 @@ extern const ConfigInfo<bool> GFX_HACK_IMMEDIATE_XFB;
 extern const ConfigInfo<bool> GFX_HACK_COPY_EFB_ENABLED;
 extern const ConfigInfo<bool> GFX_HACK_EFB_EMULATE_FORMAT_CHANGES;
 extern const ConfigInfo<bool> GFX_HACK_VERTEX_ROUDING;
+extern const ConfigInfo<bool> GFX_HACK_DISPLAY_LIST_CACHE;
 
 // Graphics.GameSpecific
 
@@ -76,7 +76,7 @@ bool IsSettingSaveable(const Config::ConfigLocation& config_location)
       Config::GFX_HACK_SKIP_XFB_COPY_TO_RAM.location, Config::GFX_HACK_IMMEDIATE_XFB.location,
       Config::GFX_HACK_COPY_EFB_ENABLED.location,
       Config::GFX_HACK_EFB_EMULATE_FORMAT_CHANGES.location,
-      Config::GFX_HACK_VERTEX_ROUDING.location,
+      Config::GFX_HACK_VERTEX_ROUDING.location, Config::GFX_HACK_DISPLAY_LIST_CACHE.location,
 
       // Graphics.GameSpecific
 
@@ -238,6 +238,15 @@ void SConfig::SaveCoreSettings(IniFile& ini)
   core->Set("TimingVariance", iTimingVariance);
   core->Set("CPUCore", iCPUCore);
   core->Set("Fastmem", bFastmem);
+  core->Set("HugePages", bHugePages);
+  core->Set("DirtyPageTracking", bDirtyPageTracking);
+  core->Set("Rewind", bRewind);
+  core->Set("RewindInterval", iRewindInterval);
+  core->Set("RewindMemory", iRewindMemory);
+  core->Set("JITBackgroundCompile", bJITBackgroundCompile);
+  core->Set("JITHotBlockProfile", bJITHotBlockProfile);
+  core->Set("JITTieredCompilation", bJITTieredCompilation);
+  core->Set("JITPartialEviction", bJITPartialEviction);
   core->Set("CPUThread", bCPUThread);
   core->Set("DSPHLE", bDSPHLE);
   core->Set("SyncOnSkipIdle", bSyncGPUOnSkipIdleHack);
@@ -245,6 +254,7 @@ void SConfig::SaveCoreSettings(IniFile& ini)
   core->Set("SyncGpuMaxDistance", iSyncGpuMaxDistance);
   core->Set("SyncGpuMinDistance", iSyncGpuMinDistance);
   core->Set("SyncGpuOverclock", fSyncGpuOverclock);
+  core->Set("PipelinedGPU", bPipelinedGPU);
   core->Set("FPRF", bFPRF);
   core->Set("AccurateNaNs", bAccurateNaNs);
   core->Set("DefaultISO", m_strDefaultISO);
@@ -282,6 +292,8 @@ void SConfig::SaveCoreSettings(IniFile& ini)
   core->Set("GFXBackend", m_strVideoBackend);
   core->Set("GPUDeterminismMode", m_strGPUDeterminismMode);
   core->Set("PerfMapDir", m_perfDir);
+  core->Set("PerfJitDump", bPerfJitDump);
+  core->Set("SamplingProfiler", bSamplingProfiler);
   core->Set("EnableCustomRTC", bEnableCustomRTC);
   core->Set("CustomRTCValue", m_customRTCValue);
   core->Set("EnableSignatureChecks", m_enable_signature_checks);
@@ -524,6 +536,15 @@ void SConfig::LoadCoreSettings(IniFile& ini)
   core->Get("CPUCore", &iCPUCore, PowerPC::CORE_INTERPRETER);
 #endif
   core->Get("Fastmem", &bFastmem, true);
+  core->Get("HugePages", &bHugePages, false);
+  core->Get("DirtyPageTracking", &bDirtyPageTracking, false);
+  core->Get("Rewind", &bRewind, false);
+  core->Get("RewindInterval", &iRewindInterval, 30);
+  core->Get("RewindMemory", &iRewindMemory, 512);
+  core->Get("JITBackgroundCompile", &bJITBackgroundCompile, false);
+  core->Get("JITHotBlockProfile", &bJITHotBlockProfile, false);
+  core->Get("JITTieredCompilation", &bJITTieredCompilation, false);
+  core->Get("JITPartialEviction", &bJITPartialEviction, false);
   core->Get("DSPHLE", &bDSPHLE, true);
   core->Get("TimingVariance", &iTimingVariance, 40);
   core->Get("CPUThread", &bCPUThread, true);
@@ -563,6 +584,7 @@ void SConfig::LoadCoreSettings(IniFile& ini)
   core->Get("SyncGpuMaxDistance", &iSyncGpuMaxDistance, 200000);
   core->Get("SyncGpuMinDistance", &iSyncGpuMinDistance, -200000);
   core->Get("SyncGpuOverclock", &fSyncGpuOverclock, 1.0f);
+  core->Get("PipelinedGPU", &bPipelinedGPU, false);
   core->Get("FastDiscSpeed", &bFastDiscSpeed, false);
   core->Get("DCBZ", &bDCBZOFF, false);
   core->Get("LowDCBZHack", &bLowDCBZHack, false);
@@ -575,6 +597,8 @@ void SConfig::LoadCoreSettings(IniFile& ini)
   core->Get("GFXBackend", &m_strVideoBackend, "");
   core->Get("GPUDeterminismMode", &m_strGPUDeterminismMode, "auto");
   core->Get("PerfMapDir", &m_perfDir, "");
+  core->Get("PerfJitDump", &bPerfJitDump, false);
+  core->Get("SamplingProfiler", &bSamplingProfiler, false);
   core->Get("EnableCustomRTC", &bEnableCustomRTC, false);
   // Default to seconds between 1.1.1970 and 1.1.2000
   core->Get("CustomRTCValue", &m_customRTCValue, 946684800);
@@ -770,6 +794,11 @@ void SConfig::LoadDefaults()
   bRunCompareServer = false;
   bDSPHLE = true;
   bFastmem = true;
+  bHugePages = false;
+  bDirtyPageTracking = false;
+  bRewind = false;
+  iRewindInterval = 30;
+  iRewindMemory = 512;
   bFPRF = false;
   bAccurateNaNs = false;
   bMMU = false;
@@ -777,6 +806,7 @@ void SConfig::LoadDefaults()
   bLowDCBZHack = false;
   iBBDumpPort = -1;
   bSyncGPU = false;
+  bPipelinedGPU = false;
   bFastDiscSpeed = false;
   m_strWiiSDCardPath = File::GetUserPath(F_WIISDCARD_IDX);
   bEnableMemcardSdWriting = true;
@@ -91,8 +91,17 @@ struct SConfig
   bool bJITPairedOff = false;
   bool bJITSystemRegistersOff = false;
   bool bJITBranchOff = false;
+  bool bJITBackgroundCompile = false;
+  bool bJITHotBlockProfile = false;
+  bool bJITTieredCompilation = false;
+  bool bJITPartialEviction = false;
 
   bool bFastmem;
+  bool bHugePages = false;
+  bool bDirtyPageTracking = false;
+  bool bRewind = false;
+  int iRewindInterval = 30;
+  int iRewindMemory = 512;
   bool bFPRF = false;
   bool bAccurateNaNs = false;
 
@@ -125,6 +134,10 @@ struct SConfig
   int iSyncGpuMinDistance;
   float fSyncGpuOverclock;
 
+  // Splits the GPU thread into a FIFO decoding thread and a backend thread in dual core mode.
+  // The decoding thread runs ahead, but waits for the backend thread at PE tokens and finishes.
+  bool bPipelinedGPU = false;
+
   int SelectedLanguage = 0;
   bool bOverrideGCLanguage = false;
 
@@ -189,6 +202,8 @@ struct SConfig
   std::string m_strWiiSDCardPath;
 
   std::string m_perfDir;
+  bool bPerfJitDump = false;
+  bool bSamplingProfiler = false;
 
   std::string m_debugger_game_id;
   // TODO: remove this as soon as the ticket view hack in IOS/ES/Views is dropped.
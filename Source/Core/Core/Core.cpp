@@ -5,6 +5,7 @@
 #include "Core/Core.h"
 
 #include <atomic>
+#include <cinttypes>
 #include <cstring>
 #include <locale>
 #include <mutex>
@@ -27,6 +28,7 @@
 #include "Common/Logging/LogManager.h"
 #include "Common/MemoryUtil.h"
 #include "Common/MsgHandler.h"
+#include "Common/PerfEventCounter.h"
 #include "Common/ScopeGuard.h"
 #include "Common/StringUtil.h"
 #include "Common/Thread.h"
@@ -51,6 +53,7 @@
 #include "Core/HW/GCKeyboard.h"
 #include "Core/HW/GCPad.h"
 #include "Core/HW/HW.h"
+#include "Core/HW/Memmap.h"
 #include "Core/HW/SystemTimers.h"
 #include "Core/HW/VideoInterface.h"
 #include "Core/HW/Wiimote.h"
@@ -349,8 +352,10 @@ static void CpuThread()
   // This needs to be delayed until after the video backend is ready.
   DolphinAnalytics::Instance()->ReportGameStart();
 
-  if (_CoreParameter.bFastmem)
+  if (_CoreParameter.bFastmem || _CoreParameter.bDirtyPageTracking)
     EMM::InstallExceptionHandler();  // Let's run under memory watch
+  if (_CoreParameter.bDirtyPageTracking && !Memory::EnableDirtyPageTracking())
+    WARN_LOG(CORE, "Dirty page tracking is not supported on this platform.");
 
   if (!s_state_filename.empty())
   {
@@ -388,15 +393,27 @@ static void CpuThread()
   MemoryWatcher::Init();
 #endif
 
+  // Lets benchmark runs compare the effect of huge pages, if the host allows reading the counters.
+  Common::PerfEventCounter dtlb_misses(Common::PerfEventCounter::Event::DataTLBMisses);
+  Common::PerfEventCounter itlb_misses(Common::PerfEventCounter::Event::InstructionTLBMisses);
+
   // Enter CPU run loop. When we leave it - we are done.
   CPU::Run();
 
   s_is_started = false;
 
+  if (dtlb_misses.IsValid() && itlb_misses.IsValid())
+  {
+    NOTICE_LOG(CORE, "CPU thread TLB misses: %" PRIu64 " data, %" PRIu64 " instruction",
+               dtlb_misses.Read(), itlb_misses.Read());
+    NOTICE_LOG(CORE, "Huge pages: %s", _CoreParameter.bHugePages ? "on" : "off");
+  }
+
   if (!_CoreParameter.bCPUThread)
     g_video_backend->Video_CleanupShared();
 
-  if (_CoreParameter.bFastmem)
+  Memory::DisableDirtyPageTracking();
+  if (_CoreParameter.bFastmem || _CoreParameter.bDirtyPageTracking)
     EMM::UninstallExceptionHandler();
 }
 
@@ -5,16 +5,18 @@
 #include "Core/CoreTiming.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cinttypes>
-#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "Common/Assert.h"
+#include "Common/BitSet.h"
 #include "Common/ChunkFile.h"
 #include "Common/Logging/Log.h"
-#include "Common/SPSCQueue.h"
 #include "Common/StringUtil.h"
 #include "Common/Thread.h"
 
@@ -27,10 +29,16 @@
 
 namespace CoreTiming
 {
+// Index into s_nodes.
+using NodeIndex = u32;
+static constexpr NodeIndex INVALID_NODE = UINT32_MAX;
+
 struct EventType
 {
   TimedCallback callback;
   const std::string* name;
+  // Pending events of this type, so RemoveEvent doesn't have to search the whole queue.
+  NodeIndex first_pending;
 };
 
 struct Event
@@ -42,10 +50,6 @@ struct Event
 };
 
 // Sort by time, unless the times are the same, in which case sort by the order added to the queue
-static bool operator>(const Event& left, const Event& right)
-{
-  return std::tie(left.time, left.fifo_order) > std::tie(right.time, right.fifo_order);
-}
 static bool operator<(const Event& left, const Event& right)
 {
   return std::tie(left.time, left.fifo_order) < std::tie(right.time, right.fifo_order);
@@ -54,16 +58,58 @@ static bool operator<(const Event& left, const Event& right)
 // unordered_map stores each element separately as a linked list node so pointers to elements
 // remain stable regardless of rehashes/resizing.
 static std::unordered_map<std::string, EventType> s_event_types;
+static std::unordered_set<const EventType*> s_registered_types;
 
 // STATE_TO_SAVE
-// The queue is a min-heap using std::make_heap/push_heap/pop_heap.
-// We don't use std::priority_queue because we need to be able to serialize, unserialize and
-// erase arbitrary events (RemoveEvent()) regardless of the queue order. These aren't accomodated
-// by the standard adaptor class.
-static std::vector<Event> s_event_queue;
+// The queue is a hierarchical timing wheel. Time is divided into ticks of 2^TICK_SHIFT cycles,
+// which are grouped into pages of WHEEL_SIZE ticks, which are grouped into superpages of
+// WHEEL_SIZE pages. Relative to the cursor (the tick of the last Advance()):
+// - level 0 has one bucket per tick of the current page,
+// - level 1 has one bucket per page of the current superpage,
+// - everything further in the future is in a single overflow bucket.
+// Events in the past go into the cursor's bucket. As the cursor moves, the buckets of the new
+// page and superpage are redistributed to the lower level. Buckets are unordered lists, so the
+// next event is found by scanning the first non-empty bucket for the lowest (time, fifo_order),
+// which keeps the exact order of a priority queue. Inserting and removing events is O(1).
+static constexpr u32 TICK_SHIFT = 10;
+static constexpr u32 WHEEL_SHIFT = 8;
+static constexpr u32 WHEEL_SIZE = 1 << WHEEL_SHIFT;
+static constexpr u32 LEVEL1_BUCKETS = WHEEL_SIZE;
+static constexpr u32 OVERFLOW_BUCKET = 2 * WHEEL_SIZE;
+static constexpr u32 NUM_BUCKETS = OVERFLOW_BUCKET + 1;
+static constexpr u32 FREE_NODE = UINT32_MAX;
+
+struct Node
+{
+  Event event;
+  NodeIndex prev;
+  NodeIndex next;
+  NodeIndex type_prev;
+  NodeIndex type_next;
+  u32 bucket;
+};
+
+// Nodes are addressed by index, as callbacks may schedule events and grow the pool.
+static std::vector<Node> s_nodes;
+static std::vector<NodeIndex> s_free_nodes;
+static std::array<NodeIndex, NUM_BUCKETS> s_buckets = [] {
+  std::array<NodeIndex, NUM_BUCKETS> buckets;
+  buckets.fill(INVALID_NODE);
+  return buckets;
+}();
+static std::array<u64, WHEEL_SIZE / 64> s_level0_mask;
+static std::array<u64, WHEEL_SIZE / 64> s_level1_mask;
+static s64 s_cursor;
 static u64 s_event_fifo_id;
-static std::mutex s_ts_write_lock;
-static Common::SPSCQueue<Event, false> s_ts_queue;
+
+// Events scheduled from other threads are pushed onto a lock-free stack, which the CPU thread
+// takes as a whole and reverses into the order they were pushed in.
+struct InboxNode
+{
+  Event event;
+  InboxNode* next;
+};
+static std::atomic<InboxNode*> s_inbox{nullptr};
 
 static float s_last_OC_factor;
 static constexpr int MAX_SLICE_LENGTH = 20000;
@@ -100,6 +146,188 @@ static int CyclesToDowncount(int cycles)
   return static_cast<int>(cycles * s_last_OC_factor);
 }
 
+static void UpdateBucketMask(u32 bucket)
+{
+  if (bucket == OVERFLOW_BUCKET)
+    return;
+
+  auto& mask = bucket < LEVEL1_BUCKETS ? s_level0_mask : s_level1_mask;
+  const u32 bit = bucket % WHEEL_SIZE;
+  if (s_buckets[bucket] != INVALID_NODE)
+    mask[bit / 64] |= 1ULL << (bit % 64);
+  else
+    mask[bit / 64] &= ~(1ULL << (bit % 64));
+}
+
+// Puts a node into the bucket for its time, relative to the current cursor.
+static void LinkNode(NodeIndex index)
+{
+  Node& node = s_nodes[index];
+  const s64 tick = std::max(node.event.time >> TICK_SHIFT, s_cursor);
+  if ((tick >> WHEEL_SHIFT) == (s_cursor >> WHEEL_SHIFT))
+    node.bucket = static_cast<u32>(tick & (WHEEL_SIZE - 1));
+  else if ((tick >> (2 * WHEEL_SHIFT)) == (s_cursor >> (2 * WHEEL_SHIFT)))
+    node.bucket = LEVEL1_BUCKETS + static_cast<u32>((tick >> WHEEL_SHIFT) & (WHEEL_SIZE - 1));
+  else
+    node.bucket = OVERFLOW_BUCKET;
+
+  node.prev = INVALID_NODE;
+  node.next = s_buckets[node.bucket];
+  if (node.next != INVALID_NODE)
+    s_nodes[node.next].prev = index;
+  s_buckets[node.bucket] = index;
+  UpdateBucketMask(node.bucket);
+}
+
+static void UnlinkNode(NodeIndex index)
+{
+  const Node& node = s_nodes[index];
+  if (node.prev != INVALID_NODE)
+    s_nodes[node.prev].next = node.next;
+  else
+    s_buckets[node.bucket] = node.next;
+  if (node.next != INVALID_NODE)
+    s_nodes[node.next].prev = node.prev;
+  UpdateBucketMask(node.bucket);
+}
+
+static void AddEvent(const Event& event)
+{
+  NodeIndex index;
+  if (!s_free_nodes.empty())
+  {
+    index = s_free_nodes.back();
+    s_free_nodes.pop_back();
+  }
+  else
+  {
+    index = static_cast<NodeIndex>(s_nodes.size());
+    s_nodes.emplace_back();
+  }
+
+  Node& node = s_nodes[index];
+  node.event = event;
+  node.type_prev = INVALID_NODE;
+  node.type_next = event.type->first_pending;
+  if (node.type_next != INVALID_NODE)
+    s_nodes[node.type_next].type_prev = index;
+  event.type->first_pending = index;
+  LinkNode(index);
+}
+
+static void DeleteEvent(NodeIndex index)
+{
+  UnlinkNode(index);
+
+  Node& node = s_nodes[index];
+  if (node.type_prev != INVALID_NODE)
+    s_nodes[node.type_prev].type_next = node.type_next;
+  else
+    node.event.type->first_pending = node.type_next;
+  if (node.type_next != INVALID_NODE)
+    s_nodes[node.type_next].type_prev = node.type_prev;
+
+  node.bucket = FREE_NODE;
+  s_free_nodes.push_back(index);
+}
+
+static void RelinkBucket(u32 bucket)
+{
+  NodeIndex index = s_buckets[bucket];
+  if (index == INVALID_NODE)
+    return;
+
+  s_buckets[bucket] = INVALID_NODE;
+  UpdateBucketMask(bucket);
+  while (index != INVALID_NODE)
+  {
+    const NodeIndex next = s_nodes[index].next;
+    LinkNode(index);
+    index = next;
+  }
+}
+
+// Moves the cursor to the tick of the global timer. Everything up to the global timer has run by
+// then, so only the bucket of the new page (or the overflow bucket, for a new superpage) has to
+// be cascaded. The other skipped buckets are relinked too in case they aren't empty, which is
+// cheap as this only happens once per page.
+static void AdvanceCursor()
+{
+  const s64 old_page = s_cursor >> WHEEL_SHIFT;
+  s_cursor = std::max(g.global_timer >> TICK_SHIFT, s_cursor);
+  const s64 new_page = s_cursor >> WHEEL_SHIFT;
+  if (new_page == old_page)
+    return;
+
+  for (u32 i = 0; i < WHEEL_SIZE; i++)
+    RelinkBucket(i);
+
+  if ((new_page >> WHEEL_SHIFT) == (old_page >> WHEEL_SHIFT))
+  {
+    for (s64 page = old_page + 1; page <= new_page; page++)
+      RelinkBucket(LEVEL1_BUCKETS + static_cast<u32>(page & (WHEEL_SIZE - 1)));
+  }
+  else
+  {
+    for (u32 i = 0; i < WHEEL_SIZE; i++)
+      RelinkBucket(LEVEL1_BUCKETS + i);
+    RelinkBucket(OVERFLOW_BUCKET);
+  }
+}
+
+static NodeIndex FindFirstInBucket(u32 bucket)
+{
+  NodeIndex first = s_buckets[bucket];
+  for (NodeIndex i = s_nodes[first].next; i != INVALID_NODE; i = s_nodes[i].next)
+  {
+    if (s_nodes[i].event < s_nodes[first].event)
+      first = i;
+  }
+  return first;
+}
+
+template <size_t N>
+static int FindFirstBucket(const std::array<u64, N>& mask)
+{
+  for (size_t i = 0; i < N; i++)
+  {
+    if (mask[i] != 0)
+      return static_cast<int>(i * 64) + LeastSignificantSetBit(mask[i]);
+  }
+  return -1;
+}
+
+// Returns the node of the event that runs next, or INVALID_NODE if there are no events.
+static NodeIndex FindNextEvent()
+{
+  int bucket = FindFirstBucket(s_level0_mask);
+  if (bucket >= 0)
+    return FindFirstInBucket(static_cast<u32>(bucket));
+
+  bucket = FindFirstBucket(s_level1_mask);
+  if (bucket >= 0)
+    return FindFirstInBucket(LEVEL1_BUCKETS + static_cast<u32>(bucket));
+
+  if (s_buckets[OVERFLOW_BUCKET] != INVALID_NODE)
+    return FindFirstInBucket(OVERFLOW_BUCKET);
+
+  return INVALID_NODE;
+}
+
+// Returns the pending events in the order they will run.
+static std::vector<Event> GetPendingEvents()
+{
+  std::vector<Event> events;
+  events.reserve(s_nodes.size() - s_free_nodes.size());
+  for (const Node& node : s_nodes)
+  {
+    if (node.bucket != FREE_NODE)
+      events.push_back(node.event);
+  }
+  std::sort(events.begin(), events.end());
+  return events;
+}
+
 EventType* RegisterEvent(const std::string& name, TimedCallback callback)
 {
   // check for existing type with same name.
@@ -109,16 +337,19 @@ EventType* RegisterEvent(const std::string& name, TimedCallback callback)
                "during Init to avoid breaking save states.",
                name.c_str());
 
-  auto info = s_event_types.emplace(name, EventType{callback, nullptr});
+  auto info = s_event_types.emplace(name, EventType{callback, nullptr, INVALID_NODE});
   EventType* event_type = &info.first->second;
   event_type->name = &info.first->first;
+  s_registered_types.insert(event_type);
   return event_type;
 }
 
 void UnregisterAllEvents()
 {
-  _assert_msg_(POWERPC, s_event_queue.empty(), "Cannot unregister events with events pending");
+  _assert_msg_(POWERPC, s_nodes.size() == s_free_nodes.size(),
+               "Cannot unregister events with events pending");
   s_event_types.clear();
+  s_registered_types.clear();
 }
 
 void Init()
@@ -136,13 +367,13 @@ void Init()
   // that slice.
   s_is_global_timer_sane = true;
 
+  s_cursor = 0;
   s_event_fifo_id = 0;
   s_ev_lost = RegisterEvent("_lost_event", &EmptyTimedCallback);
 }
 
 void Shutdown()
 {
-  std::lock_guard<std::mutex> lk(s_ts_write_lock);
   MoveEvents();
   ClearPendingEvents();
   UnregisterAllEvents();
@@ -150,7 +381,6 @@ void Shutdown()
 
 void DoState(PointerWrap& p)
 {
-  std::lock_guard<std::mutex> lk(s_ts_write_lock);
   p.Do(g.slice_length);
   p.Do(g.global_timer);
   p.Do(s_idled_cycles);
@@ -165,7 +395,10 @@ void DoState(PointerWrap& p)
   p.DoMarker("CoreTimingData");
 
   MoveEvents();
-  p.DoEachElement(s_event_queue, [](PointerWrap& pw, Event& ev) {
+  std::vector<Event> events;
+  if (p.GetMode() != PointerWrap::MODE_READ)
+    events = GetPendingEvents();
+  p.DoEachElement(events, [](PointerWrap& pw, Event& ev) {
     pw.Do(ev.time);
     pw.Do(ev.fifo_order);
 
@@ -198,11 +431,13 @@ void DoState(PointerWrap& p)
   });
   p.DoMarker("CoreTimingEvents");
 
-  // When loading from a save state, we must assume the Event order is random and meaningless.
-  // The exact layout of the heap in memory is implementation defined, therefore it is platform
-  // and library version specific.
+  // The events keep their fifo_order, so they run in the same order as before saving.
   if (p.GetMode() == PointerWrap::MODE_READ)
-    std::make_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+  {
+    ClearPendingEvents();
+    for (const Event& ev : events)
+      AddEvent(ev);
+  }
 }
 
 // This should only be called from the CPU thread. If you are calling
@@ -225,7 +460,14 @@ u64 GetIdleTicks()
 
 void ClearPendingEvents()
 {
-  s_event_queue.clear();
+  s_nodes.clear();
+  s_free_nodes.clear();
+  s_buckets.fill(INVALID_NODE);
+  s_level0_mask.fill(0);
+  s_level1_mask.fill(0);
+  s_cursor = g.global_timer >> TICK_SHIFT;
+  for (auto& entry : s_event_types)
+    entry.second.first_pending = INVALID_NODE;
 }
 
 void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata, FromThread from)
@@ -253,8 +495,7 @@ void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata,
     if (!s_is_global_timer_sane)
       ForceExceptionCheck(cycles_into_future);
 
-    s_event_queue.emplace_back(Event{timeout, s_event_fifo_id++, userdata, event_type});
-    std::push_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+    AddEvent(Event{timeout, s_event_fifo_id++, userdata, event_type});
   }
   else
   {
@@ -265,22 +506,24 @@ void ScheduleEvent(s64 cycles_into_future, EventType* event_type, u64 userdata,
                 event_type->name->c_str());
     }
 
-    std::lock_guard<std::mutex> lk(s_ts_write_lock);
-    s_ts_queue.Push(Event{g.global_timer + cycles_into_future, 0, userdata, event_type});
+    auto* node = new InboxNode{Event{g.global_timer + cycles_into_future, 0, userdata, event_type},
+                               s_inbox.load(std::memory_order_relaxed)};
+    while (!s_inbox.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                          std::memory_order_relaxed))
+    {
+    }
   }
 }
 
 void RemoveEvent(EventType* event_type)
 {
-  auto itr = std::remove_if(s_event_queue.begin(), s_event_queue.end(),
-                            [&](const Event& e) { return e.type == event_type; });
+  // Some hardware removes its events before registering them again, e.g. PowerPC::Reset() during
+  // boot, so event_type may point to a type from before the last UnregisterAllEvents().
+  if (!s_registered_types.count(event_type))
+    return;
 
-  // Removing random items breaks the invariant so we have to re-establish it.
-  if (itr != s_event_queue.end())
-  {
-    s_event_queue.erase(itr, s_event_queue.end());
-    std::make_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
-  }
+  while (event_type->first_pending != INVALID_NODE)
+    DeleteEvent(event_type->first_pending);
 }
 
 void RemoveAllEvents(EventType* event_type)
@@ -303,11 +546,27 @@ void ForceExceptionCheck(s64 cycles)
 
 void MoveEvents()
 {
-  for (Event ev; s_ts_queue.Pop(ev);)
+  if (!s_inbox.load(std::memory_order_relaxed))
+    return;
+
+  // The inbox is a stack, so reverse it to add the events in the order they were scheduled.
+  InboxNode* node = s_inbox.exchange(nullptr, std::memory_order_acquire);
+  InboxNode* oldest = nullptr;
+  while (node)
   {
-    ev.fifo_order = s_event_fifo_id++;
-    s_event_queue.emplace_back(std::move(ev));
-    std::push_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
+    InboxNode* next = node->next;
+    node->next = oldest;
+    oldest = node;
+    node = next;
+  }
+
+  while (oldest)
+  {
+    oldest->event.fifo_order = s_event_fifo_id++;
+    AddEvent(oldest->event);
+    InboxNode* next = oldest->next;
+    delete oldest;
+    oldest = next;
   }
 }
 
@@ -323,23 +582,26 @@ void Advance()
 
   s_is_global_timer_sane = true;
 
-  while (!s_event_queue.empty() && s_event_queue.front().time <= g.global_timer)
+  for (NodeIndex index = FindNextEvent();
+       index != INVALID_NODE && s_nodes[index].event.time <= g.global_timer;
+       index = FindNextEvent())
   {
-    Event evt = std::move(s_event_queue.front());
-    std::pop_heap(s_event_queue.begin(), s_event_queue.end(), std::greater<Event>());
-    s_event_queue.pop_back();
+    const Event evt = s_nodes[index].event;
+    DeleteEvent(index);
     // NOTICE_LOG(POWERPC, "[Scheduler] %-20s (%lld, %lld)", evt.type->name->c_str(),
     //            g.global_timer, evt.time);
     evt.type->callback(evt.userdata, g.global_timer - evt.time);
   }
 
+  AdvanceCursor();
   s_is_global_timer_sane = false;
 
   // Still events left (scheduled in the future)
-  if (!s_event_queue.empty())
+  const NodeIndex next = FindNextEvent();
+  if (next != INVALID_NODE)
   {
     g.slice_length = static_cast<int>(
-        std::min<s64>(s_event_queue.front().time - g.global_timer, MAX_SLICE_LENGTH));
+        std::min<s64>(s_nodes[next].event.time - g.global_timer, MAX_SLICE_LENGTH));
   }
 
   PowerPC::ppcState.downcount = CyclesToDowncount(g.slice_length);
@@ -353,9 +615,7 @@ void Advance()
 
 void LogPendingEvents()
 {
-  auto clone = s_event_queue;
-  std::sort(clone.begin(), clone.end());
-  for (const Event& ev : clone)
+  for (const Event& ev : GetPendingEvents())
   {
     INFO_LOG(POWERPC, "PENDING: Now: %" PRId64 " Pending: %" PRId64 " Type: %s", g.global_timer,
              ev.time, ev.type->name->c_str());
@@ -365,10 +625,13 @@ void LogPendingEvents()
 // Should only be called from the CPU thread after the PPC clock has changed
 void AdjustEventQueueTimes(u32 new_ppc_clock, u32 old_ppc_clock)
 {
-  for (Event& ev : s_event_queue)
+  std::vector<Event> events = GetPendingEvents();
+  ClearPendingEvents();
+  for (Event& ev : events)
   {
     const s64 ticks = (ev.time - g.global_timer) * new_ppc_clock / old_ppc_clock;
     ev.time = g.global_timer + ticks;
+    AddEvent(ev);
   }
 }
 
@@ -391,9 +654,7 @@ std::string GetScheduledEventsSummary()
   std::string text = "Scheduled events\n";
   text.reserve(1000);
 
-  auto clone = s_event_queue;
-  std::sort(clone.begin(), clone.end());
-  for (const Event& ev : clone)
+  for (const Event& ev : GetPendingEvents())
   {
     text += StringFromFormat("%s : %" PRIi64 " %016" PRIx64 "\n", ev.type->name->c_str(), ev.time,
                              ev.userdata);
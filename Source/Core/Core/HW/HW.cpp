@@ -23,6 +23,7 @@
 #include "Core/HW/VideoInterface.h"
 #include "Core/HW/WII_IPC.h"
 #include "Core/IOS/IOS.h"
+#include "Core/Rewind.h"
 #include "Core/State.h"
 #include "Core/WiiRoot.h"
 
@@ -55,10 +56,14 @@ void Init()
     IOS::Init();
     IOS::HLE::Init();  // Depends on Memory
   }
+
+  Rewind::Init();
 }
 
 void Shutdown()
 {
+  Rewind::Shutdown();
+
   // IOS should always be shut down regardless of bWii because it can be running in GC mode (MIOS).
   IOS::HLE::Shutdown();  // Depends on Memory
   IOS::Shutdown();
@@ -77,9 +82,9 @@ void Shutdown()
   CoreTiming::Shutdown();
 }
 
-void DoState(PointerWrap& p)
+void DoState(PointerWrap& p, bool include_ram)
 {
-  Memory::DoState(p);
+  Memory::DoState(p, include_ram);
   p.DoMarker("Memory");
   VideoInterface::DoState(p);
   p.DoMarker("VideoInterface");
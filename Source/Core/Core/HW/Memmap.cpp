@@ -10,13 +10,20 @@
 #include "Core/HW/Memmap.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstring>
 #include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "Common/Align.h"
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
 #include "Common/Swap.h"
 #include "Core/ConfigManager.h"
 #include "Core/HW/AudioInterface.h"
@@ -163,6 +170,76 @@ static PhysicalMemoryRegion physical_regions[] = {
 };
 
 static std::vector<LogicalMemoryView> logical_mapped_entries;
+// Logical page address -> physical page address
+static std::unordered_map<u32, u32> logical_mapped_pages;
+static constexpr u32 LOGICAL_PAGE_SIZE = 0x1000;
+
+// Dirty page tracking. Each view of a region is write-protected, and the first write to a page
+// through one of them marks the page dirty and makes it writable in that view. The views that
+// were made writable are recorded, so that only they have to be protected again.
+static bool s_dirty_tracking = false;
+static std::array<std::vector<std::atomic<bool>>, ArraySize(physical_regions)> s_dirty_pages;
+static constexpr u32 MAX_UNPROTECTED_PAGES = 0x8000;
+static std::array<u8*, MAX_UNPROTECTED_PAGES> s_unprotected_pages;
+static std::atomic<u32> s_num_unprotected_pages{0};
+// Set when the recorded pages aren't enough to find all writable views.
+static std::atomic<bool> s_protect_all_views{false};
+
+// Copy-on-write snapshots share the write protection. A page's old contents are saved before any
+// view of it is made writable, which the page's state tells readers. The saved pages are only
+// freed by Shutdown, as the exception handler may still be saving one when a snapshot is released.
+enum : u8
+{
+  PAGE_LIVE,
+  PAGE_SAVING,
+  PAGE_SAVED,
+};
+static std::atomic<bool> s_snapshot_active{false};
+static std::array<std::vector<std::atomic<u8>>, ArraySize(physical_regions)> s_snapshot_states;
+static std::array<std::unique_ptr<u8[]>, ArraySize(physical_regions)> s_snapshot_pages;
+// Set once a snapshot is released without dirty page tracking. The views are then made writable
+// again as they're written to, rather than all at once while the emulation is running.
+static std::atomic<bool> s_stale_write_protection{false};
+
+static bool IsWriteProtecting()
+{
+  return s_dirty_tracking || s_snapshot_active;
+}
+
+static void SetViewsWriteProtected(bool write_protected)
+{
+  const auto protect = [write_protected](void* pointer, size_t size) {
+    if (write_protected)
+      Common::WriteProtectMemory(pointer, size, false);
+    else
+      Common::UnWriteProtectMemory(pointer, size, false);
+  };
+
+  for (const PhysicalMemoryRegion& region : physical_regions)
+  {
+    if (*region.out_pointer)
+      protect(*region.out_pointer, region.size);
+  }
+  for (const LogicalMemoryView& entry : logical_mapped_entries)
+    protect(entry.mapped_pointer, entry.mapped_size);
+  for (const auto& page : logical_mapped_pages)
+    protect(logical_base + page.first, LOGICAL_PAGE_SIZE);
+}
+
+static void ProtectWrittenViews()
+{
+  if (s_protect_all_views.exchange(false))
+  {
+    SetViewsWriteProtected(true);
+  }
+  else
+  {
+    const u32 count = std::min(s_num_unprotected_pages.load(), MAX_UNPROTECTED_PAGES);
+    for (u32 i = 0; i < count; i++)
+      Common::WriteProtectMemory(s_unprotected_pages[i], DIRTY_PAGE_SIZE, false);
+  }
+  s_num_unprotected_pages = 0;
+}
 
 void Init()
 {
@@ -181,15 +258,20 @@ void Init()
     flags |= PhysicalMemoryRegion::WII_ONLY;
   if (bFakeVMEM)
     flags |= PhysicalMemoryRegion::FAKE_VMEM;
+  // Transparent huge pages can only back a view if its offset in the segment is aligned the same
+  // way as its address.
+  const bool huge_pages = SConfig::GetInstance().bHugePages;
   u32 mem_size = 0;
   for (PhysicalMemoryRegion& region : physical_regions)
   {
     if ((flags & region.flags) != region.flags)
       continue;
+    if (huge_pages)
+      mem_size = Common::AlignUp(mem_size, Common::HUGE_PAGE_SIZE);
     region.shm_position = mem_size;
     mem_size += region.size;
   }
-  g_arena.GrabSHMSegment(mem_size);
+  g_arena.GrabSHMSegment(mem_size, huge_pages);
   physical_base = MemArena::FindMemoryBase();
 
   for (PhysicalMemoryRegion& region : physical_regions)
@@ -224,6 +306,10 @@ void Init()
 
 void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
 {
+  // Recorded pages of the old views may not be mapped anymore.
+  if (s_dirty_tracking)
+    s_protect_all_views = true;
+
   for (auto& entry : logical_mapped_entries)
   {
     g_arena.ReleaseView(entry.mapped_pointer, entry.mapped_size);
@@ -257,14 +343,74 @@ void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table)
             exit(0);
           }
           logical_mapped_entries.push_back({mapped_pointer, mapped_size});
+          if (IsWriteProtecting())
+            Common::WriteProtectMemory(mapped_pointer, mapped_size, false);
         }
       }
     }
   }
 }
 
-void DoState(PointerWrap& p)
+bool MapLogicalPage(u32 logical_address, u32 physical_address)
+{
+#if defined(_WIN32) || defined(_ARCH_32)
+  // Views have to be aligned to the 64 KiB allocation granularity on Windows, and 32-bit builds
+  // don't have a logical address space.
+  return false;
+#else
+  const auto it = logical_mapped_pages.find(logical_address);
+  if (it != logical_mapped_pages.end())
+  {
+    if (it->second == physical_address)
+      return false;
+    UnmapLogicalPage(logical_address);
+  }
+
+  for (const auto& physical_region : physical_regions)
+  {
+    const u32 offset = physical_address - physical_region.physical_address;
+    if (!*physical_region.out_pointer || physical_address < physical_region.physical_address ||
+        offset > physical_region.size - LOGICAL_PAGE_SIZE)
+    {
+      continue;
+    }
+
+    const u32 position = physical_region.shm_position + offset;
+    if (!g_arena.CreateView(position, LOGICAL_PAGE_SIZE, logical_base + logical_address))
+      return false;
+    logical_mapped_pages.emplace(logical_address, physical_address);
+    if (IsWriteProtecting())
+      Common::WriteProtectMemory(logical_base + logical_address, LOGICAL_PAGE_SIZE, false);
+    return true;
+  }
+  return false;
+#endif
+}
+
+void UnmapLogicalPage(u32 logical_address)
+{
+  if (logical_mapped_pages.erase(logical_address))
+  {
+    g_arena.ReleaseView(logical_base + logical_address, LOGICAL_PAGE_SIZE);
+    if (s_dirty_tracking)
+      s_protect_all_views = true;
+  }
+}
+
+void UnmapLogicalPages()
 {
+  if (s_dirty_tracking)
+    s_protect_all_views = true;
+  for (const auto& page : logical_mapped_pages)
+    g_arena.ReleaseView(logical_base + page.first, LOGICAL_PAGE_SIZE);
+  logical_mapped_pages.clear();
+}
+
+void DoState(PointerWrap& p, bool include_ram)
+{
+  if (!include_ram)
+    return;
+
   bool wii = SConfig::GetInstance().bWii;
   p.DoArray(m_pRAM, RAM_SIZE);
   p.DoArray(m_pL1Cache, L1_CACHE_SIZE);
@@ -279,6 +425,14 @@ void DoState(PointerWrap& p)
 
 void Shutdown()
 {
+  DisableDirtyPageTracking();
+  s_snapshot_active = false;
+  s_stale_write_protection = false;
+  for (size_t i = 0; i < ArraySize(physical_regions); i++)
+  {
+    std::vector<std::atomic<u8>>().swap(s_snapshot_states[i]);
+    s_snapshot_pages[i].reset();
+  }
   m_IsInitialized = false;
   u32 flags = 0;
   if (SConfig::GetInstance().bWii)
@@ -297,6 +451,7 @@ void Shutdown()
     g_arena.ReleaseView(entry.mapped_pointer, entry.mapped_size);
   }
   logical_mapped_entries.clear();
+  UnmapLogicalPages();
   g_arena.ReleaseSHMSegment();
   physical_base = nullptr;
   logical_base = nullptr;
@@ -304,6 +459,278 @@ void Shutdown()
   INFO_LOG(MEMMAP, "Memory system shut down.");
 }
 
+bool IsWriteProtectionSupported()
+{
+#if defined(_ARCH_32) || defined(_M_GENERIC) || defined(__APPLE__)
+  // On macOS, the exception handler only covers the CPU thread, but the video backend and the
+  // DVD thread write to memory too.
+  return false;
+#else
+  return true;
+#endif
+}
+
+bool EnableDirtyPageTracking()
+{
+  if (!IsWriteProtectionSupported())
+    return false;
+  if (s_dirty_tracking)
+    return true;
+
+  for (size_t i = 0; i < ArraySize(physical_regions); i++)
+  {
+    if (*physical_regions[i].out_pointer)
+    {
+      s_dirty_pages[i] =
+          std::vector<std::atomic<bool>>(physical_regions[i].size / DIRTY_PAGE_SIZE);
+    }
+  }
+  SetViewsWriteProtected(true);
+  s_num_unprotected_pages = 0;
+  s_protect_all_views = false;
+  s_stale_write_protection = false;
+  s_dirty_tracking = true;
+  return true;
+}
+
+void DisableDirtyPageTracking()
+{
+  if (!s_dirty_tracking)
+    return;
+
+  s_dirty_tracking = false;
+  if (s_snapshot_active)
+    s_stale_write_protection = true;
+  else
+    SetViewsWriteProtected(false);
+  for (auto& dirty_pages : s_dirty_pages)
+    std::vector<std::atomic<bool>>().swap(dirty_pages);
+}
+
+bool IsDirtyPageTrackingEnabled()
+{
+  return s_dirty_tracking;
+}
+
+void TakeDirtyPages(std::vector<u32>* addresses, std::vector<u8>* data, bool all_pages)
+{
+  // Other threads may still write to memory, so protect the pages before they're copied, so that
+  // a write after the copy marks its page dirty again.
+  if (s_dirty_tracking)
+    ProtectWrittenViews();
+
+  for (size_t i = 0; i < ArraySize(physical_regions); i++)
+  {
+    const PhysicalMemoryRegion& region = physical_regions[i];
+    if (!*region.out_pointer)
+      continue;
+
+    for (u32 page = 0; page < region.size / DIRTY_PAGE_SIZE; page++)
+    {
+      std::atomic<bool>* dirty_page = s_dirty_tracking ? &s_dirty_pages[i][page] : nullptr;
+      const bool dirty = dirty_page && dirty_page->load(std::memory_order_relaxed) &&
+                         dirty_page->exchange(false);
+      if (!dirty && !all_pages)
+        continue;
+
+      const u8* page_pointer = *region.out_pointer + page * DIRTY_PAGE_SIZE;
+      addresses->push_back(region.physical_address + page * DIRTY_PAGE_SIZE);
+      data->insert(data->end(), page_pointer, page_pointer + DIRTY_PAGE_SIZE);
+    }
+  }
+}
+
+void ClearDirtyPages()
+{
+  if (!s_dirty_tracking)
+    return;
+
+  ProtectWrittenViews();
+  for (auto& dirty_pages : s_dirty_pages)
+  {
+    for (std::atomic<bool>& dirty : dirty_pages)
+      dirty = false;
+  }
+}
+
+void RestorePages(const std::vector<u32>& addresses, const std::vector<u8>& data)
+{
+  for (size_t i = 0; i < addresses.size(); i++)
+  {
+    for (const PhysicalMemoryRegion& region : physical_regions)
+    {
+      const u32 offset = addresses[i] - region.physical_address;
+      if (*region.out_pointer && addresses[i] >= region.physical_address &&
+          offset < region.size)
+      {
+        std::memcpy(*region.out_pointer + offset, &data[i * DIRTY_PAGE_SIZE], DIRTY_PAGE_SIZE);
+        break;
+      }
+    }
+  }
+}
+
+// Saves the old contents of a page that's about to be made writable.
+static void SaveSnapshotPage(size_t region_index, u32 offset)
+{
+  std::atomic<u8>& state = s_snapshot_states[region_index][offset / DIRTY_PAGE_SIZE];
+  u8 expected = PAGE_LIVE;
+  if (state.compare_exchange_strong(expected, PAGE_SAVING))
+  {
+    std::memcpy(&s_snapshot_pages[region_index][offset],
+                *physical_regions[region_index].out_pointer + offset, DIRTY_PAGE_SIZE);
+    state = PAGE_SAVED;
+  }
+  else
+  {
+    // Another thread wrote to the page through another view and is saving it.
+    while (state != PAGE_SAVED)
+      std::this_thread::yield();
+  }
+}
+
+std::unique_ptr<CopyOnWriteSnapshot> TakeCopyOnWriteSnapshot()
+{
+  if (!IsWriteProtectionSupported() || s_snapshot_active)
+    return nullptr;
+
+  for (size_t i = 0; i < ArraySize(physical_regions); i++)
+  {
+    const PhysicalMemoryRegion& region = physical_regions[i];
+    if (!*region.out_pointer)
+      continue;
+
+    // Untouched pages of the saved pages don't take any memory.
+    if (!s_snapshot_pages[i])
+    {
+      s_snapshot_states[i] = std::vector<std::atomic<u8>>(region.size / DIRTY_PAGE_SIZE);
+      s_snapshot_pages[i].reset(new u8[region.size]);
+    }
+    for (std::atomic<u8>& state : s_snapshot_states[i])
+      state = PAGE_LIVE;
+  }
+
+  SetViewsWriteProtected(true);
+  s_snapshot_active = true;
+  return std::unique_ptr<CopyOnWriteSnapshot>(new CopyOnWriteSnapshot);
+}
+
+CopyOnWriteSnapshot::~CopyOnWriteSnapshot()
+{
+  if (!s_dirty_tracking)
+    s_stale_write_protection = true;
+  s_snapshot_active = false;
+}
+
+bool CopyOnWriteSnapshot::Read(u32 physical_address, void* dest, u32 size) const
+{
+  for (size_t i = 0; i < ArraySize(physical_regions); i++)
+  {
+    const PhysicalMemoryRegion& region = physical_regions[i];
+    const u32 offset = physical_address - region.physical_address;
+    if (!*region.out_pointer || physical_address < region.physical_address ||
+        offset >= region.size || size > region.size - offset)
+    {
+      continue;
+    }
+
+    u8* out = static_cast<u8*>(dest);
+    for (u32 page_offset = offset; page_offset < offset + size;)
+    {
+      const u32 piece = std::min(offset + size, Common::AlignDown(page_offset, DIRTY_PAGE_SIZE) +
+                                                    DIRTY_PAGE_SIZE) -
+                        page_offset;
+      std::atomic<u8>& state = s_snapshot_states[i][page_offset / DIRTY_PAGE_SIZE];
+      bool saved = state.load(std::memory_order_acquire) == PAGE_SAVED;
+      if (!saved)
+      {
+        // No view of the page is writable before it's saved, so the page can't have changed if
+        // it still isn't saved after reading it.
+        std::memcpy(out, *region.out_pointer + page_offset, piece);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        saved = state.load(std::memory_order_relaxed) == PAGE_SAVED;
+      }
+      if (saved)
+        std::memcpy(out, &s_snapshot_pages[i][page_offset], piece);
+
+      out += piece;
+      page_offset += piece;
+    }
+    return true;
+  }
+  return false;
+}
+
+// Called from the exception handler, on whichever thread wrote to the page.
+bool HandleWriteFault(uintptr_t access_address)
+{
+  if (!s_dirty_tracking && !s_snapshot_active && !s_stale_write_protection)
+    return false;
+
+  u8* const page_pointer =
+      reinterpret_cast<u8*>(access_address & ~static_cast<uintptr_t>(DIRTY_PAGE_SIZE - 1));
+  u32 physical_address;
+  if (access_address - (uintptr_t)physical_base < 0x100000000)
+  {
+    physical_address = static_cast<u32>(access_address - (uintptr_t)physical_base);
+  }
+  else if (access_address - (uintptr_t)logical_base < 0x100000000)
+  {
+    // Only the CPU thread writes through the logical views, so the mappings can't change
+    // meanwhile.
+    physical_address = static_cast<u32>(access_address - (uintptr_t)logical_base);
+    const auto it = logical_mapped_pages.find(physical_address & ~(LOGICAL_PAGE_SIZE - 1));
+    if (it != logical_mapped_pages.end())
+      physical_address = it->second | (physical_address & (LOGICAL_PAGE_SIZE - 1));
+    else if (!PowerPC::TranslateBatAddess(PowerPC::dbat_table, &physical_address))
+      return false;
+  }
+  else
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < ArraySize(physical_regions); i++)
+  {
+    const PhysicalMemoryRegion& region = physical_regions[i];
+    const u32 offset = physical_address - region.physical_address;
+    if (!*region.out_pointer || physical_address < region.physical_address ||
+        offset >= region.size)
+    {
+      continue;
+    }
+
+    if (s_snapshot_active)
+      SaveSnapshotPage(i, Common::AlignDown(offset, DIRTY_PAGE_SIZE));
+    if (s_dirty_tracking)
+    {
+      s_dirty_pages[i][offset / DIRTY_PAGE_SIZE] = true;
+      const u32 index = s_num_unprotected_pages++;
+      if (index < MAX_UNPROTECTED_PAGES)
+        s_unprotected_pages[index] = page_pointer;
+      else
+        s_protect_all_views = true;
+    }
+    Common::UnWriteProtectMemory(page_pointer, DIRTY_PAGE_SIZE, false);
+    return true;
+  }
+
+  return false;
+}
+
+void PrepareHostWrite(const void* pointer, size_t size)
+{
+  if (!s_dirty_tracking && !s_snapshot_active && !s_stale_write_protection)
+    return;
+
+  const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+  for (uintptr_t page = address & ~static_cast<uintptr_t>(DIRTY_PAGE_SIZE - 1);
+       page < address + size; page += DIRTY_PAGE_SIZE)
+  {
+    HandleWriteFault(page);
+  }
+}
+
 void Clear()
 {
   if (m_pRAM)
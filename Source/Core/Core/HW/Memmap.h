@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
@@ -62,10 +63,63 @@ extern std::unique_ptr<MMIO::Mapping> mmio_mapping;
 bool IsInitialized();
 void Init();
 void Shutdown();
-void DoState(PointerWrap& p);
+// Snapshots leave out the memory regions, as they save them with TakeDirtyPages.
+void DoState(PointerWrap& p, bool include_ram = true);
 
 void UpdateLogicalMemory(const PowerPC::BatTable& dbat_table);
 
+// Single 4 KiB pages of the logical address space, for translations through the page table.
+// The caller must make sure that these don't overlap BAT mappings. MapLogicalPage returns
+// whether a new view was created; pages which aren't backed by memory are never mapped.
+bool MapLogicalPage(u32 logical_address, u32 physical_address);
+void UnmapLogicalPage(u32 logical_address);
+void UnmapLogicalPages();
+
+// Dirty page tracking, for incremental snapshots. While it's enabled, every view of memory is
+// write-protected until the page is written, which faults into HandleWriteFault. Requires the
+// exception handler (EMM::InstallExceptionHandler) to handle faults on every thread, and a 64-bit
+// build; IsWriteProtectionSupported tells whether that's the case.
+constexpr u32 DIRTY_PAGE_SIZE = 0x1000;
+bool IsWriteProtectionSupported();
+// Returns false if it isn't supported.
+bool EnableDirtyPageTracking();
+void DisableDirtyPageTracking();
+bool IsDirtyPageTrackingEnabled();
+// Appends the physical address and contents of every page written since the last call (or of
+// all pages) and marks them clean. Must be called with the emulation paused.
+void TakeDirtyPages(std::vector<u32>* addresses, std::vector<u8>* data, bool all_pages = false);
+void ClearDirtyPages();
+void RestorePages(const std::vector<u32>& addresses, const std::vector<u8>& data);
+// Returns whether the fault was caused by dirty page tracking or a CopyOnWriteSnapshot.
+bool HandleWriteFault(uintptr_t access_address);
+// System calls like read and recv fail on write-protected memory instead of faulting, so this
+// has to be called on the destination before passing a pointer to memory to them.
+void PrepareHostWrite(const void* pointer, size_t size);
+
+// An image of the physical memory regions as they were when it was taken, for threads that read
+// memory while the emulation keeps running. Taking one doesn't copy anything: every view is
+// write-protected, and the first write to a page after that saves its old contents for the
+// snapshot. Has the same requirements as dirty page tracking. Only one can exist at a time, and
+// it has to be destroyed before Memory::Shutdown.
+class CopyOnWriteSnapshot
+{
+public:
+  ~CopyOnWriteSnapshot();
+  CopyOnWriteSnapshot(const CopyOnWriteSnapshot&) = delete;
+  CopyOnWriteSnapshot& operator=(const CopyOnWriteSnapshot&) = delete;
+
+  // Can be called on any thread. Returns false if the range isn't within one region.
+  bool Read(u32 physical_address, void* dest, u32 size) const;
+
+private:
+  friend std::unique_ptr<CopyOnWriteSnapshot> TakeCopyOnWriteSnapshot();
+  CopyOnWriteSnapshot() = default;
+};
+
+// Must be called with the emulation paused. Returns null if a snapshot already exists or if
+// they aren't supported.
+std::unique_ptr<CopyOnWriteSnapshot> TakeCopyOnWriteSnapshot();
+
 void Clear();
 
 // Routines to access physically addressed memory, designed for use by
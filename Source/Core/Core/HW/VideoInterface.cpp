@@ -23,6 +23,7 @@
 #include "Core/HW/ProcessorInterface.h"
 #include "Core/HW/SI/SI.h"
 #include "Core/HW/SystemTimers.h"
+#include "Core/Rewind.h"
 
 #include "DiscIO/Enums.h"
 
@@ -720,6 +721,7 @@ static void BeginField(FieldType field, u64 ticks)
 static void EndField()
 {
   Core::VideoThrottle();
+  Rewind::FrameUpdate();
 }
 
 // Purpose: Send VI interrupt when triggered
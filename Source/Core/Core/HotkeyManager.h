@@ -151,6 +151,7 @@ enum Hotkey
   HK_UNDO_SAVE_STATE,
   HK_SAVE_STATE_FILE,
   HK_LOAD_STATE_FILE,
+  HK_REWIND,
 
   NUM_HOTKEYS,
 };
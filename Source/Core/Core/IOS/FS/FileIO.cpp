@@ -221,8 +221,10 @@ IPCCommandResult FileIO::Read(const ReadWriteRequest& request)
   DEBUG_LOG(IOS_FILEIO, "Read 0x%x bytes to 0x%08x from %s", request.size, request.buffer,
             m_name.c_str());
   m_file->Seek(m_SeekPos, SEEK_SET);  // File might be opened twice, need to seek before we read
-  const u32 number_of_bytes_read = static_cast<u32>(
-      fread(Memory::GetPointer(request.buffer), 1, requested_read_length, m_file->GetHandle()));
+  u8* const buffer = Memory::GetPointer(request.buffer);
+  Memory::PrepareHostWrite(buffer, requested_read_length);
+  const u32 number_of_bytes_read =
+      static_cast<u32>(fread(buffer, 1, requested_read_length, m_file->GetHandle()));
 
   if (number_of_bytes_read != requested_read_length && ferror(m_file->GetHandle()))
     return GetDefaultReply(FS_EACCESS);
@@ -554,6 +554,7 @@ void WiiSocket::Update(bool read, bool write, bool except)
           }
 #endif
           socklen_t addrlen = sizeof(sockaddr_in);
+          Memory::PrepareHostWrite(data, data_len);
           int ret = recvfrom(fd, data, data_len, flags,
                              BufferOutSize2 ? (struct sockaddr*)&local_name : nullptr,
                              BufferOutSize2 ? &addrlen : nullptr);
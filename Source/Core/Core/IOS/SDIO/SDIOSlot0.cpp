@@ -255,7 +255,9 @@ s32 SDIOSlot0::ExecuteCommand(const Request& request, u32 _BufferIn, u32 _Buffer
       if (!m_card.Seek(address, SEEK_SET))
         ERROR_LOG(IOS_SD, "Seek failed WTF");
 
-      if (m_card.ReadBytes(Memory::GetPointer(req.addr), size))
+      u8* const buffer = Memory::GetPointer(req.addr);
+      Memory::PrepareHostWrite(buffer, size);
+      if (m_card.ReadBytes(buffer, size))
       {
         DEBUG_LOG(IOS_SD, "Outbuffer size %i got %i", _rwBufferSize, size);
       }
@@ -469,7 +469,9 @@ IPCCommandResult WFSI::IOCtl(const IOCtlRequest& request)
     }
     else
     {
-      fp.ReadBytes(Memory::GetPointer(dol_addr), max_dol_size);
+      u8* const buffer = Memory::GetPointer(dol_addr);
+      Memory::PrepareHostWrite(buffer, max_dol_size);
+      fp.ReadBytes(buffer, max_dol_size);
     }
     Memory::Write_U32(real_dol_size, request.buffer_out);
     break;
@@ -517,7 +519,9 @@ u32 WFSI::GetTmd(u16 group_id, u32 title_id, u64 subtitle_id, u32 address, u32*
   }
   if (address)
   {
-    fp.ReadBytes(Memory::GetPointer(address), fp.GetSize());
+    u8* const buffer = Memory::GetPointer(address);
+    Memory::PrepareHostWrite(buffer, fp.GetSize());
+    fp.ReadBytes(buffer, fp.GetSize());
   }
   *size = fp.GetSize();
   return IPC_SUCCESS;
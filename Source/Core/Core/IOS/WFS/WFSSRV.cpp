@@ -298,7 +298,9 @@ IPCCommandResult WFSSRV::IOCtl(const IOCtlRequest& request)
       fd_obj->file.Seek(position, SEEK_SET);
     }
     size_t read_bytes;
-    fd_obj->file.ReadArray(Memory::GetPointer(addr), size, &read_bytes);
+    u8* const buffer = Memory::GetPointer(addr);
+    Memory::PrepareHostWrite(buffer, size);
+    fd_obj->file.ReadArray(buffer, size, &read_bytes);
     // TODO(wfs): Handle read errors.
     if (absolute)
     {
@@ -14,6 +14,7 @@
 #include "Common/MsgHandler.h"
 #include "Common/Thread.h"
 
+#include "Core/HW/Memmap.h"
 #include "Core/MachineContext.h"
 #include "Core/PowerPC/JitInterface.h"
 
@@ -44,7 +45,8 @@ LONG NTAPI Handler(PEXCEPTION_POINTERS pPtrs)
     uintptr_t badAddress = (uintptr_t)pPtrs->ExceptionRecord->ExceptionInformation[1];
     CONTEXT* ctx = pPtrs->ContextRecord;
 
-    if (JitInterface::HandleFault(badAddress, ctx))
+    if ((accessType == 1 && Memory::HandleWriteFault(badAddress)) ||
+        JitInterface::HandleFault(badAddress, ctx))
     {
       return (DWORD)EXCEPTION_CONTINUE_EXECUTION;
     }
@@ -171,7 +173,8 @@ static void ExceptionThread(mach_port_t port)
 
     x86_thread_state64_t* state = (x86_thread_state64_t*)msg_in.old_state;
 
-    bool ok = JitInterface::HandleFault((uintptr_t)msg_in.code[1], state);
+    bool ok = Memory::HandleWriteFault((uintptr_t)msg_in.code[1]) ||
+              JitInterface::HandleFault((uintptr_t)msg_in.code[1], state);
 
     // Set up the reply.
     msg_out.Head.msgh_bits = MACH_MSGH_BITS(MACH_MSGH_BITS_REMOTE(msg_in.Head.msgh_bits), 0);
@@ -254,6 +257,9 @@ static void sigsegv_handler(int sig, siginfo_t* info, void* raw_context)
 #else
   mcontext_t* ctx = &context->uc_mcontext;
 #endif
+  if (Memory::HandleWriteFault(bad_address))
+    return;
+
   // assume it's not a write
   if (!JitInterface::HandleFault(bad_address,
 #ifdef __APPLE__
@@ -15,11 +15,96 @@
 #include "Core/PowerPC/PPCAnalyst.h"
 #include "Core/PowerPC/PowerPC.h"
 
+namespace
+{
+// Operands of one instruction, decoded when the block is compiled.
+struct DecodedOperands
+{
+  u8 d;      // rD, rA of rlwinm, crfD of compares, BI of bc
+  u8 a;      // rA, rS of rlwinm, expected condition bit of bc
+  u8 b;      // Rotation of rlwinm, rB of register compares
+  u8 flags;  // COMPARE_* flags of compares
+  u32 imm;   // Sign-extended immediate, mask of rlwinm, branch target of bc
+};
+
+enum : u8
+{
+  COMPARE_SIGNED = 1,
+  COMPARE_REGISTER = 2,
+};
+
+// Same as Interpreter::Helper_Mask.
+u32 RotateMask(u32 mb, u32 me)
+{
+  const u32 mask = (0xFFFFFFFF >> mb) ^ (0x7FFFFFFF >> me);
+  return me < mb ? ~mask : mask;
+}
+
+inline void DoAddi(const DecodedOperands& op)
+{
+  rGPR[op.d] = (op.a ? rGPR[op.a] : 0) + op.imm;
+}
+
+inline void DoLwz(const DecodedOperands& op)
+{
+  const u32 temp = PowerPC::Read_U32((op.a ? rGPR[op.a] : 0) + op.imm);
+  if (!(PowerPC::ppcState.Exceptions & EXCEPTION_DSI))
+    rGPR[op.d] = temp;
+}
+
+inline void DoRlwinm(const DecodedOperands& op)
+{
+  rGPR[op.d] = _rotl(rGPR[op.a], op.b) & op.imm;
+}
+
+inline void DoCompare(const DecodedOperands& op)
+{
+  const u32 a = rGPR[op.a];
+  const u32 b = (op.flags & COMPARE_REGISTER) ? rGPR[op.b] : op.imm;
+  int f;
+  if (op.flags & COMPARE_SIGNED)
+  {
+    const s32 signed_a = static_cast<s32>(a);
+    const s32 signed_b = static_cast<s32>(b);
+    f = signed_a < signed_b ? 0x8 : signed_a > signed_b ? 0x4 : 0x2;
+  }
+  else
+  {
+    f = a < b ? 0x8 : a > b ? 0x4 : 0x2;
+  }
+
+  if (GetXER_SO())
+    f |= 0x1;
+
+  SetCRField(op.d, f);
+}
+}  // Anonymous namespace
+
 struct CachedInterpreter::Instruction
 {
   typedef void (*CommonCallback)(UGeckoInstruction);
   typedef bool (*ConditionalCallback)(u32 data);
 
+  // Besides the generic callbacks, a few frequent instructions and pairs of instructions have
+  // their own handlers, which work on operands decoded at compile time.
+  enum Type : u32
+  {
+    INSTRUCTION_ABORT,
+    INSTRUCTION_TYPE_COMMON,
+    INSTRUCTION_TYPE_CONDITIONAL,
+    INSTRUCTION_TYPE_ADDI,
+    INSTRUCTION_TYPE_LWZ,
+    INSTRUCTION_TYPE_RLWINM,
+    INSTRUCTION_TYPE_COMPARE,
+    // Fused pairs
+    INSTRUCTION_TYPE_LWZ_ADDI,
+    INSTRUCTION_TYPE_RLWINM_RLWINM,
+    // Compare followed by a conditional branch which ends the block. data is the address of the
+    // branch.
+    INSTRUCTION_TYPE_COMPARE_BC,
+    NUM_INSTRUCTION_TYPES,
+  };
+
   Instruction() : type(INSTRUCTION_ABORT) {}
   Instruction(const CommonCallback c, UGeckoInstruction i)
       : common_callback(c), data(i.hex), type(INSTRUCTION_TYPE_COMMON)
@@ -31,18 +116,91 @@ struct CachedInterpreter::Instruction
   {
   }
 
+  Instruction(Type t, const DecodedOperands& op1, const DecodedOperands& op2 = {}, u32 d = 0)
+      : second(op2), first(op1), data(d), type(t)
+  {
+  }
+
+  // Returns the specialized type of a single instruction, or INSTRUCTION_TYPE_COMMON if there is
+  // none.
+  static Type Decode(UGeckoInstruction inst, bool memcheck, DecodedOperands* op)
+  {
+    *op = {};
+    switch (inst.OPCD)
+    {
+    case 14:  // addi
+      *op = {static_cast<u8>(inst.RD), static_cast<u8>(inst.RA), 0, 0,
+             static_cast<u32>(SignExt16(inst.SIMM_16))};
+      return INSTRUCTION_TYPE_ADDI;
+
+    case 32:  // lwz
+      // With memcheck, the DSI check needs its own entry.
+      if (memcheck)
+        return INSTRUCTION_TYPE_COMMON;
+      *op = {static_cast<u8>(inst.RD), static_cast<u8>(inst.RA), 0, 0,
+             static_cast<u32>(SignExt16(inst.SIMM_16))};
+      return INSTRUCTION_TYPE_LWZ;
+
+    case 21:  // rlwinmx
+      if (inst.Rc)
+        return INSTRUCTION_TYPE_COMMON;
+      *op = {static_cast<u8>(inst.RA), static_cast<u8>(inst.RS), static_cast<u8>(inst.SH), 0,
+             RotateMask(inst.MB, inst.ME)};
+      return INSTRUCTION_TYPE_RLWINM;
+
+    case 11:  // cmpi
+      *op = {static_cast<u8>(inst.CRFD), static_cast<u8>(inst.RA), 0, COMPARE_SIGNED,
+             static_cast<u32>(SignExt16(inst.SIMM_16))};
+      return INSTRUCTION_TYPE_COMPARE;
+
+    case 10:  // cmpli
+      *op = {static_cast<u8>(inst.CRFD), static_cast<u8>(inst.RA), 0, 0, inst.UIMM};
+      return INSTRUCTION_TYPE_COMPARE;
+
+    case 31:
+      if (inst.SUBOP10 == 0)  // cmp
+      {
+        *op = {static_cast<u8>(inst.CRFD), static_cast<u8>(inst.RA), static_cast<u8>(inst.RB),
+               COMPARE_SIGNED | COMPARE_REGISTER, 0};
+        return INSTRUCTION_TYPE_COMPARE;
+      }
+      if (inst.SUBOP10 == 32)  // cmpl
+      {
+        *op = {static_cast<u8>(inst.CRFD), static_cast<u8>(inst.RA), static_cast<u8>(inst.RB),
+               COMPARE_REGISTER, 0};
+        return INSTRUCTION_TYPE_COMPARE;
+      }
+      return INSTRUCTION_TYPE_COMMON;
+
+    default:
+      return INSTRUCTION_TYPE_COMMON;
+    }
+  }
+
+  // Whether bc can be folded into a preceding compare: it must only test a condition bit and
+  // must not need anything of Interpreter::bcx besides that (CTR, LR, the idle loop detection).
+  static bool DecodeFusableBranch(UGeckoInstruction inst, u32 address, DecodedOperands* op)
+  {
+    if (inst.OPCD != 16 || !(inst.BO & BO_DONT_DECREMENT_FLAG) ||
+        (inst.BO & BO_DONT_CHECK_CONDITION) || inst.LK || inst.AA || inst.hex == 0x4182fff8)
+    {
+      return false;
+    }
+
+    *op = {static_cast<u8>(inst.BI), static_cast<u8>((inst.BO >> 3) & 1), 0, 0,
+           address + SignExt16(inst.BD << 2)};
+    return true;
+  }
+
   union
   {
-    const CommonCallback common_callback;
-    const ConditionalCallback conditional_callback;
+    CommonCallback common_callback;
+    ConditionalCallback conditional_callback;
+    DecodedOperands second;
   };
+  DecodedOperands first;
   u32 data;
-  enum
-  {
-    INSTRUCTION_ABORT,
-    INSTRUCTION_TYPE_COMMON,
-    INSTRUCTION_TYPE_CONDITIONAL,
-  } type;
+  Type type;
 };
 
 CachedInterpreter::CachedInterpreter() : code_buffer(32000)
@@ -86,24 +244,97 @@ void CachedInterpreter::ExecuteOneBlock()
 
   const Instruction* code = reinterpret_cast<const Instruction*>(normal_entry);
 
-  for (; code->type != Instruction::INSTRUCTION_ABORT; ++code)
+// Every handler jumps straight to the handler of the next entry. Where computed gotos are
+// available, each handler has its own indirect jump, which is much easier on the branch
+// predictor than going through the single one of a switch.
+#if defined(__GNUC__)
+  static const void* const handlers[] = {
+      &&handle_abort,       &&handle_common,    &&handle_conditional,
+      &&handle_addi,        &&handle_lwz,       &&handle_rlwinm,
+      &&handle_compare,     &&handle_lwz_addi,  &&handle_rlwinm_rlwinm,
+      &&handle_compare_bc,
+  };
+  static_assert(sizeof(handlers) / sizeof(handlers[0]) == Instruction::NUM_INSTRUCTION_TYPES,
+                "Missing CachedInterpreter handlers");
+
+#define HANDLER(type, label) label:
+#define DISPATCH() goto* handlers[code->type]
+#define NEXT()                                                                                     \
+  do                                                                                               \
+  {                                                                                                \
+    ++code;                                                                                        \
+    DISPATCH();                                                                                    \
+  } while (0)
+
+  DISPATCH();
+#else
+#define HANDLER(type, label) case Instruction::type:
+#define NEXT()                                                                                     \
+  ++code;                                                                                          \
+  continue
+
+  for (;;)
   {
     switch (code->type)
     {
-    case Instruction::INSTRUCTION_TYPE_COMMON:
-      code->common_callback(UGeckoInstruction(code->data));
-      break;
+#endif
+
+  HANDLER(INSTRUCTION_ABORT, handle_abort)
+  return;
+
+  HANDLER(INSTRUCTION_TYPE_COMMON, handle_common)
+  code->common_callback(UGeckoInstruction(code->data));
+  NEXT();
+
+  HANDLER(INSTRUCTION_TYPE_CONDITIONAL, handle_conditional)
+  if (code->conditional_callback(code->data))
+    return;
+  NEXT();
 
-    case Instruction::INSTRUCTION_TYPE_CONDITIONAL:
-      if (code->conditional_callback(code->data))
-        return;
-      break;
+  HANDLER(INSTRUCTION_TYPE_ADDI, handle_addi)
+  DoAddi(code->first);
+  NEXT();
 
+  HANDLER(INSTRUCTION_TYPE_LWZ, handle_lwz)
+  DoLwz(code->first);
+  NEXT();
+
+  HANDLER(INSTRUCTION_TYPE_RLWINM, handle_rlwinm)
+  DoRlwinm(code->first);
+  NEXT();
+
+  HANDLER(INSTRUCTION_TYPE_COMPARE, handle_compare)
+  DoCompare(code->first);
+  NEXT();
+
+  HANDLER(INSTRUCTION_TYPE_LWZ_ADDI, handle_lwz_addi)
+  DoLwz(code->first);
+  DoAddi(code->second);
+  NEXT();
+
+  HANDLER(INSTRUCTION_TYPE_RLWINM_RLWINM, handle_rlwinm_rlwinm)
+  DoRlwinm(code->first);
+  DoRlwinm(code->second);
+  NEXT();
+
+  HANDLER(INSTRUCTION_TYPE_COMPARE_BC, handle_compare_bc)
+  DoCompare(code->first);
+  PC = code->data;
+  NPC = GetCRBit(code->second.d) == code->second.a ? code->second.imm : code->data + 4;
+  NEXT();
+
+#if !defined(__GNUC__)
     default:
       ERROR_LOG(POWERPC, "Unknown CachedInterpreter Instruction: %d", code->type);
-      break;
+      ++code;
+      continue;
     }
   }
+#endif
+
+#undef HANDLER
+#undef DISPATCH
+#undef NEXT
 }
 
 void CachedInterpreter::Run()
@@ -239,9 +470,55 @@ void CachedInterpreter::Jit(u32 address)
         js.firstFPInstructionFound = true;
       }
 
+      DecodedOperands first;
+      Instruction::Type type = Instruction::Decode(ops[i].inst, jo.memcheck, &first);
+
+      // Try to fuse the instruction with the next one.
+      const bool can_fuse = type != Instruction::INSTRUCTION_TYPE_COMMON &&
+                            i + 1 < code_block.m_num_instructions && !ops[i + 1].skip &&
+                            HLE::GetFirstFunctionIndex(ops[i + 1].address) == 0;
+      DecodedOperands second;
+      Instruction::Type fused_type = Instruction::INSTRUCTION_TYPE_COMMON;
+      if (can_fuse && type == Instruction::INSTRUCTION_TYPE_COMPARE)
+      {
+        if ((ops[i + 1].opinfo->flags & FL_ENDBLOCK) &&
+            Instruction::DecodeFusableBranch(ops[i + 1].inst, ops[i + 1].address, &second))
+        {
+          fused_type = Instruction::INSTRUCTION_TYPE_COMPARE_BC;
+        }
+      }
+      else if (can_fuse)
+      {
+        const Instruction::Type next_type =
+            Instruction::Decode(ops[i + 1].inst, jo.memcheck, &second);
+        if (type == Instruction::INSTRUCTION_TYPE_LWZ &&
+            next_type == Instruction::INSTRUCTION_TYPE_ADDI)
+        {
+          fused_type = Instruction::INSTRUCTION_TYPE_LWZ_ADDI;
+        }
+        else if (type == Instruction::INSTRUCTION_TYPE_RLWINM &&
+                 next_type == Instruction::INSTRUCTION_TYPE_RLWINM)
+        {
+          fused_type = Instruction::INSTRUCTION_TYPE_RLWINM_RLWINM;
+        }
+      }
+
+      if (fused_type != Instruction::INSTRUCTION_TYPE_COMMON)
+      {
+        i++;
+        js.downcountAmount += ops[i].opinfo->numCycles;
+        m_code.emplace_back(fused_type, first, second, ops[i].address);
+        if (ops[i].opinfo->flags & FL_ENDBLOCK)
+          m_code.emplace_back(EndBlock, js.downcountAmount);
+        continue;
+      }
+
       if (endblock || memcheck)
         m_code.emplace_back(WritePC, ops[i].address);
-      m_code.emplace_back(GetInterpreterOp(ops[i].inst), ops[i].inst);
+      if (type != Instruction::INSTRUCTION_TYPE_COMMON)
+        m_code.emplace_back(type, first);
+      else
+        m_code.emplace_back(GetInterpreterOp(ops[i].inst), ops[i].inst);
       if (memcheck)
         m_code.emplace_back(CheckDSI, js.downcountAmount);
       if (endblock)
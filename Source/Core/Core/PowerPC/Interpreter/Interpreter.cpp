@@ -68,10 +68,12 @@ void Interpreter::Init()
   InitializeInstructionTables();
   m_reserve = false;
   m_end_block = false;
+  ClearCache();
 }
 
 void Interpreter::Shutdown()
 {
+  ClearCache();
 }
 
 static int startTrace = 0;
@@ -102,6 +104,8 @@ static void Trace(UGeckoInstruction& inst)
 int Interpreter::SingleStepInner()
 {
   static UGeckoInstruction instCode;
+  // Belongs to instCode, and like it is kept when an HLE function replaces the instruction.
+  static u32 num_cycles;
   u32 function = HLE::GetFirstFunctionIndex(PC);
   if (function != 0)
   {
@@ -153,10 +157,14 @@ int Interpreter::SingleStepInner()
 
     if (instCode.hex != 0)
     {
+      const DecodedInstruction& decoded = GetDecodedInstruction(PC, instCode);
+      num_cycles = decoded.num_cycles;
+
       UReg_MSR& msr = (UReg_MSR&)MSR;
-      if (msr.FP)  // If FPU is enabled, just execute
+      // check if we have to generate a FPU unavailable exception
+      if (msr.FP || !decoded.uses_fpu)
       {
-        m_op_table[instCode.OPCD](instCode);
+        decoded.handler(instCode);
         if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
         {
           PowerPC::CheckExceptions();
@@ -165,26 +173,14 @@ int Interpreter::SingleStepInner()
       }
       else
       {
-        // check if we have to generate a FPU unavailable exception
-        if (!PPCTables::UsesFPU(instCode))
-        {
-          m_op_table[instCode.OPCD](instCode);
-          if (PowerPC::ppcState.Exceptions & EXCEPTION_DSI)
-          {
-            PowerPC::CheckExceptions();
-            m_end_block = true;
-          }
-        }
-        else
-        {
-          PowerPC::ppcState.Exceptions |= EXCEPTION_FPU_UNAVAILABLE;
-          PowerPC::CheckExceptions();
-          m_end_block = true;
-        }
+        PowerPC::ppcState.Exceptions |= EXCEPTION_FPU_UNAVAILABLE;
+        PowerPC::CheckExceptions();
+        m_end_block = true;
       }
     }
     else
     {
+      num_cycles = 0;
       // Memory exception on instruction fetch
       PowerPC::CheckExceptions();
       m_end_block = true;
@@ -193,8 +189,76 @@ int Interpreter::SingleStepInner()
   last_pc = PC;
   PC = NPC;
 
-  GekkoOPInfo* opinfo = GetOpInfo(instCode);
-  return opinfo->numCycles;
+  return num_cycles;
+}
+
+const Interpreter::DecodedInstruction& Interpreter::GetDecodedInstruction(u32 address,
+                                                                          UGeckoInstruction inst)
+{
+  const u32 page_address = address & ~(DECODED_PAGE_SIZE - 1);
+  if (!m_last_decoded_page || m_last_decoded_page_address != page_address)
+  {
+    auto page = m_decoded_pages.find(page_address);
+    if (page == m_decoded_pages.end())
+    {
+      // Like the JIT with a full code cache, start over instead of growing without bound.
+      if (m_decoded_pages.size() >= MAX_DECODED_PAGES)
+        m_decoded_pages.clear();
+      page = m_decoded_pages.emplace(page_address, std::make_unique<DecodedPage>()).first;
+    }
+    m_last_decoded_page = page->second.get();
+    m_last_decoded_page_address = page_address;
+  }
+
+  DecodedInstruction& decoded = (*m_last_decoded_page)[(address & (DECODED_PAGE_SIZE - 1)) / 4];
+  if (decoded.handler && decoded.hex == inst.hex)
+    return decoded;
+
+  const GekkoOPInfo* opinfo = GetOpInfo(inst);
+  decoded.hex = inst.hex;
+  decoded.handler = GetInterpreterOp(inst);
+  decoded.num_cycles = opinfo ? opinfo->numCycles : 1;
+  decoded.uses_fpu = opinfo && (opinfo->flags & FL_USE_FPU) != 0;
+  return decoded;
+}
+
+void Interpreter::InvalidateDecodedInstructions(u32 address, u32 length)
+{
+  if (m_decoded_pages.empty() || length == 0)
+    return;
+
+  m_last_decoded_page = nullptr;
+
+  const u32 first_page = address >> DECODED_PAGE_SHIFT;
+  const u32 last_page = static_cast<u32>((u64{address} + length - 1) >> DECODED_PAGE_SHIFT);
+  if (last_page - first_page >= m_decoded_pages.size())
+  {
+    for (auto it = m_decoded_pages.begin(); it != m_decoded_pages.end();)
+    {
+      const u32 page = it->first >> DECODED_PAGE_SHIFT;
+      if (page >= first_page && page <= last_page)
+        it = m_decoded_pages.erase(it);
+      else
+        ++it;
+    }
+  }
+  else
+  {
+    for (u64 page = first_page; page <= last_page; page++)
+      m_decoded_pages.erase(static_cast<u32>(page << DECODED_PAGE_SHIFT));
+  }
+}
+
+void Interpreter::RunBlock()
+{
+  m_end_block = false;
+
+  int cycles = 0;
+  while (!m_end_block)
+  {
+    cycles += SingleStepInner();
+  }
+  PowerPC::ppcState.downcount -= cycles;
 }
 
 void Interpreter::SingleStep()
@@ -295,16 +359,7 @@ void Interpreter::Run()
     {
       // "fast" version of inner loop. well, it's not so fast.
       while (PowerPC::ppcState.downcount > 0)
-      {
-        m_end_block = false;
-
-        int cycles = 0;
-        while (!m_end_block)
-        {
-          cycles += SingleStepInner();
-        }
-        PowerPC::ppcState.downcount -= cycles;
-      }
+        RunBlock();
     }
   }
 }
@@ -327,7 +382,8 @@ void Interpreter::unknown_instruction(UGeckoInstruction inst)
 
 void Interpreter::ClearCache()
 {
-  // Do nothing.
+  m_decoded_pages.clear();
+  m_last_decoded_page = nullptr;
 }
 
 const char* Interpreter::GetName()
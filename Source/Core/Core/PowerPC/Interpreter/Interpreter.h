@@ -5,6 +5,8 @@
 #pragma once
 
 #include <array>
+#include <memory>
+#include <unordered_map>
 
 #include "Common/CommonTypes.h"
 #include "Core/PowerPC/CPUCoreBase.h"
@@ -17,11 +19,16 @@ public:
   void Shutdown() override;
   void SingleStep() override;
   int SingleStepInner();
+  // Runs instructions up to the end of the current block and charges them to the downcount.
+  void RunBlock();
 
   void Run() override;
   void ClearCache() override;
   const char* GetName() override;
 
+  // Drops the decoded instructions for the given range of effective addresses.
+  void InvalidateDecodedInstructions(u32 address, u32 length);
+
   static void unknown_instruction(UGeckoInstruction inst);
 
   // Branch Instructions
@@ -282,8 +289,25 @@ public:
   static u32 Helper_Carry(u32 value1, u32 value2);
 
 private:
+  // An instruction with everything SingleStepInner needs from the tables already looked up.
+  struct DecodedInstruction
+  {
+    u32 hex;
+    Instruction handler;
+    u32 num_cycles;
+    bool uses_fpu;
+  };
+
+  static constexpr u32 DECODED_PAGE_SHIFT = 12;
+  static constexpr u32 DECODED_PAGE_SIZE = 1 << DECODED_PAGE_SHIFT;
+  using DecodedPage = std::array<DecodedInstruction, DECODED_PAGE_SIZE / 4>;
+  // 2 MiB of code, far more than games run from at a time. The pages take 24 KiB each.
+  static constexpr size_t MAX_DECODED_PAGES = 512;
+
   static void InitializeInstructionTables();
 
+  const DecodedInstruction& GetDecodedInstruction(u32 address, UGeckoInstruction inst);
+
   // flag helper
   static void Helper_UpdateCR0(u32 value);
   static void Helper_UpdateCR1();
@@ -306,6 +330,12 @@ private:
 
   static bool m_end_block;
 
+  // Decoded instructions by effective address. The opcode is still fetched on every step, since
+  // that is what drives the emulated instruction cache; an entry is only used if its hex matches.
+  std::unordered_map<u32, std::unique_ptr<DecodedPage>> m_decoded_pages;
+  u32 m_last_decoded_page_address = 0;
+  DecodedPage* m_last_decoded_page = nullptr;
+
   // TODO: These should really be in the save state, although it's unlikely to matter much.
   // They are for lwarx and its friend stwcxd.
   static bool m_reserve;
@@ -4,6 +4,9 @@
 
 #include "Core/PowerPC/Jit64/Jit.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
 #include <map>
 #include <string>
 
@@ -18,6 +21,7 @@
 #include "Common/MemoryUtil.h"
 #include "Common/PerformanceCounter.h"
 #include "Common/StringUtil.h"
+#include "Common/Timer.h"
 #include "Common/x64ABI.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
@@ -26,6 +30,7 @@
 #include "Core/HW/GPFifo.h"
 #include "Core/HW/ProcessorInterface.h"
 #include "Core/PatchEngine.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
 #include "Core/PowerPC/Jit64/JitAsm.h"
 #include "Core/PowerPC/Jit64/JitRegCache.h"
 #include "Core/PowerPC/Jit64Common/FarCodeCache.h"
@@ -199,6 +204,12 @@ bool Jit64::HandleStackFault()
 
 bool Jit64::HandleFault(uintptr_t access_address, SContext* ctx)
 {
+  // Backpatching uses the emitter and js. Faults come from JIT code on the CPU thread, which never
+  // holds the compiler lock while running it.
+  std::unique_lock<std::mutex> lock;
+  if (m_compile_thread && Core::IsCPUThread())
+    lock = LockCompiler();
+
   uintptr_t stack = (uintptr_t)m_stack;
   uintptr_t diff = access_address - stack;
   // In the trap region?
@@ -226,7 +237,8 @@ void Jit64::Init()
   const size_t trampolines_size = jo.memcheck ? TRAMPOLINE_CODE_SIZE_MMU : TRAMPOLINE_CODE_SIZE;
   const size_t farcode_size = jo.memcheck ? FARCODE_SIZE_MMU : FARCODE_SIZE;
   const size_t constpool_size = m_const_pool.CONST_POOL_SIZE;
-  AllocCodeSpace(CODE_SIZE + routines_size + trampolines_size + farcode_size + constpool_size);
+  AllocCodeSpace(CODE_SIZE + routines_size + trampolines_size + farcode_size + constpool_size,
+                 SConfig::GetInstance().bHugePages);
   AddChildCodeSpace(&asm_routines, routines_size);
   AddChildCodeSpace(&trampolines, trampolines_size);
   AddChildCodeSpace(&m_far_code, farcode_size);
@@ -251,25 +263,128 @@ void Jit64::Init()
   m_far_code.Init();
   Clear();
 
+  // Without a block cache, everything is thrown away on every compile anyway.
+  m_partial_eviction = SConfig::GetInstance().bJITPartialEviction &&
+                       !SConfig::GetInstance().bJITNoBlockCache;
+  m_near_region_size = region_size / NUM_CODE_REGIONS;
+  m_far_region_size = farcode_size / NUM_CODE_REGIONS;
+  ResetCodeRegions();
+  m_evicted_blocks.clear();
+  m_eviction_stats = {};
+
   code_block.m_stats = &js.st;
   code_block.m_gpa = &js.gpa;
   code_block.m_fpa = &js.fpa;
   EnableOptimization();
+
+  // With tiered compilation, hot blocks get recompiled with the more expensive analysis passes.
+  m_tiered_compilation =
+      SConfig::GetInstance().bJITTieredCompilation && !SConfig::GetInstance().bEnableDebugging;
+  m_tier_stats = {};
+  m_tier_ups = 0;
+  m_tier_up_time_us = 0;
+  m_trace_branches = 0;
+  m_branch_counts.clear();
+  m_indirect_branch_caches.clear();
+  m_indirect_branch_sites = 0;
+  m_indirect_branch_fills = 0;
+  m_indirect_branch_misses = 0;
+  m_free_indirect_branch_caches.clear();
+  m_run_counter_address = nullptr;
+  if (m_tiered_compilation)
+    analyzer.SetBranchPredictor([this](u32 address) { return IsBranchLikelyTaken(address); });
+
+  // Debugging needs the blocks to match the current breakpoints and stepping state, and memcheck
+  // relies on exception handler tables which are filled in while compiling, so those always
+  // compile on the CPU thread.
+  m_background_stats = {};
+  m_compile_thread_full.Clear();
+  m_compile_thread_stop.Clear();
+  if (SConfig::GetInstance().bJITBackgroundCompile && !SConfig::GetInstance().bEnableDebugging &&
+      !jo.memcheck)
+  {
+    m_compile_thread = std::make_unique<Common::WorkQueueThread<BackgroundCompileRequest>>(
+        [this](BackgroundCompileRequest request) { CompileInBackground(request); });
+  }
 }
 
 void Jit64::ClearCache()
 {
+  DiscardBackgroundCompiles();
+  m_compile_thread_full.Clear();
+  m_hot_block_profile.RecordBlocks(blocks);
+  if (m_tiered_compilation)
+    blocks.RunOnBlocks([this](const JitBlock& block) { AccumulateTierStats(block); });
   blocks.Clear();
+  m_branch_counts.clear();
+  m_indirect_branch_caches.clear();
+  m_free_indirect_branch_caches.clear();
+  m_evicted_blocks.clear();
   trampolines.ClearCodeSpace();
   m_far_code.ClearCodeSpace();
   m_const_pool.Clear();
   ClearCodeSpace();
+  ResetCodeRegions();
   Clear();
   UpdateMemoryOptions();
 }
 
 void Jit64::Shutdown()
 {
+  if (m_compile_thread)
+  {
+    m_compile_thread_stop.Set();
+    m_compile_thread.reset();
+    DiscardBackgroundCompiles();
+
+    const BackgroundCompileStats& stats = m_background_stats;
+    NOTICE_LOG(DYNA_REC,
+               "Background JIT: %" PRIu64 " blocks queued (max queue depth %zu), %" PRIu64
+               " installed, %" PRIu64 " discarded, %" PRIu64
+               " blocks interpreted, %" PRIu64 " us of compile stalls avoided",
+               stats.queued, stats.max_queue_depth, stats.installed, stats.discarded,
+               stats.interpreted_blocks, stats.stall_time_avoided_us);
+  }
+
+  NOTICE_LOG(DYNA_REC,
+             "Indirect branch caches: %" PRIu64 " sites, %" PRIu64 " fills, %" PRIu64
+             " misses through the dispatcher",
+             m_indirect_branch_sites, m_indirect_branch_fills, m_indirect_branch_misses);
+
+  if (m_partial_eviction)
+  {
+    const EvictionStats& stats = m_eviction_stats;
+    NOTICE_LOG(DYNA_REC,
+               "Code cache eviction: %" PRIu64 " regions evicted in %" PRIu64 " us, %" PRIu64
+               " blocks evicted, %" PRIu64 " hot blocks kept, %" PRIu64
+               " evicted blocks recompiled in %" PRIu64 " us",
+               stats.evictions, stats.eviction_time_us, stats.blocks_evicted, stats.blocks_kept,
+               stats.blocks_recompiled, stats.recompile_time_us);
+  }
+
+  if (m_tiered_compilation)
+  {
+    blocks.RunOnBlocks([this](const JitBlock& block) { AccumulateTierStats(block); });
+
+    u64 total_instructions = 0;
+    for (const TierStats& stats : m_tier_stats)
+      total_instructions += stats.instructions;
+    for (size_t tier = 0; tier < NUM_TIERS; tier++)
+    {
+      const TierStats& stats = m_tier_stats[tier];
+      NOTICE_LOG(DYNA_REC,
+                 "Tier %zu: %" PRIu64 " blocks, %" PRIu64 " runs, %" PRIu64
+                 " instructions executed (%.1f%%), %" PRIu64 " profiled ticks",
+                 tier, stats.blocks, stats.runs, stats.instructions,
+                 total_instructions ? 100.0 * stats.instructions / total_instructions : 0.0,
+                 stats.ticks);
+    }
+    NOTICE_LOG(DYNA_REC,
+               "Tiered JIT: %" PRIu64 " blocks recompiled in %" PRIu64 " us, %" PRIu64
+               " conditional branches followed by traces",
+               m_tier_ups, m_tier_up_time_us, m_trace_branches);
+  }
+
   FreeStack();
   FreeCodeSpace();
 
@@ -497,6 +612,93 @@ void Jit64::WriteBLRExit()
   RET();
 }
 
+// Leaves the block through an inline cache for the target in RSCRATCH. On a hit, this takes an exit
+// which is linked to the cached target's block; on a miss, it goes through the dispatcher and, for
+// the first few misses, points the cache at the new target.
+void Jit64::WriteBCTRExit(bool bl, u32 after)
+{
+  if (!jo.enableBlocklink)
+  {
+    WriteExitDestInRSCRATCH(bl, after);
+    return;
+  }
+
+  if (!m_enable_blr_optimization)
+    bl = false;
+  MOV(32, PPCSTATE(pc), R(RSCRATCH));
+  if (Cleanup())
+    MOV(32, R(RSCRATCH), PPCSTATE(pc));
+
+  u32 index = static_cast<u32>(m_indirect_branch_caches.size());
+  if (m_free_indirect_branch_caches.empty())
+  {
+    m_indirect_branch_caches.emplace_back();
+  }
+  else
+  {
+    index = m_free_indirect_branch_caches.back();
+    m_free_indirect_branch_caches.pop_back();
+  }
+
+  IndirectBranchCache cache = {};
+  cache.block_address = js.blockStart;
+  cache.msr_bits = js.curBlock->msrBits;
+  cache.call = bl;
+
+  // Branch targets are word aligned, so nothing matches the empty cache.
+  CMP(32, R(RSCRATCH), Imm32(UINT32_MAX));
+  cache.target_imm = GetWritableCodePtr() - sizeof(u32);
+  FixupBranch miss = J_CC(CC_NE, true);
+  if (bl)
+  {
+    MOV(32, R(RSCRATCH2), Imm32(after));
+    PUSH(RSCRATCH2);
+  }
+  SUB(32, PPCSTATE(downcount), Imm32(js.downcountAmount));
+  cache.exit_ptr = GetWritableCodePtr();
+  if (bl)
+    CALL(asm_routines.dispatcher);
+  else
+    JMP(asm_routines.dispatcher, true);
+  const u8* return_point = GetCodePtr();
+  if (bl)
+  {
+    POP(RSCRATCH);
+    JustWriteExit(after, false, 0);
+  }
+
+  SwitchToFarCode();
+  SetJumpTarget(miss);
+  MOV(64, R(RSCRATCH2), ImmPtr(&m_indirect_branch_misses));
+  ADD(64, MatR(RSCRATCH2), Imm8(1));
+  cache.fill_jump = GetWritableCodePtr();
+  FixupBranch fill = J(true);
+  SetJumpTarget(fill);
+  ABI_PushRegistersAndAdjustStack({}, 0);
+  ABI_CallFunctionPC(FillIndirectBranchCacheTrampoline, this, index);
+  ABI_PopRegistersAndAdjustStack({}, 0);
+  cache.dispatch = GetCodePtr();
+  if (bl)
+  {
+    MOV(32, R(RSCRATCH2), Imm32(after));
+    PUSH(RSCRATCH2);
+  }
+  SUB(32, PPCSTATE(downcount), Imm32(js.downcountAmount));
+  if (bl)
+  {
+    CALL(asm_routines.dispatcher);
+    JMP(return_point, true);
+  }
+  else
+  {
+    JMP(asm_routines.dispatcher, true);
+  }
+  SwitchToNearCode();
+
+  m_indirect_branch_caches[index] = cache;
+  m_indirect_branch_sites++;
+}
+
 void Jit64::WriteRfiExitDestInRSCRATCH()
 {
   MOV(32, PPCSTATE(pc), R(RSCRATCH));
@@ -571,6 +773,15 @@ void Jit64::Trace()
 
 void Jit64::Jit(u32 em_address)
 {
+  std::unique_lock<std::mutex> lock;
+  if (m_compile_thread)
+  {
+    PrewarmHotBlocks();
+    if (DeferToBackgroundCompiler(em_address))
+      return;
+    lock = LockCompiler();
+  }
+
   if (m_cleanup_after_stackfault)
   {
     ClearCache();
@@ -581,10 +792,28 @@ void Jit64::Jit(u32 em_address)
 #endif
   }
 
-  if (IsAlmostFull() || m_far_code.IsAlmostFull() || trampolines.IsAlmostFull() ||
-      SConfig::GetInstance().bJITNoBlockCache)
+  if (IsCodeSpaceFull() || SConfig::GetInstance().bJITNoBlockCache)
   {
-    ClearCache();
+    // Trampolines aren't kept per region, so running out of those still needs a full clear.
+    if (m_partial_eviction && !trampolines.IsAlmostFull())
+    {
+      EvictCodeRegion();
+      // The block may have been one of the hot ones which were compiled again.
+      if (blocks.GetBlockFromStartAddress(em_address, MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK))
+        return;
+    }
+    else
+    {
+      ClearCache();
+    }
+  }
+
+  if (!m_compile_thread && m_hot_block_profile.HasPendingEntries())
+  {
+    PrewarmHotBlocks();
+    // The dispatcher will pick the block up if it was one of the prewarmed ones.
+    if (blocks.GetBlockFromStartAddress(em_address, MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK))
+      return;
   }
 
   int blockSize = code_buffer.GetSize();
@@ -617,6 +846,13 @@ void Jit64::Jit(u32 em_address)
   // Analyze the block, collect all instructions it is made of (including inlining,
   // if that is enabled), reorder instructions for optimal performance, and join joinable
   // instructions.
+  // Evicted blocks which are needed again are what eviction costs us.
+  const bool recompiling_evicted_block =
+      !m_evicted_blocks.empty() &&
+      m_evicted_blocks.erase(static_cast<u64>(MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK) << 32 |
+                             em_address) != 0;
+  const u64 start_time = recompiling_evicted_block ? Common::Timer::GetTimeUs() : 0;
+
   u32 nextPC = analyzer.Analyze(em_address, &code_block, &code_buffer, blockSize);
 
   if (code_block.m_memory_exception)
@@ -630,12 +866,20 @@ void Jit64::Jit(u32 em_address)
   }
 
   JitBlock* b = blocks.AllocateBlock(em_address);
-  DoJit(em_address, &code_buffer, b, nextPC);
+  DoJit(em_address, &code_buffer, b, nextPC, CaptureCompileInputs());
   blocks.FinalizeBlock(*b, jo.enableBlocklink, code_block.m_physical_addresses);
+
+  if (recompiling_evicted_block)
+  {
+    m_eviction_stats.blocks_recompiled++;
+    m_eviction_stats.recompile_time_us += Common::Timer::GetTimeUs() - start_time;
+  }
 }
 
-const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock* b, u32 nextPC)
+const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock* b, u32 nextPC,
+                       const CompileInputs& inputs)
 {
+  js.compileInputs = inputs;
   js.firstFPInstructionFound = false;
   js.isLastInstruction = false;
   js.blockStart = em_address;
@@ -669,6 +913,33 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
     ABI_PopRegistersAndAdjustStack({}, 0);
   }
 
+  m_run_counter_address = nullptr;
+  if (m_tiered_compilation)
+  {
+    // Count the block's runs, for the tier stats and to find hot tier 0 blocks. The profiling
+    // code below does the counting if it is enabled.
+    MOV(64, R(RSCRATCH), ImmPtr(&b->profile_data.runCount));
+    m_run_counter_address = GetWritableCodePtr() - sizeof(u64);
+    if (!Profiler::g_ProfileBlocks)
+      ADD(64, MatR(RSCRATCH), Imm8(1));
+
+    if (b->tier == 0)
+    {
+      CMP(64, MatR(RSCRATCH), Imm32(TIER_UP_THRESHOLD));
+      FixupBranch tier_up = J_CC(CC_AE, true);
+      SwitchToFarCode();
+      SetJumpTarget(tier_up);
+      // Nothing has been done yet, so simply leave through the dispatcher, which will pick up
+      // the recompiled block.
+      MOV(32, PPCSTATE(pc), Imm32(js.blockStart));
+      ABI_PushRegistersAndAdjustStack({}, 0);
+      ABI_CallFunctionPC(TierUpTrampoline, this, js.blockStart);
+      ABI_PopRegistersAndAdjustStack({}, 0);
+      JMP(asm_routines.dispatcherNoCheck, true);
+      SwitchToNearCode();
+    }
+  }
+
   // Conditionally add profiling code.
   if (Profiler::g_ProfileBlocks)
   {
@@ -719,7 +990,7 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
       // the start of the block in case our guess turns out wrong.
       for (int gqr : gqr_static)
       {
-        u32 value = GQR(gqr);
+        u32 value = js.compileInputs.gqr[gqr];
         js.constantGqr[gqr] = value;
         CMP_or_TEST(32, PPCSTATE(spr[SPR_GQR0 + gqr]), Imm32(value));
         J_CC(CC_NZ, target);
@@ -737,6 +1008,8 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
   for (u32 i = 0; i < code_block.m_num_instructions; i++)
   {
     js.compilerPC = ops[i].address;
+    if (ShouldRecordSourceMap())
+      b->source_map.emplace_back(static_cast<u32>(GetCodePtr() - start), ops[i].address);
     js.op = &ops[i];
     js.instructionNumber = i;
     js.instructionsLeft = (code_block.m_num_instructions - 1) - i;
@@ -972,6 +1245,480 @@ const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBloc
   return normalEntry;
 }
 
+std::unique_lock<std::mutex> Jit64::LockCompiler()
+{
+  if (!m_compile_thread)
+    return {};
+
+  return std::unique_lock<std::mutex>(m_compile_lock);
+}
+
+void Jit64::DiscardBackgroundCompiles()
+{
+  for (const BackgroundCompileResult& result : m_background_compiles)
+  {
+    m_queued_compiles.erase(static_cast<u64>(result.msr_bits) << 32 | result.address);
+    m_background_stats.discarded++;
+  }
+  m_background_compiles.clear();
+}
+
+// Compiles the blocks from the hot block profile whose code has been loaded since the last check,
+// or hands them to the compile thread. Called on the CPU thread on a dispatcher miss; when
+// compiling synchronously, the compiler lock must be held.
+void Jit64::PrewarmHotBlocks()
+{
+  if (SConfig::GetInstance().bEnableDebugging || SConfig::GetInstance().bJITNoBlockCache ||
+      m_cleanup_after_stackfault)
+  {
+    return;
+  }
+
+  const u32 msr_bits = MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK;
+  for (const JitHotBlockProfile::Entry& entry : m_hot_block_profile.TakeLoadedEntries(msr_bits))
+  {
+    const u32 address = entry.effective_address;
+    if (blocks.GetBlockFromStartAddress(address, msr_bits))
+      continue;
+
+    if (m_compile_thread)
+    {
+      if (CanCompileInBackground(address, msr_bits))
+        QueueBackgroundCompile(address, msr_bits);
+      continue;
+    }
+
+    if (IsCodeSpaceFull())
+      break;
+
+    // Don't touch the TLB or the instruction cache for a block which may never run.
+    analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_READS);
+    const u32 nextPC = analyzer.Analyze(address, &code_block, &code_buffer, code_buffer.GetSize());
+    analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_READS);
+
+    // The address has to map to the code which was hashed. The block may still come out smaller
+    // than the recorded one, e.g. if that was compiled at a higher tier.
+    if (code_block.m_memory_exception ||
+        !JitHotBlockProfile::ContainsAddresses(entry, code_block.m_physical_addresses))
+    {
+      continue;
+    }
+
+    JitBlock* b = blocks.AllocateBlock(address);
+    DoJit(address, &code_buffer, b, nextPC, CaptureCompileInputs());
+    blocks.FinalizeBlock(*b, jo.enableBlocklink, code_block.m_physical_addresses);
+  }
+}
+
+// Called on the CPU thread for a block which isn't compiled yet. Returns false if the block has
+// to be compiled synchronously; otherwise the block has either been installed from a finished
+// background compile or been run by the interpreter, and the dispatcher should look at PC again.
+bool Jit64::DeferToBackgroundCompiler(u32 em_address)
+{
+  const u32 msr_bits = MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK;
+
+  // Don't wait for the compile thread to finish its current block; that's the stall we're trying
+  // to avoid. Finished blocks will get installed on a later miss.
+  std::unique_lock<std::mutex> lock(m_compile_lock, std::try_to_lock);
+  if (lock.owns_lock())
+  {
+    InstallBackgroundCompiles();
+    if (blocks.GetBlockFromStartAddress(em_address, msr_bits))
+      return true;
+  }
+
+  if (!CanCompileInBackground(em_address, msr_bits))
+    return false;
+
+  QueueBackgroundCompile(em_address, msr_bits);
+
+  if (lock.owns_lock())
+    lock.unlock();
+
+  m_background_stats.interpreted_blocks++;
+  Interpreter::getInstance()->RunBlock();
+  return true;
+}
+
+bool Jit64::CanCompileInBackground(u32 em_address, u32 msr_bits) const
+{
+  if (m_compile_thread_full.IsSet() || m_cleanup_after_stackfault || Profiler::g_ProfileBlocks ||
+      SConfig::GetInstance().bJITNoBlockCache)
+  {
+    return false;
+  }
+
+  // The compile thread can't walk the page table, so make sure it will be able to read the code.
+  return PowerPC::HostTryReadInstruction(em_address).valid;
+}
+
+void Jit64::QueueBackgroundCompile(u32 em_address, u32 msr_bits)
+{
+  if (m_queued_compiles.insert(static_cast<u64>(msr_bits) << 32 | em_address).second)
+  {
+    m_compile_thread->EmplaceItem(
+        BackgroundCompileRequest{em_address, msr_bits, CaptureCompileInputs()});
+    m_background_stats.queued++;
+    m_background_stats.max_queue_depth =
+        std::max(m_background_stats.max_queue_depth, m_queued_compiles.size());
+  }
+}
+
+void Jit64::CompileInBackground(BackgroundCompileRequest request)
+{
+  if (m_compile_thread_stop.IsSet())
+    return;
+
+  std::lock_guard<std::mutex> lock(m_compile_lock);
+
+  m_background_compiles.emplace_back();
+  BackgroundCompileResult& result = m_background_compiles.back();
+  result.address = request.address;
+  result.msr_bits = request.msr_bits;
+  result.success = false;
+
+  // Profiling code refers to the JitBlock by address, which only exists once the block is
+  // installed.
+  if (m_compile_thread_full.IsSet() || Profiler::g_ProfileBlocks)
+    return;
+
+  // Leave clearing the cache to the CPU thread, which will compile synchronously from now on.
+  if (IsCodeSpaceFull())
+  {
+    m_compile_thread_full.Set();
+    return;
+  }
+
+  const u64 start_time = Common::Timer::GetTimeUs();
+
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_READS);
+  const u32 nextPC =
+      analyzer.Analyze(request.address, &code_block, &code_buffer, code_buffer.GetSize());
+  analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_READS);
+
+  if (code_block.m_memory_exception)
+    return;
+
+  JitBlock& b = result.block;
+  b.effectiveAddress = request.address;
+  b.msrBits = request.msr_bits;
+  b.codeSize = 0;
+  b.originalSize = 0;
+  b.tier = 0;
+  DoJit(request.address, &code_buffer, &b, nextPC, request.inputs);
+  result.run_counter_address = m_run_counter_address;
+
+  result.physical_addresses = code_block.m_physical_addresses;
+  result.instructions.reserve(code_block.m_num_instructions);
+  for (u32 i = 0; i < code_block.m_num_instructions; i++)
+  {
+    const PPCAnalyst::CodeOp& op = code_buffer.codebuffer[i];
+    result.instructions.emplace_back(op.address, op.inst.hex);
+  }
+
+  result.compile_time_us = Common::Timer::GetTimeUs() - start_time;
+  result.success = !Profiler::g_ProfileBlocks;
+}
+
+// Moves finished background compiles into the block cache. Must be called on the CPU thread with
+// the compiler lock held.
+void Jit64::InstallBackgroundCompiles()
+{
+  for (BackgroundCompileResult& result : m_background_compiles)
+  {
+    m_queued_compiles.erase(static_cast<u64>(result.msr_bits) << 32 | result.address);
+
+    if (!IsBackgroundCompileCurrent(result))
+    {
+      m_background_stats.discarded++;
+      continue;
+    }
+
+    JitBlock* b = blocks.AllocateBlock(result.address);
+    b->checkedEntry = result.block.checkedEntry;
+    b->normalEntry = result.block.normalEntry;
+    b->codeSize = result.block.codeSize;
+    b->originalSize = result.block.originalSize;
+    b->linkData = std::move(result.block.linkData);
+    b->source_map = std::move(result.block.source_map);
+    if (result.run_counter_address)
+    {
+      const u64 run_counter = reinterpret_cast<u64>(&b->profile_data.runCount);
+      std::memcpy(result.run_counter_address, &run_counter, sizeof(run_counter));
+    }
+    blocks.FinalizeBlock(*b, jo.enableBlocklink, result.physical_addresses);
+
+    m_background_stats.installed++;
+    m_background_stats.stall_time_avoided_us += result.compile_time_us;
+  }
+  m_background_compiles.clear();
+}
+
+bool Jit64::IsBackgroundCompileCurrent(const BackgroundCompileResult& result)
+{
+  if (!result.success || Profiler::g_ProfileBlocks)
+    return false;
+
+  if ((MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK) != result.msr_bits ||
+      blocks.GetBlockFromStartAddress(result.address, result.msr_bits))
+  {
+    return false;
+  }
+
+  // The compile thread read memory directly. Check that the CPU would still fetch the same code
+  // from the same place; this also catches code which was modified after the block was queued.
+  for (const auto& instruction : result.instructions)
+  {
+    const PowerPC::TryReadInstResult read = PowerPC::TryReadInstruction(instruction.first);
+    if (!read.valid || read.hex != instruction.second ||
+        result.physical_addresses.find(read.physical_address) == result.physical_addresses.end())
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Jit64::TierUpTrampoline(Jit64* jit, u32 em_address)
+{
+  jit->TierUp(em_address);
+}
+
+// Recompiles a hot tier 0 block with the expensive analysis passes. Called from the block itself
+// before it has executed any instructions; the block's code stays around until the next cache
+// clear or eviction of its region, so returning to it is fine.
+void Jit64::TierUp(u32 em_address)
+{
+  // If the compile thread is busy, try again on the block's next run.
+  std::unique_lock<std::mutex> lock(m_compile_lock, std::defer_lock);
+  if (m_compile_thread && !lock.try_lock())
+    return;
+
+  const u32 msr_bits = MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK;
+  JitBlock* old_block = blocks.GetBlockFromStartAddress(em_address, msr_bits);
+  if (!old_block || old_block->tier != 0)
+    return;
+
+  // Clearing the cache here would free the code we return to, so leave that to the next
+  // dispatcher miss.
+  if (IsCodeSpaceFull())
+    return;
+
+  const u64 start_time = Common::Timer::GetTimeUs();
+  if (CompileHotBlock(em_address, old_block))
+    m_tier_ups++;
+  m_tier_up_time_us += Common::Timer::GetTimeUs() - start_time;
+}
+
+// Compiles the block at em_address at tier 1, replacing old_block if there is one. Returns false
+// if the code couldn't be read.
+bool Jit64::CompileHotBlock(u32 em_address, JitBlock* old_block)
+{
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CROSS_BRANCH_LIVENESS);
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_EXTENDED_BLOCKS);
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_TRACES);
+
+  const u32 nextPC = analyzer.Analyze(em_address, &code_block, &code_buffer, code_buffer.GetSize());
+  const bool success = !code_block.m_memory_exception;
+  if (success)
+  {
+    // Replacing the block unlinks the blocks jumping to it; finalizing the new one links them
+    // to it again.
+    if (old_block)
+    {
+      AccumulateTierStats(*old_block);
+      blocks.EraseBlock(*old_block);
+    }
+
+    JitBlock* b = blocks.AllocateBlock(em_address);
+    b->tier = 1;
+    DoJit(em_address, &code_buffer, b, nextPC, CaptureCompileInputs());
+    blocks.FinalizeBlock(*b, jo.enableBlocklink, code_block.m_physical_addresses);
+    m_trace_branches += std::count_if(
+        code_buffer.codebuffer, code_buffer.codebuffer + code_block.m_num_instructions,
+        [](const PPCAnalyst::CodeOp& op) { return op.isTraceBranch; });
+  }
+
+  analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_CROSS_BRANCH_LIVENESS);
+  analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_EXTENDED_BLOCKS);
+  analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_TRACES);
+  return success;
+}
+
+void Jit64::AccumulateTierStats(const JitBlock& block)
+{
+  TierStats& stats = m_tier_stats[std::min<size_t>(block.tier, NUM_TIERS - 1)];
+  stats.blocks++;
+  stats.runs += block.profile_data.runCount;
+  stats.instructions += block.profile_data.runCount * block.originalSize;
+  stats.ticks += block.profile_data.ticCounter;
+}
+
+// Makes tier 0 code count the outcomes of a conditional branch, for tier 1 to decide which ones
+// its traces follow.
+void Jit64::CountBranch(UGeckoInstruction inst, bool taken)
+{
+  const bool conditional =
+      (inst.BO & BO_DONT_DECREMENT_FLAG) == 0 || (inst.BO & BO_DONT_CHECK_CONDITION) == 0;
+  if (!m_tiered_compilation || analyzer.HasOption(PPCAnalyst::PPCAnalyzer::OPTION_TRACES) ||
+      !conditional || inst.LK)
+  {
+    return;
+  }
+
+  BranchCounts& counts = m_branch_counts[js.compilerPC];
+  MOV(64, R(RSCRATCH), ImmPtr(taken ? &counts.taken : &counts.not_taken));
+  ADD(32, MatR(RSCRATCH), Imm8(1));
+}
+
+bool Jit64::IsBranchLikelyTaken(u32 address) const
+{
+  const auto it = m_branch_counts.find(address);
+  if (it == m_branch_counts.end())
+    return false;
+
+  const u64 taken = it->second.taken;
+  const u64 runs = taken + it->second.not_taken;
+  return runs >= TRACE_MIN_BRANCH_RUNS && taken * 16 >= runs * 15;
+}
+
+void Jit64::FillIndirectBranchCacheTrampoline(Jit64* jit, u32 index)
+{
+  jit->FillIndirectBranchCache(index);
+}
+
+// Called on a miss with the branch target in PC. The block containing the cache might have been
+// replaced since it was entered, in which case its code is only left through the dispatcher.
+void Jit64::FillIndirectBranchCache(u32 index)
+{
+  std::unique_lock<std::mutex> lock(m_compile_lock, std::defer_lock);
+  if (m_compile_thread && !lock.try_lock())
+    return;
+
+  IndirectBranchCache& cache = m_indirect_branch_caches[index];
+  JitBlock* block = blocks.GetBlockFromStartAddress(cache.block_address, cache.msr_bits);
+  const bool in_block = block && cache.exit_ptr >= block->checkedEntry &&
+                        cache.exit_ptr < block->checkedEntry + block->codeSize;
+  if (!in_block || (MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK) != cache.msr_bits)
+  {
+    return;
+  }
+
+  const u32 target = PC;
+  std::memcpy(cache.target_imm, &target, sizeof(target));
+  blocks.RetargetExit(*block, cache.exit_ptr, cache.call, target);
+  m_indirect_branch_fills++;
+
+  // Polymorphic sites go straight to the dispatcher from now on.
+  if (++cache.fills == MAX_INDIRECT_BRANCH_CACHE_FILLS)
+  {
+    XEmitter emitter(cache.fill_jump);
+    emitter.JMP(cache.dispatch, true);
+  }
+}
+
+bool Jit64::IsCodeSpaceFull() const
+{
+  if (trampolines.IsAlmostFull())
+    return true;
+  if (!m_partial_eviction)
+    return IsAlmostFull() || m_far_code.IsAlmostFull();
+
+  // Regions are evicted as a whole, so a block must not run past the end of the current one.
+  const u8* near_end = m_near_code_base + (m_code_region + 1) * m_near_region_size;
+  const u8* far_end = m_far_code_base + (m_code_region + 1) * m_far_region_size;
+  return static_cast<size_t>(near_end - GetCodePtr()) < CODE_REGION_MARGIN ||
+         static_cast<size_t>(far_end - m_far_code.GetCodePtr()) < CODE_REGION_MARGIN;
+}
+
+// Called when both code spaces have just been emptied.
+void Jit64::ResetCodeRegions()
+{
+  m_code_region = 0;
+  m_near_code_base = GetWritableCodePtr();
+  m_far_code_base = m_far_code.GetWritableCodePtr();
+}
+
+// Makes room by moving on to the next region and evicting the blocks which were compiled into it,
+// i.e. the oldest code. Tier 1 blocks have been hot since they were compiled, so they are compiled
+// into the new region again right away. Only call this where a full cache clear would be safe.
+void Jit64::EvictCodeRegion()
+{
+  const u64 start_time = Common::Timer::GetTimeUs();
+
+  // Finished background compiles can be in any region.
+  DiscardBackgroundCompiles();
+  m_compile_thread_full.Clear();
+
+  m_code_region = (m_code_region + 1) % NUM_CODE_REGIONS;
+  u8* near_start = m_near_code_base + m_code_region * m_near_region_size;
+  u8* near_end = near_start + m_near_region_size;
+  u8* far_start = m_far_code_base + m_code_region * m_far_region_size;
+  u8* far_end = far_start + m_far_region_size;
+  const auto in_region = [near_start, near_end](const u8* ptr) {
+    return ptr >= near_start && ptr < near_end;
+  };
+
+  const u32 msr_bits = MSR & JitBaseBlockCache::JIT_CACHE_MSR_MASK;
+  std::vector<u32> hot_blocks;
+  blocks.RunOnBlocks([&](const JitBlock& block) {
+    if (!in_region(block.checkedEntry))
+      return;
+    m_hot_block_profile.RecordBlock(block);
+    if (m_tiered_compilation)
+      AccumulateTierStats(block);
+    // Blocks can only be compiled for the current address translation.
+    if (block.tier != 0 && block.msrBits == msr_bits)
+      hot_blocks.push_back(block.effectiveAddress);
+    else
+      m_evicted_blocks.insert(static_cast<u64>(block.msrBits) << 32 | block.effectiveAddress);
+  });
+  const size_t num_evicted = blocks.EraseBlocksInCodeRange(near_start, near_end);
+
+  // Drop everything else which refers to the evicted code. The inline caches' far code is in the
+  // far region with the same index, so nothing can call FillIndirectBranchCache for them anymore.
+  for (auto it = m_back_patch_info.begin(); it != m_back_patch_info.end();)
+    it = in_region(it->first) ? m_back_patch_info.erase(it) : std::next(it);
+  for (auto it = m_exception_handler_at_loc.begin(); it != m_exception_handler_at_loc.end();)
+    it = in_region(it->first) ? m_exception_handler_at_loc.erase(it) : std::next(it);
+  for (u32 i = 0; i < m_indirect_branch_caches.size(); i++)
+  {
+    IndirectBranchCache& cache = m_indirect_branch_caches[i];
+    if (cache.exit_ptr && in_region(cache.exit_ptr))
+    {
+      cache.exit_ptr = nullptr;
+      m_free_indirect_branch_caches.push_back(i);
+    }
+  }
+
+  SetCodePtr(near_start);
+  m_far_code.SetCodePtr(far_start);
+
+  // Leave at least half of the region for new code, or the next eviction would come right away.
+  size_t num_kept = 0;
+  analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_READS);
+  for (u32 address : hot_blocks)
+  {
+    const bool has_space =
+        static_cast<size_t>(near_end - GetCodePtr()) > m_near_region_size / 2 &&
+        static_cast<size_t>(far_end - m_far_code.GetCodePtr()) > m_far_region_size / 2;
+    if (has_space && CompileHotBlock(address, nullptr))
+      num_kept++;
+    else
+      m_evicted_blocks.insert(static_cast<u64>(msr_bits) << 32 | address);
+  }
+  analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_READS);
+
+  const u64 eviction_time = Common::Timer::GetTimeUs() - start_time;
+  m_eviction_stats.evictions++;
+  m_eviction_stats.eviction_time_us += eviction_time;
+  m_eviction_stats.blocks_evicted += num_evicted;
+  m_eviction_stats.blocks_kept += num_kept;
+  INFO_LOG(DYNA_REC, "Evicted code region %zu: %zu blocks, %zu hot blocks kept, %" PRIu64 " us",
+           m_code_region, num_evicted, num_kept, eviction_time);
+}
+
 BitSet8 Jit64::ComputeStaticGQRs(const PPCAnalyst::CodeBlock& cb) const
 {
   return cb.m_gqr_used & ~cb.m_gqr_modified;
@@ -1017,7 +1764,7 @@ void Jit64::IntializeSpeculativeConstants()
   const u8* target = nullptr;
   for (auto i : code_block.m_gpr_inputs)
   {
-    u32 compileTimeValue = PowerPC::ppcState.gpr[i];
+    u32 compileTimeValue = js.compileInputs.gpr[i];
     if (PowerPC::IsOptimizableGatherPipeWrite(compileTimeValue) ||
         PowerPC::IsOptimizableGatherPipeWrite(compileTimeValue - 0x8000) ||
         compileTimeValue == 0xCC000000)
@@ -18,7 +18,18 @@
 // ----------
 #pragma once
 
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 #include "Common/CommonTypes.h"
+#include "Common/Flag.h"
+#include "Common/WorkQueueThread.h"
 #include "Common/x64ABI.h"
 #include "Common/x64Emitter.h"
 #include "Core/PowerPC/Jit64/FPURegCache.h"
@@ -46,7 +57,8 @@ public:
   // Jit!
 
   void Jit(u32 em_address) override;
-  const u8* DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock* b, u32 nextPC);
+  const u8* DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock* b, u32 nextPC,
+                  const CompileInputs& inputs);
 
   BitSet32 CallerSavedRegistersInUse() const;
   BitSet8 ComputeStaticGQRs(const PPCAnalyst::CodeBlock&) const;
@@ -58,6 +70,9 @@ public:
 
   void ClearCache() override;
 
+  std::unique_lock<std::mutex> LockCompiler() override;
+  void DiscardBackgroundCompiles() override;
+
   const CommonAsmRoutines* GetAsmRoutines() override { return &asm_routines; }
   const char* GetName() override { return "JIT64"; }
   // Run!
@@ -71,6 +86,7 @@ public:
   void JustWriteExit(u32 destination, bool bl, u32 after);
   void WriteExitDestInRSCRATCH(bool bl = false, u32 after = 0);
   void WriteBLRExit();
+  void WriteBCTRExit(bool bl, u32 after);
   void WriteExceptionExit();
   void WriteExternalExceptionExit();
   void WriteRfiExitDestInRSCRATCH();
@@ -231,12 +247,132 @@ public:
   void eieio(UGeckoInstruction inst);
 
 private:
+  struct BackgroundCompileRequest
+  {
+    u32 address;
+    u32 msr_bits;
+    CompileInputs inputs;
+  };
+
+  struct BackgroundCompileResult
+  {
+    u32 address;
+    u32 msr_bits;
+    bool success;
+    JitBlock block;
+    std::set<u32> physical_addresses;
+    // Effective address and encoding of every instruction the block was compiled from.
+    std::vector<std::pair<u32, u32>> instructions;
+    u64 compile_time_us;
+    // Where the code refers to the block's run counter; see m_run_counter_address.
+    u8* run_counter_address;
+  };
+
+  struct BackgroundCompileStats
+  {
+    u64 queued;
+    u64 installed;
+    u64 discarded;
+    u64 interpreted_blocks;
+    size_t max_queue_depth;
+    // Time the compile thread spent on blocks which got installed, i.e. the time the CPU thread
+    // would otherwise have been stalled for.
+    u64 stall_time_avoided_us;
+  };
+
+  // Tier 0 blocks are recompiled at tier 1 after this many runs.
+  static constexpr u64 TIER_UP_THRESHOLD = 1000;
+  static constexpr size_t NUM_TIERS = 2;
+
+  struct TierStats
+  {
+    u64 blocks;
+    u64 runs;
+    // Guest instructions executed in blocks of this tier.
+    u64 instructions;
+    // Host time spent in blocks of this tier; only counted while block profiling is enabled.
+    u64 ticks;
+  };
+
+  // How often a conditional branch in tier 0 code went each way.
+  struct BranchCounts
+  {
+    u32 taken;
+    u32 not_taken;
+  };
+
+  // A monomorphic inline cache for an indirect branch through CTR. The emitted code compares the
+  // branch target against the cached one and takes a linked exit if they match.
+  struct IndirectBranchCache
+  {
+    u32 block_address;
+    u32 msr_bits;
+    bool call;
+    u32 fills;
+    // The immediate of the target comparison.
+    u8* target_imm;
+    // The linkable exit taken on a hit.
+    u8* exit_ptr;
+    // The jump on the miss path to the code which fills the cache, and the code dispatching
+    // without doing so.
+    u8* fill_jump;
+    const u8* dispatch;
+  };
+
+  // Sites which miss after being filled this many times are left to the dispatcher.
+  static constexpr u32 MAX_INDIRECT_BRANCH_CACHE_FILLS = 4;
+
+  // Tier 1 traces follow conditional branches which were taken at least 15 out of 16 times,
+  // in at least this many runs.
+  static constexpr u32 TRACE_MIN_BRANCH_RUNS = 64;
+
+  // The near and far code spaces are split into this many regions, which are filled in turn.
+  // When the current region fills up, only the blocks in the next one are evicted.
+  static constexpr size_t NUM_CODE_REGIONS = 8;
+  // Like X64CodeBlock::IsAlmostFull(), this has to be bigger than the biggest block.
+  static constexpr size_t CODE_REGION_MARGIN = 0x10000;
+
+  struct EvictionStats
+  {
+    u64 evictions;
+    // Includes compiling the hot blocks again.
+    u64 eviction_time_us;
+    u64 blocks_evicted;
+    // Hot blocks which were compiled into the new region right after being evicted.
+    u64 blocks_kept;
+    // Evicted blocks which ran again and had to be compiled on a dispatcher miss.
+    u64 blocks_recompiled;
+    u64 recompile_time_us;
+  };
+
   static void InitializeInstructionTables();
   void CompileInstruction(PPCAnalyst::CodeOp& op);
 
   void AllocStack();
   void FreeStack();
 
+  void PrewarmHotBlocks();
+
+  static void TierUpTrampoline(Jit64* jit, u32 em_address);
+  void TierUp(u32 em_address);
+  bool CompileHotBlock(u32 em_address, JitBlock* old_block);
+  void AccumulateTierStats(const JitBlock& block);
+  void CountBranch(UGeckoInstruction inst, bool taken);
+  bool IsBranchLikelyTaken(u32 address) const;
+  static void FillIndirectBranchCacheTrampoline(Jit64* jit, u32 index);
+  void FillIndirectBranchCache(u32 index);
+
+  bool IsCodeSpaceFull() const;
+  void ResetCodeRegions();
+  void EvictCodeRegion();
+
+  bool DeferToBackgroundCompiler(u32 em_address);
+  bool CanCompileInBackground(u32 em_address, u32 msr_bits) const;
+  void QueueBackgroundCompile(u32 em_address, u32 msr_bits);
+  void CompileInBackground(BackgroundCompileRequest request);
+  void InstallBackgroundCompiles();
+  bool IsBackgroundCompileCurrent(const BackgroundCompileResult& result);
+
   GPRRegCache gpr{*this};
   FPURegCache fpr{*this};
 
@@ -246,6 +382,46 @@ private:
   Jit64AsmRoutineManager asm_routines;
 
   bool m_enable_blr_optimization;
+  bool m_tiered_compilation;
+  std::array<TierStats, NUM_TIERS> m_tier_stats;
+  u64 m_tier_ups;
+  u64 m_tier_up_time_us;
+  u64 m_trace_branches;
+  // Keyed by the branch's address. Emitted code points into the map, so it is only cleared
+  // together with the code.
+  std::map<u32, BranchCounts> m_branch_counts;
+  // Indexed by the number the emitted code passes to FillIndirectBranchCache(). Cleared together
+  // with the code.
+  std::vector<IndirectBranchCache> m_indirect_branch_caches;
+  u64 m_indirect_branch_sites;
+  u64 m_indirect_branch_fills;
+  u64 m_indirect_branch_misses;
+  // Entries of m_indirect_branch_caches whose code has been evicted, for reuse by new sites.
+  std::vector<u32> m_free_indirect_branch_caches;
+  bool m_partial_eviction;
+  // The region new code currently goes into, and the layout of the regions.
+  size_t m_code_region;
+  u8* m_near_code_base;
+  size_t m_near_region_size;
+  u8* m_far_code_base;
+  size_t m_far_region_size;
+  // (msr_bits << 32 | address) of every evicted block which hasn't been compiled again yet.
+  std::unordered_set<u64> m_evicted_blocks;
+  EvictionStats m_eviction_stats;
+  // Where DoJit put the address of the block's run counter into the code, so that it can be
+  // patched once a background compile gets its final JitBlock.
+  u8* m_run_counter_address;
   bool m_cleanup_after_stackfault;
   u8* m_stack;
+
+  // Background compilation. m_compile_lock guards all of the compiler state above as well as
+  // m_background_compiles; everything else is only touched by the CPU thread.
+  std::unique_ptr<Common::WorkQueueThread<BackgroundCompileRequest>> m_compile_thread;
+  std::mutex m_compile_lock;
+  std::vector<BackgroundCompileResult> m_background_compiles;
+  // (msr_bits << 32 | address) of every request which hasn't been installed or discarded yet.
+  std::unordered_set<u64> m_queued_compiles;
+  Common::Flag m_compile_thread_full;
+  Common::Flag m_compile_thread_stop;
+  BackgroundCompileStats m_background_stats;
 };
@@ -179,9 +179,19 @@ void Jit64AsmRoutineManager::Generate()
   ABI_CallFunction(JitTrampoline);
   ABI_PopRegistersAndAdjustStack({}, 0);
 
+  // With background compilation, Jit may have run the block in the interpreter instead.
+  FixupBranch interpreted_timing;
+  if (SConfig::GetInstance().bJITBackgroundCompile)
+  {
+    CMP(32, PPCSTATE(downcount), Imm8(0));
+    interpreted_timing = J_CC(CC_LE, true);
+  }
+
   JMP(dispatcherNoCheck, true);
 
   SetJumpTarget(bail);
+  if (SConfig::GetInstance().bJITBackgroundCompile)
+    SetJumpTarget(interpreted_timing);
   doTiming = GetCodePtr();
 
   // make sure npc contains the next pc (needed for exception checking in CoreTiming::Advance)
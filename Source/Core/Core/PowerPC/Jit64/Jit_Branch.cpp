@@ -154,12 +154,29 @@ void Jit64::bcx(UGeckoInstruction inst)
     return;
   }
 
+  // The analyzer built a trace through the branch target, so the block is only left if the
+  // branch isn't taken.
+  if (js.op->isTraceBranch)
+  {
+    SwitchToFarCode();
+    if ((inst.BO & BO_DONT_CHECK_CONDITION) == 0)
+      SetJumpTarget(pConditionDontBranch);
+    if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
+      SetJumpTarget(pCTRDontBranch);
+    gpr.Flush(RegCache::FlushMode::MaintainState);
+    fpr.Flush(RegCache::FlushMode::MaintainState);
+    WriteExit(js.compilerPC + 4);
+    SwitchToNearCode();
+    return;
+  }
+
   u32 destination;
   if (inst.AA)
     destination = SignExt16(inst.BD << 2);
   else
     destination = js.compilerPC + SignExt16(inst.BD << 2);
 
+  CountBranch(inst, true);
   gpr.Flush(RegCache::FlushMode::MaintainState);
   fpr.Flush(RegCache::FlushMode::MaintainState);
   WriteExit(destination, inst.LK, js.compilerPC + 4);
@@ -168,6 +185,7 @@ void Jit64::bcx(UGeckoInstruction inst)
     SetJumpTarget(pConditionDontBranch);
   if ((inst.BO & BO_DONT_DECREMENT_FLAG) == 0)
     SetJumpTarget(pCTRDontBranch);
+  CountBranch(inst, false);
 
   if (!analyzer.HasOption(PPCAnalyst::PPCAnalyzer::OPTION_CONDITIONAL_CONTINUE))
   {
@@ -198,7 +216,7 @@ void Jit64::bcctrx(UGeckoInstruction inst)
     if (inst.LK_3)
       MOV(32, PPCSTATE_LR, Imm32(js.compilerPC + 4));  // LR = PC + 4;
     AND(32, R(RSCRATCH), Imm32(0xFFFFFFFC));
-    WriteExitDestInRSCRATCH(inst.LK_3, js.compilerPC + 4);
+    WriteBCTRExit(inst.LK_3, js.compilerPC + 4);
   }
   else
   {
@@ -211,13 +229,13 @@ void Jit64::bcctrx(UGeckoInstruction inst)
         JumpIfCRFieldBit(inst.BI >> 2, 3 - (inst.BI & 3), !(inst.BO_2 & BO_BRANCH_IF_TRUE));
     MOV(32, R(RSCRATCH), PPCSTATE_CTR);
     AND(32, R(RSCRATCH), Imm32(0xFFFFFFFC));
-    // MOV(32, PPCSTATE(pc), R(RSCRATCH)); => Already done in WriteExitDestInRSCRATCH()
+    // MOV(32, PPCSTATE(pc), R(RSCRATCH)); => Already done in WriteBCTRExit()
     if (inst.LK_3)
       MOV(32, PPCSTATE_LR, Imm32(js.compilerPC + 4));  // LR = PC + 4;
 
     gpr.Flush(RegCache::FlushMode::MaintainState);
     fpr.Flush(RegCache::FlushMode::MaintainState);
-    WriteExitDestInRSCRATCH(inst.LK_3, js.compilerPC + 4);
+    WriteBCTRExit(inst.LK_3, js.compilerPC + 4);
     // Would really like to continue the block here, but it ends. TODO.
     SetJumpTarget(b);
 
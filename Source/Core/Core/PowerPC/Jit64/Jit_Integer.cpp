@@ -378,7 +378,7 @@ void Jit64::DoMergedBranch()
       MOV(32, PPCSTATE(spr[SPR_LR]), Imm32(nextPC + 4));
     MOV(32, R(RSCRATCH), PPCSTATE(spr[SPR_CTR]));
     AND(32, R(RSCRATCH), Imm32(0xFFFFFFFC));
-    WriteExitDestInRSCRATCH(next.LK, nextPC + 4);
+    WriteBCTRExit(next.LK, nextPC + 4);
   }
   else if ((next.OPCD == 19) && (next.SUBOP10 == 16))  // bclrx
   {
@@ -416,6 +416,18 @@ void Jit64::DoMergedBranchCondition()
   else  // SO bit, do not branch (we don't emulate SO for cmp).
     pDontBranch = J(true);
 
+  if (js.op[1].isTraceBranch)
+  {
+    // The block continues at the branch target.
+    SwitchToFarCode();
+    SetJumpTarget(pDontBranch);
+    gpr.Flush(RegCache::FlushMode::MaintainState);
+    fpr.Flush(RegCache::FlushMode::MaintainState);
+    WriteExit(nextPC + 4);
+    SwitchToNearCode();
+    return;
+  }
+
   gpr.Flush(RegCache::FlushMode::MaintainState);
   fpr.Flush(RegCache::FlushMode::MaintainState);
 
@@ -452,7 +464,17 @@ void Jit64::DoMergedBranchImmediate(s64 val)
   else  // SO bit, do not branch (we don't emulate SO for cmp).
     branch = false;
 
-  if (branch)
+  if (js.op[1].isTraceBranch)
+  {
+    // The block continues at the branch target.
+    if (!branch)
+    {
+      gpr.Flush();
+      fpr.Flush();
+      WriteExit(nextPC + 4);
+    }
+  }
+  else if (branch)
   {
     gpr.Flush();
     fpr.Flush();
@@ -364,7 +364,7 @@ void EmuCodeBlock::SafeLoadToReg(X64Reg reg_value, const Gen::OpArg& opAddress,
   }
 
   FixupBranch exit;
-  bool dr_set = (flags & SAFE_LOADSTORE_DR_ON) || UReg_MSR(MSR).DR;
+  bool dr_set = (flags & SAFE_LOADSTORE_DR_ON) || UReg_MSR(g_jit->js.compileInputs.msr).DR;
   bool fast_check_address = !slowmem && dr_set;
   if (fast_check_address)
   {
@@ -519,7 +519,7 @@ void EmuCodeBlock::SafeWriteRegToReg(OpArg reg_value, X64Reg reg_addr, int acces
   }
 
   FixupBranch exit;
-  bool dr_set = (flags & SAFE_LOADSTORE_DR_ON) || UReg_MSR(MSR).DR;
+  bool dr_set = (flags & SAFE_LOADSTORE_DR_ON) || UReg_MSR(g_jit->js.compileInputs.msr).DR;
   bool fast_check_address = !slowmem && dr_set;
   if (fast_check_address)
   {
@@ -19,6 +19,7 @@
 #include "Core/HW/Memmap.h"
 #include "Core/MachineContext.h"
 #include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PowerPC.h"
 
 // This generates some fairly heavy trampolines, but it doesn't really hurt.
 // Only instructions that access I/O will get these, and there won't be that
@@ -32,7 +33,12 @@ bool Jitx86Base::HandleFault(uintptr_t access_address, SContext* ctx)
 
   const auto logical_base_ptr = reinterpret_cast<uintptr_t>(Memory::logical_base);
   if (access_address >= logical_base_ptr && access_address < logical_base_ptr + 0x100010000)
+  {
+    // The page table is mapped lazily, so the access may succeed once it is.
+    if (IsInSpace(reinterpret_cast<u8*>(ctx->CTX_PC)) && PowerPC::UpdateFastmemPageTable())
+      return true;
     return BackPatch(static_cast<u32>(access_address - logical_base_ptr), ctx);
+  }
 
   return false;
 }
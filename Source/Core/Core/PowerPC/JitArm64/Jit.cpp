@@ -41,7 +41,7 @@ void JitArm64::Init()
   InitializeInstructionTables();
 
   size_t child_code_size = SConfig::GetInstance().bMMU ? FARCODE_SIZE_MMU : FARCODE_SIZE;
-  AllocCodeSpace(CODE_SIZE + child_code_size);
+  AllocCodeSpace(CODE_SIZE + child_code_size, SConfig::GetInstance().bHugePages);
   AddChildCodeSpace(&farcode, child_code_size);
   jo.enableBlocklink = true;
   jo.optimizeGatherPipe = true;
@@ -85,7 +85,14 @@ bool JitArm64::HandleFault(uintptr_t access_address, SContext* ctx)
 
   // If the fault is in JIT code space, look for fastmem areas.
   if (!success && IsInSpace((u8*)ctx->CTX_PC))
-    success = HandleFastmemFault(access_address, ctx);
+  {
+    // The page table is mapped lazily, so the access may succeed once it is.
+    uintptr_t logical_base = (uintptr_t)Memory::logical_base;
+    if (access_address - logical_base < 0x100000000ULL && PowerPC::UpdateFastmemPageTable())
+      success = true;
+    else
+      success = HandleFastmemFault(access_address, ctx);
+  }
 
   if (!success)
   {
@@ -654,6 +661,8 @@ void JitArm64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer* code_buf, JitBlock*
   for (u32 i = 0; i < code_block.m_num_instructions; i++)
   {
     js.compilerPC = ops[i].address;
+    if (ShouldRecordSourceMap())
+      b->source_map.emplace_back(static_cast<u32>(GetCodePtr() - start), ops[i].address);
     js.op = &ops[i];
     js.instructionNumber = i;
     js.instructionsLeft = (code_block.m_num_instructions - 1) - i;
@@ -4,11 +4,15 @@
 
 #include "Core/PowerPC/JitCommon/JitBase.h"
 
+#include <algorithm>
+
 #include "Common/CommonTypes.h"
+#include "Common/JitRegister.h"
 #include "Core/ConfigManager.h"
 #include "Core/HW/CPU.h"
 #include "Core/PowerPC/PPCAnalyst.h"
 #include "Core/PowerPC/PowerPC.h"
+#include "Core/PowerPC/SamplingProfiler.h"
 
 JitBase* g_jit;
 
@@ -27,6 +31,11 @@ JitBase::JitBase() = default;
 
 JitBase::~JitBase() = default;
 
+bool JitBase::ShouldRecordSourceMap()
+{
+  return JitRegister::IsEnabled() || SamplingProfiler::IsRunning();
+}
+
 bool JitBase::CanMergeNextInstructions(int count) const
 {
   if (CPU::IsStepping() || js.instructionsLeft < count)
@@ -49,3 +58,14 @@ void JitBase::UpdateMemoryOptions()
   jo.fastmem = SConfig::GetInstance().bFastmem && (UReg_MSR(MSR).DR || !any_watchpoints);
   jo.memcheck = SConfig::GetInstance().bMMU || any_watchpoints;
 }
+
+JitBase::CompileInputs JitBase::CaptureCompileInputs()
+{
+  CompileInputs inputs;
+  inputs.msr = MSR;
+  std::copy(std::begin(PowerPC::ppcState.gpr), std::end(PowerPC::ppcState.gpr),
+            inputs.gpr.begin());
+  for (size_t i = 0; i < inputs.gqr.size(); i++)
+    inputs.gqr[i] = GQR(i);
+  return inputs;
+}
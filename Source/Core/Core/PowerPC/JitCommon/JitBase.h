@@ -8,7 +8,9 @@
 //#define JIT_LOG_GPR     // Enables logging of the PPC general purpose regs
 //#define JIT_LOG_FPR     // Enables logging of the PPC floating point regs
 
+#include <array>
 #include <map>
+#include <mutex>
 #include <unordered_set>
 
 #include "Common/CommonTypes.h"
@@ -18,6 +20,7 @@
 #include "Core/PowerPC/CPUCoreBase.h"
 #include "Core/PowerPC/JitCommon/JitAsmCommon.h"
 #include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/JitCommon/JitHotBlockProfile.h"
 #include "Core/PowerPC/PPCAnalyst.h"
 
 // Use these to control the instruction selection
@@ -53,6 +56,14 @@ protected:
     bool fastmem;
     bool memcheck;
   };
+  // The guest state a block gets specialized on. It is captured on the CPU thread, as the CPU
+  // thread keeps changing ppcState while a block compiles in the background.
+  struct CompileInputs
+  {
+    u32 msr;
+    std::array<u32, 32> gpr;
+    std::array<u32, 8> gqr;
+  };
   struct JitState
   {
     u32 compilerPC;
@@ -95,6 +106,7 @@ protected:
     u8* rewriteStart;
 
     JitBlock* curBlock;
+    CompileInputs compileInputs{};
 
     std::unordered_set<u32> fifoWriteAddresses;
     std::unordered_set<u32> pairedQuantizeAddresses;
@@ -103,11 +115,14 @@ protected:
 
   PPCAnalyst::CodeBlock code_block;
   PPCAnalyst::PPCAnalyzer analyzer;
+  JitHotBlockProfile m_hot_block_profile;
 
   bool CanMergeNextInstructions(int count) const;
 
   void UpdateMemoryOptions();
 
+  static CompileInputs CaptureCompileInputs();
+
 public:
   // This should probably be removed from public:
   JitOptions jo;
@@ -125,6 +140,19 @@ public:
 
   virtual bool HandleFault(uintptr_t access_address, SContext* ctx) = 0;
   virtual bool HandleStackFault() { return false; }
+
+  // Whether the JIT should fill in JitBlock::source_map for the blocks it compiles.
+  static bool ShouldRecordSourceMap();
+
+  // JITs which compile in the background share the emitter, the analyzer and js with their
+  // compile thread. Code outside the JIT must hold this lock while clearing the code space or
+  // changing js.
+  virtual std::unique_lock<std::mutex> LockCompiler() { return {}; }
+  // Drops blocks which were compiled in the background but not installed yet, e.g. because js
+  // changed under them. Must be called with the compiler lock held.
+  virtual void DiscardBackgroundCompiles() {}
+
+  JitHotBlockProfile& GetHotBlockProfile() { return m_hot_block_profile; }
 };
 
 void JitTrampoline(u32 em_address);
@@ -13,9 +13,10 @@
 #include <array>
 #include <cstring>
 #include <functional>
-#include <map>
+#include <iterator>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Common/JitRegister.h"
@@ -33,8 +34,25 @@ using namespace Gen;
 
 bool JitBlock::OverlapsPhysicalRange(u32 address, u32 length) const
 {
-  return physical_addresses.lower_bound(address) !=
-         physical_addresses.lower_bound(address + length);
+  auto first = std::lower_bound(physical_addresses.begin(), physical_addresses.end(), address);
+  return first != physical_addresses.end() && *first < address + length;
+}
+
+// Removes every occurrence of block from a vector of blocks, not preserving order.
+static void EraseBlockPointer(std::vector<JitBlock*>& blocks, const JitBlock* block)
+{
+  for (size_t i = 0; i < blocks.size();)
+  {
+    if (blocks[i] == block)
+    {
+      blocks[i] = blocks.back();
+      blocks.pop_back();
+    }
+    else
+    {
+      i++;
+    }
+  }
 }
 
 JitBaseBlockCache::JitBaseBlockCache(JitBase& jit) : m_jit{jit}
@@ -45,7 +63,7 @@ JitBaseBlockCache::~JitBaseBlockCache() = default;
 
 void JitBaseBlockCache::Init()
 {
-  JitRegister::Init(SConfig::GetInstance().m_perfDir);
+  JitRegister::Init(SConfig::GetInstance().m_perfDir, SConfig::GetInstance().bPerfJitDump);
 
   Clear();
 }
@@ -66,9 +84,14 @@ void JitBaseBlockCache::Clear()
   m_jit.js.pairedQuantizeAddresses.clear();
   for (auto& e : block_map)
   {
-    DestroyBlock(e.second);
+    for (JitBlock* block : e.second)
+    {
+      DestroyBlock(*block);
+      FreeBlock(block);
+    }
   }
   block_map.clear();
+  host_block_map.clear();
   links_to.clear();
   block_range_map.clear();
 
@@ -91,17 +114,50 @@ JitBlock** JitBaseBlockCache::GetFastBlockMap()
 void JitBaseBlockCache::RunOnBlocks(std::function<void(const JitBlock&)> f)
 {
   for (const auto& e : block_map)
-    f(e.second);
+  {
+    for (const JitBlock* block : e.second)
+      f(*block);
+  }
+}
+
+JitBlock* JitBaseBlockCache::NewBlock()
+{
+  if (free_blocks.empty())
+  {
+    block_slabs.emplace_back(new JitBlock[BLOCK_SLAB_ELEMENTS]);
+    JitBlock* slab = block_slabs.back().get();
+    // Hand out the slab in ascending address order.
+    for (size_t i = BLOCK_SLAB_ELEMENTS; i-- > 0;)
+      free_blocks.push_back(&slab[i]);
+  }
+
+  JitBlock* block = free_blocks.back();
+  free_blocks.pop_back();
+  return block;
+}
+
+void JitBaseBlockCache::FreeBlock(JitBlock* block)
+{
+  // Keep the capacity of the vectors around for the next user of this slot.
+  block->linkData.clear();
+  block->physical_addresses.clear();
+  free_blocks.push_back(block);
 }
 
 JitBlock* JitBaseBlockCache::AllocateBlock(u32 em_address)
 {
   u32 physicalAddress = PowerPC::JitCache_TranslateAddress(em_address).address;
-  JitBlock& b = block_map.emplace(physicalAddress, JitBlock())->second;
+  JitBlock& b = *NewBlock();
+  block_map[physicalAddress].push_back(&b);
   b.effectiveAddress = em_address;
   b.physicalAddress = physicalAddress;
   b.msrBits = MSR & JIT_CACHE_MSR_MASK;
+  b.codeSize = 0;
+  b.originalSize = 0;
+  b.tier = 0;
   b.linkData.clear();
+  b.source_map.clear();
+  b.profile_data = {};
   b.fast_block_map_index = 0;
   return &b;
 }
@@ -112,37 +168,76 @@ void JitBaseBlockCache::FinalizeBlock(JitBlock& block, bool block_link,
   size_t index = FastLookupIndexForAddress(block.effectiveAddress);
   fast_block_map[index] = &block;
   block.fast_block_map_index = index;
+  if (host_block_map_valid)
+  {
+    if (JitBase::ShouldRecordSourceMap())
+    {
+      host_block_map[block.checkedEntry] = &block;
+    }
+    else
+    {
+      host_block_map.clear();
+      host_block_map_valid = false;
+    }
+  }
 
-  block.physical_addresses = physical_addresses;
+  block.physical_addresses.assign(physical_addresses.begin(), physical_addresses.end());
 
-  u32 range_mask = ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
-  for (u32 addr : physical_addresses)
+  // physical_addresses is sorted, so all addresses within a page are adjacent.
+  u32 last_page = 0;
+  bool first = true;
+  for (u32 addr : block.physical_addresses)
   {
     valid_block.Set(addr / 32);
-    block_range_map[addr & range_mask].insert(&block);
+    const u32 page = addr >> BLOCK_RANGE_MAP_SHIFT;
+    if (first || page != last_page)
+      block_range_map[page].push_back(&block);
+    last_page = page;
+    first = false;
   }
 
   if (block_link)
   {
     for (const auto& e : block.linkData)
     {
-      links_to.emplace(e.exitAddress, &block);
+      std::vector<JitBlock*>& sources = links_to[e.exitAddress];
+      if (std::find(sources.begin(), sources.end(), &block) == sources.end())
+        sources.push_back(&block);
     }
 
     LinkBlock(block);
   }
 
-  Symbol* symbol = nullptr;
-  if (JitRegister::IsEnabled() &&
-      (symbol = g_symbolDB.GetSymbolFromAddr(block.effectiveAddress)) != nullptr)
+  if (!JitRegister::IsEnabled())
+    return;
+
+  // Each guest instruction becomes a line of its function, counting from 1, so that perf
+  // annotate can attribute samples to guest code even when blocks span several functions.
+  std::vector<JitRegister::SourceLine> lines;
+  lines.reserve(block.source_map.size());
+  for (const auto& entry : block.source_map)
   {
-    JitRegister::Register(block.checkedEntry, block.codeSize, "JIT_PPC_%s_%08x",
-                          symbol->function_name.c_str(), block.physicalAddress);
+    const Symbol* symbol = g_symbolDB.GetSymbolFromAddr(entry.second);
+    if (symbol)
+    {
+      lines.push_back({block.checkedEntry + entry.first, symbol->function_name,
+                       (entry.second - symbol->address) / 4 + 1});
+    }
+    else
+    {
+      lines.push_back({block.checkedEntry + entry.first, "PPC", entry.second});
+    }
+  }
+
+  if (const Symbol* symbol = g_symbolDB.GetSymbolFromAddr(block.effectiveAddress))
+  {
+    JitRegister::Register(block.checkedEntry, block.codeSize, lines, "JIT_PPC_%s_%08x",
+                          symbol->function_name.c_str(), block.effectiveAddress);
   }
   else
   {
-    JitRegister::Register(block.checkedEntry, block.codeSize, "JIT_PPC_%08x",
-                          block.physicalAddress);
+    JitRegister::Register(block.checkedEntry, block.codeSize, lines, "JIT_PPC_%08x",
+                          block.effectiveAddress);
   }
 }
 
@@ -159,17 +254,41 @@ JitBlock* JitBaseBlockCache::GetBlockFromStartAddress(u32 addr, u32 msr)
     translated_addr = translated.address;
   }
 
-  auto iter = block_map.equal_range(translated_addr);
-  for (; iter.first != iter.second; iter.first++)
+  auto iter = block_map.find(translated_addr);
+  if (iter == block_map.end())
+    return nullptr;
+
+  for (JitBlock* b : iter->second)
   {
-    JitBlock& b = iter.first->second;
-    if (b.effectiveAddress == addr && b.msrBits == (msr & JIT_CACHE_MSR_MASK))
-      return &b;
+    if (b->effectiveAddress == addr && b->msrBits == (msr & JIT_CACHE_MSR_MASK))
+      return b;
   }
 
   return nullptr;
 }
 
+JitBlock* JitBaseBlockCache::GetBlockFromHostAddress(const u8* address)
+{
+  if (!host_block_map_valid)
+  {
+    for (const auto& e : block_map)
+    {
+      for (JitBlock* block : e.second)
+        host_block_map[block->checkedEntry] = block;
+    }
+    host_block_map_valid = true;
+  }
+
+  auto iter = host_block_map.upper_bound(address);
+  if (iter == host_block_map.begin())
+    return nullptr;
+
+  JitBlock* block = std::prev(iter)->second;
+  if (address >= block->checkedEntry + block->codeSize)
+    return nullptr;
+  return block;
+}
+
 const u8* JitBaseBlockCache::Dispatch()
 {
   JitBlock* block = fast_block_map[FastLookupIndexForAddress(PC)];
@@ -222,53 +341,156 @@ void JitBaseBlockCache::InvalidateICache(u32 address, u32 length, bool forced)
 
 void JitBaseBlockCache::ErasePhysicalRange(u32 address, u32 length)
 {
-  // Iterate over all macro blocks which overlap the given range.
-  u32 range_mask = ~(BLOCK_RANGE_MAP_ELEMENTS - 1);
-  auto start = block_range_map.lower_bound(address & range_mask);
-  auto end = block_range_map.lower_bound(address + length);
-  while (start != end)
+  if (length == 0)
+    return;
+
+  // Gather the pages which overlap the given range. Large ranges (e.g. a whole memory bank)
+  // typically contain far fewer pages with code than pages in total, so walk the map instead.
+  const u32 first_page = address >> BLOCK_RANGE_MAP_SHIFT;
+  const u32 last_page = (address + length - 1) >> BLOCK_RANGE_MAP_SHIFT;
+  std::vector<u32> pages;
+  if (last_page - first_page >= block_range_map.size())
   {
-    // Iterate over all blocks in the macro block.
-    auto iter = start->second.begin();
-    while (iter != start->second.end())
+    for (const auto& e : block_range_map)
     {
-      JitBlock* block = *iter;
-      if (block->OverlapsPhysicalRange(address, length))
-      {
-        // If the block overlaps, also remove all other occupied slots in the other macro blocks.
-        // This will leak empty macro blocks, but they may be reused or cleared later on.
-        for (u32 addr : block->physical_addresses)
-          if ((addr & range_mask) != start->first)
-            block_range_map[addr & range_mask].erase(block);
-
-        // And remove the block.
-        DestroyBlock(*block);
-        auto block_map_iter = block_map.equal_range(block->physicalAddress);
-        while (block_map_iter.first != block_map_iter.second)
-        {
-          if (&block_map_iter.first->second == block)
-          {
-            block_map.erase(block_map_iter.first);
-            break;
-          }
-          block_map_iter.first++;
-        }
-        iter = start->second.erase(iter);
-      }
-      else
+      if (e.first >= first_page && e.first <= last_page)
+        pages.push_back(e.first);
+    }
+  }
+  else
+  {
+    for (u32 page = first_page; page <= last_page; page++)
+    {
+      if (block_range_map.count(page))
+        pages.push_back(page);
+    }
+  }
+
+  for (u32 page : pages)
+  {
+    auto page_iter = block_range_map.find(page);
+    if (page_iter == block_range_map.end())
+      continue;
+
+    // Iterate over all blocks in the page.
+    std::vector<JitBlock*>& blocks = page_iter->second;
+    for (size_t i = 0; i < blocks.size();)
+    {
+      JitBlock* block = blocks[i];
+      if (!block->OverlapsPhysicalRange(address, length))
       {
-        iter++;
+        i++;
+        continue;
       }
+
+      // If the block overlaps, also remove it from the other pages it occupies.
+      RemoveFromRangeMap(block, page);
+      blocks[i] = blocks.back();
+      blocks.pop_back();
+
+      // And remove the block.
+      DestroyBlock(*block);
+      RemoveFromBlockMap(block);
+      FreeBlock(block);
     }
 
-    // If the macro block is empty, drop it.
-    if (start->second.empty())
-      start = block_range_map.erase(start);
-    else
-      start++;
+    // If the page is empty, drop it.
+    if (blocks.empty())
+      block_range_map.erase(page_iter);
+  }
+}
+
+void JitBaseBlockCache::EraseBlock(JitBlock& block)
+{
+  RemoveFromRangeMap(&block, UINT32_MAX);
+  DestroyBlock(block);
+  RemoveFromBlockMap(&block);
+  FreeBlock(&block);
+}
+
+size_t JitBaseBlockCache::EraseBlocksInCodeRange(const u8* start, const u8* end)
+{
+  std::vector<JitBlock*> erased;
+  for (const auto& e : block_map)
+  {
+    for (JitBlock* block : e.second)
+    {
+      if (block->checkedEntry >= start && block->checkedEntry < end)
+        erased.push_back(block);
+    }
+  }
+
+  for (JitBlock* block : erased)
+    EraseBlock(*block);
+  return erased.size();
+}
+
+void JitBaseBlockCache::RetargetExit(JitBlock& block, u8* exit_ptr, bool call, u32 address)
+{
+  auto link = std::find_if(block.linkData.begin(), block.linkData.end(),
+                           [exit_ptr](const auto& e) { return e.exitPtrs == exit_ptr; });
+  if (link == block.linkData.end())
+  {
+    block.linkData.push_back({exit_ptr, address, false, call});
+  }
+  else
+  {
+    const u32 old_address = link->exitAddress;
+    if (link->linkStatus)
+      WriteLinkBlock(*link, nullptr);
+    link->exitAddress = address;
+    link->linkStatus = false;
+
+    // The block stays a source of its other exits to the old address.
+    const bool still_links_old_address =
+        std::any_of(block.linkData.begin(), block.linkData.end(),
+                    [old_address](const auto& e) { return e.exitAddress == old_address; });
+    auto iter = links_to.find(old_address);
+    if (!still_links_old_address && iter != links_to.end())
+    {
+      EraseBlockPointer(iter->second, &block);
+      if (iter->second.empty())
+        links_to.erase(iter);
+    }
+  }
+
+  std::vector<JitBlock*>& sources = links_to[address];
+  if (std::find(sources.begin(), sources.end(), &block) == sources.end())
+    sources.push_back(&block);
+
+  LinkBlockExits(block);
+}
+
+void JitBaseBlockCache::RemoveFromRangeMap(JitBlock* block, u32 skip_page)
+{
+  // physical_addresses is sorted, so all addresses within a page are adjacent.
+  u32 last_page = skip_page;
+  for (u32 addr : block->physical_addresses)
+  {
+    const u32 page = addr >> BLOCK_RANGE_MAP_SHIFT;
+    if (page == last_page || page == skip_page)
+      continue;
+    last_page = page;
+
+    auto iter = block_range_map.find(page);
+    if (iter == block_range_map.end())
+      continue;
+    EraseBlockPointer(iter->second, block);
+    if (iter->second.empty())
+      block_range_map.erase(iter);
   }
 }
 
+void JitBaseBlockCache::RemoveFromBlockMap(JitBlock* block)
+{
+  auto iter = block_map.find(block->physicalAddress);
+  if (iter == block_map.end())
+    return;
+  EraseBlockPointer(iter->second, block);
+  if (iter->second.empty())
+    block_map.erase(iter);
+}
+
 u32* JitBaseBlockCache::GetBlockBitSet() const
 {
   return valid_block.m_valid_block.get();
@@ -303,13 +525,14 @@ void JitBaseBlockCache::LinkBlockExits(JitBlock& block)
 void JitBaseBlockCache::LinkBlock(JitBlock& block)
 {
   LinkBlockExits(block);
-  auto ppp = links_to.equal_range(block.effectiveAddress);
+  auto iter = links_to.find(block.effectiveAddress);
+  if (iter == links_to.end())
+    return;
 
-  for (auto iter = ppp.first; iter != ppp.second; ++iter)
+  for (JitBlock* b2 : iter->second)
   {
-    JitBlock& b2 = *iter->second;
-    if (block.msrBits == b2.msrBits)
-      LinkBlockExits(b2);
+    if (block.msrBits == b2->msrBits)
+      LinkBlockExits(*b2);
   }
 }
 
@@ -322,10 +545,13 @@ void JitBaseBlockCache::UnlinkBlock(const JitBlock& block)
   }
 
   // Unlink all exits of other blocks which points to this block
-  auto ppp = links_to.equal_range(block.effectiveAddress);
-  for (auto iter = ppp.first; iter != ppp.second; ++iter)
+  auto iter = links_to.find(block.effectiveAddress);
+  if (iter == links_to.end())
+    return;
+
+  for (JitBlock* source : iter->second)
   {
-    JitBlock& sourceBlock = *iter->second;
+    JitBlock& sourceBlock = *source;
     if (sourceBlock.msrBits != block.msrBits)
       continue;
 
@@ -345,19 +571,24 @@ void JitBaseBlockCache::DestroyBlock(JitBlock& block)
   if (fast_block_map[block.fast_block_map_index] == &block)
     fast_block_map[block.fast_block_map_index] = nullptr;
 
+  if (host_block_map_valid)
+  {
+    auto host_iter = host_block_map.find(block.checkedEntry);
+    if (host_iter != host_block_map.end() && host_iter->second == &block)
+      host_block_map.erase(host_iter);
+  }
+
   UnlinkBlock(block);
 
   // Delete linking addresses
   for (const auto& e : block.linkData)
   {
-    auto it = links_to.equal_range(e.exitAddress);
-    while (it.first != it.second)
-    {
-      if (it.first->second == &block)
-        it.first = links_to.erase(it.first);
-      else
-        it.first++;
-    }
+    auto iter = links_to.find(e.exitAddress);
+    if (iter == links_to.end())
+      continue;
+    EraseBlockPointer(iter->second, &block);
+    if (iter->second.empty())
+      links_to.erase(iter);
   }
 
   // Raise an signal if we are going to call this block again
@@ -11,6 +11,8 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Common/CommonTypes.h"
@@ -49,6 +51,9 @@ struct JitBlock
   // The number of PPC instructions represented by this block. Mostly
   // useful for logging.
   u32 originalSize;
+  // The optimization tier the block was compiled at. With tiered compilation, blocks are first
+  // compiled at tier 0 and recompiled at a higher tier once they have run often enough.
+  u32 tier;
 
   // Information about exits to a known address from this block.
   // This is used to implement block linking.
@@ -61,8 +66,13 @@ struct JitBlock
   };
   std::vector<LinkData> linkData;
 
-  // This set stores all physical addresses of all occupied instructions.
-  std::set<u32> physical_addresses;
+  // Sorted physical addresses of all occupied instructions.
+  std::vector<u32> physical_addresses;
+
+  // (offset from checkedEntry, effective address) of the code for each instruction. Only
+  // recorded when JitBase::ShouldRecordSourceMap(); it's the line information of the perf
+  // jitdump and lets the sampling profiler attribute samples to instructions.
+  std::vector<std::pair<u32, u32>> source_map;
 
   // Block profiling data, structure is inlined in Jit.cpp
   struct ProfileData
@@ -141,6 +151,9 @@ public:
   // This might return nullptr if there is no such block.
   JitBlock* GetBlockFromStartAddress(u32 em_address, u32 msr);
 
+  // Returns the block whose code contains the given host address, or nullptr.
+  JitBlock* GetBlockFromHostAddress(const u8* address);
+
   // Get the normal entry for the block associated with the current program
   // counter. This will JIT code if necessary. (This is the reference
   // implementation; high-performance JITs will want to use a custom
@@ -149,6 +162,15 @@ public:
 
   void InvalidateICache(u32 address, u32 length, bool forced);
   void ErasePhysicalRange(u32 address, u32 length);
+  // Removes a single block, e.g. because it is being replaced with a better version.
+  void EraseBlock(JitBlock& block);
+  // Makes the exit at exit_ptr go to a new address and links it if possible. The exit is added to
+  // the block's link data if it isn't part of it yet. Used by inline caches for indirect branches,
+  // which learn their target while running.
+  void RetargetExit(JitBlock& block, u8* exit_ptr, bool call, u32 address);
+  // Removes every block whose code starts in [start, end), so that the code space can be reused.
+  // Returns the number of blocks removed.
+  size_t EraseBlocksInCodeRange(const u8* start, const u8* end);
 
   u32* GetBlockBitSet() const;
 
@@ -169,19 +191,36 @@ private:
   // Fast but risky block lookup based on fast_block_map.
   size_t FastLookupIndexForAddress(u32 address);
 
+  JitBlock* NewBlock();
+  void FreeBlock(JitBlock* block);
+  void RemoveFromRangeMap(JitBlock* block, u32 skip_page);
+  void RemoveFromBlockMap(JitBlock* block);
+
+  // Blocks are carved out of fixed-size slabs, so a block never moves while it is alive and
+  // neighbouring blocks share cache lines. Destroyed blocks go back onto free_blocks and are
+  // reused (together with their vectors' storage) by the next AllocateBlock().
+  static constexpr size_t BLOCK_SLAB_ELEMENTS = 0x400;
+  std::vector<std::unique_ptr<JitBlock[]>> block_slabs;
+  std::vector<JitBlock*> free_blocks;
+
   // links_to hold all exit points of all valid blocks in a reverse way.
   // It is used to query all blocks which links to an address.
-  std::multimap<u32, JitBlock*> links_to;  // destination_PC -> number
+  std::unordered_map<u32, std::vector<JitBlock*>> links_to;  // destination_PC -> blocks
 
   // Map indexed by the physical address of the entry point.
   // This is used to query the block based on the current PC in a slow way.
-  std::multimap<u32, JitBlock> block_map;  // start_addr -> block
-
-  // Range of overlapping code indexed by a masked physical address.
-  // This is used for invalidation of memory regions. The range is grouped
-  // in macro blocks of each 0x100 bytes.
-  static constexpr u32 BLOCK_RANGE_MAP_ELEMENTS = 0x100;
-  std::map<u32, std::set<JitBlock*>> block_range_map;
+  std::unordered_map<u32, std::vector<JitBlock*>> block_map;  // start_addr -> blocks
+
+  // Map indexed by the start of the host code (checkedEntry) of each block.
+  // Only the sampling profiler looks blocks up by host address, so this is built by the first
+  // GetBlockFromHostAddress() and only kept up to date while JitBase::ShouldRecordSourceMap().
+  std::map<const u8*, JitBlock*> host_block_map;
+  bool host_block_map_valid = false;
+
+  // Blocks overlapping each physical page, indexed by the page number.
+  // This is used for invalidation of memory regions.
+  static constexpr u32 BLOCK_RANGE_MAP_SHIFT = 12;
+  std::unordered_map<u32, std::vector<JitBlock*>> block_range_map;
 
   // This bitsets shows which cachelines overlap with any blocks.
   // It is used to provide a fast way to query if no icache invalidation is needed.
@@ -0,0 +1,239 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/JitCommon/JitHotBlockProfile.h"
+
+#include <algorithm>
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "Common/Hash.h"
+#include "Common/Logging/Log.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+
+namespace
+{
+constexpr u32 PROFILE_MAGIC = 0x504A4844;  // "DHJP"
+constexpr u32 PROFILE_VERSION = 1;
+
+// Sanity limit for the number of runs of a single block read from a file.
+constexpr u32 MAX_RUNS_PER_ENTRY = 0x1000;
+
+struct FileHeader
+{
+  u32 magic;
+  u32 version;
+  u32 num_entries;
+};
+
+struct FileEntry
+{
+  u32 effective_address;
+  u32 msr_bits;
+  u32 code_hash;
+  u32 num_runs;
+  u64 run_count;
+};
+
+// Only RAM is considered; the code in fake VMEM or the locked L1 cache is not preserved in a
+// meaningful way between sessions anyway.
+const u8* GetPhysicalPointer(u32 address, u32 size)
+{
+  if (!Memory::m_pRAM)
+    return nullptr;
+
+  if (address < Memory::REALRAM_SIZE && size <= Memory::REALRAM_SIZE - address)
+    return Memory::m_pRAM + address;
+
+  const u32 exram_offset = address & 0x0FFFFFFF;
+  if (Memory::m_pEXRAM && (address >> 28) == 0x1 && exram_offset < Memory::EXRAM_SIZE &&
+      size <= Memory::EXRAM_SIZE - exram_offset)
+  {
+    return Memory::m_pEXRAM + exram_offset;
+  }
+
+  return nullptr;
+}
+}  // Anonymous namespace
+
+void JitHotBlockProfile::Load(const std::string& filename)
+{
+  m_filename = filename;
+  m_entries.clear();
+  m_pending.clear();
+  m_scan_counter = 0;
+
+  File::IOFile file(filename, "rb");
+  if (!file)
+    return;
+
+  FileHeader header;
+  if (!file.ReadArray(&header, 1) || header.magic != PROFILE_MAGIC ||
+      header.version != PROFILE_VERSION)
+  {
+    WARN_LOG(DYNA_REC, "Ignoring JIT profile %s: wrong format", filename.c_str());
+    return;
+  }
+
+  for (u32 i = 0; i < header.num_entries && i < MAX_ENTRIES; i++)
+  {
+    FileEntry file_entry;
+    if (!file.ReadArray(&file_entry, 1) || file_entry.num_runs > MAX_RUNS_PER_ENTRY)
+      break;
+
+    Entry entry;
+    entry.effective_address = file_entry.effective_address;
+    entry.msr_bits = file_entry.msr_bits;
+    entry.code_hash = file_entry.code_hash;
+    // Age the counts, so that blocks which stop being hot eventually drop out of the profile.
+    entry.run_count = std::max<u64>(file_entry.run_count / 2, 1);
+    entry.physical_runs.resize(file_entry.num_runs);
+    if (!file.ReadArray(entry.physical_runs.data(), entry.physical_runs.size()))
+      break;
+
+    m_entries[GetKey(entry.effective_address, entry.msr_bits)] = entry;
+    m_pending.push_back(std::move(entry));
+  }
+
+  std::stable_sort(m_pending.begin(), m_pending.end(), [](const Entry& a, const Entry& b) {
+    return a.run_count > b.run_count;
+  });
+
+  NOTICE_LOG(DYNA_REC, "Loaded %zu hot blocks from %s", m_pending.size(), filename.c_str());
+}
+
+void JitHotBlockProfile::Save() const
+{
+  if (!IsActive() || m_entries.empty())
+    return;
+
+  std::vector<const Entry*> entries;
+  entries.reserve(m_entries.size());
+  for (const auto& e : m_entries)
+    entries.push_back(&e.second);
+
+  const size_t count = std::min(entries.size(), MAX_ENTRIES);
+  std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+                    [](const Entry* a, const Entry* b) { return a->run_count > b->run_count; });
+  entries.resize(count);
+
+  File::CreateFullPath(m_filename);
+  File::IOFile file(m_filename, "wb");
+  if (!file)
+  {
+    WARN_LOG(DYNA_REC, "Failed to write JIT profile %s", m_filename.c_str());
+    return;
+  }
+
+  const FileHeader header = {PROFILE_MAGIC, PROFILE_VERSION, static_cast<u32>(count)};
+  file.WriteArray(&header, 1);
+  for (const Entry* entry : entries)
+  {
+    const FileEntry file_entry = {entry->effective_address, entry->msr_bits, entry->code_hash,
+                                  static_cast<u32>(entry->physical_runs.size()), entry->run_count};
+    file.WriteArray(&file_entry, 1);
+    file.WriteArray(entry->physical_runs.data(), entry->physical_runs.size());
+  }
+
+  NOTICE_LOG(DYNA_REC, "Saved %zu hot blocks to %s", count, m_filename.c_str());
+}
+
+void JitHotBlockProfile::RecordBlocks(JitBaseBlockCache& cache)
+{
+  if (!IsActive())
+    return;
+
+  cache.RunOnBlocks([this](const JitBlock& block) { RecordBlock(block); });
+}
+
+void JitHotBlockProfile::RecordBlock(const JitBlock& block)
+{
+  if (!IsActive())
+    return;
+
+  std::vector<PhysicalRun> runs = GetPhysicalRuns(block.physical_addresses);
+  u32 hash;
+  if (runs.empty() || !HashCode(runs, &hash))
+    return;
+
+  // Without block profiling there are no run counts; every block which got compiled then
+  // counts as having run once.
+  const u64 run_count = std::max<u64>(block.profile_data.runCount, 1);
+
+  Entry& entry = m_entries[GetKey(block.effectiveAddress, block.msrBits)];
+  if (entry.run_count != 0 && entry.code_hash == hash && entry.physical_runs == runs)
+  {
+    entry.run_count += run_count;
+    return;
+  }
+
+  entry.effective_address = block.effectiveAddress;
+  entry.msr_bits = block.msrBits;
+  entry.code_hash = hash;
+  entry.run_count = run_count;
+  entry.physical_runs = std::move(runs);
+}
+
+std::vector<JitHotBlockProfile::Entry> JitHotBlockProfile::TakeLoadedEntries(u32 msr_bits)
+{
+  if (m_pending.empty() || m_scan_counter++ % SCAN_INTERVAL != 0)
+    return {};
+
+  std::vector<Entry> result;
+  auto kept = m_pending.begin();
+  for (Entry& entry : m_pending)
+  {
+    if (entry.msr_bits == msr_bits)
+    {
+      u32 hash;
+      if (HashCode(entry.physical_runs, &hash) && hash == entry.code_hash)
+      {
+        result.push_back(std::move(entry));
+        continue;
+      }
+      // Otherwise every scan would hash it again for the rest of the session.
+      if (++entry.failed_scans >= MAX_FAILED_SCANS)
+        continue;
+    }
+
+    if (&*kept != &entry)
+      *kept = std::move(entry);
+    ++kept;
+  }
+  m_pending.erase(kept, m_pending.end());
+  return result;
+}
+
+bool JitHotBlockProfile::HashCode(const std::vector<PhysicalRun>& runs, u32* hash)
+{
+  u32 result = 0;
+  for (const PhysicalRun& run : runs)
+  {
+    const u32 size = run.second * 4;
+    const u8* code = GetPhysicalPointer(run.first, size);
+    if (!code)
+      return false;
+    result = result * 0x9E3779B1 + HashAdler32(code, size);
+  }
+
+  *hash = result;
+  return true;
+}
+
+bool JitHotBlockProfile::ContainsAddresses(const Entry& entry,
+                                           const std::set<u32>& physical_addresses)
+{
+  // Both the runs and the addresses are sorted.
+  auto run = entry.physical_runs.begin();
+  for (u32 address : physical_addresses)
+  {
+    while (run != entry.physical_runs.end() && run->first + run->second * 4 <= address)
+      ++run;
+    if (run == entry.physical_runs.end() || address < run->first)
+      return false;
+  }
+  return true;
+}
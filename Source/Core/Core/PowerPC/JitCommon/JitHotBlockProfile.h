@@ -0,0 +1,100 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+class JitBaseBlockCache;
+struct JitBlock;
+
+// Remembers which blocks a game spent its time in, so that they can be compiled before they are
+// first dispatched the next time the same executable boots.
+//
+// Blocks are identified by their effective address and MSR bits. Each entry also records the
+// physical memory the block was compiled from and a hash of that memory, which tells us whether
+// the code has been loaded (and is unchanged) at the time we want to compile it.
+class JitHotBlockProfile
+{
+public:
+  // A run of consecutive instructions: (first physical address, number of instructions).
+  using PhysicalRun = std::pair<u32, u32>;
+
+  struct Entry
+  {
+    u32 effective_address;
+    u32 msr_bits;
+    u32 code_hash;
+    u64 run_count;
+    std::vector<PhysicalRun> physical_runs;
+    // How many scans found the code of the pending entry missing or changed.
+    u32 failed_scans = 0;
+  };
+
+  // Only the hottest blocks are kept in the file.
+  static constexpr size_t MAX_ENTRIES = 4096;
+  // The pending entries are checked against memory on every SCAN_INTERVAL-th call to
+  // TakeLoadedEntries().
+  static constexpr u32 SCAN_INTERVAL = 256;
+  // Pending entries whose code is still missing after this many scans are dropped.
+  static constexpr u32 MAX_FAILED_SCANS = 64;
+
+  bool IsActive() const { return !m_filename.empty(); }
+  bool HasPendingEntries() const { return !m_pending.empty(); }
+
+  // Starts profiling into filename, and reads the entries from a previous session if the file
+  // exists. All loaded entries become pending.
+  void Load(const std::string& filename);
+  void Save() const;
+
+  // Adds the blocks in the cache to the profile. This has to be called before the cache is
+  // cleared.
+  void RecordBlocks(JitBaseBlockCache& cache);
+  // Adds a single block, e.g. one which is about to be evicted from the cache.
+  void RecordBlock(const JitBlock& block);
+
+  // Returns the pending entries for msr_bits whose code is currently in memory, hottest first,
+  // and removes them from the pending list. Entries whose code isn't loaded yet stay pending, up
+  // to MAX_FAILED_SCANS scans.
+  std::vector<Entry> TakeLoadedEntries(u32 msr_bits);
+
+  // Turns sorted physical instruction addresses into runs.
+  template <typename Container>
+  static std::vector<PhysicalRun> GetPhysicalRuns(const Container& physical_addresses)
+  {
+    std::vector<PhysicalRun> runs;
+    for (u32 address : physical_addresses)
+    {
+      if (!runs.empty() && runs.back().first + runs.back().second * 4 == address)
+        runs.back().second++;
+      else
+        runs.emplace_back(address, 1);
+    }
+    return runs;
+  }
+
+  // Hashes the instructions in physical memory. Returns false if the runs aren't in RAM.
+  static bool HashCode(const std::vector<PhysicalRun>& runs, u32* hash);
+
+  // Whether all of the given physical addresses are part of the entry's runs.
+  static bool ContainsAddresses(const Entry& entry, const std::set<u32>& physical_addresses);
+
+private:
+  static u64 GetKey(u32 effective_address, u32 msr_bits)
+  {
+    return static_cast<u64>(msr_bits) << 32 | effective_address;
+  }
+
+  std::string m_filename;
+  std::unordered_map<u64, Entry> m_entries;
+  std::vector<Entry> m_pending;
+  u32 m_scan_counter = 0;
+};
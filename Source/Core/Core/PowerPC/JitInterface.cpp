@@ -7,8 +7,10 @@
 #include <algorithm>
 #include <cinttypes>
 #include <cstdio>
+#include <iterator>
 #include <string>
 #include <unordered_set>
+#include <utility>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -17,13 +19,18 @@
 #endif
 
 #include "Common/ChunkFile.h"
+#include "Common/CommonPaths.h"
 #include "Common/CommonTypes.h"
 #include "Common/File.h"
+#include "Common/FileUtil.h"
 #include "Common/MsgHandler.h"
+#include "Common/StringUtil.h"
 
+#include "Core/ConfigManager.h"
 #include "Core/Core.h"
 #include "Core/PowerPC/CPUCoreBase.h"
 #include "Core/PowerPC/CachedInterpreter/CachedInterpreter.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 #include "Core/PowerPC/PPCSymbolDB.h"
 #include "Core/PowerPC/PowerPC.h"
@@ -42,7 +49,10 @@ namespace JitInterface
 void DoState(PointerWrap& p)
 {
   if (g_jit && p.GetMode() == PointerWrap::MODE_READ)
+  {
+    auto lock = g_jit->LockCompiler();
     g_jit->ClearCache();
+  }
 }
 CPUCoreBase* InitJitCore(int core)
 {
@@ -90,16 +100,17 @@ void WriteProfileResults(const std::string& filename)
     return;
   }
   fprintf(f.GetHandle(), "origAddr\tblkName\trunCount\tcost\ttimeCost\tpercent\ttimePercent\tOvAlli"
-                         "nBlkTime(ms)\tblkCodeSize\n");
+                         "nBlkTime(ms)\tblkCodeSize\ttier\n");
   for (auto& stat : prof_stats.block_stats)
   {
     std::string name = g_symbolDB.GetDescription(stat.addr);
     double percent = 100.0 * (double)stat.cost / (double)prof_stats.cost_sum;
     double timePercent = 100.0 * (double)stat.tick_counter / (double)prof_stats.timecost_sum;
     fprintf(f.GetHandle(),
-            "%08x\t%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%.2f\t%.2f\t%i\n", stat.addr,
-            name.c_str(), stat.run_count, stat.cost, stat.tick_counter, percent, timePercent,
-            (double)stat.tick_counter * 1000.0 / (double)prof_stats.countsPerSec, stat.block_size);
+            "%08x\t%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%.2f\t%.2f\t%.2f\t%i\t%u\n",
+            stat.addr, name.c_str(), stat.run_count, stat.cost, stat.tick_counter, percent,
+            timePercent, (double)stat.tick_counter * 1000.0 / (double)prof_stats.countsPerSec,
+            stat.block_size, stat.tier);
   }
 }
 
@@ -125,7 +136,7 @@ void GetProfileResults(ProfileStats* prof_stats)
     // Todo: tweak.
     if (data.runCount >= 1)
       prof_stats->block_stats.emplace_back(block.effectiveAddress, cost, timecost, data.runCount,
-                                           block.codeSize);
+                                           block.codeSize, block.tier);
     prof_stats->cost_sum += cost;
     prof_stats->timecost_sum += timecost;
   });
@@ -174,6 +185,25 @@ int GetHostCode(u32* address, const u8** code, u32* code_size)
   return 0;
 }
 
+bool GetGuestAddressFromHostAddress(const void* host_address, u32* guest_address)
+{
+  if (!g_jit)
+    return false;
+
+  const u8* address = static_cast<const u8*>(host_address);
+  const JitBlock* block = g_jit->GetBlockCache()->GetBlockFromHostAddress(address);
+  if (!block)
+    return false;
+
+  const u32 offset = static_cast<u32>(address - block->checkedEntry);
+  const auto iter = std::upper_bound(
+      block->source_map.begin(), block->source_map.end(), offset,
+      [](u32 value, const std::pair<u32, u32>& entry) { return value < entry.first; });
+  *guest_address =
+      iter == block->source_map.begin() ? block->effectiveAddress : std::prev(iter)->second;
+  return true;
+}
+
 bool HandleFault(uintptr_t access_address, SContext* ctx)
 {
   // Prevent nullptr dereference on a crash with no JIT present
@@ -197,8 +227,11 @@ bool HandleStackFault()
 
 void ClearCache()
 {
-  if (g_jit)
-    g_jit->ClearCache();
+  if (!g_jit)
+    return;
+
+  auto lock = g_jit->LockCompiler();
+  g_jit->ClearCache();
 }
 void ClearSafe()
 {
@@ -206,14 +239,27 @@ void ClearSafe()
   // inside a JIT'ed block: it clears the instruction cache, but not
   // the JIT'ed code.
   // TODO: There's probably a better way to handle this situation.
-  if (g_jit)
-    g_jit->GetBlockCache()->Clear();
+  Interpreter::getInstance()->ClearCache();
+  if (!g_jit)
+    return;
+
+  // The compile thread reads the exception address sets, which this clears, and compiles against
+  // the blocks being cleared.
+  auto lock = g_jit->LockCompiler();
+  g_jit->GetBlockCache()->Clear();
+  g_jit->DiscardBackgroundCompiles();
 }
 
 void InvalidateICache(u32 address, u32 size, bool forced)
 {
-  if (g_jit)
-    g_jit->GetBlockCache()->InvalidateICache(address, size, forced);
+  Interpreter::getInstance()->InvalidateDecodedInstructions(address, size);
+  if (!g_jit)
+    return;
+
+  // Unless forced, this erases from the exception address sets the compile thread reads.
+  auto lock = g_jit->LockCompiler();
+  g_jit->GetBlockCache()->InvalidateICache(address, size, forced);
+  g_jit->DiscardBackgroundCompiles();
 }
 
 void CompileExceptionCheck(ExceptionType type)
@@ -245,7 +291,12 @@ void CompileExceptionCheck(ExceptionType type)
       if (optype != OPTYPE_STORE && optype != OPTYPE_STOREFP && (optype != OPTYPE_STOREPS))
         return;
     }
-    exception_addresses->insert(PC);
+    {
+      // Blocks compiled before the address was recorded would be missing the check.
+      auto lock = g_jit->LockCompiler();
+      exception_addresses->insert(PC);
+      g_jit->DiscardBackgroundCompiles();
+    }
 
     // Invalidate the JIT block so that it gets recompiled with the external exception check
     // included.
@@ -253,10 +304,25 @@ void CompileExceptionCheck(ExceptionType type)
   }
 }
 
+void LoadHotBlockProfile(const std::string& game_id, u32 executable_hash)
+{
+  if (!g_jit || !SConfig::GetInstance().bJITHotBlockProfile)
+    return;
+
+  const std::string filename =
+      StringFromFormat("%sJitProfiles" DIR_SEP "%s_%08x.bin",
+                       File::GetUserPath(D_CACHE_IDX).c_str(), game_id.c_str(), executable_hash);
+  g_jit->GetHotBlockProfile().Load(filename);
+}
+
 void Shutdown()
 {
   if (g_jit)
   {
+    JitHotBlockProfile& profile = g_jit->GetHotBlockProfile();
+    profile.RecordBlocks(*g_jit->GetBlockCache());
+    profile.Save();
+
     g_jit->Shutdown();
     delete g_jit;
     g_jit = nullptr;
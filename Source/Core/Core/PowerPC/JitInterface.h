@@ -31,6 +31,9 @@ CPUCoreBase* GetCore();
 void WriteProfileResults(const std::string& filename);
 void GetProfileResults(ProfileStats* prof_stats);
 int GetHostCode(u32* address, const u8** code, u32* code_size);
+// Maps an address in the code of a JIT block back to the guest instruction it was compiled from.
+// Without a source map for the block, this is the start of the block.
+bool GetGuestAddressFromHostAddress(const void* host_address, u32* guest_address);
 
 // Memory Utilities
 bool HandleFault(uintptr_t access_address, SContext* ctx);
@@ -46,5 +49,8 @@ void InvalidateICache(u32 address, u32 size, bool forced);
 
 void CompileExceptionCheck(ExceptionType type);
 
+// Loads the hot block profile for the given executable and starts recording into it, if enabled.
+void LoadHotBlockProfile(const std::string& game_id, u32 executable_hash);
+
 void Shutdown();
 }
@@ -2,13 +2,18 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <array>
 #include <cstddef>
 #include <cstring>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "Common/Atomic.h"
 #include "Common/BitUtils.h"
 #include "Common/CommonTypes.h"
+#include "Common/Logging/Log.h"
+#include "Common/Swap.h"
 
 #include "Core/ConfigManager.h"
 #include "Core/HW/CPU.h"
@@ -164,6 +169,7 @@ BatTable ibat_table;
 BatTable dbat_table;
 
 static void GenerateDSIException(u32 _EffectiveAddress, bool _bWrite);
+static void PageTableUpdated();
 
 template <XCheckTLBFlag flag, typename T, bool never_translate = false>
 static T ReadFromHardware(u32 em_address)
@@ -667,6 +673,31 @@ bool HostIsInstructionRAMAddress(u32 address)
   return !(address & 3) && IsRAMAddress<FLAG_OPCODE_NO_EXCEPTION>(address, UReg_MSR(MSR).IR);
 }
 
+TryReadInstResult HostTryReadInstruction(const u32 address)
+{
+  // Only the BATs are consulted, and the instruction cache is bypassed: neither the TLB nor
+  // the cache may be touched from outside the CPU thread.
+  u32 physical_address = address;
+  if (UReg_MSR(MSR).IR && !TranslateBatAddess(ibat_table, &physical_address))
+    return TryReadInstResult{false, false, 0, 0};
+
+  u32 hex;
+  if (Memory::m_pFakeVMEM && ((physical_address & 0xFE000000) == 0x7E000000))
+  {
+    hex = Common::swap32(&Memory::m_pFakeVMEM[physical_address & Memory::FAKEVMEM_MASK]);
+  }
+  else if ((physical_address >> 28) != 0xE &&
+           IsRAMAddress<FLAG_OPCODE_NO_EXCEPTION>(physical_address, false))
+  {
+    hex = Memory::Read_U32(physical_address);
+  }
+  else
+  {
+    return TryReadInstResult{false, false, 0, 0};
+  }
+  return TryReadInstResult{true, true, hex, physical_address};
+}
+
 void DMA_LCToMemory(const u32 memAddr, const u32 cacheAddr, const u32 numBlocks)
 {
   // TODO: It's not completely clear this is the right spot for this code;
@@ -958,6 +989,166 @@ void SDRUpdated()
   }
   PowerPC::ppcState.pagetable_base = htaborg << 16;
   PowerPC::ppcState.pagetable_hashmask = ((htabmask << 10) | 0x3ff);
+
+  PageTableUpdated();
+}
+
+void SRUpdated()
+{
+  PageTableUpdated();
+}
+
+// The emulated TLB only has 128 entries, which is far less than what games use. Translations
+// are additionally kept in a bigger direct-mapped TLB which only exists on the host side. It is
+// invalidated whenever the emulated TLB is, so it doesn't change which translations are used
+// (apart from the emulated TLB's replacement order, which isn't observable without modifying the
+// page table without tlbie).
+constexpr u32 SOFTWARE_TLB_SIZE = 8192;
+constexpr u32 SOFTWARE_TLB_VALID = 1;
+
+struct SoftwareTLBEntry
+{
+  // Effective page address | SOFTWARE_TLB_VALID
+  u32 tag;
+  u32 physical_page;
+  // Whether the C bit is set in the page table entry, i.e. whether writes can skip the walk.
+  bool changed;
+};
+
+static std::array<std::array<SoftwareTLBEntry, SOFTWARE_TLB_SIZE>, NUM_TLBS> s_software_tlb;
+static MMUStats s_mmu_stats;
+
+// Pages translated through the page table which are mapped for fastmem, grouped by the set of
+// the emulated TLB they belong to (which is what tlbie invalidates).
+static std::array<std::vector<u32>, HW_PAGE_INDEX_MASK + 1> s_fastmem_pages;
+// Whether the page table or the segment registers changed since the pages were last mapped.
+static bool s_fastmem_page_table_stale = false;
+
+const MMUStats& GetMMUStats()
+{
+  return s_mmu_stats;
+}
+
+void ResetMMUStats()
+{
+  s_mmu_stats = {};
+}
+
+static void FillSoftwareTLB(const XCheckTLBFlag flag, const u32 address, const u32 physical_page,
+                            const bool changed)
+{
+  // Lookups without exceptions don't set the R bit, so they must not skip a later walk.
+  if (IsNoExceptionFlag(flag))
+    return;
+
+  const u32 index = (address >> HW_PAGE_INDEX_SHIFT) & (SOFTWARE_TLB_SIZE - 1);
+  SoftwareTLBEntry& entry = s_software_tlb[IsOpcodeFlag(flag)][index];
+  entry.tag = (address & ~0xfff) | SOFTWARE_TLB_VALID;
+  entry.physical_page = physical_page;
+  entry.changed = changed;
+}
+
+static void InvalidateSoftwareTLB()
+{
+  s_software_tlb = {};
+}
+
+static void MapFastmemPage(const u32 address, const u32 physical_page)
+{
+  const u32 page = address & ~0xfff;
+  // BAT mappings take precedence; fastmem doesn't support memchecks.
+  if (!Memory::logical_base || (dbat_table[page >> BAT_INDEX_SHIFT] & BAT_MAPPED_BIT) ||
+      PowerPC::memchecks.OverlapsMemcheck(page, HW_PAGE_SIZE))
+  {
+    return;
+  }
+
+  if (Memory::MapLogicalPage(page, physical_page))
+  {
+    s_fastmem_pages[(page >> HW_PAGE_INDEX_SHIFT) & HW_PAGE_INDEX_MASK].push_back(page);
+    s_mmu_stats.fastmem_pages_mapped++;
+  }
+}
+
+static void UnmapFastmemPages()
+{
+  for (std::vector<u32>& pages : s_fastmem_pages)
+    pages.clear();
+  Memory::UnmapLogicalPages();
+}
+
+// Maps every page of the page table which has been both referenced and changed. Pages without
+// the C bit can't be mapped, since writes through fastmem wouldn't set it; without the R bit, the
+// first access has to set it. Those pages get mapped once they are walked.
+static void MapFastmemPageTable()
+{
+  UnmapFastmemPages();
+  if (!SConfig::GetInstance().bMMU || !Memory::logical_base)
+    return;
+
+  const u32 table_base = PowerPC::ppcState.pagetable_base;
+  const u32 table_size = (PowerPC::ppcState.pagetable_hashmask + 1) * 64;
+  if (PowerPC::ppcState.pagetable_hashmask == 0 || table_base >= Memory::REALRAM_SIZE ||
+      table_size > Memory::REALRAM_SIZE - table_base)
+  {
+    return;
+  }
+
+  // VSID -> segments using it
+  std::unordered_map<u32, u32> segments;
+  for (u32 i = 0; i < 16; i++)
+  {
+    const u32 sr = PowerPC::ppcState.sr[i];
+    if (!(sr & 0x80000000))
+      segments[sr & 0xffffff] |= 1 << i;
+  }
+
+  s_mmu_stats.fastmem_rebuilds++;
+  for (u32 pteg = 0; pteg <= PowerPC::ppcState.pagetable_hashmask; pteg++)
+  {
+    for (u32 i = 0; i < 8; i++)
+    {
+      const u8* pte = Memory::physical_base + table_base + pteg * 64 + i * 8;
+      const u32 pte1 = Common::swap32(pte);
+      const u32 pte2 = Common::swap32(pte + 4);
+      // V, R and C
+      if (!(pte1 & 0x80000000) || (pte2 & 0x180) != 0x180)
+        continue;
+
+      const u32 vsid = (pte1 >> 7) & 0xffffff;
+      const auto segment = segments.find(vsid);
+      if (segment == segments.end())
+        continue;
+
+      // Undo the hash function to get the page index.
+      const u32 hash = (pte1 & 0x40) ? ~pteg : pteg;
+      const u32 page_index = ((pte1 & 0x3f) << 10) | ((hash ^ vsid) & 0x3ff);
+      for (u32 sr = 0; sr < 16; sr++)
+      {
+        if (segment->second & (1 << sr))
+          MapFastmemPage(sr << 28 | page_index << HW_PAGE_INDEX_SHIFT, pte2 & 0xfffff000);
+      }
+    }
+  }
+}
+
+// Rescanning the page table is expensive, and games tend to write all segment registers in a row,
+// so the mappings are only dropped here. They are rebuilt on the next fastmem fault.
+static void PageTableUpdated()
+{
+  InvalidateSoftwareTLB();
+  UnmapFastmemPages();
+  s_fastmem_page_table_stale = SConfig::GetInstance().bMMU && Memory::logical_base;
+}
+
+bool UpdateFastmemPageTable()
+{
+  if (!s_fastmem_page_table_stale)
+    return false;
+
+  s_fastmem_page_table_stale = false;
+  MapFastmemPageTable();
+  return true;
 }
 
 enum TLBLookupResult
@@ -991,6 +1182,7 @@ static TLBLookupResult LookupTLBPageAddress(const XCheckTLBFlag flag, const u32
       tlbe.recent = 0;
 
     *paddr = tlbe.paddr[0] | (vpa & 0xfff);
+    FillSoftwareTLB(flag, vpa, tlbe.paddr[0], (tlbe.pte[0] & PTE2_C) != 0);
 
     return TLB_FOUND;
   }
@@ -1013,6 +1205,7 @@ static TLBLookupResult LookupTLBPageAddress(const XCheckTLBFlag flag, const u32
       tlbe.recent = 1;
 
     *paddr = tlbe.paddr[1] | (vpa & 0xfff);
+    FillSoftwareTLB(flag, vpa, tlbe.paddr[1], (tlbe.pte[1] & PTE2_C) != 0);
 
     return TLB_FOUND;
   }
@@ -1044,11 +1237,33 @@ void InvalidateTLBEntry(u32 address)
   TLBEntry& tlbe_i = ppcState.tlb[1][entry_index];
   tlbe_i.tag[0] = TLBEntry::INVALID_TAG;
   tlbe_i.tag[1] = TLBEntry::INVALID_TAG;
+
+  // Everything which maps to the same set of the emulated TLB has to go.
+  for (auto& software_tlb : s_software_tlb)
+  {
+    for (u32 i = entry_index; i < SOFTWARE_TLB_SIZE; i += HW_PAGE_INDEX_MASK + 1)
+      software_tlb[i].tag = 0;
+  }
+
+  for (u32 page : s_fastmem_pages[entry_index])
+    Memory::UnmapLogicalPage(page);
+  s_fastmem_pages[entry_index].clear();
 }
 
 // Page Address Translation
 static TranslateAddressResult TranslatePageAddress(const u32 address, const XCheckTLBFlag flag)
 {
+  const u32 software_tlb_index = (address >> HW_PAGE_INDEX_SHIFT) & (SOFTWARE_TLB_SIZE - 1);
+  const SoftwareTLBEntry& software_tlbe = s_software_tlb[IsOpcodeFlag(flag)][software_tlb_index];
+  if (software_tlbe.tag == ((address & ~0xfff) | SOFTWARE_TLB_VALID) &&
+      (flag != FLAG_WRITE || software_tlbe.changed))
+  {
+    s_mmu_stats.software_tlb_hits++;
+    return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED,
+                                  software_tlbe.physical_page | EA_Offset(address)};
+  }
+  s_mmu_stats.software_tlb_misses++;
+
   // TLB cache
   // This catches 99%+ of lookups in practice, so the actual page table entry code below doesn't
   // benefit
@@ -1058,6 +1273,8 @@ static TranslateAddressResult TranslatePageAddress(const u32 address, const XChe
   if (res == TLB_FOUND)
     return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED, translatedAddress};
 
+  s_mmu_stats.page_walks++;
+
   u32 sr = PowerPC::ppcState.sr[EA_SR(address)];
 
   if (sr & 0x80000000)
@@ -1128,6 +1345,10 @@ static TranslateAddressResult TranslatePageAddress(const u32 address, const XChe
         if (res != TLB_UPDATE_C)
           UpdateTLBEntry(flag, PTE2, address);
 
+        FillSoftwareTLB(flag, address, PTE2.RPN << 12, PTE2.C != 0);
+        if ((flag == FLAG_READ || flag == FLAG_WRITE) && PTE2.C)
+          MapFastmemPage(address, PTE2.RPN << 12);
+
         return TranslateAddressResult{TranslateAddressResult::PAGE_TABLE_TRANSLATED,
                                       (PTE2.RPN << 12) | offset};
       }
@@ -1241,8 +1462,11 @@ void DBATUpdated()
   }
 
 #ifndef _ARCH_32
+  // The page table mappings may now overlap BATs.
+  UnmapFastmemPages();
   Memory::UpdateLogicalMemory(dbat_table);
 #endif
+  PageTableUpdated();
 
   // IsOptimizable*Address and dcbz depends on the BAT mapping, so we need a flush here.
   JitInterface::ClearSafe();
@@ -38,6 +38,11 @@ constexpr int CODEBUFFER_SIZE = 32000;
 
 // 0 does not perform block merging
 constexpr u32 BRANCH_FOLLOWING_THRESHOLD = 2;
+constexpr u32 EXTENDED_BRANCH_FOLLOWING_THRESHOLD = 6;
+
+// How many instructions at a branch target are looked at to find out whether the carry flag is
+// live there.
+constexpr u32 CROSS_BRANCH_LIVENESS_DEPTH = 16;
 
 constexpr u32 INVALID_BRANCH_TARGET = 0xFFFFFFFF;
 
@@ -682,6 +687,66 @@ void PPCAnalyzer::SetInstructionStats(CodeBlock* block, CodeOp* code, const Gekk
   }
 }
 
+PowerPC::TryReadInstResult PPCAnalyzer::ReadInstruction(u32 address) const
+{
+  return HasOption(OPTION_HOST_READS) ? PowerPC::HostTryReadInstruction(address) :
+                                        PowerPC::TryReadInstruction(address);
+}
+
+// Returns false if the straight-line code at address overwrites the carry flag before anything
+// can read it.
+bool PPCAnalyzer::IsCarryLiveAt(u32 address, CodeBlock* block) const
+{
+  std::vector<u32> physical_addresses;
+  for (u32 i = 0; i < CROSS_BRANCH_LIVENESS_DEPTH; i++, address += 4)
+  {
+    const PowerPC::TryReadInstResult result = ReadInstruction(address);
+    if (!result.valid)
+      return true;
+    physical_addresses.push_back(result.physical_address);
+
+    const UGeckoInstruction inst = result.hex;
+    const GekkoOPInfo* opinfo = GetOpInfo(inst);
+    if (!opinfo || (opinfo->flags & (FL_READ_CA | FL_ENDBLOCK)))
+      return true;
+
+    const u32 spr = (inst.SPRU << 5) | (inst.SPRL & 0x1F);
+    if (inst.OPCD == 31 && inst.SUBOP10 == 339 && spr == SPR_XER)  // mfspr
+      return true;
+
+    if ((opinfo->flags & FL_SET_CA) ||
+        (inst.OPCD == 31 && inst.SUBOP10 == 467 && spr == SPR_XER))  // mtspr
+    {
+      // The block now depends on this code staying the same.
+      block->m_physical_addresses.insert(physical_addresses.begin(), physical_addresses.end());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Returns whether the carry flag may be read after op leaves the block. falls_through says
+// whether the instruction after op is reached through an exit as well.
+bool PPCAnalyzer::IsCarryLiveAtExit(const CodeOp& op, bool falls_through, CodeBlock* block) const
+{
+  const UGeckoInstruction inst = op.inst;
+  if (inst.OPCD == 18)  // bx
+    return IsCarryLiveAt(SignExt26(inst.LI << 2) + (inst.AA ? 0 : op.address), block);
+
+  if (inst.OPCD == 16 && op.isTraceBranch)  // bcx, leaving only when not taken
+    return IsCarryLiveAt(op.address + 4, block);
+
+  if (inst.OPCD == 16)  // bcx
+  {
+    return IsCarryLiveAt(SignExt16(inst.BD << 2) + (inst.AA ? 0 : op.address), block) ||
+           (falls_through && IsCarryLiveAt(op.address + 4, block));
+  }
+
+  // Indirect branches, exceptions, rfi and the like.
+  return true;
+}
+
 u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32 blockSize)
 {
   // Clear block stats
@@ -711,10 +776,13 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
   size_t caller = 0;
   u32 numFollows = 0;
   u32 num_inst = 0;
+  const u32 follow_threshold = HasOption(OPTION_EXTENDED_BLOCKS) ?
+                                   EXTENDED_BRANCH_FOLLOWING_THRESHOLD :
+                                   BRANCH_FOLLOWING_THRESHOLD;
 
   for (u32 i = 0; i < blockSize; ++i)
   {
-    auto result = PowerPC::TryReadInstruction(address);
+    auto result = ReadInstruction(address);
     if (!result.valid)
     {
       if (i == 0)
@@ -747,7 +815,7 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
     //       If it is small, the performance will be down.
     //       If it is big, the size of generated code will be big and
     //       cache clearning will happen many times.
-    if (HasOption(OPTION_BRANCH_FOLLOW) && numFollows < BRANCH_FOLLOWING_THRESHOLD)
+    if (HasOption(OPTION_BRANCH_FOLLOW) && numFollows < follow_threshold)
     {
       if (inst.OPCD == 18 && blockSize > 1)
       {
@@ -774,6 +842,18 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
           caller = i;
         }
       }
+      else if (inst.OPCD == 16 && !inst.LK && blockSize > 1 && HasOption(OPTION_TRACES) &&
+               m_branch_predictor && m_branch_predictor(address))
+      {
+        // Follow conditional branches which are almost always taken, but leave loops back to
+        // the start of the block to block linking.
+        destination = SignExt16(inst.BD << 2) + (inst.AA ? 0 : address);
+        follow = destination != block->m_address;
+        code[i].isTraceBranch = follow;
+        // The block can be left in the middle of a call, so the return can't be inlined.
+        if (follow)
+          found_call = false;
+      }
       else if (inst.OPCD == 19 && inst.SUBOP10 == 16 && !inst.LK && found_call &&
                (inst.BO & BO_DONT_DECREMENT_FLAG) && (inst.BO & BO_DONT_CHECK_CONDITION))
       {
@@ -869,6 +949,17 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
   // Scan for flag dependencies; assume the next block (or any branch that can leave the block)
   // wants flags, to be safe.
   bool wantsCR0 = true, wantsCR1 = true, wantsFPRF = true, wantsCA = true;
+  const bool cross_branch_liveness = HasOption(OPTION_CROSS_BRANCH_LIVENESS) && num_inst > 0;
+  if (cross_branch_liveness)
+  {
+    // The exits of a final branch are handled below; for everything else, look at where the
+    // block continues.
+    const u32 last_opcd = code[num_inst - 1].inst.OPCD;
+    if (!found_exit)
+      wantsCA = IsCarryLiveAt(address, block);
+    else if (last_opcd == 16 || last_opcd == 18)
+      wantsCA = false;
+  }
   BitSet32 fprInUse, gprInUse, gprInReg, fprInXmm;
   for (int i = block->m_num_instructions - 1; i >= 0; i--)
   {
@@ -876,14 +967,18 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32
     bool opWantsCR1 = code[i].wantsCR1;
     bool opWantsFPRF = code[i].wantsFPRF;
     bool opWantsCA = code[i].wantsCA;
+    const bool exitWantsCA =
+        code[i].canEndBlock &&
+        (!cross_branch_liveness ||
+         IsCarryLiveAtExit(code[i], found_exit && i == static_cast<int>(num_inst) - 1, block));
     code[i].wantsCR0 = wantsCR0 || code[i].canEndBlock;
     code[i].wantsCR1 = wantsCR1 || code[i].canEndBlock;
     code[i].wantsFPRF = wantsFPRF || code[i].canEndBlock;
-    code[i].wantsCA = wantsCA || code[i].canEndBlock;
+    code[i].wantsCA = wantsCA || exitWantsCA;
     wantsCR0 |= opWantsCR0 || code[i].canEndBlock;
     wantsCR1 |= opWantsCR1 || code[i].canEndBlock;
     wantsFPRF |= opWantsFPRF || code[i].canEndBlock;
-    wantsCA |= opWantsCA || code[i].canEndBlock;
+    wantsCA |= opWantsCA || exitWantsCA;
     wantsCR0 &= !code[i].outputCR0 || opWantsCR0;
     wantsCR1 &= !code[i].outputCR1 || opWantsCR1;
     wantsFPRF &= !code[i].outputFPRF || opWantsFPRF;
@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <functional>
 #include <map>
 #include <set>
 #include <string>
@@ -18,6 +19,11 @@
 class PPCSymbolDB;
 struct Symbol;
 
+namespace PowerPC
+{
+struct TryReadInstResult;
+}
+
 namespace PPCAnalyst
 {
 struct CodeOp  // 16B
@@ -44,6 +50,8 @@ struct CodeOp  // 16B
   bool canEndBlock;
   bool skipLRStack;
   bool skip;  // followed BL-s for example
+  // conditional branch whose target continues the block; the block is left when it isn't taken
+  bool isTraceBranch;
   // which registers are still needed after this instruction in this block
   BitSet32 fprInUse;
   BitSet32 gprInUse;
@@ -177,9 +185,13 @@ private:
   void ReorderInstructionsCore(u32 instructions, CodeOp* code, bool reverse, ReorderType type);
   void ReorderInstructions(u32 instructions, CodeOp* code);
   void SetInstructionStats(CodeBlock* block, CodeOp* code, const GekkoOPInfo* opinfo, u32 index);
+  PowerPC::TryReadInstResult ReadInstruction(u32 address) const;
+  bool IsCarryLiveAt(u32 address, CodeBlock* block) const;
+  bool IsCarryLiveAtExit(const CodeOp& op, bool falls_through, CodeBlock* block) const;
 
   // Options
   u32 m_options;
+  std::function<bool(u32 address)> m_branch_predictor;
 
 public:
   enum AnalystOption
@@ -218,13 +230,37 @@ public:
 
     // Reorder cror instructions next to their associated fcmp.
     OPTION_CROR_MERGE = (1 << 6),
+
+    // Read instructions without touching the emulated instruction cache or TLB.
+    // Required when analyzing off the CPU thread.
+    OPTION_HOST_READS = (1 << 7),
+
+    // Look at the code at the known targets of the block's exits to find out whether they
+    // overwrite the carry flag before reading it, instead of assuming that every exit needs it.
+    // The instructions looked at are added to the block's physical addresses, so that the block
+    // gets invalidated together with them.
+    OPTION_CROSS_BRANCH_LIVENESS = (1 << 8),
+
+    // Follow more unconditional branches per block. Makes for bigger blocks, so this is only
+    // worth it for hot code.
+    OPTION_EXTENDED_BLOCKS = (1 << 9),
+
+    // Also follow conditional branches which the branch predictor says are almost always taken,
+    // so that the block becomes a trace through the code which actually runs.
+    // Requires JIT support for CodeOp::isTraceBranch.
+    OPTION_TRACES = (1 << 10),
   };
 
+  // Returns whether the conditional branch at the given address is taken often enough to be
+  // followed by OPTION_TRACES.
+  using BranchPredictor = std::function<bool(u32 address)>;
+
   PPCAnalyzer() : m_options(0) {}
   // Option setting/getting
   void SetOption(AnalystOption option) { m_options |= option; }
   void ClearOption(AnalystOption option) { m_options &= ~(option); }
   bool HasOption(AnalystOption option) const { return !!(m_options & option); }
+  void SetBranchPredictor(BranchPredictor predictor) { m_branch_predictor = std::move(predictor); }
   u32 Analyze(u32 address, CodeBlock* block, CodeBuffer* buffer, u32 blockSize);
 };
 
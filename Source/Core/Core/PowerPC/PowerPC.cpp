@@ -4,6 +4,7 @@
 
 #include "Core/PowerPC/PowerPC.h"
 
+#include <cinttypes>
 #include <cstring>
 #include <vector>
 
@@ -23,6 +24,7 @@
 #include "Core/PowerPC/CPUCoreBase.h"
 #include "Core/PowerPC/Interpreter/Interpreter.h"
 #include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/SamplingProfiler.h"
 
 namespace PowerPC
 {
@@ -216,9 +218,11 @@ void Init(int cpu_core)
       CoreTiming::RegisterEvent("invalidateEmulatedCache", InvalidateCacheThreadSafe);
 
   Reset();
+  ResetMMUStats();
 
   InitializeCPUCore(cpu_core);
   ppcState.iCache.Init();
+  SamplingProfiler::Init();
 
   if (SConfig::GetInstance().bEnableDebugging)
     breakpoints.ClearAllTemporary();
@@ -249,6 +253,18 @@ void ScheduleInvalidateCacheThreadSafe(u32 address)
 
 void Shutdown()
 {
+  if (SConfig::GetInstance().bMMU)
+  {
+    const MMUStats& stats = GetMMUStats();
+    const u64 lookups = stats.software_tlb_hits + stats.software_tlb_misses;
+    NOTICE_LOG(POWERPC, "MMU: software TLB hit rate %.2f%% (%" PRIu64 " of %" PRIu64
+                        " lookups), %" PRIu64 " page walks, %" PRIu64
+                        " fastmem pages mapped in %" PRIu64 " rebuilds",
+               lookups ? 100.0 * stats.software_tlb_hits / lookups : 0.0, stats.software_tlb_hits,
+               lookups, stats.page_walks, stats.fastmem_pages_mapped, stats.fastmem_rebuilds);
+  }
+
+  SamplingProfiler::Shutdown();
   InjectExternalCPUCore(nullptr);
   JitInterface::Shutdown();
   s_interpreter->Shutdown();
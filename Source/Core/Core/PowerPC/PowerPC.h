@@ -245,6 +245,9 @@ struct TryReadInstResult
   u32 physical_address;
 };
 TryReadInstResult TryReadInstruction(u32 address);
+// Same as TryReadInstruction, but doesn't change any CPU state, so it can be used off the CPU
+// thread. Addresses which are only mapped through the page table are treated as invalid.
+TryReadInstResult HostTryReadInstruction(u32 address);
 
 u8 Read_U8(u32 address);
 u16 Read_U16(u32 address);
@@ -277,9 +280,27 @@ void ClearCacheLine(u32 address);  // Zeroes 32 bytes; address should be 32-byte
 
 // TLB functions
 void SDRUpdated();
+void SRUpdated();
 void InvalidateTLBEntry(u32 address);
 void DBATUpdated();
 void IBATUpdated();
+// Maps the page table for fastmem again if it or the segment registers changed since it was last
+// mapped. Returns false if the mappings were up to date. Called on fastmem faults.
+bool UpdateFastmemPageTable();
+
+struct MMUStats
+{
+  // Lookups in the host side TLB, which sits in front of the emulated one.
+  u64 software_tlb_hits;
+  u64 software_tlb_misses;
+  // Lookups which missed both TLBs and had to search the page table.
+  u64 page_walks;
+  // Pages translated through the page table which were mapped for fastmem.
+  u64 fastmem_pages_mapped;
+  u64 fastmem_rebuilds;
+};
+const MMUStats& GetMMUStats();
+void ResetMMUStats();
 
 // Result changes based on the BAT registers and MSR.DR.  Returns whether
 // it's safe to optimize a read or write to this address to an unguarded
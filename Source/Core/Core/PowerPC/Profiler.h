@@ -12,8 +12,8 @@
 
 struct BlockStat
 {
-  BlockStat(u32 _addr, u64 c, u64 ticks, u64 run, u32 size)
-      : addr(_addr), cost(c), tick_counter(ticks), run_count(run), block_size(size)
+  BlockStat(u32 _addr, u64 c, u64 ticks, u64 run, u32 size, u32 tier_)
+      : addr(_addr), cost(c), tick_counter(ticks), run_count(run), block_size(size), tier(tier_)
   {
   }
   u32 addr;
@@ -21,6 +21,7 @@ struct BlockStat
   u64 tick_counter;
   u64 run_count;
   u32 block_size;
+  u32 tier;
 
   bool operator<(const BlockStat& other) const { return cost > other.cost; }
 };
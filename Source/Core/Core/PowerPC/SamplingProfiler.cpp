@@ -0,0 +1,344 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/PowerPC/SamplingProfiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "Common/CommonFuncs.h"
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "Common/Logging/Log.h"
+#include "Common/StringUtil.h"
+#include "Common/Swap.h"
+#include "Core/ConfigManager.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/HW/SystemTimers.h"
+#include "Core/MachineContext.h"
+#include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PPCSymbolDB.h"
+#include "Core/PowerPC/PowerPC.h"
+
+namespace SamplingProfiler
+{
+// Samples per second of CPU thread time.
+constexpr long SAMPLE_FREQUENCY = 1000;
+// Samples are resolved on the CPU thread, between blocks, this many times per emulated second.
+constexpr u32 RESOLVE_FREQUENCY = 100;
+constexpr size_t SAMPLE_BUFFER_SIZE = 2048;
+constexpr u32 MAX_STACK_DEPTH = 32;
+
+// Everything the signal handler can find out without taking locks or calling into the emulator.
+// The JIT keeps guest registers in host registers, so r1 may be a few instructions out of date.
+struct Sample
+{
+  const void* host_pc;
+  u32 pc;
+  u32 lr;
+  u32 depth;
+  std::array<u32, MAX_STACK_DEPTH> return_addresses;
+};
+
+// Written by the signal handler and read on the CPU thread, which the handler interrupts.
+static std::array<Sample, SAMPLE_BUFFER_SIZE> s_samples;
+static std::atomic<u32> s_samples_head{0};
+static std::atomic<u32> s_samples_tail{0};
+static std::atomic<u64> s_samples_dropped{0};
+
+static std::atomic<bool> s_running{false};
+static CoreTiming::EventType* s_event_resolve;
+
+// Folded stack -> number of samples.
+static std::map<std::string, u64> s_folded_stacks;
+static u64 s_total_samples = 0;
+static std::mutex s_results_lock;
+
+#ifdef __linux__
+static std::mutex s_timer_lock;
+static bool s_timer_created = false;
+static timer_t s_timer;
+static bool s_handler_installed = false;
+static struct sigaction s_old_action;
+
+// Reads a word of the guest stack straight from RAM, as the signal handler can't use the MMU
+// code. Only BAT mapped stacks are supported, which is what games use.
+static bool ReadStackWord(u32 address, u32* value)
+{
+  if ((address & 3) != 0)
+    return false;
+  if (UReg_MSR(MSR).DR && !PowerPC::TranslateBatAddess(PowerPC::dbat_table, &address))
+    return false;
+
+  if (Memory::m_pRAM && address < Memory::REALRAM_SIZE)
+  {
+    *value = Common::swap32(Memory::m_pRAM + address);
+    return true;
+  }
+
+  const u32 exram_offset = address & 0x0FFFFFFF;
+  if (Memory::m_pEXRAM && (address >> 28) == 0x1 && exram_offset < Memory::EXRAM_SIZE)
+  {
+    *value = Common::swap32(Memory::m_pEXRAM + exram_offset);
+    return true;
+  }
+
+  return false;
+}
+
+static void SignalHandler(int, siginfo_t*, void* raw_context)
+{
+  const u32 head = s_samples_head.load(std::memory_order_relaxed);
+  if (head - s_samples_tail.load(std::memory_order_acquire) >= SAMPLE_BUFFER_SIZE)
+  {
+    s_samples_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  Sample& sample = s_samples[head % SAMPLE_BUFFER_SIZE];
+  SContext* ctx = &static_cast<ucontext_t*>(raw_context)->uc_mcontext;
+  sample.host_pc = reinterpret_cast<const void*>(ctx->CTX_PC);
+  sample.pc = PC;
+  sample.lr = LR;
+
+  // Walk the back chain. Each frame starts with a pointer to the caller's frame, which holds
+  // the saved LR at offset 4. The chain has to go up the stack, which stops loops.
+  sample.depth = 0;
+  u32 frame = PowerPC::ppcState.gpr[1];
+  u32 caller_frame;
+  u32 return_address;
+  while (sample.depth < MAX_STACK_DEPTH && ReadStackWord(frame, &caller_frame) &&
+         caller_frame > frame && ReadStackWord(caller_frame + 4, &return_address))
+  {
+    sample.return_addresses[sample.depth++] = return_address;
+    frame = caller_frame;
+  }
+
+  s_samples_head.store(head + 1, std::memory_order_release);
+}
+
+static void InstallSignalHandler()
+{
+  if (s_handler_installed)
+    return;
+
+  struct sigaction sa = {};
+  sa.sa_sigaction = &SignalHandler;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGPROF, &sa, &s_old_action);
+  s_handler_installed = true;
+}
+
+static void UninstallSignalHandler()
+{
+  if (!s_handler_installed)
+    return;
+
+  sigaction(SIGPROF, &s_old_action, nullptr);
+  s_handler_installed = false;
+}
+
+// Must be called on the CPU thread, whose CPU time the timer then measures.
+static void CreateTimer()
+{
+  sigevent event = {};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event._sigev_un._tid = static_cast<pid_t>(syscall(SYS_gettid));
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &s_timer) != 0)
+  {
+    ERROR_LOG(POWERPC, "Sampling profiler: timer_create failed: %s", LastStrerrorString().c_str());
+    return;
+  }
+
+  itimerspec spec = {};
+  spec.it_interval.tv_nsec = 1000000000 / SAMPLE_FREQUENCY;
+  spec.it_value = spec.it_interval;
+  timer_settime(s_timer, 0, &spec, nullptr);
+  s_timer_created = true;
+}
+
+static void DeleteTimer()
+{
+  if (!s_timer_created)
+    return;
+
+  timer_delete(s_timer);
+  s_timer_created = false;
+}
+#endif
+
+static std::string GetFunctionName(u32 address)
+{
+  const Symbol* symbol = g_symbolDB.GetSymbolFromAddr(address);
+  return symbol ? symbol->function_name : "[unknown]";
+}
+
+static std::string GetFoldedStack(const Sample& sample)
+{
+  // Samples outside of JIT code are in the emulator itself, e.g. in the slow path of a memory
+  // access. They are attributed to the last guest PC the JIT wrote back.
+  u32 address;
+  const bool in_jit_code = JitInterface::GetGuestAddressFromHostAddress(sample.host_pc, &address);
+  if (!in_jit_code)
+    address = sample.pc;
+
+  // Leaf first. LR is the caller until the leaf saves it and makes a call; repeats of the same
+  // function (e.g. LR pointing back into the leaf) are collapsed.
+  std::vector<std::string> frames{GetFunctionName(address)};
+  const auto add_caller = [&frames](u32 return_address) {
+    std::string name = GetFunctionName(return_address - 4);
+    if (name != frames.back())
+      frames.push_back(std::move(name));
+  };
+  add_caller(sample.lr);
+  for (u32 i = 0; i < sample.depth; i++)
+    add_caller(sample.return_addresses[i]);
+
+  std::string result;
+  for (auto iter = frames.rbegin(); iter != frames.rend(); ++iter)
+  {
+    if (!result.empty())
+      result += ';';
+    result += *iter;
+  }
+  if (!in_jit_code && PowerPC::GetMode() == PowerPC::CoreMode::JIT)
+    result += ";[host]";
+  return result;
+}
+
+// Must be called on the CPU thread, or with the CPU thread stopped, as the JIT blocks the
+// samples point into must not change meanwhile.
+static void ResolveSamples()
+{
+  std::lock_guard<std::mutex> lk(s_results_lock);
+  const u32 head = s_samples_head.load(std::memory_order_acquire);
+  u32 tail = s_samples_tail.load(std::memory_order_relaxed);
+  for (; tail != head; tail++)
+  {
+    s_folded_stacks[GetFoldedStack(s_samples[tail % SAMPLE_BUFFER_SIZE])]++;
+    s_total_samples++;
+  }
+  s_samples_tail.store(tail, std::memory_order_release);
+}
+
+static void ResolveCallback(u64 userdata, s64 cycles_late)
+{
+  ResolveSamples();
+
+#ifdef __linux__
+  {
+    std::lock_guard<std::mutex> lk(s_timer_lock);
+    if (s_running && !s_timer_created)
+      CreateTimer();
+  }
+#endif
+
+  if (s_running)
+  {
+    CoreTiming::ScheduleEvent(SystemTimers::GetTicksPerSecond() / RESOLVE_FREQUENCY - cycles_late,
+                              s_event_resolve);
+  }
+}
+
+void Init()
+{
+  s_event_resolve = CoreTiming::RegisterEvent("SamplingProfiler", ResolveCallback);
+
+  if (SConfig::GetInstance().bSamplingProfiler)
+    Start();
+}
+
+void Shutdown()
+{
+  const bool was_running = IsRunning();
+  Stop();
+  ResolveSamples();
+
+  if (was_running && s_total_samples != 0)
+  {
+    const std::string& game_id = SConfig::GetInstance().GetGameID();
+    const std::string filename =
+        StringFromFormat("%sDebug/%s_samples.folded", File::GetUserPath(D_DUMP_IDX).c_str(),
+                         game_id.empty() ? "unknown" : game_id.c_str());
+    WriteFoldedStacks(filename);
+    NOTICE_LOG(POWERPC, "Sampling profiler: wrote %" PRIu64 " samples (%" PRIu64 " dropped) to %s",
+               s_total_samples, s_samples_dropped.load(), filename.c_str());
+  }
+
+#ifdef __linux__
+  UninstallSignalHandler();
+#endif
+
+  std::lock_guard<std::mutex> lk(s_results_lock);
+  s_folded_stacks.clear();
+  s_total_samples = 0;
+  s_samples_dropped = 0;
+}
+
+void Start()
+{
+#ifdef __linux__
+  if (s_running.exchange(true))
+    return;
+
+  InstallSignalHandler();
+  // The timer is created on the CPU thread by the first callback.
+  CoreTiming::ScheduleEvent(0, s_event_resolve, 0, CoreTiming::FromThread::ANY);
+#else
+  WARN_LOG(POWERPC, "The sampling profiler is not supported on this platform.");
+#endif
+}
+
+void Stop()
+{
+  s_running = false;
+
+#ifdef __linux__
+  std::lock_guard<std::mutex> lk(s_timer_lock);
+  DeleteTimer();
+#endif
+}
+
+bool IsRunning()
+{
+  return s_running;
+}
+
+void WriteFoldedStacks(const std::string& filename)
+{
+  File::CreateFullPath(filename);
+  File::IOFile file(filename, "w");
+  if (!file)
+  {
+    ERROR_LOG(POWERPC, "Sampling profiler: failed to write %s", filename.c_str());
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(s_results_lock);
+  for (const auto& entry : s_folded_stacks)
+  {
+    const std::string line =
+        StringFromFormat("%s %" PRIu64 "\n", entry.first.c_str(), entry.second);
+    file.WriteBytes(line.data(), line.size());
+  }
+}
+}
@@ -0,0 +1,26 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+// Statistical profiler for guest code. Unlike block profiling, it doesn't instrument the
+// generated code: the CPU thread is interrupted at a fixed rate of its CPU time, and each sample
+// is attributed to the guest instruction whose JIT code was running, then aggregated by the
+// PPCSymbolDB functions of the guest call stack (recovered from the stack back chain).
+//
+// Results are written as folded stacks, which flamegraph.pl and compatible tools read directly.
+// Only supported on Linux.
+namespace SamplingProfiler
+{
+void Init();
+void Shutdown();
+
+void Start();
+void Stop();
+bool IsRunning();
+
+void WriteFoldedStacks(const std::string& filename);
+}
@@ -0,0 +1,400 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/Rewind.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <lzo/lzo1x.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Logging/Log.h"
+#include "Common/StringUtil.h"
+#include "Common/WorkQueueThread.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/HW/SystemTimers.h"
+#include "Core/Movie.h"
+#include "Core/NetPlayProto.h"
+#include "Core/State.h"
+
+#include "VideoCommon/Fifo.h"
+#include "VideoCommon/OnScreenDisplay.h"
+
+namespace Rewind
+{
+// Snapshots between keyframes. Stepping back decodes from the last keyframe on.
+constexpr u32 KEYFRAME_INTERVAL = 60;
+// Snapshots are skipped while the worker is this far behind.
+constexpr u32 MAX_PENDING_CAPTURES = 2;
+
+struct Capture
+{
+  bool keyframe;
+  u64 ticks;
+  u64 generation;
+  std::unique_ptr<State::Snapshot> snapshot;
+};
+
+static bool s_enabled = false;
+
+// Accessed on the CPU thread only.
+static u32 s_fields_since_capture = 0;
+static u32 s_captures_since_keyframe = 0;
+
+static std::atomic<bool> s_force_keyframe{true};
+static std::atomic<u32> s_pending_captures{0};
+
+static std::mutex s_spare_snapshots_lock;
+static std::vector<std::unique_ptr<State::Snapshot>> s_spare_snapshots;
+
+// Guards the ring. Stepping back increments the generation, so the worker drops the captures
+// that were still queued, which come after the snapshot that was loaded.
+static std::mutex s_entries_lock;
+static std::deque<Entry> s_entries;
+static size_t s_memory_usage = 0;
+static u64 s_generation = 0;
+
+// Accessed on the worker thread only.
+static std::unique_ptr<Encoder> s_encoder;
+// Set when a capture was lost, until the next keyframe.
+static bool s_chain_broken = false;
+
+static Common::WorkQueueThread<Capture> s_worker;
+
+static size_t GetMemoryUsage(const Entry& entry)
+{
+  return entry.compressed.size() + entry.page_addresses.size() * sizeof(u32);
+}
+
+static void XorBytes(u8* dest, const u8* src, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    dest[i] ^= src[i];
+}
+
+static void ResetDeltaBase(DeltaBase* base, const u8* state, u32 state_size,
+                           const std::vector<u32>& page_addresses, const u8* page_data)
+{
+  base->state.assign(state, state + state_size);
+  base->page_addresses = page_addresses;
+  base->page_data.assign(page_data, page_data + page_addresses.size() * Memory::DIRTY_PAGE_SIZE);
+  base->page_offsets.clear();
+  for (size_t i = 0; i < page_addresses.size(); i++)
+    base->page_offsets[page_addresses[i]] = i * Memory::DIRTY_PAGE_SIZE;
+}
+
+static u8* GetBasePage(DeltaBase* base, u32 address)
+{
+  auto iter = base->page_offsets.find(address);
+  if (iter == base->page_offsets.end())
+  {
+    // Only keyframes have all pages. Start missing ones out as zeroes, on both ends.
+    iter = base->page_offsets.emplace(address, base->page_data.size()).first;
+    base->page_addresses.push_back(address);
+    base->page_data.resize(base->page_data.size() + Memory::DIRTY_PAGE_SIZE);
+  }
+  return &base->page_data[iter->second];
+}
+
+// Turns the state and pages into their XOR with the base, which then holds them.
+static void EncodeDelta(DeltaBase* base, u8* state, u32 state_size,
+                        const std::vector<u32>& page_addresses, u8* page_data)
+{
+  base->state.resize(state_size);
+  XorBytes(state, base->state.data(), state_size);
+  XorBytes(base->state.data(), state, state_size);
+
+  for (size_t i = 0; i < page_addresses.size(); i++)
+  {
+    u8* page = page_data + i * Memory::DIRTY_PAGE_SIZE;
+    u8* base_page = GetBasePage(base, page_addresses[i]);
+    XorBytes(page, base_page, Memory::DIRTY_PAGE_SIZE);
+    XorBytes(base_page, page, Memory::DIRTY_PAGE_SIZE);
+  }
+}
+
+// The inverse of EncodeDelta: applies the delta to the base.
+static void DecodeDelta(DeltaBase* base, const u8* state, u32 state_size,
+                        const std::vector<u32>& page_addresses, const u8* page_data)
+{
+  base->state.resize(state_size);
+  XorBytes(base->state.data(), state, state_size);
+
+  for (size_t i = 0; i < page_addresses.size(); i++)
+  {
+    XorBytes(GetBasePage(base, page_addresses[i]), page_data + i * Memory::DIRTY_PAGE_SIZE,
+             Memory::DIRTY_PAGE_SIZE);
+  }
+}
+
+Encoder::Encoder()
+    : m_wrkmem((LZO1X_1_MEM_COMPRESS + sizeof(u64) - 1) / sizeof(u64))
+{
+  static_assert(alignof(u64) >= alignof(lzo_align_t), "LZO's work memory is misaligned");
+}
+
+bool Encoder::Encode(const State::Snapshot& snapshot, bool keyframe, u64 ticks, Entry* entry)
+{
+  const u32 state_size = static_cast<u32>(snapshot.state.size());
+
+  m_delta.resize(snapshot.state.size() + snapshot.page_data.size());
+  std::copy(snapshot.state.begin(), snapshot.state.end(), m_delta.begin());
+  std::copy(snapshot.page_data.begin(), snapshot.page_data.end(), m_delta.begin() + state_size);
+  if (keyframe)
+  {
+    ResetDeltaBase(&m_base, m_delta.data(), state_size, snapshot.page_addresses,
+                   m_delta.data() + state_size);
+  }
+  else
+  {
+    EncodeDelta(&m_base, m_delta.data(), state_size, snapshot.page_addresses,
+                m_delta.data() + state_size);
+  }
+
+  entry->keyframe = keyframe;
+  entry->ticks = ticks;
+  entry->state_size = state_size;
+  entry->uncompressed_size = static_cast<u32>(m_delta.size());
+  entry->page_addresses = snapshot.page_addresses;
+
+  m_compressed.resize(m_delta.size() + m_delta.size() / 16 + 64 + 3);
+  lzo_uint compressed_size = 0;
+  if (lzo1x_1_compress(m_delta.data(), m_delta.size(), m_compressed.data(), &compressed_size,
+                       m_wrkmem.data()) != LZO_E_OK)
+  {
+    return false;
+  }
+  entry->compressed.assign(m_compressed.begin(), m_compressed.begin() + compressed_size);
+  return true;
+}
+
+bool Decode(const std::deque<Entry>& entries, size_t index, State::Snapshot* snapshot)
+{
+  size_t keyframe = index;
+  while (!entries[keyframe].keyframe)
+  {
+    if (keyframe == 0)
+      return false;
+    keyframe--;
+  }
+
+  DeltaBase base;
+  std::vector<u8> buffer;
+  for (size_t i = keyframe; i <= index; i++)
+  {
+    const Entry& entry = entries[i];
+    buffer.resize(entry.uncompressed_size);
+    lzo_uint size = buffer.size();
+    if (lzo1x_decompress_safe(entry.compressed.data(), entry.compressed.size(), buffer.data(),
+                              &size, nullptr) != LZO_E_OK ||
+        size != buffer.size())
+    {
+      return false;
+    }
+
+    const u8* page_data = buffer.data() + entry.state_size;
+    if (entry.keyframe)
+      ResetDeltaBase(&base, buffer.data(), entry.state_size, entry.page_addresses, page_data);
+    else
+      DecodeDelta(&base, buffer.data(), entry.state_size, entry.page_addresses, page_data);
+  }
+
+  snapshot->keyframe = true;
+  snapshot->state = std::move(base.state);
+  snapshot->page_addresses = std::move(base.page_addresses);
+  snapshot->page_data = std::move(base.page_data);
+  return true;
+}
+
+static std::unique_ptr<State::Snapshot> GetSpareSnapshot()
+{
+  std::lock_guard<std::mutex> lk(s_spare_snapshots_lock);
+  if (s_spare_snapshots.empty())
+    return std::make_unique<State::Snapshot>();
+
+  std::unique_ptr<State::Snapshot> snapshot = std::move(s_spare_snapshots.back());
+  s_spare_snapshots.pop_back();
+  return snapshot;
+}
+
+static void ReturnSpareSnapshot(std::unique_ptr<State::Snapshot> snapshot)
+{
+  std::lock_guard<std::mutex> lk(s_spare_snapshots_lock);
+  s_spare_snapshots.push_back(std::move(snapshot));
+}
+
+// Drops the oldest keyframe and its deltas until the ring fits. s_entries_lock must be held.
+static void TrimEntries()
+{
+  const size_t max_memory_usage = static_cast<size_t>(SConfig::GetInstance().iRewindMemory) << 20;
+  while (s_memory_usage > max_memory_usage)
+  {
+    size_t next_keyframe = 1;
+    while (next_keyframe < s_entries.size() && !s_entries[next_keyframe].keyframe)
+      next_keyframe++;
+    if (next_keyframe == s_entries.size())
+      break;
+
+    for (size_t i = 0; i < next_keyframe; i++)
+    {
+      s_memory_usage -= GetMemoryUsage(s_entries.front());
+      s_entries.pop_front();
+    }
+  }
+}
+
+static void ProcessCapture(Capture capture)
+{
+  s_pending_captures--;
+  if (!capture.keyframe && s_chain_broken)
+  {
+    ReturnSpareSnapshot(std::move(capture.snapshot));
+    return;
+  }
+
+  Entry entry;
+  const bool success =
+      s_encoder->Encode(*capture.snapshot, capture.keyframe, capture.ticks, &entry);
+  ReturnSpareSnapshot(std::move(capture.snapshot));
+  if (!success)
+  {
+    ERROR_LOG(CORE, "Rewind: failed to compress a snapshot");
+    s_chain_broken = true;
+    s_force_keyframe = true;
+    return;
+  }
+  s_chain_broken = false;
+
+  {
+    std::lock_guard<std::mutex> lk(s_entries_lock);
+    if (capture.generation == s_generation)
+    {
+      s_memory_usage += GetMemoryUsage(entry);
+      s_entries.push_back(std::move(entry));
+      TrimEntries();
+    }
+  }
+}
+
+void Init()
+{
+  s_enabled = SConfig::GetInstance().bRewind && !NetPlay::IsNetPlayRunning();
+  if (!s_enabled)
+    return;
+
+  s_fields_since_capture = 0;
+  s_captures_since_keyframe = 0;
+  s_force_keyframe = true;
+  s_pending_captures = 0;
+  s_chain_broken = false;
+  s_encoder = std::make_unique<Encoder>();
+  s_worker.Reset(ProcessCapture);
+}
+
+void Shutdown()
+{
+  if (!s_enabled)
+    return;
+
+  s_worker.Shutdown();
+  s_enabled = false;
+
+  std::lock_guard<std::mutex> lk(s_entries_lock);
+  s_entries.clear();
+  s_memory_usage = 0;
+  s_generation++;
+  s_spare_snapshots.clear();
+  s_encoder.reset();
+}
+
+void FrameUpdate()
+{
+  if (!s_enabled)
+    return;
+
+  const u32 interval = std::max(SConfig::GetInstance().iRewindInterval, 1);
+  if (++s_fields_since_capture < interval || s_pending_captures >= MAX_PENDING_CAPTURES)
+    return;
+  s_fields_since_capture = 0;
+
+  Capture capture;
+  capture.keyframe =
+      s_force_keyframe.exchange(false) || ++s_captures_since_keyframe >= KEYFRAME_INTERVAL;
+  if (capture.keyframe)
+    s_captures_since_keyframe = 0;
+  capture.ticks = CoreTiming::GetTicks();
+  {
+    std::lock_guard<std::mutex> lk(s_entries_lock);
+    capture.generation = s_generation;
+  }
+  capture.snapshot = GetSpareSnapshot();
+  // The GPU thread writes to memory too. It has to be done with the FIFO data until the dirty
+  // pages are taken, or its writes meanwhile could be missing from both this snapshot and the next.
+  // Only this thread gives it more, so waiting for it to go idle is enough.
+  Fifo::SyncGPU(Fifo::SyncGPUReason::Other);
+  Fifo::FlushGpu();
+  State::SaveSnapshot(*capture.snapshot, capture.keyframe);
+
+  s_pending_captures++;
+  s_worker.EmplaceItem(std::move(capture));
+}
+
+bool StepBack()
+{
+  if (!s_enabled)
+    return false;
+  if (Movie::IsMovieActive())
+  {
+    OSD::AddMessage("Rewinding is disabled while a movie is active");
+    return false;
+  }
+
+  bool success = false;
+  Core::RunAsCPUThread([&] {
+    State::Snapshot snapshot;
+    u64 ticks = 0;
+    {
+      std::lock_guard<std::mutex> lk(s_entries_lock);
+      if (s_entries.empty())
+        return;
+      if (s_entries.size() > 1)
+      {
+        s_memory_usage -= GetMemoryUsage(s_entries.back());
+        s_entries.pop_back();
+      }
+      s_generation++;
+
+      if (!Decode(s_entries, s_entries.size() - 1, &snapshot))
+      {
+        ERROR_LOG(CORE, "Rewind: failed to decompress a snapshot");
+        return;
+      }
+      ticks = s_entries.back().ticks;
+    }
+
+    // The captures after this aren't relative to the snapshot being loaded.
+    s_force_keyframe = true;
+    s_fields_since_capture = 0;
+
+    const u64 ticks_back = CoreTiming::GetTicks() - ticks;
+    success = State::LoadSnapshot({&snapshot});
+    if (success)
+    {
+      OSD::AddMessage(StringFromFormat("Rewound %.1f seconds",
+                                       static_cast<double>(ticks_back) /
+                                           SystemTimers::GetTicksPerSecond()));
+    }
+  });
+  return success;
+}
+}
@@ -0,0 +1,75 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/State.h"
+
+// Keeps the recent past in memory to step back through. Every SConfig::iRewindInterval fields a
+// snapshot (see State::SaveSnapshot) is taken, then delta encoded against the one before and
+// compressed on a worker thread, with a self-contained keyframe every so often. The oldest
+// snapshots are dropped once the ring uses more than SConfig::iRewindMemory MiB.
+//
+// Snapshots are cheapest with dirty page tracking enabled, as only the pages written since the
+// last snapshot are then copied on the CPU thread.
+namespace Rewind
+{
+void Init();
+void Shutdown();
+
+// Called on the CPU thread at the end of each field.
+void FrameUpdate();
+
+// Goes back to the snapshot before the newest one, which is dropped. Repeat to go further back.
+bool StepBack();
+
+// A compressed snapshot.
+struct Entry
+{
+  // Keyframes don't depend on the entries before them.
+  bool keyframe;
+  u64 ticks;
+  u32 state_size;
+  u32 uncompressed_size;
+  std::vector<u32> page_addresses;
+  // The state, then the pages, each XORed with their previous contents unless a keyframe.
+  std::vector<u8> compressed;
+};
+
+// The previous contents the deltas are relative to.
+struct DeltaBase
+{
+  std::vector<u8> state;
+  std::vector<u32> page_addresses;
+  std::vector<u8> page_data;
+  std::unordered_map<u32, size_t> page_offsets;
+};
+
+// Turns a sequence of snapshots into entries.
+class Encoder
+{
+public:
+  Encoder();
+
+  // Unless keyframe is set, the entry is relative to the snapshot encoded before. Returns false
+  // if the snapshot couldn't be compressed, in which case the snapshots after it can't be
+  // encoded until the next keyframe.
+  bool Encode(const State::Snapshot& snapshot, bool keyframe, u64 ticks, Entry* entry);
+
+private:
+  DeltaBase m_base;
+  std::vector<u8> m_delta;
+  std::vector<u8> m_compressed;
+  // LZO's work memory, which has to be aligned like an lzo_align_t.
+  std::vector<u64> m_wrkmem;
+};
+
+// Rebuilds the full snapshot of entries[index], from the keyframe before it on.
+bool Decode(const std::deque<Entry>& entries, size_t index, State::Snapshot* snapshot);
+}
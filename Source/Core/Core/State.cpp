@@ -4,13 +4,17 @@
 
 #include "Core/State.h"
 
+#include <algorithm>
+#include <atomic>
 #include <lzo/lzo1x.h>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
 #include <vector>
+#include <zlib.h>
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
@@ -29,11 +33,13 @@
 #include "Core/CoreTiming.h"
 #include "Core/GeckoCode.h"
 #include "Core/HW/HW.h"
+#include "Core/HW/Memmap.h"
 #include "Core/HW/Wiimote.h"
 #include "Core/Host.h"
 #include "Core/Movie.h"
 #include "Core/NetPlayClient.h"
 #include "Core/PowerPC/PowerPC.h"
+#include "Core/StateChunkWriter.h"
 
 #include "VideoCommon/AVIDump.h"
 #include "VideoCommon/OnScreenDisplay.h"
@@ -41,6 +47,7 @@
 
 namespace State
 {
+// Chunk size of the LZO stream written by older versions, which can still be loaded.
 #if defined(__LZO_STRICT_16BIT)
 static const u32 IN_LEN = 8 * 1024u;
 #elif defined(LZO_ARCH_I086) && !defined(LZO_HAVE_MM_HUGE_ARRAY)
@@ -53,10 +60,9 @@ static const u32 OUT_LEN = IN_LEN + (IN_LEN / 16) + 64 + 3;
 
 static unsigned char __LZO_MMODEL out[OUT_LEN];
 
-#define HEAP_ALLOC(var, size)                                                                      \
-  lzo_align_t __LZO_MMODEL var[((size) + (sizeof(lzo_align_t) - 1)) / sizeof(lzo_align_t)]
-
-static HEAP_ALLOC(wrkmem, LZO1X_1_MEM_COMPRESS);
+// Far more than the emulated memory of a Wii, so that a corrupt header can't make loading
+// allocate arbitrary amounts of memory.
+static const u64 MAX_UNCOMPRESSED_STATE_SIZE = 1024 * 1024 * 1024;
 
 static std::string g_last_filename;
 
@@ -64,11 +70,9 @@ static AfterLoadCallbackFunc s_on_after_load_callback;
 
 // Temporary undo state buffer
 static std::vector<u8> g_undo_load_buffer;
-static std::vector<u8> g_current_buffer;
 static int g_loadDepth = 0;
 
 static std::mutex g_cs_undo_load_buffer;
-static std::mutex g_cs_current_buffer;
 static Common::Event g_compressAndDumpStateSyncEvent;
 
 static std::thread g_save_thread;
@@ -146,7 +150,7 @@ static bool DoStateVersion(PointerWrap& p, std::string* version_created_by)
   return true;
 }
 
-static std::string DoState(PointerWrap& p)
+static std::string DoState(PointerWrap& p, bool include_ram = true)
 {
   std::string version_created_by;
   if (!DoStateVersion(p, &version_created_by))
@@ -186,7 +190,7 @@ static std::string DoState(PointerWrap& p)
   // the controller code might need to schedule an event if the controller has changed.
   CoreTiming::DoState(p);
   p.DoMarker("CoreTiming");
-  HW::DoState(p);
+  HW::DoState(p, include_ram);
   p.DoMarker("HW");
   Movie::DoState(p);
   p.DoMarker("Movie");
@@ -240,6 +244,54 @@ void VerifyBuffer(std::vector<u8>& buffer)
   });
 }
 
+void SaveSnapshot(Snapshot& snapshot, bool keyframe)
+{
+  Core::RunAsCPUThread([&] {
+    u8* ptr = nullptr;
+    PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
+
+    DoState(p, false);
+    const size_t buffer_size = reinterpret_cast<size_t>(ptr);
+    snapshot.state.resize(buffer_size);
+
+    ptr = snapshot.state.data();
+    p.SetMode(PointerWrap::MODE_WRITE);
+    DoState(p, false);
+
+    // Only after DoState, which has the video backend write back to memory.
+    snapshot.keyframe = keyframe || !Memory::IsDirtyPageTrackingEnabled();
+    snapshot.page_addresses.clear();
+    snapshot.page_data.clear();
+    Memory::TakeDirtyPages(&snapshot.page_addresses, &snapshot.page_data, snapshot.keyframe);
+  });
+}
+
+bool LoadSnapshot(const std::vector<Snapshot*>& chain)
+{
+  if (NetPlay::IsNetPlayRunning())
+  {
+    OSD::AddMessage("Loading savestates is disabled in Netplay to prevent desyncs");
+    return false;
+  }
+  if (chain.empty() || !chain.front()->keyframe)
+    return false;
+
+  bool success = false;
+  Core::RunAsCPUThread([&] {
+    for (const Snapshot* snapshot : chain)
+      Memory::RestorePages(snapshot->page_addresses, snapshot->page_data);
+
+    u8* ptr = chain.back()->state.data();
+    PointerWrap p(&ptr, PointerWrap::MODE_READ);
+    DoState(p, false);
+    success = p.GetMode() == PointerWrap::MODE_READ;
+
+    // The next snapshot is relative to this one.
+    Memory::ClearDirtyPages();
+  });
+  return success;
+}
+
 // return state number not in map
 static int GetEmptySlot(std::map<double, int> m)
 {
@@ -287,18 +339,133 @@ static std::map<double, int> GetSavedStates()
   return m;
 }
 
+// Calls func(i) for every i in [0, count), spread over all cores.
+template <typename Func>
+static void ParallelFor(size_t count, Func func)
+{
+  const size_t num_threads =
+      std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), count);
+  std::atomic<size_t> next{0};
+  const auto worker = [&] {
+    for (size_t i = next++; i < count; i = next++)
+      func(i);
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads)
+    thread.join();
+}
+
+// Reads a state written by StateChunkWriter, after its CompressedStateHeader.
+static bool ReadCompressedState(File::IOFile& f, const CompressedStateHeader& header,
+                                std::vector<u8>& buffer)
+{
+  if (header.chunk_size == 0 || header.chunk_size > CHUNK_SIZE ||
+      header.uncompressed_size > MAX_UNCOMPRESSED_STATE_SIZE)
+  {
+    return false;
+  }
+
+  const u64 num_chunks = (header.uncompressed_size + header.chunk_size - 1) / header.chunk_size;
+  if (num_chunks * sizeof(ChunkInfo) > f.GetSize())
+    return false;
+
+  std::vector<ChunkInfo> chunk_infos(num_chunks);
+  if (!f.ReadArray(chunk_infos.data(), chunk_infos.size()))
+    return false;
+
+  std::vector<u64> chunk_offsets(num_chunks + 1);
+  for (size_t i = 0; i < num_chunks; i++)
+  {
+    const u32 compressed_size = chunk_infos[i].compressed_size & ~CHUNK_UNCOMPRESSED_FLAG;
+    if (compressed_size > CHUNK_OUT_LEN)
+      return false;
+    chunk_offsets[i + 1] = chunk_offsets[i] + compressed_size;
+  }
+  if (chunk_offsets.back() > f.GetSize() - f.Tell())
+    return false;
+
+  std::vector<u8> compressed(chunk_offsets.back());
+  if (!f.ReadBytes(compressed.data(), compressed.size()))
+    return false;
+
+  buffer.resize(header.uncompressed_size);
+  std::atomic<bool> success{true};
+  ParallelFor(num_chunks, [&](size_t i) {
+    const u8* chunk_data = compressed.data() + chunk_offsets[i];
+    const lzo_uint compressed_size = static_cast<lzo_uint>(chunk_offsets[i + 1] - chunk_offsets[i]);
+    u8* const dest = buffer.data() + i * header.chunk_size;
+    const lzo_uint dest_size = static_cast<lzo_uint>(
+        std::min<u64>(header.uncompressed_size - i * header.chunk_size, header.chunk_size));
+
+    lzo_uint new_len = dest_size;
+    if (chunk_infos[i].compressed_size & CHUNK_UNCOMPRESSED_FLAG)
+    {
+      if (compressed_size != dest_size)
+      {
+        success = false;
+        return;
+      }
+      std::copy(chunk_data, chunk_data + compressed_size, dest);
+    }
+    else if (lzo1x_decompress_safe(chunk_data, compressed_size, dest, &new_len, nullptr) !=
+                 LZO_E_OK ||
+             new_len != dest_size)
+    {
+      success = false;
+      return;
+    }
+
+    if (static_cast<u32>(adler32(1, dest, static_cast<uInt>(dest_size))) != chunk_infos[i].checksum)
+      success = false;
+  });
+
+  return success;
+}
+
+// Reads the LZO stream written by older versions, which is a sequence of compressed IN_LEN chunks.
+static bool ReadLegacyCompressedState(File::IOFile& f, u32 size, std::vector<u8>& buffer)
+{
+  buffer.resize(size);
+
+  lzo_uint i = 0;
+  while (true)
+  {
+    lzo_uint32 cur_len = 0;  // number of bytes to read
+    lzo_uint new_len = 0;    // number of bytes to write
+
+    if (!f.ReadArray(&cur_len, 1))
+      break;
+
+    f.ReadBytes(out, cur_len);
+    const int res = lzo1x_decompress(out, cur_len, &buffer[i], &new_len, nullptr);
+    if (res != LZO_E_OK)
+    {
+      // This doesn't seem to happen anymore.
+      PanicAlertT("Internal LZO Error - decompression failed (%d) (%li, %li) \n"
+                  "Try loading the state again",
+                  res, i, new_len);
+      return false;
+    }
+
+    i += new_len;
+  }
+
+  return true;
+}
+
 struct CompressAndDumpState_args
 {
-  std::vector<u8>* buffer_vector;
-  std::mutex* buffer_mutex;
+  std::unique_ptr<StateChunkWriter> writer;
   std::string filename;
   bool wait;
 };
 
 static void CompressAndDumpState(CompressAndDumpState_args save_args)
 {
-  std::lock_guard<std::mutex> lk(*save_args.buffer_mutex);
-
   // ScopeGuard is used here to ensure that g_compressAndDumpStateSyncEvent.Set()
   // will be called and that it will happen after the IOFile is closed.
   // Both ScopeGuard's and IOFile's finalization occur at respective object destruction time.
@@ -312,8 +479,6 @@ static void CompressAndDumpState(CompressAndDumpState_args save_args)
   if (!save_args.wait)
     on_exit.Exit();
 
-  const u8* const buffer_data = &(*(save_args.buffer_vector))[0];
-  const size_t buffer_size = (save_args.buffer_vector)->size();
   std::string& filename = save_args.filename;
 
   // For easy debugging
@@ -348,45 +513,13 @@ static void CompressAndDumpState(CompressAndDumpState_args save_args)
   // Setting up the header
   StateHeader header;
   strncpy(header.gameID, SConfig::GetInstance().GetGameID().c_str(), 6);
-  header.size = g_use_compression ? (u32)buffer_size : 0;
+  // Only states from older versions have a size, see CompressedStateHeader.
+  header.size = 0;
   header.time = Common::Timer::GetDoubleTime();
 
   f.WriteArray(&header, 1);
 
-  if (header.size != 0)  // non-zero header size means the state is compressed
-  {
-    lzo_uint i = 0;
-    while (true)
-    {
-      lzo_uint32 cur_len = 0;
-      lzo_uint out_len = 0;
-
-      if ((i + IN_LEN) >= buffer_size)
-      {
-        cur_len = (lzo_uint32)(buffer_size - i);
-      }
-      else
-      {
-        cur_len = IN_LEN;
-      }
-
-      if (lzo1x_1_compress(buffer_data + i, cur_len, out, &out_len, wrkmem) != LZO_E_OK)
-        PanicAlertT("Internal LZO Error - compression failed");
-
-      // The size of the data to write is 'out_len'
-      f.WriteArray((lzo_uint32*)&out_len, 1);
-      f.WriteBytes(out, out_len);
-
-      if (cur_len != IN_LEN)
-        break;
-
-      i += cur_len;
-    }
-  }
-  else  // uncompressed
-  {
-    f.WriteBytes(buffer_data, buffer_size);
-  }
+  save_args.writer->WriteTo(f);
 
   Core::DisplayMessage(StringFromFormat("Saved State to %s", filename.c_str()), 2000);
   Host_UpdateMainFrame();
@@ -395,33 +528,22 @@ static void CompressAndDumpState(CompressAndDumpState_args save_args)
 void SaveAs(const std::string& filename, bool wait)
 {
   Core::RunAsCPUThread([&] {
-    // Measure the size of the buffer.
-    u8* ptr = nullptr;
-    PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
+    auto writer = std::make_unique<StateChunkWriter>(g_use_compression);
+    PointerWrap p(writer.get());
     DoState(p);
-    const size_t buffer_size = reinterpret_cast<size_t>(ptr);
-
-    // Then actually do the write.
-    {
-      std::lock_guard<std::mutex> lk(g_cs_current_buffer);
-      g_current_buffer.resize(buffer_size);
-      ptr = &g_current_buffer[0];
-      p.SetMode(PointerWrap::MODE_WRITE);
-      DoState(p);
-    }
 
     if (p.GetMode() == PointerWrap::MODE_WRITE)
     {
+      p.Finish();
       Core::DisplayMessage("Saving State...", 1000);
 
       CompressAndDumpState_args save_args;
-      save_args.buffer_vector = &g_current_buffer;
-      save_args.buffer_mutex = &g_cs_current_buffer;
+      save_args.writer = std::move(writer);
       save_args.filename = filename;
       save_args.wait = wait;
 
       Flush();
-      g_save_thread = std::thread(CompressAndDumpState, save_args);
+      g_save_thread = std::thread(CompressAndDumpState, std::move(save_args));
       g_compressAndDumpStateSyncEvent.Wait();
 
       g_last_filename = filename;
@@ -483,44 +605,35 @@ static void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_
 
   std::vector<u8> buffer;
 
-  if (header.size != 0)  // non-zero size means the state is compressed
+  if (header.size != 0)  // non-zero size means the state is from an older version
   {
     Core::DisplayMessage("Decompressing State...", 500);
-
-    buffer.resize(header.size);
-
-    lzo_uint i = 0;
-    while (true)
+    if (!ReadLegacyCompressedState(f, header.size, buffer))
+      return;
+  }
+  else
+  {
+    CompressedStateHeader compressed_header;
+    if (f.ReadArray(&compressed_header, 1) && compressed_header.magic == COMPRESSED_STATE_MAGIC)
     {
-      lzo_uint32 cur_len = 0;  // number of bytes to read
-      lzo_uint new_len = 0;    // number of bytes to write
-
-      if (!f.ReadArray(&cur_len, 1))
-        break;
-
-      f.ReadBytes(out, cur_len);
-      const int res = lzo1x_decompress(out, cur_len, &buffer[i], &new_len, nullptr);
-      if (res != LZO_E_OK)
+      Core::DisplayMessage("Decompressing State...", 500);
+      if (!ReadCompressedState(f, compressed_header, buffer))
       {
-        // This doesn't seem to happen anymore.
-        PanicAlertT("Internal LZO Error - decompression failed (%d) (%li, %li) \n"
-                    "Try loading the state again",
-                    res, i, new_len);
+        PanicAlertT("The savestate is corrupted and could not be decompressed.");
         return;
       }
-
-      i += new_len;
     }
-  }
-  else  // uncompressed
-  {
-    const size_t size = (size_t)(f.GetSize() - sizeof(StateHeader));
-    buffer.resize(size);
-
-    if (!f.ReadBytes(&buffer[0], size))
+    else  // uncompressed
     {
-      PanicAlert("wtf? reading bytes: %zu", size);
-      return;
+      const size_t size = (size_t)(f.GetSize() - sizeof(StateHeader));
+      buffer.resize(size);
+
+      f.Clear();
+      if (!f.Seek(sizeof(StateHeader), SEEK_SET) || !f.ReadBytes(&buffer[0], size))
+      {
+        PanicAlert("wtf? reading bytes: %zu", size);
+        return;
+      }
     }
   }
 
@@ -642,11 +755,6 @@ void Shutdown()
   // swapping with an empty vector, rather than clear()ing
   // this gives a better guarantee to free the allocated memory right NOW (as opposed to, actually,
   // never)
-  {
-    std::lock_guard<std::mutex> lk(g_cs_current_buffer);
-    std::vector<u8>().swap(g_current_buffer);
-  }
-
   {
     std::lock_guard<std::mutex> lk(g_cs_undo_load_buffer);
     std::vector<u8>().swap(g_undo_load_buffer);
@@ -53,6 +53,24 @@ void SaveToBuffer(std::vector<u8>& buffer);
 void LoadFromBuffer(std::vector<u8>& buffer);
 void VerifyBuffer(std::vector<u8>& buffer);
 
+// Snapshots are savestates in memory for saving often, e.g. for rewinding. A keyframe holds all
+// of emulated memory. With dirty page tracking (SConfig::bDirtyPageTracking), the snapshots
+// after it only hold the pages written since the snapshot before; without, all are keyframes.
+struct Snapshot
+{
+  bool keyframe = false;
+  // Everything but emulated memory.
+  std::vector<u8> state;
+  // Physical addresses of the pages in page_data, Memory::DIRTY_PAGE_SIZE bytes each.
+  std::vector<u32> page_addresses;
+  std::vector<u8> page_data;
+};
+
+void SaveSnapshot(Snapshot& snapshot, bool keyframe);
+// Loads the last snapshot of the chain, which must start with a keyframe and contain every
+// snapshot taken after it.
+bool LoadSnapshot(const std::vector<Snapshot*>& chain);
+
 void LoadLastSaved(int i = 1);
 void SaveFirstSaved();
 void UndoSaveState();
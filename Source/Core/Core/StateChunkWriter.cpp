@@ -0,0 +1,159 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/StateChunkWriter.h"
+
+#include <algorithm>
+#include <lzo/lzo1x.h>
+#include <utility>
+#include <zlib.h>
+
+#include "Common/File.h"
+
+namespace State
+{
+StateChunkWriter::StateChunkWriter(bool compress) : m_compress(compress)
+{
+  if (!m_compress)
+    return;
+
+  const u32 num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  m_max_pending = 2 * num_threads;
+  for (u32 i = 0; i < num_threads; i++)
+    m_threads.emplace_back([this] { CompressChunks(); });
+}
+
+StateChunkWriter::~StateChunkWriter()
+{
+  StopThreads();
+}
+
+u8* StateChunkWriter::NextBuffer(u8* end, u8** next_end)
+{
+  if (end)
+    SubmitChunk(end);
+
+  m_chunks.emplace_back();
+  Chunk& chunk = m_chunks.back();
+  {
+    std::lock_guard<std::mutex> lk(m_lock);
+    if (!m_spare_buffers.empty())
+    {
+      chunk.data = std::move(m_spare_buffers.back());
+      m_spare_buffers.pop_back();
+    }
+  }
+  chunk.data.resize(CHUNK_SIZE);
+
+  *next_end = chunk.data.data() + CHUNK_SIZE;
+  return chunk.data.data();
+}
+
+void StateChunkWriter::Finish(u8* end)
+{
+  SubmitChunk(end);
+}
+
+void StateChunkWriter::WriteTo(File::IOFile& f)
+{
+  if (!m_compress)
+  {
+    for (const Chunk& chunk : m_chunks)
+      f.WriteBytes(chunk.data.data(), chunk.size);
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_done_cvar.wait(lk, [this] { return m_num_compressed == m_chunks.size(); });
+  }
+  StopThreads();
+
+  CompressedStateHeader header;
+  header.magic = COMPRESSED_STATE_MAGIC;
+  header.chunk_size = CHUNK_SIZE;
+  header.uncompressed_size = m_uncompressed_size;
+  f.WriteArray(&header, 1);
+  for (const Chunk& chunk : m_chunks)
+    f.WriteArray(&chunk.info, 1);
+  for (const Chunk& chunk : m_chunks)
+    f.WriteBytes(chunk.data.data(), chunk.info.compressed_size & ~CHUNK_UNCOMPRESSED_FLAG);
+}
+
+void StateChunkWriter::SubmitChunk(u8* end)
+{
+  Chunk& chunk = m_chunks.back();
+  chunk.size = static_cast<u32>(end - chunk.data.data());
+  m_uncompressed_size += chunk.size;
+  if (chunk.size == 0)
+  {
+    m_chunks.pop_back();
+    return;
+  }
+
+  if (m_compress)
+  {
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_done_cvar.wait(lk, [this] { return m_num_submitted - m_num_compressed < m_max_pending; });
+    m_queue.push(&chunk);
+    m_num_submitted++;
+    m_peak_pending = std::max(m_peak_pending, m_num_submitted - m_num_compressed);
+    m_queue_cvar.notify_one();
+  }
+}
+
+void StateChunkWriter::CompressChunks()
+{
+  std::vector<lzo_align_t> wrkmem((LZO1X_1_MEM_COMPRESS + sizeof(lzo_align_t) - 1) /
+                                  sizeof(lzo_align_t));
+  std::vector<u8> out(CHUNK_OUT_LEN);
+
+  while (true)
+  {
+    Chunk* chunk;
+    {
+      std::unique_lock<std::mutex> lk(m_lock);
+      m_queue_cvar.wait(lk, [this] { return m_stop || !m_queue.empty(); });
+      if (m_stop)
+        return;
+      chunk = m_queue.front();
+      m_queue.pop();
+    }
+
+    chunk->info.checksum = static_cast<u32>(adler32(1, chunk->data.data(), chunk->size));
+    lzo_uint out_len = 0;
+    std::vector<u8> spare_buffer;
+    if (lzo1x_1_compress(chunk->data.data(), chunk->size, out.data(), &out_len, wrkmem.data()) !=
+            LZO_E_OK ||
+        out_len >= chunk->size)
+    {
+      chunk->info.compressed_size = chunk->size | CHUNK_UNCOMPRESSED_FLAG;
+    }
+    else
+    {
+      chunk->info.compressed_size = static_cast<u32>(out_len);
+      spare_buffer = std::move(chunk->data);
+      chunk->data.assign(out.begin(), out.begin() + out_len);
+    }
+
+    std::lock_guard<std::mutex> lk(m_lock);
+    if (!spare_buffer.empty())
+      m_spare_buffers.push_back(std::move(spare_buffer));
+    m_num_compressed++;
+    m_done_cvar.notify_one();
+  }
+}
+
+void StateChunkWriter::StopThreads()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_lock);
+    m_stop = true;
+  }
+  m_queue_cvar.notify_all();
+  for (std::thread& thread : m_threads)
+    thread.join();
+  m_threads.clear();
+}
+}  // namespace State
@@ -0,0 +1,100 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Common/ChunkFile.h"
+#include "Common/CommonTypes.h"
+
+namespace File
+{
+class IOFile;
+}
+
+namespace State
+{
+// Compressed states are split into chunks that are compressed independently, so that they can be
+// compressed and decompressed on all cores. The StateHeader's size is 0, like for uncompressed
+// states, so that older versions fail the version check instead of misreading the LZO stream.
+// The chunk table follows the CompressedStateHeader, then the compressed chunks.
+static const u32 COMPRESSED_STATE_MAGIC = 0x43534344;  // "DCSC"
+static const u32 CHUNK_SIZE = 256 * 1024;
+static const u32 CHUNK_OUT_LEN = CHUNK_SIZE + (CHUNK_SIZE / 16) + 64 + 3;
+// Set in a ChunkInfo's compressed_size if the chunk didn't compress and is stored as is.
+static const u32 CHUNK_UNCOMPRESSED_FLAG = 0x80000000;
+
+struct CompressedStateHeader
+{
+  u32 magic;
+  u32 chunk_size;
+  u64 uncompressed_size;
+};
+
+struct ChunkInfo
+{
+  u32 compressed_size;
+  // Adler-32 of the uncompressed chunk.
+  u32 checksum;
+};
+
+// Collects a state being saved in chunks, which worker threads compress while the rest of the
+// state is still being written. Neither a measure pass nor a buffer for the whole state is needed.
+class StateChunkWriter final : public PointerWrapSink
+{
+public:
+  explicit StateChunkWriter(bool compress);
+  ~StateChunkWriter() override;
+
+  // Blocks while GetMaxPendingChunks() chunks wait to be compressed, so that writing a state
+  // doesn't outrun the workers and hold all of it uncompressed.
+  u8* NextBuffer(u8* end, u8** next_end) override;
+  void Finish(u8* end) override;
+
+  // Writes the state, which goes after the StateHeader.
+  void WriteTo(File::IOFile& f);
+
+  size_t GetMaxPendingChunks() const { return m_max_pending; }
+  // The most chunks that were waiting to be compressed at once.
+  size_t GetPeakPendingChunks() const { return m_peak_pending; }
+
+private:
+  struct Chunk
+  {
+    // The uncompressed chunk until it's compressed.
+    std::vector<u8> data;
+    u32 size = 0;
+    ChunkInfo info = {};
+  };
+
+  void SubmitChunk(u8* end);
+  void CompressChunks();
+  void StopThreads();
+
+  bool m_compress;
+  size_t m_max_pending = 0;
+  size_t m_peak_pending = 0;
+  u64 m_uncompressed_size = 0;
+  // A deque, as the workers hold pointers to the chunks while more are added.
+  std::deque<Chunk> m_chunks;
+
+  std::mutex m_lock;
+  std::condition_variable m_queue_cvar;
+  // Signalled whenever a worker has compressed a chunk.
+  std::condition_variable m_done_cvar;
+  std::queue<Chunk*> m_queue;
+  std::vector<std::vector<u8>> m_spare_buffers;
+  size_t m_num_submitted = 0;
+  size_t m_num_compressed = 0;
+  bool m_stop = false;
+  std::vector<std::thread> m_threads;
+};
+}
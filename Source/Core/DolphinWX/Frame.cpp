@@ -56,6 +56,7 @@
 #include "Core/IOS/IOS.h"
 #include "Core/IOS/USB/Bluetooth/BTBase.h"
 #include "Core/Movie.h"
+#include "Core/Rewind.h"
 #include "Core/State.h"
 
 #include "DolphinWX/Config/ConfigMain.h"
@@ -1679,6 +1680,8 @@ void CFrame::ParseHotkeys()
     State::UndoLoadState();
   if (IsHotkey(HK_UNDO_SAVE_STATE))
     State::UndoSaveState();
+  if (IsHotkey(HK_REWIND))
+    Rewind::StepBack();
 }
 
 void CFrame::HandleFrameSkipHotkeys()
@@ -0,0 +1,205 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoCommon/DisplayListCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+#include "VideoCommon/DataReader.h"
+#include "VideoCommon/NativeVertexFormat.h"
+#include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace DisplayListCache
+{
+// Dropping everything once either limit is hit keeps the bookkeeping trivial. Games which call
+// more display lists than this per frame won't benefit anyway.
+static constexpr size_t MAX_CACHED_BYTES = 64 * 1024 * 1024;
+static constexpr size_t MAX_DISPLAY_LISTS = 8192;
+
+struct Draw
+{
+  u32 offset;
+  const VertexLoaderBase* loader;
+  int primitive;
+  int count;
+  std::vector<u8> vertices;
+
+  // The loaders keep the last (up to) three positions around for the zfreeze slope.
+  int zfreeze_vertices;
+  bool has_position_matrix_index;
+  float position_cache[3][4];
+  u32 position_matrix_index[4];
+};
+
+struct DisplayList
+{
+  u64 hash = 0;
+  u32 calls = 0;
+  std::vector<Draw> draws;
+};
+
+enum class Mode
+{
+  None,
+  Record,
+  Replay
+};
+
+static std::unordered_map<u64, DisplayList> s_display_lists;
+static size_t s_cached_bytes = 0;
+
+// The display list currently being run.
+static Mode s_mode = Mode::None;
+static DisplayList* s_current = nullptr;
+static const u8* s_data = nullptr;
+static u32 s_size = 0;
+static bool s_hashed = false;
+static size_t s_next_draw = 0;
+
+static void TruncateDraws(DisplayList* display_list, size_t count)
+{
+  for (size_t i = count; i < display_list->draws.size(); ++i)
+    s_cached_bytes -= display_list->draws[i].vertices.size();
+  display_list->draws.resize(count);
+}
+
+void Init()
+{
+  SetHash64Function();
+  Clear();
+}
+
+void Clear()
+{
+  s_display_lists.clear();
+  s_cached_bytes = 0;
+  s_mode = Mode::None;
+  s_current = nullptr;
+}
+
+void BeginDisplayList(u32 address, const u8* data, u32 size)
+{
+  if (!g_ActiveConfig.bDisplayListCache)
+  {
+    if (!s_display_lists.empty())
+      Clear();
+    return;
+  }
+
+  if (s_cached_bytes > MAX_CACHED_BYTES || s_display_lists.size() >= MAX_DISPLAY_LISTS)
+    Clear();
+
+  s_current = &s_display_lists[(static_cast<u64>(address) << 32) | size];
+  s_data = data;
+  s_size = size;
+  s_hashed = false;
+  s_next_draw = 0;
+
+  // Lists which are only called once aren't worth copying the vertices of.
+  if (s_current->calls++ == 0)
+  {
+    s_mode = Mode::None;
+    return;
+  }
+
+  if (s_current->draws.empty())
+  {
+    // Hashed lazily, so lists without draws to keep cost nothing.
+    s_mode = Mode::Record;
+    return;
+  }
+
+  s_hashed = true;
+  if (GetHash64(data, size, 0) == s_current->hash)
+  {
+    s_mode = Mode::Replay;
+    return;
+  }
+
+  TruncateDraws(s_current, 0);
+  s_mode = Mode::Record;
+  s_hashed = false;
+}
+
+void EndDisplayList()
+{
+  if (s_mode == Mode::Replay && s_next_draw < s_current->draws.size())
+    TruncateDraws(s_current, s_next_draw);
+
+  s_mode = Mode::None;
+  s_current = nullptr;
+}
+
+const Draw* FindDraw(const VertexLoaderBase* loader, int primitive, int count, const u8* src)
+{
+  if (s_mode != Mode::Replay || loader->m_has_indexed_attributes)
+    return nullptr;
+
+  const u32 offset = static_cast<u32>(src - s_data);
+  if (s_next_draw < s_current->draws.size())
+  {
+    const Draw& draw = s_current->draws[s_next_draw];
+    if (draw.offset == offset && draw.loader == loader && draw.primitive == primitive &&
+        draw.count == count)
+    {
+      s_next_draw++;
+      return &draw;
+    }
+  }
+
+  // The CP state differs from when the list was recorded, so record it again from here on.
+  TruncateDraws(s_current, s_next_draw);
+  s_mode = Mode::Record;
+  return nullptr;
+}
+
+int ReplayDraw(const Draw* draw, DataReader dst)
+{
+  std::memcpy(dst.GetPointer(), draw->vertices.data(), draw->vertices.size());
+  std::memcpy(VertexLoaderManager::position_cache, draw->position_cache,
+              draw->zfreeze_vertices * sizeof(draw->position_cache[0]));
+  if (draw->has_position_matrix_index)
+  {
+    std::memcpy(&VertexLoaderManager::position_matrix_index[1], &draw->position_matrix_index[1],
+                draw->zfreeze_vertices * sizeof(u32));
+  }
+  return draw->count;
+}
+
+void RecordDraw(VertexLoaderBase* loader, int primitive, int count, const u8* src, const u8* dst)
+{
+  if (s_mode != Mode::Record || loader->m_has_indexed_attributes)
+    return;
+
+  if (!s_hashed)
+  {
+    s_current->hash = GetHash64(s_data, s_size, 0);
+    s_hashed = true;
+  }
+
+  const size_t size = static_cast<size_t>(count) * loader->m_native_vtx_decl.stride;
+  Draw draw;
+  draw.offset = static_cast<u32>(src - s_data);
+  draw.loader = loader;
+  draw.primitive = primitive;
+  draw.count = count;
+  draw.vertices.assign(dst, dst + size);
+  draw.zfreeze_vertices = std::min(count, 3);
+  draw.has_position_matrix_index = (loader->m_native_components & VB_HAS_POSMTXIDX) != 0;
+  std::memcpy(draw.position_cache, VertexLoaderManager::position_cache,
+              sizeof(draw.position_cache));
+  std::memcpy(draw.position_matrix_index, VertexLoaderManager::position_matrix_index,
+              sizeof(draw.position_matrix_index));
+
+  s_current->draws.push_back(std::move(draw));
+  s_cached_bytes += size;
+}
+}
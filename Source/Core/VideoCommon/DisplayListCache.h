@@ -0,0 +1,38 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+class DataReader;
+class VertexLoaderBase;
+
+// Remembers the converted vertices of the draws in display lists, so that calling the same list
+// again can copy them into the vertex buffer instead of running the vertex loaders. A list is keyed
+// by its address and size and checked against a hash of its contents on every call. Each draw is
+// also checked against the loader and vertex count it was recorded with, so CP state changes
+// between calls fall back to loading (and recording) the vertices again.
+//
+// Only draws without indexed attributes are kept, as the vertex arrays they would read from are
+// not part of the display list.
+namespace DisplayListCache
+{
+struct Draw;
+
+void Init();
+void Clear();
+
+// Called on the GPU thread around running a display list.
+void BeginDisplayList(u32 address, const u8* data, u32 size);
+void EndDisplayList();
+
+// Returns the recorded draw for this position in the running display list, if there is one.
+const Draw* FindDraw(const VertexLoaderBase* loader, int primitive, int count, const u8* src);
+// Copies the draw's vertices to dst and restores the loader side effects.
+int ReplayDraw(const Draw* draw, DataReader dst);
+// Records count vertices that the loader just wrote to dst.
+void RecordDraw(VertexLoaderBase* loader, int primitive, int count, const u8* src,
+                const u8* dst);
+}
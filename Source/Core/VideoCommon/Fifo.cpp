@@ -6,6 +6,7 @@
 
 #include <atomic>
 #include <cstring>
+#include <thread>
 
 #include "Common/Assert.h"
 #include "Common/Atomic.h"
@@ -15,6 +16,8 @@
 #include "Common/FPURoundMode.h"
 #include "Common/MemoryUtil.h"
 #include "Common/MsgHandler.h"
+#include "Common/Thread.h"
+#include "Common/Timer.h"
 
 #include "Core/ConfigManager.h"
 #include "Core/CoreTiming.h"
@@ -22,6 +25,7 @@
 #include "Core/Host.h"
 
 #include "VideoCommon/AsyncRequests.h"
+#include "VideoCommon/BPMemory.h"
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/CommandProcessor.h"
 #include "VideoCommon/DataReader.h"
@@ -33,20 +37,42 @@
 namespace Fifo
 {
 static constexpr u32 FIFO_SIZE = 2 * 1024 * 1024;
+// In pipelined mode this also carries the loaded vertices, so it has to fit the largest draw
+// (65535 vertices of up to 220 bytes each) next to the rest of the data.
+static constexpr u32 FIFO_AUX_SIZE = 16 * 1024 * 1024;
 static constexpr int GPU_TIME_SLOT_SIZE = 1000;
 
 static Common::BlockingLoop s_gpu_mainloop;
 
+// Reads and preprocesses the FIFO in pipelined mode, see RunDecodeLoop.
+static Common::BlockingLoop s_decode_loop;
+static std::thread s_decode_thread;
+static Common::Flag s_decode_idle;
+// Set by the decode thread when it has preprocessed a PE token or finish.
+static bool s_decode_hit_pe_signal;
+
 static Common::Flag s_emu_running_state;
 
 // Most of this array is unlikely to be faulted in...
-static u8 s_fifo_aux_data[FIFO_SIZE];
+static u8 s_fifo_aux_data[FIFO_AUX_SIZE];
 static u8* s_fifo_aux_write_ptr;
 static u8* s_fifo_aux_read_ptr;
 
 // This could be in SConfig, but it depends on multiple settings
 // and can change at runtime.
 static bool s_use_deterministic_gpu_thread;
+static bool s_use_pipelined_gpu_thread;
+
+// The time each stage of the pipelined mode spent working, for the statistics.
+static std::atomic<u64> s_decode_busy_us;
+// The time the decode thread spent waiting for the GPU thread, which isn't work.
+static u64 s_decode_wait_us;
+static std::atomic<u64> s_submit_busy_us;
+static u64 s_stage_load_time_us;
+static u64 s_stage_load_decode_us;
+static u64 s_stage_load_submit_us;
+static float s_decode_load;
+static float s_submit_load;
 
 static CoreTiming::EventType* s_event_sync_gpu;
 
@@ -56,6 +82,7 @@ static u8* s_video_buffer_read_ptr;
 static std::atomic<u8*> s_video_buffer_write_ptr;
 static std::atomic<u8*> s_video_buffer_seen_ptr;
 static u8* s_video_buffer_pp_read_ptr;
+static std::atomic<u8*> s_video_buffer_preprocessed_ptr;
 // The read_ptr is always owned by the GPU thread.  In normal mode, so is the
 // write_ptr, despite it being atomic.  In deterministic GPU thread mode,
 // things get a bit more complicated:
@@ -67,6 +94,9 @@ static u8* s_video_buffer_pp_read_ptr;
 // FIFO.  Maybe someday it will be under the lock.  For now, because RunGpuLoop
 // polls, it's just atomic.
 // - The pp_read_ptr is the CPU preprocessing version of the read_ptr.
+// In pipelined mode the decode thread takes the place of the CPU thread, and the
+// GPU thread only runs up to the preprocessed_ptr.  Unlike the write_ptr, that
+// never points into a partial command, whose vertices haven't been loaded yet.
 
 static std::atomic<int> s_sync_ticks;
 static bool s_syncing_suspended;
@@ -79,10 +109,16 @@ void DoState(PointerWrap& p)
   p.DoPointer(write_ptr, s_video_buffer);
   s_video_buffer_write_ptr = write_ptr;
   p.DoPointer(s_video_buffer_read_ptr, s_video_buffer);
-  if (p.mode == PointerWrap::MODE_READ && s_use_deterministic_gpu_thread)
+  if (p.mode == PointerWrap::MODE_READ &&
+      (s_use_deterministic_gpu_thread || s_use_pipelined_gpu_thread))
   {
     // We're good and paused, right?
     s_video_buffer_seen_ptr = s_video_buffer_pp_read_ptr = s_video_buffer_read_ptr;
+    s_video_buffer_preprocessed_ptr = s_video_buffer_read_ptr;
+
+    // The decode thread gets to preprocess the loaded commands again.
+    if (s_use_pipelined_gpu_thread)
+      s_fifo_aux_write_ptr = s_fifo_aux_read_ptr = s_fifo_aux_data;
   }
 
   p.Do(s_sync_ticks);
@@ -101,6 +137,8 @@ void PauseAndLock(bool doLock, bool unpauseOnUnlock)
     if (!param.bCPUThread || s_use_deterministic_gpu_thread)
       return;
 
+    if (s_use_pipelined_gpu_thread)
+      s_decode_loop.WaitYield(std::chrono::milliseconds(100), Host_YieldToUI);
     s_gpu_mainloop.WaitYield(std::chrono::milliseconds(100), Host_YieldToUI);
   }
   else
@@ -116,7 +154,11 @@ void Init()
   s_video_buffer = static_cast<u8*>(Common::AllocateMemoryPages(FIFO_SIZE + 4));
   ResetVideoBuffer();
   if (SConfig::GetInstance().bCPUThread)
+  {
     s_gpu_mainloop.Prepare();
+    if (SConfig::GetInstance().bPipelinedGPU)
+      s_decode_loop.Prepare();
+  }
   s_sync_ticks.store(0);
 }
 
@@ -131,6 +173,7 @@ void Shutdown()
   s_video_buffer_pp_read_ptr = nullptr;
   s_video_buffer_read_ptr = nullptr;
   s_video_buffer_seen_ptr = nullptr;
+  s_video_buffer_preprocessed_ptr = nullptr;
   s_fifo_aux_write_ptr = nullptr;
   s_fifo_aux_read_ptr = nullptr;
 }
@@ -152,16 +195,31 @@ void EmulatorState(bool running)
 {
   s_emu_running_state.Set(running);
   if (running)
+  {
+    s_decode_loop.Wakeup();
     s_gpu_mainloop.Wakeup();
+  }
   else
+  {
+    s_decode_loop.AllowSleep();
     s_gpu_mainloop.AllowSleep();
+  }
 }
 
-void SyncGPU(SyncGPUReason reason, bool may_move_read_ptr)
+static void WaitForGpuLoop()
+{
+  const u64 start_time = Common::Timer::GetTimeUs();
+  s_gpu_mainloop.Wait();
+  if (s_use_pipelined_gpu_thread)
+    s_decode_wait_us += Common::Timer::GetTimeUs() - start_time;
+}
+
+// Waits for the GPU thread to catch up with the preprocessing and moves what's left to the start
+// of the buffers.  Called from the thread which preprocesses.
+static void SyncPreprocessedData(bool may_move_read_ptr)
 {
-  if (s_use_deterministic_gpu_thread)
   {
-    s_gpu_mainloop.Wait();
+    WaitForGpuLoop();
     if (!s_gpu_mainloop.IsRunning())
       return;
 
@@ -182,36 +240,60 @@ void SyncGPU(SyncGPUReason reason, bool may_move_read_ptr)
 
       memmove(s_video_buffer, s_video_buffer_pp_read_ptr, size);
       // This change always decreases the pointers.  We write seen_ptr
-      // after write_ptr here, and read it before in RunGpuLoop, so
-      // 'write_ptr > seen_ptr' there cannot become spuriously true.
+      // after write_ptr (and preprocessed_ptr) here, and read it before in
+      // RunGpuLoop, so 'write_ptr > seen_ptr' there cannot become spuriously true.
       s_video_buffer_write_ptr = write_ptr = s_video_buffer + size;
+      s_video_buffer_preprocessed_ptr = s_video_buffer;
       s_video_buffer_pp_read_ptr = s_video_buffer;
       s_video_buffer_read_ptr = s_video_buffer;
-      s_video_buffer_seen_ptr = write_ptr;
+      s_video_buffer_seen_ptr = s_use_pipelined_gpu_thread ? s_video_buffer : write_ptr;
     }
   }
 }
 
-void PushFifoAuxBuffer(const void* ptr, size_t size)
+void SyncGPU(SyncGPUReason reason, bool may_move_read_ptr)
 {
-  if (size > (size_t)(s_fifo_aux_data + FIFO_SIZE - s_fifo_aux_write_ptr))
+  if (s_use_deterministic_gpu_thread)
+  {
+    SyncPreprocessedData(may_move_read_ptr);
+  }
+  else if (s_use_pipelined_gpu_thread && reason != SyncGPUReason::Swap)
   {
-    SyncGPU(SyncGPUReason::AuxSpace, /* may_move_read_ptr */ false);
+    // The callers may reset the buffers both threads work on. Swaps are queued for the GPU
+    // thread like in dual core mode, so they don't drain the pipeline every field.
+    s_decode_loop.Wait();
+    s_gpu_mainloop.Wait();
+  }
+}
+
+void* ReserveFifoAuxBuffer(size_t size)
+{
+  if (size > (size_t)(s_fifo_aux_data + FIFO_AUX_SIZE - s_fifo_aux_write_ptr))
+  {
+    SyncPreprocessedData(/* may_move_read_ptr */ false);
     if (!s_gpu_mainloop.IsRunning())
     {
       // GPU is shutting down
-      return;
+      return nullptr;
     }
-    if (size > (size_t)(s_fifo_aux_data + FIFO_SIZE - s_fifo_aux_write_ptr))
+    if (size > (size_t)(s_fifo_aux_data + FIFO_AUX_SIZE - s_fifo_aux_write_ptr))
     {
       // That will sync us up to the last 32 bytes, so this short region
-      // of FIFO would have to point to a 2MB display list or something.
+      // of FIFO would have to point to a 16MB display list or something.
       PanicAlert("absurdly large aux buffer");
-      return;
+      return nullptr;
     }
   }
-  memcpy(s_fifo_aux_write_ptr, ptr, size);
+  void* ret = s_fifo_aux_write_ptr;
   s_fifo_aux_write_ptr += size;
+  return ret;
+}
+
+void PushFifoAuxBuffer(const void* ptr, size_t size)
+{
+  void* dst = ReserveFifoAuxBuffer(size);
+  if (dst)
+    memcpy(dst, ptr, size);
 }
 
 void* PopFifoAuxBuffer(size_t size)
@@ -221,6 +303,21 @@ void* PopFifoAuxBuffer(size_t size)
   return ret;
 }
 
+void PreprocessBPWrite(u32 value)
+{
+  switch (value >> 24)
+  {
+  case BPMEM_SETDRAWDONE:
+    if ((value & 0xff) == 0x02)
+      s_decode_hit_pe_signal = true;
+    break;
+  case BPMEM_PE_TOKEN_ID:
+  case BPMEM_PE_TOKEN_INT_ID:
+    s_decode_hit_pe_signal = true;
+    break;
+  }
+}
+
 // Description: RunGpuLoop() sends data through this function.
 static void ReadDataFromFifo(u32 readPtr)
 {
@@ -242,7 +339,7 @@ static void ReadDataFromFifo(u32 readPtr)
   s_video_buffer_write_ptr += len;
 }
 
-// The deterministic_gpu_thread version.
+// The deterministic_gpu_thread and pipelined version.
 static void ReadDataFromFifoOnCPU(u32 readPtr)
 {
   size_t len = 32;
@@ -251,7 +348,7 @@ static void ReadDataFromFifoOnCPU(u32 readPtr)
   {
     // We can't wrap around while the GPU is working on the data.
     // This should be very rare due to the reset in SyncGPU.
-    SyncGPU(SyncGPUReason::Wraparound);
+    SyncPreprocessedData(/* may_move_read_ptr */ true);
     if (!s_gpu_mainloop.IsRunning())
     {
       // GPU is shutting down, so the next asserts may fail
@@ -276,6 +373,7 @@ static void ReadDataFromFifoOnCPU(u32 readPtr)
       DataReader(s_video_buffer_pp_read_ptr, write_ptr + len), nullptr, false);
   // This would have to be locked if the GPU thread didn't spin.
   s_video_buffer_write_ptr = write_ptr + len;
+  s_video_buffer_preprocessed_ptr = s_video_buffer_pp_read_ptr;
 }
 
 void ResetVideoBuffer()
@@ -284,10 +382,75 @@ void ResetVideoBuffer()
   s_video_buffer_write_ptr = s_video_buffer;
   s_video_buffer_seen_ptr = s_video_buffer;
   s_video_buffer_pp_read_ptr = s_video_buffer;
+  s_video_buffer_preprocessed_ptr = s_video_buffer;
   s_fifo_aux_write_ptr = s_fifo_aux_data;
   s_fifo_aux_read_ptr = s_fifo_aux_data;
 }
 
+// In pipelined mode this thread reads the FIFO instead of the GPU thread.  It preprocesses the
+// commands like the CPU thread does in deterministic mode, which includes loading the vertices,
+// and leaves only the backend work to the GPU thread.
+static void RunDecodeLoop()
+{
+  Common::SetCurrentThreadName("Video Decode thread");
+
+  s_decode_loop.Run(
+      [] {
+        if (!s_emu_running_state.IsSet() || !s_use_pipelined_gpu_thread)
+          return;
+
+        CommandProcessor::SCPFifoStruct& fifo = CommandProcessor::fifo;
+        const u64 start_time = Common::Timer::GetTimeUs();
+        const u64 start_wait_us = s_decode_wait_us;
+        s_decode_idle.Clear();
+
+        // Commands which were restored by loading a state haven't been preprocessed yet.
+        if (s_video_buffer_pp_read_ptr != s_video_buffer_write_ptr)
+        {
+          s_video_buffer_pp_read_ptr = OpcodeDecoder::Run<true>(
+              DataReader(s_video_buffer_pp_read_ptr, s_video_buffer_write_ptr), nullptr, false);
+          s_video_buffer_preprocessed_ptr = s_video_buffer_pp_read_ptr;
+        }
+
+        CommandProcessor::SetCPStatusFromGPU();
+
+        // check if we are able to run this buffer
+        while (!CommandProcessor::IsInterruptWaiting() && fifo.bFF_GPReadEnable &&
+               fifo.CPReadWriteDistance && !AtBreakpoint() && s_emu_running_state.IsSet())
+        {
+          u32 readPtr = fifo.CPReadPointer;
+          ReadDataFromFifoOnCPU(readPtr);
+          s_gpu_mainloop.Wakeup();
+          // The CPU may wait for the token, and mustn't see the read pointer past it before.
+          if (s_decode_hit_pe_signal)
+          {
+            s_decode_hit_pe_signal = false;
+            WaitForGpuLoop();
+          }
+
+          if (readPtr == fifo.CPEnd)
+            readPtr = fifo.CPBase;
+          else
+            readPtr += 32;
+
+          Common::AtomicStore(fifo.CPReadPointer, readPtr);
+          Common::AtomicAdd(fifo.CPReadWriteDistance, static_cast<u32>(-32));
+          if (s_video_buffer_pp_read_ptr == s_video_buffer_write_ptr)
+            Common::AtomicStore(fifo.SafeCPReadPointer, fifo.CPReadPointer);
+
+          CommandProcessor::SetCPStatusFromGPU();
+        }
+
+        s_decode_busy_us +=
+            Common::Timer::GetTimeUs() - start_time - (s_decode_wait_us - start_wait_us);
+
+        // Lets the GPU thread flush the vertex manager once it has caught up.
+        s_decode_idle.Set();
+        s_gpu_mainloop.Wakeup();
+      },
+      100);
+}
+
 // Description: Main FIFO update loop
 // Purpose: Keep the Core HW updated about the CPU-GPU distance
 void RunGpuLoop()
@@ -295,6 +458,9 @@ void RunGpuLoop()
   AsyncRequests::GetInstance()->SetEnable(true);
   AsyncRequests::GetInstance()->SetPassthrough(false);
 
+  if (SConfig::GetInstance().bCPUThread && SConfig::GetInstance().bPipelinedGPU)
+    s_decode_thread = std::thread(RunDecodeLoop);
+
   s_gpu_mainloop.Run(
       [] {
         const SConfig& param = SConfig::GetInstance();
@@ -305,19 +471,30 @@ void RunGpuLoop()
         if (!s_emu_running_state.IsSet())
           return;
 
-        if (s_use_deterministic_gpu_thread)
+        if (s_use_deterministic_gpu_thread || s_use_pipelined_gpu_thread)
         {
           AsyncRequests::GetInstance()->PullEvents();
 
-          // All the fifo/CP stuff is on the CPU.  We just need to run the opcode decoder.
+          // All the fifo/CP stuff is on the CPU (or the decode thread).  We just need to run the
+          // opcode decoder.
           u8* seen_ptr = s_video_buffer_seen_ptr;
-          u8* write_ptr = s_video_buffer_write_ptr;
+          u8* write_ptr = s_use_pipelined_gpu_thread ? s_video_buffer_preprocessed_ptr :
+                                                       s_video_buffer_write_ptr;
           // See comment in SyncGPU
           if (write_ptr > seen_ptr)
           {
+            const u64 start_time = Common::Timer::GetTimeUs();
             s_video_buffer_read_ptr =
                 OpcodeDecoder::Run(DataReader(s_video_buffer_read_ptr, write_ptr), nullptr, false);
             s_video_buffer_seen_ptr = write_ptr;
+            s_submit_busy_us += Common::Timer::GetTimeUs() - start_time;
+          }
+
+          // Like in dual core mode, draw what's buffered once the FIFO has run dry.
+          if (s_use_pipelined_gpu_thread && s_decode_idle.IsSet() &&
+              s_video_buffer_preprocessed_ptr == write_ptr)
+          {
+            g_vertex_manager->Flush();
           }
         }
         else
@@ -391,6 +568,12 @@ void RunGpuLoop()
       },
       100);
 
+  if (s_decode_thread.joinable())
+  {
+    s_decode_loop.Stop();
+    s_decode_thread.join();
+  }
+
   AsyncRequests::GetInstance()->SetEnable(false);
   AsyncRequests::GetInstance()->SetPassthrough(true);
 }
@@ -402,11 +585,14 @@ void FlushGpu()
   if (!param.bCPUThread || s_use_deterministic_gpu_thread)
     return;
 
+  if (s_use_pipelined_gpu_thread)
+    s_decode_loop.Wait();
   s_gpu_mainloop.Wait();
 }
 
 void GpuMaySleep()
 {
+  s_decode_loop.AllowSleep();
   s_gpu_mainloop.AllowSleep();
 }
 
@@ -421,7 +607,11 @@ void RunGpu()
   const SConfig& param = SConfig::GetInstance();
 
   // wake up GPU thread
-  if (param.bCPUThread && !s_use_deterministic_gpu_thread)
+  if (param.bCPUThread && s_use_pipelined_gpu_thread)
+  {
+    s_decode_loop.Wakeup();
+  }
+  else if (param.bCPUThread && !s_use_deterministic_gpu_thread)
   {
     s_gpu_mainloop.Wakeup();
   }
@@ -513,16 +703,28 @@ void UpdateWantDeterminism(bool want)
 
   gpu_thread = gpu_thread && param.bCPUThread;
 
-  if (s_use_deterministic_gpu_thread != gpu_thread)
+  // SyncGPU mode needs the cycle counts of the commands as they are run, so it stays on a single
+  // thread.
+  const bool pipelined = param.bCPUThread && param.bPipelinedGPU && !param.bSyncGPU && !gpu_thread;
+
+  if (s_use_deterministic_gpu_thread != gpu_thread || s_use_pipelined_gpu_thread != pipelined)
   {
+    const bool was_preprocessing = s_use_deterministic_gpu_thread || s_use_pipelined_gpu_thread;
     s_use_deterministic_gpu_thread = gpu_thread;
-    if (gpu_thread)
+    s_use_pipelined_gpu_thread = pipelined;
+    if (gpu_thread || pipelined)
     {
       // These haven't been updated in non-deterministic mode.
       s_video_buffer_seen_ptr = s_video_buffer_pp_read_ptr = s_video_buffer_read_ptr;
+      s_video_buffer_preprocessed_ptr = s_video_buffer_read_ptr;
       CopyPreprocessCPStateFromMain();
       VertexLoaderManager::MarkAllDirty();
     }
+    else if (was_preprocessing)
+    {
+      // The array pointers were resolved from the preprocess state in pipelined mode.
+      g_main_cp_state.bases_dirty = true;
+    }
   }
 }
 
@@ -531,6 +733,35 @@ bool UseDeterministicGPUThread()
   return s_use_deterministic_gpu_thread;
 }
 
+bool UsePipelinedGPUThread()
+{
+  return s_use_pipelined_gpu_thread;
+}
+
+bool GetPipelineStageLoad(float* decode_load, float* submit_load)
+{
+  if (!s_use_pipelined_gpu_thread)
+    return false;
+
+  // Averaged over a second, as this is polled every frame.
+  const u64 now = Common::Timer::GetTimeUs();
+  const u64 elapsed = now - s_stage_load_time_us;
+  if (elapsed >= 1000000)
+  {
+    const u64 decode_us = s_decode_busy_us;
+    const u64 submit_us = s_submit_busy_us;
+    s_decode_load = static_cast<float>(decode_us - s_stage_load_decode_us) / elapsed;
+    s_submit_load = static_cast<float>(submit_us - s_stage_load_submit_us) / elapsed;
+    s_stage_load_time_us = now;
+    s_stage_load_decode_us = decode_us;
+    s_stage_load_submit_us = submit_us;
+  }
+
+  *decode_load = s_decode_load;
+  *submit_load = s_submit_load;
+  return true;
+}
+
 /* This function checks the emulated CPU - GPU distance and may wake up the GPU,
  * or block the CPU if required. It should be called by the CPU thread regularly.
  * @ticks The gone emulated CPU time.
@@ -18,6 +18,11 @@ void DoState(PointerWrap& f);
 void PauseAndLock(bool doLock, bool unpauseOnUnlock);
 void UpdateWantDeterminism(bool want);
 bool UseDeterministicGPUThread();
+// In pipelined mode a separate thread reads the FIFO and loads the vertices, and the GPU thread
+// only runs the backend side of the commands.
+bool UsePipelinedGPUThread();
+// Reports how busy the two threads of the pipelined mode are, as a fraction of the time.
+bool GetPipelineStageLoad(float* decode_load, float* submit_load);
 
 // Used for diagnostics.
 enum class SyncGPUReason
@@ -30,11 +35,17 @@ enum class SyncGPUReason
   Swap,
   AuxSpace,
 };
-// In deterministic GPU thread mode this waits for the GPU to be done with pending work.
+// In deterministic and pipelined GPU thread mode this waits for the GPU to be done with pending
+// work.
 void SyncGPU(SyncGPUReason reason, bool may_move_read_ptr = true);
 
 void PushFifoAuxBuffer(const void* ptr, size_t size);
+// Like PushFifoAuxBuffer, but lets the caller write the data.  Returns nullptr on failure.
+void* ReserveFifoAuxBuffer(size_t size);
 void* PopFifoAuxBuffer(size_t size);
+// Called by the decode thread in pipelined mode.  After a BP write which raises a PE token or
+// finish, it stops reading the FIFO until the GPU thread has raised it, like in dual core mode.
+void PreprocessBPWrite(u32 value);
 
 void FlushGpu();
 void RunGpu();
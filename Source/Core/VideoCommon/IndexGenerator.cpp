@@ -2,10 +2,13 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <array>
 #include <cstddef>
 
+#include "Common/CPUDetect.h"
 #include "Common/Common.h"
 #include "Common/CommonTypes.h"
+#include "Common/Intrinsics.h"
 #include "Common/Logging/Log.h"
 #include "VideoCommon/IndexGenerator.h"
 #include "VideoCommon/OpcodeDecoding.h"
@@ -20,27 +23,193 @@ static const u16 s_primitive_restart = UINT16_MAX;
 
 static u16* (*primitive_table[8])(u16*, u32, u32);
 
+// The indices one iteration of a vectorized primitive writes, as vertex numbers of the first
+// iteration. Every following iteration is the same pattern moved up by `vertices`.
+static constexpr s8 CENTER = -1;   // The first vertex of the draw, for fans.
+static constexpr s8 RESTART = -2;  // The primitive restart index.
+
+template <size_t N>
+struct IndexPattern
+{
+  IndexPattern(u32 vertices_, const std::array<s8, 8 * N>& offsets) : vertices(vertices_)
+  {
+    for (size_t i = 0; i < 8 * N; ++i)
+    {
+      start[i] = offsets[i] < 0 ? 0 : offsets[i];
+      step[i] = offsets[i] < 0 ? 0 : vertices;
+      mask[i] = offsets[i] == RESTART ? s_primitive_restart : 0;
+    }
+    // The same for two iterations at a time, for AVX2.
+    for (size_t i = 0; i < 16 * N; ++i)
+    {
+      const size_t lane = i % (8 * N);
+      start2[i] = start[lane] + step[lane] * static_cast<u16>(i / (8 * N));
+      step2[i] = step[lane] * 2;
+      mask2[i] = mask[lane];
+    }
+  }
+
+  u32 vertices;
+
+  // Each index is (index + start + iteration * step) | mask.
+  u16 start[8 * N];
+  u16 step[8 * N];
+  u16 mask[8 * N];
+  u16 start2[16 * N];
+  u16 step2[16 * N];
+  u16 mask2[16 * N];
+};
+
+// Points, line lists and primitive restart strips.
+static const IndexPattern<1> s_sequence(8, {{0, 1, 2, 3, 4, 5, 6, 7}});
+static const IndexPattern<3> s_list(24, {{0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11,
+                                          12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23}});
+static const IndexPattern<1> s_list_pr(6, {{0, 1, 2, RESTART, 3, 4, 5, RESTART}});
+static const IndexPattern<3> s_strip(8, {{0, 1, 2, 1, 3, 2, 2, 3, 4, 3, 5, 4,
+                                          4, 5, 6, 5, 7, 6, 6, 7, 8, 7, 9, 8}});
+static const IndexPattern<3> s_fan(8, {{CENTER, 1, 2, CENTER, 2, 3, CENTER, 3, 4, CENTER, 4, 5,
+                                        CENTER, 5, 6, CENTER, 6, 7, CENTER, 7, 8, CENTER, 8, 9}});
+static const IndexPattern<3> s_fan_pr(12, {{1, 2,  CENTER, 3,  4,  RESTART, 4,  5,
+                                            CENTER, 6, 7,  RESTART, 7,  8,  CENTER, 9,
+                                            10, RESTART, 10, 11, CENTER, 12, 13, RESTART}});
+static const IndexPattern<3> s_quads(16, {{0, 1, 2, 0, 2, 3, 4,  5,  6,  4,  6,  7,
+                                           8, 9, 10, 8, 10, 11, 12, 13, 14, 12, 14, 15}});
+static const IndexPattern<5> s_quads_pr(
+    32, {{1,  2,  0,  3,  RESTART, 5,  6,  4,  7,  RESTART, 9,  10, 8,  11,
+          RESTART, 13, 14, 12, 15, RESTART, 17, 18, 16, 19, RESTART, 21, 22, 20,
+          23, RESTART, 25, 26, 24, 27, RESTART, 29, 30, 28, 31, RESTART}});
+static const IndexPattern<1> s_line_strip(4, {{0, 1, 1, 2, 2, 3, 3, 4}});
+
+// Each of these writes as many iterations of a pattern as fit into numVerts, leaving out the
+// vertices before first. Returns the vertex the scalar code continues with.
+struct ScalarIndices
+{
+  template <size_t N>
+  static u32 Write(u16*& Iptr, const IndexPattern<N>& pattern, u32 index, u32 first, u32 numVerts)
+  {
+    return first;
+  }
+};
+
+#ifdef _M_X86
+template <size_t N>
+static u16* WriteSSE2(u16* Iptr, const IndexPattern<N>& pattern, u32 index, u32 iteration,
+                      u32 count)
+{
+  const __m128i base = _mm_set1_epi16(static_cast<s16>(index));
+  const __m128i first = _mm_set1_epi16(static_cast<s16>(iteration));
+  __m128i values[N], steps[N], masks[N];
+  for (size_t j = 0; j < N; ++j)
+  {
+    steps[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pattern.step[8 * j]));
+    masks[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pattern.mask[8 * j]));
+    values[j] = _mm_add_epi16(
+        base, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pattern.start[8 * j])));
+    values[j] = _mm_add_epi16(values[j], _mm_mullo_epi16(steps[j], first));
+  }
+
+  for (u32 i = 0; i < count; ++i)
+  {
+    for (size_t j = 0; j < N; ++j)
+    {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(Iptr), _mm_or_si128(values[j], masks[j]));
+      values[j] = _mm_add_epi16(values[j], steps[j]);
+      Iptr += 8;
+    }
+  }
+  return Iptr;
+}
+
+struct SSE2Indices
+{
+  template <size_t N>
+  static u32 Write(u16*& Iptr, const IndexPattern<N>& pattern, u32 index, u32 first, u32 numVerts)
+  {
+    if (numVerts <= first)
+      return first;
+    const u32 count = (numVerts - first) / pattern.vertices;
+    Iptr = WriteSSE2(Iptr, pattern, index, 0, count);
+    return first + count * pattern.vertices;
+  }
+};
+
+template <size_t N>
+FUNCTION_TARGET_AVX2 static u16* WriteAVX2(u16* Iptr, const IndexPattern<N>& pattern, u32 index,
+                                           u32 count)
+{
+  const __m256i base = _mm256_set1_epi16(static_cast<s16>(index));
+  __m256i values[N], steps[N], masks[N];
+  for (size_t j = 0; j < N; ++j)
+  {
+    values[j] = _mm256_add_epi16(
+        base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&pattern.start2[16 * j])));
+    steps[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&pattern.step2[16 * j]));
+    masks[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&pattern.mask2[16 * j]));
+  }
+
+  for (u32 i = 0; i < count; ++i)
+  {
+    for (size_t j = 0; j < N; ++j)
+    {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(Iptr),
+                          _mm256_or_si256(values[j], masks[j]));
+      values[j] = _mm256_add_epi16(values[j], steps[j]);
+      Iptr += 16;
+    }
+  }
+  return Iptr;
+}
+
+struct AVX2Indices
+{
+  template <size_t N>
+  static u32 Write(u16*& Iptr, const IndexPattern<N>& pattern, u32 index, u32 first, u32 numVerts)
+  {
+    if (numVerts <= first)
+      return first;
+    const u32 count = (numVerts - first) / pattern.vertices;
+    Iptr = WriteAVX2(Iptr, pattern, index, count / 2);
+    if (count % 2)
+      Iptr = WriteSSE2(Iptr, pattern, index, count - 1, 1);
+    return first + count * pattern.vertices;
+  }
+};
+#endif
+
 void IndexGenerator::Init()
+{
+#ifdef _M_X86
+  if (cpu_info.bAVX2)
+    InitPrimitiveTable<AVX2Indices>();
+  else if (cpu_info.bSSE2)
+    InitPrimitiveTable<SSE2Indices>();
+  else
+#endif
+    InitPrimitiveTable<ScalarIndices>();
+}
+
+template <class Vec>
+void IndexGenerator::InitPrimitiveTable()
 {
   if (g_Config.backend_info.bSupportsPrimitiveRestart)
   {
-    primitive_table[OpcodeDecoder::GX_DRAW_QUADS] = AddQuads<true>;
-    primitive_table[OpcodeDecoder::GX_DRAW_QUADS_2] = AddQuads_nonstandard<true>;
-    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLES] = AddList<true>;
-    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP] = AddStrip<true>;
-    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_FAN] = AddFan<true>;
+    primitive_table[OpcodeDecoder::GX_DRAW_QUADS] = AddQuads<true, Vec>;
+    primitive_table[OpcodeDecoder::GX_DRAW_QUADS_2] = AddQuads_nonstandard<true, Vec>;
+    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLES] = AddList<true, Vec>;
+    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP] = AddStrip<true, Vec>;
+    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_FAN] = AddFan<true, Vec>;
   }
   else
   {
-    primitive_table[OpcodeDecoder::GX_DRAW_QUADS] = AddQuads<false>;
-    primitive_table[OpcodeDecoder::GX_DRAW_QUADS_2] = AddQuads_nonstandard<false>;
-    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLES] = AddList<false>;
-    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP] = AddStrip<false>;
-    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_FAN] = AddFan<false>;
+    primitive_table[OpcodeDecoder::GX_DRAW_QUADS] = AddQuads<false, Vec>;
+    primitive_table[OpcodeDecoder::GX_DRAW_QUADS_2] = AddQuads_nonstandard<false, Vec>;
+    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLES] = AddList<false, Vec>;
+    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP] = AddStrip<false, Vec>;
+    primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_FAN] = AddFan<false, Vec>;
   }
-  primitive_table[OpcodeDecoder::GX_DRAW_LINES] = &AddLineList;
-  primitive_table[OpcodeDecoder::GX_DRAW_LINE_STRIP] = &AddLineStrip;
-  primitive_table[OpcodeDecoder::GX_DRAW_POINTS] = &AddPoints;
+  primitive_table[OpcodeDecoder::GX_DRAW_LINES] = &AddLineList<Vec>;
+  primitive_table[OpcodeDecoder::GX_DRAW_LINE_STRIP] = &AddLineStrip<Vec>;
+  primitive_table[OpcodeDecoder::GX_DRAW_POINTS] = &AddPoints<Vec>;
 }
 
 void IndexGenerator::Start(u16* Indexptr)
@@ -68,22 +237,24 @@ __forceinline u16* IndexGenerator::WriteTriangle(u16* Iptr, u32 index1, u32 inde
   return Iptr;
 }
 
-template <bool pr>
+template <bool pr, class Vec>
 u16* IndexGenerator::AddList(u16* Iptr, u32 const numVerts, u32 index)
 {
-  for (u32 i = 2; i < numVerts; i += 3)
+  u32 i = pr ? Vec::Write(Iptr, s_list_pr, index, 0, numVerts) :
+               Vec::Write(Iptr, s_list, index, 0, numVerts);
+  for (i += 2; i < numVerts; i += 3)
   {
     Iptr = WriteTriangle<pr>(Iptr, index + i - 2, index + i - 1, index + i);
   }
   return Iptr;
 }
 
-template <bool pr>
+template <bool pr, class Vec>
 u16* IndexGenerator::AddStrip(u16* Iptr, u32 const numVerts, u32 index)
 {
   if (pr)
   {
-    for (u32 i = 0; i < numVerts; ++i)
+    for (u32 i = Vec::Write(Iptr, s_sequence, index, 0, numVerts); i < numVerts; ++i)
     {
       *Iptr++ = index + i;
     }
@@ -91,8 +262,9 @@ u16* IndexGenerator::AddStrip(u16* Iptr, u32 const numVerts, u32 index)
   }
   else
   {
+    // The pattern covers an even number of triangles, so the winding starts out the same.
     bool wind = false;
-    for (u32 i = 2; i < numVerts; ++i)
+    for (u32 i = Vec::Write(Iptr, s_strip, index, 2, numVerts); i < numVerts; ++i)
     {
       Iptr = WriteTriangle<pr>(Iptr, index + i - 2, index + i - !wind, index + i - wind);
 
@@ -121,10 +293,11 @@ u16* IndexGenerator::AddStrip(u16* Iptr, u32 const numVerts, u32 index)
  * so we use 6 indices for 3 triangles
  */
 
-template <bool pr>
+template <bool pr, class Vec>
 u16* IndexGenerator::AddFan(u16* Iptr, u32 numVerts, u32 index)
 {
-  u32 i = 2;
+  u32 i = pr ? Vec::Write(Iptr, s_fan_pr, index, 2, numVerts) :
+               Vec::Write(Iptr, s_fan, index, 2, numVerts);
 
   if (pr)
   {
@@ -172,10 +345,11 @@ u16* IndexGenerator::AddFan(u16* Iptr, u32 numVerts, u32 index)
  * A simple triangle has to be rendered for three vertices.
  * ZWW do this for sun rays
  */
-template <bool pr>
+template <bool pr, class Vec>
 u16* IndexGenerator::AddQuads(u16* Iptr, u32 numVerts, u32 index)
 {
-  u32 i = 3;
+  u32 i = pr ? Vec::Write(Iptr, s_quads_pr, index, 3, numVerts) :
+               Vec::Write(Iptr, s_quads, index, 3, numVerts);
   for (; i < numVerts; i += 4)
   {
     if (pr)
@@ -202,17 +376,18 @@ u16* IndexGenerator::AddQuads(u16* Iptr, u32 numVerts, u32 index)
   return Iptr;
 }
 
-template <bool pr>
+template <bool pr, class Vec>
 u16* IndexGenerator::AddQuads_nonstandard(u16* Iptr, u32 numVerts, u32 index)
 {
   WARN_LOG(VIDEO, "Non-standard primitive drawing command GL_DRAW_QUADS_2");
-  return AddQuads<pr>(Iptr, numVerts, index);
+  return AddQuads<pr, Vec>(Iptr, numVerts, index);
 }
 
 // Lines
+template <class Vec>
 u16* IndexGenerator::AddLineList(u16* Iptr, u32 numVerts, u32 index)
 {
-  for (u32 i = 1; i < numVerts; i += 2)
+  for (u32 i = Vec::Write(Iptr, s_sequence, index, 1, numVerts); i < numVerts; i += 2)
   {
     *Iptr++ = index + i - 1;
     *Iptr++ = index + i;
@@ -222,9 +397,10 @@ u16* IndexGenerator::AddLineList(u16* Iptr, u32 numVerts, u32 index)
 
 // shouldn't be used as strips as LineLists are much more common
 // so converting them to lists
+template <class Vec>
 u16* IndexGenerator::AddLineStrip(u16* Iptr, u32 numVerts, u32 index)
 {
-  for (u32 i = 1; i < numVerts; ++i)
+  for (u32 i = Vec::Write(Iptr, s_line_strip, index, 1, numVerts); i < numVerts; ++i)
   {
     *Iptr++ = index + i - 1;
     *Iptr++ = index + i;
@@ -233,9 +409,10 @@ u16* IndexGenerator::AddLineStrip(u16* Iptr, u32 numVerts, u32 index)
 }
 
 // Points
+template <class Vec>
 u16* IndexGenerator::AddPoints(u16* Iptr, u32 numVerts, u32 index)
 {
-  for (u32 i = 0; i != numVerts; ++i)
+  for (u32 i = Vec::Write(Iptr, s_sequence, index, 0, numVerts); i != numVerts; ++i)
   {
     *Iptr++ = index + i;
   }
@@ -24,23 +24,30 @@ public:
   static u32 GetRemainingIndices();
 
 private:
+  // The Vec parameter provides the vectorized part of each primitive, the rest is done here.
+  template <class Vec>
+  static void InitPrimitiveTable();
+
   // Triangles
-  template <bool pr>
+  template <bool pr, class Vec>
   static u16* AddList(u16* Iptr, u32 numVerts, u32 index);
-  template <bool pr>
+  template <bool pr, class Vec>
   static u16* AddStrip(u16* Iptr, u32 numVerts, u32 index);
-  template <bool pr>
+  template <bool pr, class Vec>
   static u16* AddFan(u16* Iptr, u32 numVerts, u32 index);
-  template <bool pr>
+  template <bool pr, class Vec>
   static u16* AddQuads(u16* Iptr, u32 numVerts, u32 index);
-  template <bool pr>
+  template <bool pr, class Vec>
   static u16* AddQuads_nonstandard(u16* Iptr, u32 numVerts, u32 index);
 
   // Lines
+  template <class Vec>
   static u16* AddLineList(u16* Iptr, u32 numVerts, u32 index);
+  template <class Vec>
   static u16* AddLineStrip(u16* Iptr, u32 numVerts, u32 index);
 
   // Points
+  template <class Vec>
   static u16* AddPoints(u16* Iptr, u32 numVerts, u32 index);
 
   template <bool pr>
@@ -14,6 +14,7 @@
 #include "VideoCommon/BPStructs.h"
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/CommandProcessor.h"
+#include "VideoCommon/DisplayListCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/GeometryShaderManager.h"
 #include "VideoCommon/IndexGenerator.h"
@@ -194,6 +195,7 @@ void VideoBackendBase::InitializeShared()
   PixelEngine::Init();
   BPInit();
   VertexLoaderManager::Init();
+  DisplayListCache::Init();
   IndexGenerator::Init();
   VertexShaderManager::Init();
   GeometryShaderManager::Init();
@@ -24,6 +24,7 @@
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/CommandProcessor.h"
 #include "VideoCommon/DataReader.h"
+#include "VideoCommon/DisplayListCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/VertexLoaderManager.h"
@@ -40,7 +41,7 @@ static u32 InterpretDisplayList(u32 address, u32 size)
 {
   u8* startAddress;
 
-  if (Fifo::UseDeterministicGPUThread())
+  if (Fifo::UseDeterministicGPUThread() || Fifo::UsePipelinedGPUThread())
     startAddress = (u8*)Fifo::PopFifoAuxBuffer(size);
   else
     startAddress = Memory::GetPointer(address);
@@ -53,7 +54,9 @@ static u32 InterpretDisplayList(u32 address, u32 size)
     // temporarily swap dl and non-dl (small "hack" for the stats)
     Statistics::SwapDL();
 
+    DisplayListCache::BeginDisplayList(address, startAddress, size);
     Run(DataReader(startAddress, startAddress + size), &cycles, true);
+    DisplayListCache::EndDisplayList();
     INCSTAT(stats.thisFrame.numDListsCalled);
 
     // un-swap
@@ -203,7 +206,11 @@ u8* Run(DataReader src, u32* cycles, bool in_display_list)
         u32 bp_cmd = src.Read<u32>();
         if (is_preprocess)
         {
-          LoadBPRegPreprocess(bp_cmd);
+          // In pipelined mode the GPU thread raises the tokens, like in dual core mode.
+          if (!Fifo::UsePipelinedGPUThread())
+            LoadBPRegPreprocess(bp_cmd);
+          else
+            Fifo::PreprocessBPWrite(bp_cmd);
         }
         else
         {
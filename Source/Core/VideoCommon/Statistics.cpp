@@ -7,6 +7,7 @@
 #include <utility>
 
 #include "Common/StringUtil.h"
+#include "VideoCommon/Fifo.h"
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VideoConfig.h"
@@ -66,8 +67,18 @@ std::string Statistics::ToString()
   str += StringFromFormat("Vertex streamed: %i kB\n", stats.thisFrame.bytesVertexStreamed / 1024);
   str += StringFromFormat("Index streamed: %i kB\n", stats.thisFrame.bytesIndexStreamed / 1024);
   str += StringFromFormat("Uniform streamed: %i kB\n", stats.thisFrame.bytesUniformStreamed / 1024);
+  str += StringFromFormat("Texture lookups: %i\n", stats.thisFrame.numTextureLookups);
+  str += StringFromFormat("Texture hashes: %i (%i kB)\n", stats.thisFrame.numTextureHashes,
+                          stats.thisFrame.bytesTextureHashed / 1024);
   str += StringFromFormat("Vertex Loaders: %i\n", stats.numVertexLoaders);
 
+  float decode_load, submit_load;
+  if (Fifo::GetPipelineStageLoad(&decode_load, &submit_load))
+  {
+    str += StringFromFormat("Decode thread busy: %.0f%%\n", decode_load * 100.0f);
+    str += StringFromFormat("Submit thread busy: %.0f%%\n", submit_load * 100.0f);
+  }
+
   std::string vertex_list = VertexLoaderManager::VertexLoadersToString();
 
   // TODO : at some point text1 just becomes too huge and overflows, we can't even read the added
@@ -51,6 +51,10 @@ struct Statistics
     int bytesIndexStreamed;
     int bytesUniformStreamed;
 
+    int numTextureLookups;
+    int numTextureHashes;
+    int bytesTextureHashed;
+
     int numTrianglesClipped;
     int numTrianglesIn;
     int numTrianglesRejected;
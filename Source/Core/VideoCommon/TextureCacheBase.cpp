@@ -43,6 +43,15 @@ static const int TEXTURE_POOL_KILL_THRESHOLD = 3;
 
 std::unique_ptr<TextureCacheBase> g_texture_cache;
 
+// All texture hashes go through here, as the hashes of EFB copies are compared with the hashes of
+// loaded textures.
+static u64 HashTextureData(const u8* src, u32 len, u32 samples)
+{
+  INCSTAT(stats.thisFrame.numTextureHashes);
+  ADDSTAT(stats.thisFrame.bytesTextureHashed, len);
+  return GetHash64(src, len, samples);
+}
+
 std::bitset<8> TextureCacheBase::valid_bind_points;
 
 TextureCacheBase::TCacheEntry::TCacheEntry(std::unique_ptr<AbstractTexture> tex)
@@ -91,12 +100,9 @@ void TextureCacheBase::Invalidate()
     bound_textures[i] = nullptr;
   }
 
-  for (auto& tex : textures_by_address)
-  {
-    delete tex.second;
-  }
-  textures_by_address.clear();
-  textures_by_hash.clear();
+  textures_by_address.ForEach([](u32 addr, TCacheEntry* entry) { delete entry; });
+  textures_by_address.Clear();
+  textures_by_hash.Clear();
 
   texture_pool.clear();
 }
@@ -143,46 +149,40 @@ void TextureCacheBase::OnConfigChanged(VideoConfig& config)
 
 void TextureCacheBase::Cleanup(int _frameCount)
 {
-  TexAddrCache::iterator iter = textures_by_address.begin();
-  TexAddrCache::iterator tcend = textures_by_address.end();
-  while (iter != tcend)
+  // Invalidating removes entries from the index, so walk over a copy of it.
+  std::vector<TCacheEntry*> entries;
+  entries.reserve(textures_by_address.Size());
+  textures_by_address.ForEach([&](u32 addr, TCacheEntry* entry) { entries.push_back(entry); });
+
+  for (TCacheEntry* entry : entries)
   {
-    if (iter->second->tmem_only)
+    if (entry->tmem_only)
     {
-      iter = InvalidateTexture(iter);
+      InvalidateTexture(entry);
     }
-    else if (iter->second->frameCount == FRAMECOUNT_INVALID)
+    else if (entry->frameCount == FRAMECOUNT_INVALID)
     {
-      iter->second->frameCount = _frameCount;
-      ++iter;
+      entry->frameCount = _frameCount;
     }
-    else if (_frameCount > TEXTURE_KILL_THRESHOLD + iter->second->frameCount)
+    else if (_frameCount > TEXTURE_KILL_THRESHOLD + entry->frameCount)
     {
-      if (iter->second->IsCopy())
+      if (entry->IsCopy())
       {
         // Only remove EFB copies when they wouldn't be used anymore(changed hash), because EFB
         // copies living on the
         // host GPU are unrecoverable. Perform this check only every TEXTURE_KILL_THRESHOLD for
         // performance reasons
-        if ((_frameCount - iter->second->frameCount) % TEXTURE_KILL_THRESHOLD == 1 &&
-            iter->second->hash != iter->second->CalculateHash())
-        {
-          iter = InvalidateTexture(iter);
-        }
-        else
+        if ((_frameCount - entry->frameCount) % TEXTURE_KILL_THRESHOLD == 1 &&
+            entry->hash != entry->CalculateHash())
         {
-          ++iter;
+          InvalidateTexture(entry);
         }
       }
       else
       {
-        iter = InvalidateTexture(iter);
+        InvalidateTexture(entry);
       }
     }
-    else
-    {
-      ++iter;
-    }
   }
 
   TexPool::iterator iter2 = texture_pool.begin();
@@ -248,7 +248,7 @@ TextureCacheBase::ApplyPaletteToEntry(TCacheEntry* entry, u8* palette, TLUTForma
   decoded_entry->may_have_overlapping_textures = entry->may_have_overlapping_textures;
 
   ConvertTexture(decoded_entry, entry, palette, tlutfmt);
-  textures_by_address.emplace(entry->addr, decoded_entry);
+  textures_by_address.Insert(entry->addr, decoded_entry);
 
   return decoded_entry;
 }
@@ -318,10 +318,14 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
 
   u32 numBlocksX = (entry_to_update->native_width + block_width - 1) / block_width;
 
-  auto iter = FindOverlappingTextures(entry_to_update->addr, entry_to_update->size_in_bytes);
-  while (iter.first != iter.second)
+  for (TCacheEntry* entry :
+       FindOverlappingTextures(entry_to_update->addr, entry_to_update->size_in_bytes))
   {
-    TCacheEntry* entry = iter.first->second;
+    // The list was taken before the loop, so it may hold entries which were invalidated since.
+    // Their texture went back to the pool.
+    if (!entry->texture)
+      continue;
+
     if (entry != entry_to_update && entry->IsCopy() && !entry->tmem_only &&
         entry->references.count(entry_to_update) == 0 &&
         entry->OverlapsMemoryRange(entry_to_update->addr, entry_to_update->size_in_bytes) &&
@@ -343,7 +347,6 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
           }
           else
           {
-            ++iter.first;
             continue;
           }
         }
@@ -412,7 +415,7 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
         {
           // Remove the temporary converted texture, it won't be used anywhere else
           // TODO: It would be nice to convert and copy in one step, but this code path isn't common
-          InvalidateTexture(GetTexCacheIter(entry));
+          InvalidateTexture(entry);
         }
         else
         {
@@ -425,11 +428,9 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u8* pale
       else
       {
         // If the hash does not match, this EFB copy will not be used for anything, so remove it
-        iter.first = InvalidateTexture(iter.first);
-        continue;
+        InvalidateTexture(entry);
       }
     }
-    ++iter.first;
   }
   return entry_to_update;
 }
@@ -723,13 +724,13 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
 
   // TODO: This doesn't hash GB tiles for preloaded RGBA8 textures (instead, it's hashing more data
   // from the low tmem bank than it should)
-  base_hash = GetHash64(src_data, texture_size, textureCacheSafetyColorSampleSize);
+  base_hash = HashTextureData(src_data, texture_size, textureCacheSafetyColorSampleSize);
   u32 palette_size = 0;
   if (isPaletteTexture)
   {
     palette_size = TexDecoder_GetPaletteSize(texformat);
-    full_hash =
-        base_hash ^ GetHash64(&texMem[tlutaddr], palette_size, textureCacheSafetyColorSampleSize);
+    full_hash = base_hash ^ HashTextureData(&texMem[tlutaddr], palette_size,
+                                            textureCacheSafetyColorSampleSize);
   }
   else
   {
@@ -775,22 +776,19 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
   // For efb copies, the entry created in CopyRenderTargetToTexture always has to be used, or else
   // it was
   // done in vain.
-  auto iter_range = textures_by_address.equal_range(address);
-  TexAddrCache::iterator iter = iter_range.first;
-  TexAddrCache::iterator oldest_entry = iter;
+  INCSTAT(stats.thisFrame.numTextureLookups);
+  const TexAddrCache::Bucket* bucket = textures_by_address.Find(address);
+  TCacheEntry* oldest_entry = nullptr;
   int temp_frameCount = 0x7fffffff;
-  TexAddrCache::iterator unconverted_copy = textures_by_address.end();
+  TCacheEntry* unconverted_copy = nullptr;
 
-  while (iter != iter_range.second)
+  for (size_t i = 0; bucket && i < bucket->size(); ++i)
   {
-    TCacheEntry* entry = iter->second;
+    TCacheEntry* entry = (*bucket)[i];
 
     // Skip entries that are only left in our texture cache for the tmem cache emulation
     if (entry->tmem_only)
-    {
-      ++iter;
       continue;
-    }
 
     // Do not load strided EFB copies, they are not meant to be used directly.
     // Also do not directly load EFB copies, which were partly overwritten.
@@ -814,7 +812,7 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
         // perform the conversion later.  Currently, we only convert EFB copies to
         // palette textures; we could do other conversions if it proved to be
         // beneficial.
-        unconverted_copy = iter;
+        unconverted_copy = entry;
       }
       else
       {
@@ -822,7 +820,12 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
         // never be useful again.  It's theoretically possible for a game to do
         // something weird where the copy could become useful in the future, but in
         // practice it doesn't happen.
-        iter = InvalidateTexture(iter);
+        if (InvalidateTexture(entry))
+        {
+          // The next entry moved into this position, and the bucket may have moved.
+          bucket = textures_by_address.Find(address);
+          --i;
+        }
         continue;
       }
     }
@@ -833,9 +836,7 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
           entry->native_levels >= tex_levels && entry->native_width == nativeW &&
           entry->native_height == nativeH)
       {
-        entry = DoPartialTextureUpdates(iter->second, &texMem[tlutaddr], tlutfmt);
-
-        return entry;
+        return DoPartialTextureUpdates(entry, &texMem[tlutaddr], tlutfmt);
       }
     }
 
@@ -848,15 +849,13 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
         !entry->IsEfbCopy() && !(isPaletteTexture && entry->base_hash == base_hash))
     {
       temp_frameCount = entry->frameCount;
-      oldest_entry = iter;
+      oldest_entry = entry;
     }
-    ++iter;
   }
 
-  if (unconverted_copy != textures_by_address.end())
+  if (unconverted_copy)
   {
-    TCacheEntry* decoded_entry =
-        ApplyPaletteToEntry(unconverted_copy->second, &texMem[tlutaddr], tlutfmt);
+    TCacheEntry* decoded_entry = ApplyPaletteToEntry(unconverted_copy, &texMem[tlutaddr], tlutfmt);
 
     if (decoded_entry)
     {
@@ -873,25 +872,22 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
   if (textureCacheSafetyColorSampleSize == 0 ||
       std::max(texture_size, palette_size) <= (u32)textureCacheSafetyColorSampleSize * 8)
   {
-    auto hash_range = textures_by_hash.equal_range(full_hash);
-    TexHashCache::iterator hash_iter = hash_range.first;
-    while (hash_iter != hash_range.second)
+    INCSTAT(stats.thisFrame.numTextureLookups);
+    const TexHashCache::Bucket* hash_bucket = textures_by_hash.Find(full_hash);
+    for (size_t i = 0; hash_bucket && i < hash_bucket->size(); ++i)
     {
-      TCacheEntry* entry = hash_iter->second;
+      TCacheEntry* entry = (*hash_bucket)[i];
       // All parameters, except the address, need to match here
       if (entry->format == full_format && entry->native_levels >= tex_levels &&
           entry->native_width == nativeW && entry->native_height == nativeH)
       {
-        entry = DoPartialTextureUpdates(hash_iter->second, &texMem[tlutaddr], tlutfmt);
-
-        return entry;
+        return DoPartialTextureUpdates(entry, &texMem[tlutaddr], tlutfmt);
       }
-      ++hash_iter;
     }
   }
 
   // If at least one entry was not used for the same frame, overwrite the oldest one
-  if (temp_frameCount != 0x7fffffff)
+  if (oldest_entry)
   {
     // pool this texture and make a new one later
     InvalidateTexture(oldest_entry);
@@ -1005,11 +1001,12 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
     }
   }
 
-  iter = textures_by_address.emplace(address, entry);
+  textures_by_address.Insert(address, entry);
   if (textureCacheSafetyColorSampleSize == 0 ||
       std::max(texture_size, palette_size) <= (u32)textureCacheSafetyColorSampleSize * 8)
   {
-    entry->textures_by_hash_iter = textures_by_hash.emplace(full_hash, entry);
+    textures_by_hash.Insert(full_hash, entry);
+    entry->textures_by_hash_key = full_hash;
   }
 
   entry->SetGeneralParameters(address, texture_size, full_format, false);
@@ -1095,9 +1092,9 @@ TextureCacheBase::GetTexture(u32 address, u32 width, u32 height, const TextureFo
   }
 
   INCSTAT(stats.numTexturesUploaded);
-  SETSTAT(stats.numTexturesAlive, textures_by_address.size());
+  SETSTAT(stats.numTexturesAlive, textures_by_address.Size());
 
-  entry = DoPartialTextureUpdates(iter->second, &texMem[tlutaddr], tlutfmt);
+  entry = DoPartialTextureUpdates(entry, &texMem[tlutaddr], tlutfmt);
 
   return entry;
 }
@@ -1214,8 +1211,8 @@ std::optional<TextureLookupInformation> TextureCacheBase::ComputeTextureInformat
 
   // TODO: This doesn't hash GB tiles for preloaded RGBA8 textures (instead, it's hashing more data
   // from the low tmem bank than it should)
-  tex_info.base_hash = GetHash64(tex_info.src_data, tex_info.total_bytes,
-                                 tex_info.texture_cache_safety_color_sample_size);
+  tex_info.base_hash = HashTextureData(tex_info.src_data, tex_info.total_bytes,
+                                       tex_info.texture_cache_safety_color_sample_size);
 
   tex_info.is_palette_texture = IsColorIndexed(tex_format);
 
@@ -1223,8 +1220,9 @@ std::optional<TextureLookupInformation> TextureCacheBase::ComputeTextureInformat
   {
     tex_info.palette_size = TexDecoder_GetPaletteSize(tex_format);
     tex_info.full_hash =
-        tex_info.base_hash ^ GetHash64(&texMem[tex_info.tlut_address], tex_info.palette_size,
-                                       tex_info.texture_cache_safety_color_sample_size);
+        tex_info.base_hash ^ HashTextureData(&texMem[tex_info.tlut_address],
+                                             tex_info.palette_size,
+                                             tex_info.texture_cache_safety_color_sample_size);
   }
   else
   {
@@ -1237,12 +1235,11 @@ std::optional<TextureLookupInformation> TextureCacheBase::ComputeTextureInformat
 TextureCacheBase::TCacheEntry*
 TextureCacheBase::GetXFBFromCache(const TextureLookupInformation& tex_info)
 {
-  auto iter_range = textures_by_address.equal_range(tex_info.address);
-  TexAddrCache::iterator iter = iter_range.first;
-
-  while (iter != iter_range.second)
+  INCSTAT(stats.thisFrame.numTextureLookups);
+  const TexAddrCache::Bucket* bucket = textures_by_address.Find(tex_info.address);
+  for (size_t i = 0; bucket && i < bucket->size(); ++i)
   {
-    TCacheEntry* entry = iter->second;
+    TCacheEntry* entry = (*bucket)[i];
 
     if ((entry->is_xfb_copy || entry->format.texfmt == TextureFormat::XFB) &&
         entry->native_width == tex_info.native_width &&
@@ -1259,12 +1256,13 @@ TextureCacheBase::GetXFBFromCache(const TextureLookupInformation& tex_info)
         // At this point, we either have an xfb copy that has changed its hash
         // or an xfb created by stitching or from memory that has been changed
         // we are safe to invalidate this
-        iter = InvalidateTexture(iter);
-        continue;
+        if (InvalidateTexture(entry))
+        {
+          bucket = textures_by_address.Find(tex_info.address);
+          --i;
+        }
       }
     }
-
-    ++iter;
   }
 
   return nullptr;
@@ -1277,10 +1275,13 @@ bool TextureCacheBase::LoadTextureFromOverlappingTextures(TCacheEntry* entry_to_
 
   u32 numBlocksX = entry_to_update->native_width / tex_info.block_width;
 
-  auto iter = FindOverlappingTextures(entry_to_update->addr, entry_to_update->size_in_bytes);
-  while (iter.first != iter.second)
+  for (TCacheEntry* entry :
+       FindOverlappingTextures(entry_to_update->addr, entry_to_update->size_in_bytes))
   {
-    TCacheEntry* entry = iter.first->second;
+    // Invalidated since the list was taken, see DoPartialTextureUpdates.
+    if (!entry->texture)
+      continue;
+
     if (entry != entry_to_update && entry->IsCopy() && !entry->tmem_only &&
         entry->references.count(entry_to_update) == 0 &&
         entry->OverlapsMemoryRange(entry_to_update->addr, entry_to_update->size_in_bytes) &&
@@ -1303,7 +1304,6 @@ bool TextureCacheBase::LoadTextureFromOverlappingTextures(TCacheEntry* entry_to_
           }
           else
           {
-            ++iter.first;
             continue;
           }
         }
@@ -1399,7 +1399,7 @@ bool TextureCacheBase::LoadTextureFromOverlappingTextures(TCacheEntry* entry_to_
         {
           // Remove the temporary converted texture, it won't be used anywhere else
           // TODO: It would be nice to convert and copy in one step, but this code path isn't common
-          InvalidateTexture(GetTexCacheIter(entry));
+          InvalidateTexture(entry);
         }
         else
         {
@@ -1412,11 +1412,9 @@ bool TextureCacheBase::LoadTextureFromOverlappingTextures(TCacheEntry* entry_to_
       else
       {
         // If the hash does not match, this EFB copy will not be used for anything, so remove it
-        iter.first = InvalidateTexture(iter.first);
-        continue;
+        InvalidateTexture(entry);
       }
     }
-    ++iter.first;
   }
 
   return updated_entry;
@@ -1439,12 +1437,13 @@ TextureCacheBase::CreateNormalTexture(const TextureLookupInformation& tex_info)
   if (!entry)
     return nullptr;
 
-  textures_by_address.emplace(tex_info.address, entry);
+  textures_by_address.Insert(tex_info.address, entry);
   if (tex_info.texture_cache_safety_color_sample_size == 0 ||
       std::max(tex_info.total_bytes, tex_info.palette_size) <=
           (u32)tex_info.texture_cache_safety_color_sample_size * 8)
   {
-    entry->textures_by_hash_iter = textures_by_hash.emplace(tex_info.full_hash, entry);
+    textures_by_hash.Insert(tex_info.full_hash, entry);
+    entry->textures_by_hash_key = tex_info.full_hash;
   }
 
   entry->SetGeneralParameters(tex_info.address, tex_info.total_bytes, tex_info.full_format, false);
@@ -1455,7 +1454,7 @@ TextureCacheBase::CreateNormalTexture(const TextureLookupInformation& tex_info)
   entry->SetNotCopy();
 
   INCSTAT(stats.numTexturesUploaded);
-  SETSTAT(stats.numTexturesAlive, textures_by_address.size());
+  SETSTAT(stats.numTexturesAlive, textures_by_address.Size());
 
   return entry;
 }
@@ -1929,10 +1928,11 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, EFBCopyFormat dstF
   // as our efb copy are marked to check them for partial texture updates.
   // TODO: The logic to detect overlapping strided efb copies is not 100% accurate.
   bool strided_efb_copy = dstStride != bytes_per_row;
-  auto iter = FindOverlappingTextures(dstAddr, covered_range);
-  while (iter.first != iter.second)
+  for (TCacheEntry* entry : FindOverlappingTextures(dstAddr, covered_range))
   {
-    TCacheEntry* entry = iter.first->second;
+    // Skips the entries which were invalidated since the list was taken.
+    if (!entry->texture)
+      continue;
 
     if (entry->addr == dstAddr && entry->is_xfb_copy)
     {
@@ -1950,7 +1950,7 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, EFBCopyFormat dstF
           (!strided_efb_copy && entry->size_in_bytes == overlap_range) ||
           (strided_efb_copy && entry->size_in_bytes == overlap_range && entry->addr == dstAddr))
       {
-        iter.first = InvalidateTexture(iter.first);
+        InvalidateTexture(entry);
         continue;
       }
       entry->may_have_overlapping_textures = true;
@@ -1970,13 +1970,12 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, EFBCopyFormat dstF
 
       // Do not load textures by hash, if they were at least partly overwritten by an efb copy.
       // In this case, comparing the hash is not enough to check, if two textures are identical.
-      if (entry->textures_by_hash_iter != textures_by_hash.end())
+      if (entry->textures_by_hash_key)
       {
-        textures_by_hash.erase(entry->textures_by_hash_iter);
-        entry->textures_by_hash_iter = textures_by_hash.end();
+        textures_by_hash.Erase(*entry->textures_by_hash_key, entry);
+        entry->textures_by_hash_key.reset();
       }
     }
-    ++iter.first;
   }
 
   if (copy_to_vram)
@@ -2033,7 +2032,7 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, EFBCopyFormat dstF
                              0);
       }
 
-      textures_by_address.emplace(dstAddr, entry);
+      textures_by_address.Insert(dstAddr, entry);
     }
   }
 }
@@ -2074,7 +2073,6 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::AllocateCacheEntry(const Textur
     return nullptr;
   }
   TCacheEntry* cacheEntry = new TCacheEntry(std::move(texture));
-  cacheEntry->textures_by_hash_iter = textures_by_hash.end();
   cacheEntry->id = last_entry_id++;
   return cacheEntry;
 }
@@ -2115,23 +2113,7 @@ TextureCacheBase::FindMatchingTextureFromPool(const TextureConfig& config)
   return matching_iter != range.second ? matching_iter : texture_pool.end();
 }
 
-TextureCacheBase::TexAddrCache::iterator
-TextureCacheBase::GetTexCacheIter(TextureCacheBase::TCacheEntry* entry)
-{
-  auto iter_range = textures_by_address.equal_range(entry->addr);
-  TexAddrCache::iterator iter = iter_range.first;
-  while (iter != iter_range.second)
-  {
-    if (iter->second == entry)
-    {
-      return iter;
-    }
-    ++iter;
-  }
-  return textures_by_address.end();
-}
-
-std::pair<TextureCacheBase::TexAddrCache::iterator, TextureCacheBase::TexAddrCache::iterator>
+const std::vector<TextureCacheBase::TCacheEntry*>&
 TextureCacheBase::FindOverlappingTextures(u32 addr, u32 size_in_bytes)
 {
   // We index by the starting address only, so there is no way to query all textures
@@ -2142,24 +2124,25 @@ TextureCacheBase::FindOverlappingTextures(u32 addr, u32 size_in_bytes)
   // 1024 x 1024 texel times 8 nibbles per texel
   constexpr u32 max_texture_size = 1024 * 1024 * 4;
   u32 lower_addr = addr > max_texture_size ? addr - max_texture_size : 0;
-  auto begin = textures_by_address.lower_bound(lower_addr);
-  auto end = textures_by_address.upper_bound(addr + size_in_bytes);
 
-  return std::make_pair(begin, end);
+  INCSTAT(stats.thisFrame.numTextureLookups);
+  overlapping_textures.clear();
+  textures_by_address.ForEachInRange(
+      lower_addr, addr + size_in_bytes,
+      [this](u32 key, TCacheEntry* entry) { overlapping_textures.push_back(entry); });
+  return overlapping_textures;
 }
 
-TextureCacheBase::TexAddrCache::iterator
-TextureCacheBase::InvalidateTexture(TexAddrCache::iterator iter)
+bool TextureCacheBase::InvalidateTexture(TCacheEntry* entry)
 {
-  if (iter == textures_by_address.end())
-    return textures_by_address.end();
-
-  TCacheEntry* entry = iter->second;
+  const TexAddrCache::Bucket* bucket = textures_by_address.Find(entry->addr);
+  if (!bucket || std::find(bucket->begin(), bucket->end(), entry) == bucket->end())
+    return false;
 
-  if (entry->textures_by_hash_iter != textures_by_hash.end())
+  if (entry->textures_by_hash_key)
   {
-    textures_by_hash.erase(entry->textures_by_hash_iter);
-    entry->textures_by_hash_iter = textures_by_hash.end();
+    textures_by_hash.Erase(*entry->textures_by_hash_key, entry);
+    entry->textures_by_hash_key.reset();
   }
 
   for (size_t i = 0; i < bound_textures.size(); ++i)
@@ -2170,14 +2153,15 @@ TextureCacheBase::InvalidateTexture(TexAddrCache::iterator iter)
     if (bound_textures[i] == entry && IsValidBindPoint(static_cast<u32>(i)))
     {
       bound_textures[i]->tmem_only = true;
-      return ++iter;
+      return false;
     }
   }
 
   auto config = entry->texture->GetConfig();
   texture_pool.emplace(config, TexPoolEntry(std::move(entry->texture)));
 
-  return textures_by_address.erase(iter);
+  textures_by_address.Erase(entry->addr, entry);
+  return true;
 }
 
 u32 TextureCacheBase::TCacheEntry::BytesPerRow() const
@@ -2247,7 +2231,7 @@ u64 TextureCacheBase::TCacheEntry::CalculateHash() const
   u8* ptr = Memory::GetPointer(addr);
   if (memory_stride == BytesPerRow())
   {
-    return GetHash64(ptr, size_in_bytes, HashSampleSize());
+    return HashTextureData(ptr, size_in_bytes, HashSampleSize());
   }
   else
   {
@@ -2266,7 +2250,7 @@ u64 TextureCacheBase::TCacheEntry::CalculateHash() const
     {
       // Multiply by a prime number to mix the hash up a bit. This prevents identical blocks from
       // canceling each other out
-      temp_hash = (temp_hash * 397) ^ GetHash64(ptr, BytesPerRow(), samples_per_row);
+      temp_hash = (temp_hash * 397) ^ HashTextureData(ptr, BytesPerRow(), samples_per_row);
       ptr += memory_stride;
     }
     return temp_hash;
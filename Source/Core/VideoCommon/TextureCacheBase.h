@@ -6,15 +6,16 @@
 
 #include <array>
 #include <bitset>
-#include <map>
 #include <memory>
 #include <optional>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Common/FlatHashIndex.h"
 #include "VideoCommon/AbstractTexture.h"
 #include "VideoCommon/BPMemory.h"
 #include "VideoCommon/TextureConfig.h"
@@ -139,9 +140,9 @@ public:
     // used to delete textures which haven't been used for TEXTURE_KILL_THRESHOLD frames
     int frameCount = FRAMECOUNT_INVALID;
 
-    // Keep an iterator to the entry in textures_by_hash, so it does not need to be searched when
-    // removing the cache entry
-    std::multimap<u64, TCacheEntry*>::iterator textures_by_hash_iter;
+    // The key of the entry in textures_by_hash, if it is in there, so it does not need to be
+    // recomputed when removing the cache entry
+    std::optional<u64> textures_by_hash_key;
 
     // This is used to keep track of both:
     //   * efb copies used by this partially updated texture
@@ -292,8 +293,8 @@ private:
     int frameCount = FRAMECOUNT_INVALID;
     TexPoolEntry(std::unique_ptr<AbstractTexture> tex) : texture(std::move(tex)) {}
   };
-  using TexAddrCache = std::multimap<u32, TCacheEntry*>;
-  using TexHashCache = std::multimap<u64, TCacheEntry*>;
+  using TexAddrCache = Common::FlatHashIndex<u32, TCacheEntry*, true>;
+  using TexHashCache = Common::FlatHashIndex<u64, TCacheEntry*>;
   using TexPool = std::unordered_multimap<TextureConfig, TexPoolEntry>;
 
   void SetBackupConfig(const VideoConfig& config);
@@ -309,19 +310,18 @@ private:
   TCacheEntry* AllocateCacheEntry(const TextureConfig& config);
   std::unique_ptr<AbstractTexture> AllocateTexture(const TextureConfig& config);
   TexPool::iterator FindMatchingTextureFromPool(const TextureConfig& config);
-  TexAddrCache::iterator GetTexCacheIter(TCacheEntry* entry);
 
-  // Return all possible overlapping textures. As addr+size of the textures is not
-  // indexed, this may return false positives.
-  std::pair<TexAddrCache::iterator, TexAddrCache::iterator>
-  FindOverlappingTextures(u32 addr, u32 size_in_bytes);
+  // Return all possible overlapping textures, sorted by address. As addr+size of the textures is
+  // not indexed, this may return false positives. The result is only valid until the next call.
+  const std::vector<TCacheEntry*>& FindOverlappingTextures(u32 addr, u32 size_in_bytes);
 
   virtual void CopyEFBToCacheEntry(TCacheEntry* entry, bool is_depth_copy,
                                    const EFBRectangle& src_rect, bool scale_by_half,
                                    unsigned int cbuf_id, const float* colmat) = 0;
 
-  // Removes and unlinks texture from texture cache and returns it to the pool
-  TexAddrCache::iterator InvalidateTexture(TexAddrCache::iterator t_iter);
+  // Removes and unlinks texture from texture cache and returns it to the pool. Returns false if
+  // the entry was kept for the tmem cache emulation, or wasn't in the cache.
+  bool InvalidateTexture(TCacheEntry* entry);
 
   void UninitializeXFBMemory(u8* dst, u32 stride, u32 bytes_per_row, u32 num_blocks_y);
 
@@ -329,6 +329,8 @@ private:
   TexHashCache textures_by_hash;
   TexPool texture_pool;
   u64 last_entry_id = 0;
+  // Reused by FindOverlappingTextures, which runs for every EFB copy and partial texture update.
+  std::vector<TCacheEntry*> overlapping_textures;
 
   // Backup configuration values
   struct BackupConfig
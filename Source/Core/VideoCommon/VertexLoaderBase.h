@@ -73,6 +73,7 @@ public:
 
   // per loader public state
   int m_VertexSize = 0;  // number of bytes of a raw GC vertex
+  bool m_has_indexed_attributes = false;  // whether any attribute reads from a vertex array
   PortableVertexDeclaration m_native_vtx_decl{};
   u32 m_native_components = 0;
 
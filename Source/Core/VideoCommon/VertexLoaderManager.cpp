@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <cstring>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -17,6 +18,8 @@
 
 #include "VideoCommon/BPMemory.h"
 #include "VideoCommon/DataReader.h"
+#include "VideoCommon/DisplayListCache.h"
+#include "VideoCommon/Fifo.h"
 #include "VideoCommon/IndexGenerator.h"
 #include "VideoCommon/NativeVertexFormat.h"
 #include "VideoCommon/Statistics.h"
@@ -33,6 +36,9 @@ float position_cache[3][4];
 // So only index 1 - 3 are used.
 u32 position_matrix_index[4];
 
+float preloaded_position_cache[3][4];
+u32 preloaded_position_matrix_index[4];
+
 static NativeVertexFormatMap s_native_vertex_map;
 static NativeVertexFormat* s_current_vtx_fmt;
 u32 g_current_components;
@@ -44,6 +50,23 @@ static VertexLoaderMap s_vertex_loader_map;
 
 u8* cached_arraybases[12];
 
+namespace
+{
+// In pipelined mode the decode thread loads the vertices of each draw into the aux FIFO, behind
+// this header, for the GPU thread to copy into the vertex buffer.
+struct PreloadedDraw
+{
+  VertexLoaderBase* loader;
+  int count;
+  u32 vertex_bytes;
+  float position_cache[3][4];
+  u32 position_matrix_index[4];
+};
+
+// The loaders may write a few bytes past the last vertex with SIMD stores.
+constexpr u32 PRELOAD_PADDING = 16;
+}
+
 void Init()
 {
   MarkAllDirty();
@@ -57,14 +80,16 @@ void Init()
 void Clear()
 {
   std::lock_guard<std::mutex> lk(s_vertex_loader_map_lock);
+  // The cached display lists point at the loaders.
+  DisplayListCache::Clear();
   s_vertex_loader_map.clear();
   s_native_vertex_map.clear();
 }
 
-void UpdateVertexArrayPointers()
+static void UpdateVertexArrayPointers(CPState* state)
 {
   // Anything to update?
-  if (!g_main_cp_state.bases_dirty)
+  if (!state->bases_dirty)
     return;
 
   // Some games such as Burnout 2 can put invalid addresses into
@@ -75,11 +100,16 @@ void UpdateVertexArrayPointers()
   for (int i = 0; i < 12; i++)
   {
     // Only update the array base if the vertex description states we are going to use it.
-    if (g_main_cp_state.vtx_desc.GetVertexArrayStatus(i) & MASK_INDEXED)
-      cached_arraybases[i] = Memory::GetPointer(g_main_cp_state.array_bases[i]);
+    if (state->vtx_desc.GetVertexArrayStatus(i) & MASK_INDEXED)
+      cached_arraybases[i] = Memory::GetPointer(state->array_bases[i]);
   }
 
-  g_main_cp_state.bases_dirty = false;
+  state->bases_dirty = false;
+}
+
+void UpdateVertexArrayPointers()
+{
+  UpdateVertexArrayPointers(&g_main_cp_state);
 }
 
 namespace
@@ -195,6 +225,18 @@ NativeVertexFormat* GetUberVertexFormat(const PortableVertexDeclaration& decl)
   return GetOrCreateMatchingFormat(new_decl);
 }
 
+static void SetNativeVertexFormat(VertexLoaderBase* loader)
+{
+  // search for a cached native vertex format
+  const PortableVertexDeclaration& format = loader->m_native_vtx_decl;
+  std::unique_ptr<NativeVertexFormat>& native = s_native_vertex_map[format];
+  if (!native)
+  {
+    native = g_vertex_manager->CreateNativeVertexFormat(format);
+  }
+  loader->m_native_vertex_format = native.get();
+}
+
 static VertexLoaderBase* RefreshLoader(int vtx_attr_group, bool preprocess = false)
 {
   CPState* state = preprocess ? &g_preprocess_cp_state : &g_main_cp_state;
@@ -223,16 +265,7 @@ static VertexLoaderBase* RefreshLoader(int vtx_attr_group, bool preprocess = fal
       INCSTAT(stats.numVertexLoaders);
     }
     if (check_for_native_format)
-    {
-      // search for a cached native vertex format
-      const PortableVertexDeclaration& format = loader->m_native_vtx_decl;
-      std::unique_ptr<NativeVertexFormat>& native = s_native_vertex_map[format];
-      if (!native)
-      {
-        native = g_vertex_manager->CreateNativeVertexFormat(format);
-      }
-      loader->m_native_vertex_format = native.get();
-    }
+      SetNativeVertexFormat(loader);
     state->vertex_loaders[vtx_attr_group] = loader;
     state->attr_dirty[vtx_attr_group] = false;
   }
@@ -248,19 +281,75 @@ static VertexLoaderBase* RefreshLoader(int vtx_attr_group, bool preprocess = fal
   return loader;
 }
 
+// Runs the loader on the decode thread in pipelined mode. Returns false if there's no space for
+// the vertices, in which case the GPU thread mustn't see the draw.
+static bool PreloadVertices(VertexLoaderBase* loader, int count, DataReader src)
+{
+  // The array pointers are only ever resolved on this thread in pipelined mode.
+  UpdateVertexArrayPointers(&g_preprocess_cp_state);
+
+  PreloadedDraw draw;
+  draw.loader = loader;
+  draw.vertex_bytes = count * loader->m_native_vtx_decl.stride + PRELOAD_PADDING;
+  u8* header = static_cast<u8*>(Fifo::ReserveFifoAuxBuffer(sizeof(draw) + draw.vertex_bytes));
+  if (!header)
+    return false;
+
+  u8* vertices = header + sizeof(draw);
+  draw.count = loader->RunVertices(src, DataReader(vertices, vertices + draw.vertex_bytes), count);
+  std::memcpy(draw.position_cache, position_cache, sizeof(draw.position_cache));
+  std::memcpy(draw.position_matrix_index, position_matrix_index,
+              sizeof(draw.position_matrix_index));
+  std::memcpy(header, &draw, sizeof(draw));
+  return true;
+}
+
+// Copies the vertices PreloadVertices loaded to dst on the GPU thread.
+static int SubmitPreloadedVertices(const PreloadedDraw& draw, DataReader dst)
+{
+  const u8* vertices = static_cast<const u8*>(Fifo::PopFifoAuxBuffer(draw.vertex_bytes));
+  std::memcpy(dst.GetPointer(), vertices, draw.count * draw.loader->m_native_vtx_decl.stride);
+  std::memcpy(preloaded_position_cache, draw.position_cache, sizeof(preloaded_position_cache));
+  std::memcpy(preloaded_position_matrix_index, draw.position_matrix_index,
+              sizeof(preloaded_position_matrix_index));
+  return draw.count;
+}
+
 int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src, bool is_preprocess)
 {
   if (!count)
     return 0;
 
-  VertexLoaderBase* loader = RefreshLoader(vtx_attr_group, is_preprocess);
+  // The decode thread only hands complete commands over in pipelined mode, so the size check below
+  // can't fail after the header is popped.
+  const bool preloaded = !is_preprocess && Fifo::UsePipelinedGPUThread();
+  PreloadedDraw preloaded_draw;
+  VertexLoaderBase* loader;
+  if (preloaded)
+  {
+    std::memcpy(&preloaded_draw, Fifo::PopFifoAuxBuffer(sizeof(preloaded_draw)),
+                sizeof(preloaded_draw));
+    loader = preloaded_draw.loader;
+    g_main_cp_state.last_id = vtx_attr_group;
+    if (!loader->m_native_vertex_format)
+      SetNativeVertexFormat(loader);
+  }
+  else
+  {
+    loader = RefreshLoader(vtx_attr_group, is_preprocess);
+  }
 
   int size = count * loader->m_VertexSize;
   if ((int)src.size() < size)
     return -1;
 
   if (is_preprocess)
+  {
+    // Stops the decode pass before this command, so it's retried.
+    if (Fifo::UsePipelinedGPUThread() && !PreloadVertices(loader, count, src))
+      return -1;
     return size;
+  }
 
   // If the native vertex format changed, force a flush.
   if (loader->m_native_vertex_format != s_current_vtx_fmt ||
@@ -280,7 +369,21 @@ int RunVertices(int vtx_attr_group, int primitive, int count, DataReader src, bo
   DataReader dst = g_vertex_manager->PrepareForAdditionalData(
       primitive, count, loader->m_native_vtx_decl.stride, cullall);
 
-  count = loader->RunVertices(src, dst, count);
+  const DisplayListCache::Draw* cached_draw =
+      preloaded ? nullptr : DisplayListCache::FindDraw(loader, primitive, count, src.GetPointer());
+  if (preloaded)
+  {
+    count = SubmitPreloadedVertices(preloaded_draw, dst);
+  }
+  else if (cached_draw)
+  {
+    count = DisplayListCache::ReplayDraw(cached_draw, dst);
+  }
+  else
+  {
+    count = loader->RunVertices(src, dst, count);
+    DisplayListCache::RecordDraw(loader, primitive, count, src.GetPointer(), dst.GetPointer());
+  }
 
   IndexGenerator::AddIndices(primitive, count);
 
@@ -353,6 +456,14 @@ void LoadCPReg(u32 sub_cmd, u32 value, bool is_preprocess)
     break;
 
   case 0xB0:
+    // The vertex loaders read the strides of the main state, and run on the decode thread in
+    // pipelined mode.
+    if (Fifo::UsePipelinedGPUThread())
+    {
+      if (!is_preprocess)
+        break;
+      g_main_cp_state.array_strides[sub_cmd & 0xF] = value & 0xFF;
+    }
     state->array_strides[sub_cmd & 0xF] = value & 0xFF;
     break;
   }
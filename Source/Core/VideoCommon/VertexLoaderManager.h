@@ -50,6 +50,9 @@ void UpdateVertexArrayPointers();
 // These arrays are in reverse order.
 extern float position_cache[3][4];
 extern u32 position_matrix_index[4];
+// The copies the GPU thread uses when the vertices were loaded on the decode thread.
+extern float preloaded_position_cache[3][4];
+extern u32 preloaded_position_matrix_index[4];
 
 // VB_HAS_X. Bitmask telling what vertex components are present.
 extern u32 g_current_components;
@@ -30,6 +30,61 @@ static const X64Reg base_reg = RBX;
 
 static const u8* memory_base_ptr = (u8*)&g_main_cp_state.array_strides;
 
+static const __m128i shuffle_lut[5][3] = {
+    {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFF00L),   // 1x u8
+     _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFF01L, 0xFFFFFF00L),   // 2x u8
+     _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFF02L, 0xFFFFFF01L, 0xFFFFFF00L)},  // 3x u8
+    {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x00FFFFFFL),   // 1x s8
+     _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x01FFFFFFL, 0x00FFFFFFL),   // 2x s8
+     _mm_set_epi32(0xFFFFFFFFL, 0x02FFFFFFL, 0x01FFFFFFL, 0x00FFFFFFL)},  // 3x s8
+    {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFF0001L),   // 1x u16
+     _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFF0203L, 0xFFFF0001L),   // 2x u16
+     _mm_set_epi32(0xFFFFFFFFL, 0xFFFF0405L, 0xFFFF0203L, 0xFFFF0001L)},  // 3x u16
+    {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x0001FFFFL),   // 1x s16
+     _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x0203FFFFL, 0x0001FFFFL),   // 2x s16
+     _mm_set_epi32(0xFFFFFFFFL, 0x0405FFFFL, 0x0203FFFFL, 0x0001FFFFL)},  // 3x s16
+    {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x00010203L),   // 1x float
+     _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x04050607L, 0x00010203L),   // 2x float
+     _mm_set_epi32(0xFFFFFFFFL, 0x08090A0BL, 0x04050607L, 0x00010203L)},  // 3x float
+};
+static const __m128 scale_factors[32] = {
+    _mm_set_ps1(1. / (1u << 0)),  _mm_set_ps1(1. / (1u << 1)),  _mm_set_ps1(1. / (1u << 2)),
+    _mm_set_ps1(1. / (1u << 3)),  _mm_set_ps1(1. / (1u << 4)),  _mm_set_ps1(1. / (1u << 5)),
+    _mm_set_ps1(1. / (1u << 6)),  _mm_set_ps1(1. / (1u << 7)),  _mm_set_ps1(1. / (1u << 8)),
+    _mm_set_ps1(1. / (1u << 9)),  _mm_set_ps1(1. / (1u << 10)), _mm_set_ps1(1. / (1u << 11)),
+    _mm_set_ps1(1. / (1u << 12)), _mm_set_ps1(1. / (1u << 13)), _mm_set_ps1(1. / (1u << 14)),
+    _mm_set_ps1(1. / (1u << 15)), _mm_set_ps1(1. / (1u << 16)), _mm_set_ps1(1. / (1u << 17)),
+    _mm_set_ps1(1. / (1u << 18)), _mm_set_ps1(1. / (1u << 19)), _mm_set_ps1(1. / (1u << 20)),
+    _mm_set_ps1(1. / (1u << 21)), _mm_set_ps1(1. / (1u << 22)), _mm_set_ps1(1. / (1u << 23)),
+    _mm_set_ps1(1. / (1u << 24)), _mm_set_ps1(1. / (1u << 25)), _mm_set_ps1(1. / (1u << 26)),
+    _mm_set_ps1(1. / (1u << 27)), _mm_set_ps1(1. / (1u << 28)), _mm_set_ps1(1. / (1u << 29)),
+    _mm_set_ps1(1. / (1u << 30)), _mm_set_ps1(1. / (1u << 31)),
+};
+
+// The tables above with every entry repeated for both 128-bit lanes, for the AVX2 loop.
+struct PairedConstants
+{
+  __m128i shuffle_lut[5][3][2];
+  __m128 scale_factors[32][2];
+};
+static const PairedConstants s_paired_constants = [] {
+  PairedConstants constants;
+  for (int format = 0; format < 5; format++)
+  {
+    for (int count = 0; count < 3; count++)
+    {
+      constants.shuffle_lut[format][count][0] = shuffle_lut[format][count];
+      constants.shuffle_lut[format][count][1] = shuffle_lut[format][count];
+    }
+  }
+  for (int i = 0; i < 32; i++)
+  {
+    constants.scale_factors[i][0] = scale_factors[i];
+    constants.scale_factors[i][1] = scale_factors[i];
+  }
+  return constants;
+}();
+
 static OpArg MPIC(const void* ptr, X64Reg scale_reg, int scale = SCALE_1)
 {
   return MComplex(base_reg, scale_reg, scale, PtrOffset(ptr, memory_base_ptr));
@@ -46,7 +101,8 @@ VertexLoaderX64::VertexLoaderX64(const TVtxDesc& vtx_desc, const VAT& vtx_att)
   if (!IsInitialized())
     return;
 
-  AllocCodeSpace(4096);
+  // The AVX2 loop roughly doubles the code.
+  AllocCodeSpace(CanLoadVertexPairs() ? 8192 : 4096);
   ClearCodeSpace();
   GenerateVertexLoader();
   WriteProtect();
@@ -82,39 +138,11 @@ int VertexLoaderX64::ReadVertex(OpArg data, u64 attribute, int format, int count
                                 bool dequantize, u8 scaling_exponent,
                                 AttributeFormat* native_format)
 {
-  static const __m128i shuffle_lut[5][3] = {
-      {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFF00L),   // 1x u8
-       _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFF01L, 0xFFFFFF00L),   // 2x u8
-       _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFF02L, 0xFFFFFF01L, 0xFFFFFF00L)},  // 3x u8
-      {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x00FFFFFFL),   // 1x s8
-       _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x01FFFFFFL, 0x00FFFFFFL),   // 2x s8
-       _mm_set_epi32(0xFFFFFFFFL, 0x02FFFFFFL, 0x01FFFFFFL, 0x00FFFFFFL)},  // 3x s8
-      {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFF0001L),   // 1x u16
-       _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFF0203L, 0xFFFF0001L),   // 2x u16
-       _mm_set_epi32(0xFFFFFFFFL, 0xFFFF0405L, 0xFFFF0203L, 0xFFFF0001L)},  // 3x u16
-      {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x0001FFFFL),   // 1x s16
-       _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x0203FFFFL, 0x0001FFFFL),   // 2x s16
-       _mm_set_epi32(0xFFFFFFFFL, 0x0405FFFFL, 0x0203FFFFL, 0x0001FFFFL)},  // 3x s16
-      {_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x00010203L),   // 1x float
-       _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x04050607L, 0x00010203L),   // 2x float
-       _mm_set_epi32(0xFFFFFFFFL, 0x08090A0BL, 0x04050607L, 0x00010203L)},  // 3x float
-  };
-  static const __m128 scale_factors[32] = {
-      _mm_set_ps1(1. / (1u << 0)),  _mm_set_ps1(1. / (1u << 1)),  _mm_set_ps1(1. / (1u << 2)),
-      _mm_set_ps1(1. / (1u << 3)),  _mm_set_ps1(1. / (1u << 4)),  _mm_set_ps1(1. / (1u << 5)),
-      _mm_set_ps1(1. / (1u << 6)),  _mm_set_ps1(1. / (1u << 7)),  _mm_set_ps1(1. / (1u << 8)),
-      _mm_set_ps1(1. / (1u << 9)),  _mm_set_ps1(1. / (1u << 10)), _mm_set_ps1(1. / (1u << 11)),
-      _mm_set_ps1(1. / (1u << 12)), _mm_set_ps1(1. / (1u << 13)), _mm_set_ps1(1. / (1u << 14)),
-      _mm_set_ps1(1. / (1u << 15)), _mm_set_ps1(1. / (1u << 16)), _mm_set_ps1(1. / (1u << 17)),
-      _mm_set_ps1(1. / (1u << 18)), _mm_set_ps1(1. / (1u << 19)), _mm_set_ps1(1. / (1u << 20)),
-      _mm_set_ps1(1. / (1u << 21)), _mm_set_ps1(1. / (1u << 22)), _mm_set_ps1(1. / (1u << 23)),
-      _mm_set_ps1(1. / (1u << 24)), _mm_set_ps1(1. / (1u << 25)), _mm_set_ps1(1. / (1u << 26)),
-      _mm_set_ps1(1. / (1u << 27)), _mm_set_ps1(1. / (1u << 28)), _mm_set_ps1(1. / (1u << 29)),
-      _mm_set_ps1(1. / (1u << 30)), _mm_set_ps1(1. / (1u << 31)),
-  };
-
   X64Reg coords = XMM0;
 
+  m_attributes.push_back({LoadedAttribute::Type::Vector, m_src_ofs, m_dst_ofs, format, count_in,
+                          count_out, dequantize, scaling_exponent});
+
   int elem_size = 1 << (format / 2);
   int load_bytes = elem_size * count_in;
   OpArg dest = MDisp(dst_reg, m_dst_ofs);
@@ -265,7 +293,7 @@ int VertexLoaderX64::ReadVertex(OpArg data, u64 attribute, int format, int count
   return load_bytes;
 }
 
-void VertexLoaderX64::ReadColor(OpArg data, u64 attribute, int format)
+int VertexLoaderX64::ReadColor(OpArg data, OpArg dest, int format)
 {
   int load_bytes = 0;
   switch (format)
@@ -276,7 +304,7 @@ void VertexLoaderX64::ReadColor(OpArg data, u64 attribute, int format)
     MOV(32, R(scratch1), data);
     if (format != FORMAT_32B_8888)
       OR(32, R(scratch1), Imm32(0xFF000000));
-    MOV(32, MDisp(dst_reg, m_dst_ofs), R(scratch1));
+    MOV(32, dest, R(scratch1));
     load_bytes = 3 + (format != FORMAT_24B_888);
     break;
 
@@ -316,7 +344,7 @@ void VertexLoaderX64::ReadColor(OpArg data, u64 attribute, int format)
       OR(32, R(scratch1), R(scratch2));
     }
     OR(32, R(scratch1), Imm32(0x000000FF));
-    SwapAndStore(32, MDisp(dst_reg, m_dst_ofs), scratch1);
+    SwapAndStore(32, dest, scratch1);
     load_bytes = 2;
     break;
 
@@ -344,7 +372,7 @@ void VertexLoaderX64::ReadColor(OpArg data, u64 attribute, int format)
     MOV(32, R(scratch2), R(scratch1));
     SHL(32, R(scratch1), Imm8(4));
     OR(32, R(scratch1), R(scratch2));
-    SwapAndStore(32, MDisp(dst_reg, m_dst_ofs), scratch1);
+    SwapAndStore(32, dest, scratch1);
     load_bytes = 2;
     break;
 
@@ -376,12 +404,150 @@ void VertexLoaderX64::ReadColor(OpArg data, u64 attribute, int format)
     SHR(32, R(scratch1), Imm8(6));
     AND(32, R(scratch1), Imm32(0x03030303));
     OR(32, R(scratch1), R(scratch2));
-    SwapAndStore(32, MDisp(dst_reg, m_dst_ofs), scratch1);
+    SwapAndStore(32, dest, scratch1);
     load_bytes = 3;
     break;
   }
-  if (attribute == DIRECT)
-    m_src_ofs += load_bytes;
+  return load_bytes;
+}
+
+bool VertexLoaderX64::CanLoadVertexPairs() const
+{
+  if (!cpu_info.bAVX2)
+    return false;
+
+  // Indexed attributes would need two address computations for every attribute.
+  for (int i = 0; i < 12; i++)
+  {
+    if (m_VtxDesc.GetVertexArrayStatus(i) & MASK_INDEXED)
+      return false;
+  }
+
+  // Neither are the texture matrix indices (bits 1 to 8) handled.
+  return ((m_VtxDesc.Hex >> 1) & 0xFF) == 0;
+}
+
+void VertexLoaderX64::ReadVertexPair(const LoadedAttribute& attribute)
+{
+  const u32 vertex_size = m_src_ofs;
+  const u32 stride = m_dst_ofs;
+
+  if (attribute.type == LoadedAttribute::Type::PosMatIdx)
+  {
+    for (u32 i = 0; i < 2; i++)
+    {
+      MOVZX(32, 8, scratch1, MDisp(src_reg, attribute.src_ofs + i * vertex_size));
+      AND(32, R(scratch1), Imm8(0x3F));
+      MOV(32, MDisp(dst_reg, attribute.dst_ofs + i * stride), R(scratch1));
+    }
+    return;
+  }
+
+  if (attribute.type == LoadedAttribute::Type::Color)
+  {
+    for (u32 i = 0; i < 2; i++)
+    {
+      ReadColor(MDisp(src_reg, attribute.src_ofs + i * vertex_size),
+                MDisp(dst_reg, attribute.dst_ofs + i * stride), attribute.format);
+    }
+    return;
+  }
+
+  // The first vertex goes to the low and the second one to the high lane of YMM0.
+  int load_bytes = (1 << (attribute.format / 2)) * attribute.count_in;
+  for (u32 i = 0; i < 2; i++)
+  {
+    X64Reg reg = i ? XMM1 : XMM0;
+    OpArg data = MDisp(src_reg, attribute.src_ofs + i * vertex_size);
+    if (load_bytes > 8)
+      VMOVDQU(reg, data);
+    else if (load_bytes > 4)
+      VMOVQ_xmm(reg, data);
+    else
+      VMOVD_xmm(reg, data);
+  }
+  VINSERTI128(YMM0, YMM0, R(XMM1), 1);
+
+  VPSHUFB(256, YMM0, YMM0,
+          MPIC(&s_paired_constants.shuffle_lut[attribute.format][attribute.count_in - 1]));
+
+  // Sign-extend.
+  if (attribute.format == FORMAT_BYTE)
+    VPSRAD(256, YMM0, YMM0, 24);
+  if (attribute.format == FORMAT_SHORT)
+    VPSRAD(256, YMM0, YMM0, 16);
+
+  if (attribute.format != FORMAT_FLOAT)
+  {
+    VCVTDQ2PS(256, YMM0, R(YMM0));
+
+    if (attribute.dequantize && attribute.scaling_exponent)
+    {
+      VMULPS(256, YMM0, YMM0,
+             MPIC(&s_paired_constants.scale_factors[attribute.scaling_exponent]));
+    }
+  }
+
+  VEXTRACTI128(R(XMM1), YMM0, 1);
+
+  // The 16 byte store of three components is fine as long as it runs into data which is written
+  // later, which is not the case for the last attribute of the first vertex.
+  const bool last = attribute.dst_ofs + sizeof(float) * attribute.count_out == stride;
+  for (u32 i = 0; i < 2; i++)
+  {
+    X64Reg reg = i ? XMM1 : XMM0;
+    OpArg dest = MDisp(dst_reg, attribute.dst_ofs + i * stride);
+    switch (attribute.count_out)
+    {
+    case 1:
+      VMOVSS(dest, reg);
+      break;
+    case 2:
+      VMOVLPS(dest, reg);
+      break;
+    case 3:
+      if (i == 0 && last)
+      {
+        VMOVLPS(dest, reg);
+        dest.AddMemOffset(2 * sizeof(float));
+        VEXTRACTPS(dest, reg, 2);
+      }
+      else
+      {
+        VMOVUPS(dest, reg);
+      }
+      break;
+    }
+  }
+}
+
+// Loads two vertices per iteration with AVX2, until only the last four are left for the regular
+// loop.  That one takes care of the zfreeze cache, which only gets the last three vertices.
+//
+// Only mid-sized draws take this loop. Below MIN_PAIR_COUNT the setup doesn't pay off, and above
+// MAX_PAIR_COUNT it measured up to ~30% slower than the SSE loop (VertexLoaderAVX2Test.Speed).
+void VertexLoaderX64::GenerateVertexPairLoop(const u8* loop_start)
+{
+  CMP(32, R(count_reg), Imm32(MIN_PAIR_COUNT));
+  FixupBranch too_few = J_CC(CC_B, true);
+  CMP(32, R(count_reg), Imm32(MAX_PAIR_COUNT));
+  FixupBranch too_many = J_CC(CC_A, true);
+
+  const u8* pair_start = GetCodePtr();
+  for (const LoadedAttribute& attribute : m_attributes)
+    ReadVertexPair(attribute);
+
+  ADD(64, R(dst_reg), Imm32(2 * m_dst_ofs));
+  ADD(64, R(src_reg), Imm32(2 * m_src_ofs));
+  SUB(32, R(count_reg), Imm8(2));
+  CMP(32, R(count_reg), Imm8(4));
+  J_CC(CC_A, pair_start);
+
+  // Avoids the penalty of mixing in the SSE code of the other loop.
+  VZEROUPPER();
+  SetJumpTarget(too_few);
+  SetJumpTarget(too_many);
+  JMP(loop_start, true);
 }
 
 void VertexLoaderX64::GenerateVertexLoader()
@@ -402,12 +568,19 @@ void VertexLoaderX64::GenerateVertexLoader()
   if (m_VtxDesc.Position & MASK_INDEXED)
     XOR(32, R(skipped_reg), R(skipped_reg));
 
+  // The AVX2 loop is generated last, as it needs the layout of the vertex.
+  const bool load_pairs = CanLoadVertexPairs();
+  FixupBranch to_pair_loop;
+  if (load_pairs)
+    to_pair_loop = J(true);
+
   // TODO: load constants into registers outside the main loop
 
   const u8* loop_start = GetCodePtr();
 
   if (m_VtxDesc.PosMatIdx)
   {
+    m_attributes.push_back({LoadedAttribute::Type::PosMatIdx, m_src_ofs, m_dst_ofs});
     MOVZX(32, 8, scratch1, MDisp(src_reg, m_src_ofs));
     AND(32, R(scratch1), Imm8(0x3F));
     MOV(32, MDisp(dst_reg, m_dst_ofs), R(scratch1));
@@ -471,8 +644,12 @@ void VertexLoaderX64::GenerateVertexLoader()
   {
     if (col[i])
     {
+      const int format = m_VtxAttr.color[i].Comp;
+      m_attributes.push_back({LoadedAttribute::Type::Color, m_src_ofs, m_dst_ofs, format});
       data = GetVertexAddr(ARRAY_COLOR + i, col[i]);
-      ReadColor(data, col[i], m_VtxAttr.color[i].Comp);
+      int load_bytes = ReadColor(data, MDisp(dst_reg, m_dst_ofs), format);
+      if (col[i] == DIRECT)
+        m_src_ofs += load_bytes;
       m_native_components |= VB_HAS_COL0 << i;
       m_native_vtx_decl.colors[i].components = 4;
       m_native_vtx_decl.colors[i].enable = true;
@@ -551,6 +728,12 @@ void VertexLoaderX64::GenerateVertexLoader()
     RET();
   }
 
+  if (load_pairs)
+  {
+    SetJumpTarget(to_pair_loop);
+    GenerateVertexPairLoop(loop_start);
+  }
+
   m_VertexSize = m_src_ofs;
   m_native_vtx_decl.stride = m_dst_ofs;
 }
@@ -2,6 +2,8 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <vector>
+
 #include "Common/CommonTypes.h"
 #include "Common/x64Emitter.h"
 #include "VideoCommon/VertexLoaderBase.h"
@@ -9,6 +11,10 @@
 class VertexLoaderX64 : public VertexLoaderBase, public Gen::X64CodeBlock
 {
 public:
+  // The vertex counts the AVX2 loop is used for.
+  static constexpr u32 MIN_PAIR_COUNT = 16;
+  static constexpr u32 MAX_PAIR_COUNT = 256;
+
   VertexLoaderX64(const TVtxDesc& vtx_desc, const VAT& vtx_att);
 
 protected:
@@ -17,12 +23,35 @@ protected:
   int RunVertices(DataReader src, DataReader dst, int count) override;
 
 private:
+  // Where GenerateVertexLoader placed an attribute, for loading it in the AVX2 loop.
+  struct LoadedAttribute
+  {
+    enum class Type
+    {
+      Vector,
+      Color,
+      PosMatIdx,
+    };
+    Type type;
+    u32 src_ofs;
+    u32 dst_ofs;
+    int format;
+    int count_in;
+    int count_out;
+    bool dequantize;
+    u8 scaling_exponent;
+  };
+
   u32 m_src_ofs = 0;
   u32 m_dst_ofs = 0;
+  std::vector<LoadedAttribute> m_attributes;
   Gen::FixupBranch m_skip_vertex;
   Gen::OpArg GetVertexAddr(int array, u64 attribute);
   int ReadVertex(Gen::OpArg data, u64 attribute, int format, int count_in, int count_out,
                  bool dequantize, u8 scaling_exponent, AttributeFormat* native_format);
-  void ReadColor(Gen::OpArg data, u64 attribute, int format);
+  int ReadColor(Gen::OpArg data, Gen::OpArg dest, int format);
+  bool CanLoadVertexPairs() const;
+  void ReadVertexPair(const LoadedAttribute& attribute);
+  void GenerateVertexPairLoop(const u8* loop_start);
   void GenerateVertexLoader();
 };
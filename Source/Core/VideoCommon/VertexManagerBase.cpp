@@ -17,6 +17,7 @@
 #include "VideoCommon/BPMemory.h"
 #include "VideoCommon/DataReader.h"
 #include "VideoCommon/Debugger.h"
+#include "VideoCommon/Fifo.h"
 #include "VideoCommon/GeometryShaderManager.h"
 #include "VideoCommon/IndexGenerator.h"
 #include "VideoCommon/NativeVertexFormat.h"
@@ -429,6 +430,13 @@ void VertexManagerBase::CalculateZSlope(NativeVertexFormat* format)
   if ((m_cur_buffer_pointer - m_base_buffer_pointer) < (vert_decl.stride * 3))
     return;
 
+  const bool preloaded = Fifo::UsePipelinedGPUThread();
+  float(&position_cache)[3][4] = preloaded ? VertexLoaderManager::preloaded_position_cache :
+                                             VertexLoaderManager::position_cache;
+  const u32(&position_matrix_index)[4] = preloaded ?
+                                             VertexLoaderManager::preloaded_position_matrix_index :
+                                             VertexLoaderManager::position_matrix_index;
+
   // Lookup vertices of the last rendered triangle and software-transform them
   // This allows us to determine the depth slope, which will be used if z-freeze
   // is enabled in the following flush.
@@ -436,13 +444,12 @@ void VertexManagerBase::CalculateZSlope(NativeVertexFormat* format)
   {
     // If this vertex format has per-vertex position matrix IDs, look it up.
     if (vert_decl.posmtx.enable)
-      mtxIdx = VertexLoaderManager::position_matrix_index[3 - i];
+      mtxIdx = position_matrix_index[3 - i];
 
     if (vert_decl.position.components == 2)
-      VertexLoaderManager::position_cache[2 - i][2] = 0;
+      position_cache[2 - i][2] = 0;
 
-    VertexShaderManager::TransformToClipSpace(&VertexLoaderManager::position_cache[2 - i][0],
-                                              &out[i * 4], mtxIdx);
+    VertexShaderManager::TransformToClipSpace(&position_cache[2 - i][0], &out[i * 4], mtxIdx);
 
     // Transform to Screenspace
     float inv_w = 1.0f / out[3 + i * 4];
@@ -126,6 +126,7 @@ struct VideoConfig final
   bool bEnablePixelLighting;
   bool bFastDepthCalc;
   bool bVertexRounding;
+  bool bDisplayListCache;
   int iLog;           // CONF_ bits
   int iSaveTargetId;  // TODO: Should be dropped
 
@@ -265,7 +265,7 @@ void LoadIndexedXF(u32 val, int refarray)
 
   u32* currData = (u32*)(&xfmem) + address;
   u32* newData;
-  if (Fifo::UseDeterministicGPUThread())
+  if (Fifo::UseDeterministicGPUThread() || Fifo::UsePipelinedGPUThread())
   {
     newData = (u32*)Fifo::PopFifoAuxBuffer(size * sizeof(u32));
   }
@@ -0,0 +1,202 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/FlatHashIndex.h"
+
+using Common::FlatHashIndex;
+
+namespace
+{
+// A texture heavy frame: 2000 cached textures with distinct addresses, 20000 loads by address,
+// 200 of them replaced, and 50 EFB copies looking for the textures they overlap.
+struct TextureCacheFrame
+{
+  static constexpr int FRAMES = 20;
+  static constexpr int REPLACED = 200;
+  static constexpr u32 COPY_SIZE = 640 * 528 * 2;
+
+  TextureCacheFrame() : addresses(2000), lookup_order(20000), copy_addresses(50)
+  {
+    std::mt19937 rng(0);
+    for (u32& address : addresses)
+      address = (rng() & 0x1FFFFFF) & ~31u;
+    for (int& i : lookup_order)
+      i = rng() % addresses.size();
+    for (u32& address : copy_addresses)
+      address = (rng() & 0x1FFFFFF) & ~31u;
+  }
+
+  // Like TextureCacheBase::FindOverlappingTextures, which looks back by the largest texture size.
+  static u32 LookBackStart(u32 address)
+  {
+    const u32 look_back = 1024 * 1024 * 4;
+    return address > look_back ? address - look_back : 0;
+  }
+
+  std::vector<u32> addresses;
+  std::vector<int> lookup_order;
+  std::vector<u32> copy_addresses;
+};
+
+// Returns the values of key in the same order as a multimap would keep them.
+std::vector<int> Values(const std::multimap<u32, int>& map, u32 key)
+{
+  std::vector<int> values;
+  auto range = map.equal_range(key);
+  for (auto iter = range.first; iter != range.second; ++iter)
+    values.push_back(iter->second);
+  return values;
+}
+
+template <bool Ordered>
+std::vector<int> Values(const FlatHashIndex<u32, int, Ordered>& index, u32 key)
+{
+  const auto* bucket = index.Find(key);
+  return bucket ? *bucket : std::vector<int>();
+}
+}  // namespace
+
+TEST(FlatHashIndex, Simple)
+{
+  FlatHashIndex<u32, int> index;
+  EXPECT_TRUE(index.Empty());
+  EXPECT_EQ(nullptr, index.Find(5));
+
+  index.Insert(5, 1);
+  index.Insert(5, 2);
+  index.Insert(7, 3);
+  EXPECT_EQ(3u, index.Size());
+  EXPECT_EQ(std::vector<int>({1, 2}), Values(index, 5));
+  EXPECT_EQ(std::vector<int>({3}), Values(index, 7));
+
+  EXPECT_FALSE(index.Erase(5, 3));
+  EXPECT_FALSE(index.Erase(6, 1));
+  EXPECT_TRUE(index.Erase(5, 1));
+  EXPECT_EQ(std::vector<int>({2}), Values(index, 5));
+  EXPECT_TRUE(index.Erase(5, 2));
+  EXPECT_EQ(nullptr, index.Find(5));
+  EXPECT_EQ(1u, index.Size());
+
+  index.Clear();
+  EXPECT_TRUE(index.Empty());
+  EXPECT_EQ(nullptr, index.Find(7));
+}
+
+TEST(FlatHashIndex, MatchesMultimap)
+{
+  // Few distinct keys make for long probe chains, which exercises the backward shift on erase.
+  for (u32 key_range : {16u, 1000u, 100000u})
+  {
+    std::mt19937 rng(key_range);
+    std::uniform_int_distribution<u32> key_dist(0, key_range - 1);
+    FlatHashIndex<u32, int, true> index;
+    std::multimap<u32, int> reference;
+
+    for (int i = 0; i < 50000; i++)
+    {
+      const u32 key = key_dist(rng);
+      if (rng() % 3 != 0)
+      {
+        index.Insert(key, i);
+        reference.emplace(key, i);
+      }
+      else
+      {
+        const std::vector<int> values = Values(reference, key);
+        if (values.empty())
+        {
+          EXPECT_FALSE(index.Erase(key, i));
+          continue;
+        }
+        const int value = values[rng() % values.size()];
+        EXPECT_TRUE(index.Erase(key, value));
+        reference.erase(std::find_if(reference.lower_bound(key), reference.upper_bound(key),
+                                     [value](const auto& entry) { return entry.second == value; }));
+      }
+    }
+
+    ASSERT_EQ(reference.size(), index.Size());
+    for (u32 key = 0; key < key_range; key++)
+      ASSERT_EQ(Values(reference, key), Values(index, key)) << "key " << key;
+
+    std::multimap<u32, int> iterated;
+    index.ForEach([&](u32 key, int value) { iterated.emplace(key, value); });
+    EXPECT_EQ(reference, iterated);
+
+    const u32 first = key_range / 4;
+    const u32 last = key_range / 2;
+    // Ranges are visited in the multimap's order.
+    const std::vector<std::pair<u32, int>> expected_range(reference.lower_bound(first),
+                                                          reference.upper_bound(last));
+    std::vector<std::pair<u32, int>> in_range;
+    index.ForEachInRange(first, last,
+                         [&](u32 key, int value) { in_range.emplace_back(key, value); });
+    EXPECT_EQ(expected_range, in_range);
+  }
+}
+
+TEST(FlatHashIndex, MultimapSpeed)
+{
+  const TextureCacheFrame frame;
+  std::multimap<u32, int> map;
+  for (size_t i = 0; i < frame.addresses.size(); i++)
+    map.emplace(frame.addresses[i], static_cast<int>(i));
+
+  for (int i = 0; i < TextureCacheFrame::FRAMES; i++)
+  {
+    for (int j : frame.lookup_order)
+    {
+      auto range = map.equal_range(frame.addresses[j]);
+      EXPECT_NE(range.first, range.second);
+    }
+    for (int j = 0; j < TextureCacheFrame::REPLACED; j++)
+    {
+      auto range = map.equal_range(frame.addresses[j]);
+      map.erase(std::find_if(range.first, range.second,
+                             [j](const auto& entry) { return entry.second == j; }));
+      map.emplace(frame.addresses[j], j);
+    }
+    for (u32 address : frame.copy_addresses)
+    {
+      std::vector<int> entries;
+      const auto end = map.upper_bound(address + TextureCacheFrame::COPY_SIZE);
+      for (auto iter = map.lower_bound(frame.LookBackStart(address)); iter != end; ++iter)
+        entries.push_back(iter->second);
+    }
+  }
+}
+
+TEST(FlatHashIndex, Speed)
+{
+  const TextureCacheFrame frame;
+  FlatHashIndex<u32, int, true> index;
+  for (size_t i = 0; i < frame.addresses.size(); i++)
+    index.Insert(frame.addresses[i], static_cast<int>(i));
+
+  for (int i = 0; i < TextureCacheFrame::FRAMES; i++)
+  {
+    for (int j : frame.lookup_order)
+      EXPECT_NE(nullptr, index.Find(frame.addresses[j]));
+    for (int j = 0; j < TextureCacheFrame::REPLACED; j++)
+    {
+      index.Erase(frame.addresses[j], j);
+      index.Insert(frame.addresses[j], j);
+    }
+    for (u32 address : frame.copy_addresses)
+    {
+      std::vector<int> entries;
+      index.ForEachInRange(frame.LookBackStart(address), address + TextureCacheFrame::COPY_SIZE,
+                           [&entries](u32 key, int value) { entries.push_back(value); });
+    }
+  }
+}
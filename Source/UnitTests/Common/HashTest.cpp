@@ -0,0 +1,127 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/CPUDetect.h"
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+
+namespace
+{
+std::vector<u8> MakeInput(u32 len)
+{
+  std::vector<u8> data(len);
+  for (u32 i = 0; i < len; i++)
+    data[i] = static_cast<u8>(i * 31 + 7);
+  return data;
+}
+
+class HashTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_saved_cpu_info = cpu_info;
+    SetHash64Function();
+  }
+  void TearDown() override
+  {
+    cpu_info = m_saved_cpu_info;
+    SetHash64Function();
+  }
+
+  void Select(bool avx2)
+  {
+    cpu_info = m_saved_cpu_info;
+    cpu_info.bAVX2 = avx2;
+    SetHash64Function();
+  }
+
+  // Hashes twenty frames' worth of texture uploads: 256 textures of 64 KiB each.
+  void HashFrames(u32 samples)
+  {
+    const std::vector<u8> data = MakeInput(64 * 1024);
+    for (int i = 0; i < 256 * 20; i++)
+      GetHash64(data.data(), static_cast<u32>(data.size()), samples);
+  }
+
+  CPUInfo m_saved_cpu_info;
+};
+}  // namespace
+
+TEST_F(HashTest, XXH3ReferenceValues)
+{
+  // Computed with the reference implementation, which every length class has to match.
+  static const std::pair<u32, u64> expected[] = {
+      {0, 0x2d06800538d394c2},    {1, 0x4c5cca45d0f4811f},    {3, 0x15f7093b173d005c},
+      {4, 0xdca012f95811b6b9},    {8, 0xdec6a9a43575982e},    {9, 0xcbe393399f17ffbd},
+      {16, 0x7e484c18d74895d0},   {17, 0x208bde5ee2bed407},   {64, 0xdd30702ab46b3745},
+      {100, 0x8c97158042fbf926},  {128, 0xf92b70eaa21a6288},  {129, 0xf8f76713f2bb60fa},
+      {200, 0x12fdb864685f344d},  {240, 0xccc7375172c41f03},  {241, 0x0b3b630948ce4a00},
+      {1024, 0x23bc880ebf0d29c6}, {1025, 0xc09fdfbc398c7d82}, {2048, 0x19f6f9c987331373},
+      {4103, 0xad0017645a159db5},
+  };
+
+  for (const auto& entry : expected)
+  {
+    const std::vector<u8> data = MakeInput(entry.first);
+    EXPECT_EQ(entry.second, GetXXH3Hash64(data.data(), entry.first)) << "len " << entry.first;
+  }
+}
+
+TEST_F(HashTest, XXH3ImplementationsMatch)
+{
+  if (!m_saved_cpu_info.bAVX2)
+    return;
+
+  const std::vector<u8> data = MakeInput(70000);
+  for (u32 len = 241; len < data.size(); len = len * 3 / 2 + 13)
+  {
+    Select(false);
+    const u64 expected = GetXXH3Hash64(data.data(), len);
+    Select(true);
+    EXPECT_EQ(expected, GetXXH3Hash64(data.data(), len)) << "len " << len;
+  }
+}
+
+TEST_F(HashTest, XXH3OnlyForWholeInputsWithAVX2)
+{
+  const std::vector<u8> data = MakeInput(65536);
+  Select(false);
+  const u64 sampled = GetHash64(data.data(), 65536, 128);
+  EXPECT_NE(GetXXH3Hash64(data.data(), 65536), GetHash64(data.data(), 65536, 0));
+  if (!m_saved_cpu_info.bAVX2)
+    return;
+
+  Select(true);
+  EXPECT_EQ(GetXXH3Hash64(data.data(), 65536), GetHash64(data.data(), 65536, 0));
+  // Sampled hashes keep spreading 128 words over the input.
+  EXPECT_EQ(sampled, GetHash64(data.data(), 65536, 128));
+  // Inputs small enough to be hashed completely ignore samples.
+  EXPECT_EQ(GetXXH3Hash64(data.data(), 1000), GetHash64(data.data(), 1000, 128));
+}
+
+TEST_F(HashTest, WithoutAVX2Speed)
+{
+  Select(false);
+  HashFrames(0);
+}
+
+TEST_F(HashTest, WithAVX2Speed)
+{
+  if (!m_saved_cpu_info.bAVX2)
+    return;
+
+  Select(true);
+  HashFrames(0);
+}
+
+TEST_F(HashTest, SampledSpeed)
+{
+  HashFrames(128);
+}
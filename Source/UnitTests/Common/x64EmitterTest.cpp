@@ -858,8 +858,6 @@ TWO_OP_SSE_TEST(PMOVZXDQ, "qword")
 
 // TODO: BLEND
 
-// TODO: AVX
-
 // for VEX GPR instructions that take the form op reg, r/m, reg
 #define VEX_RMR_TEST(Name)                                                                         \
   TEST_F(x64EmitterTest, Name)                                                                     \
@@ -1005,6 +1003,18 @@ VEX_RMI_TEST(RORX)
       }                                                                                            \
   }
 
+AVX_RRM_TEST(VADDSD, "qword")
+AVX_RRM_TEST(VADDPD, "dqword")
+AVX_RRM_TEST(VSUBSD, "qword")
+AVX_RRM_TEST(VSUBPD, "dqword")
+AVX_RRM_TEST(VMULSD, "qword")
+AVX_RRM_TEST(VMULPS, "dqword")
+AVX_RRM_TEST(VMULPD, "dqword")
+AVX_RRM_TEST(VDIVSD, "qword")
+AVX_RRM_TEST(VDIVPD, "dqword")
+AVX_RRM_TEST(VSQRTSD, "qword")
+AVX_RRM_TEST(VUNPCKLPD, "dqword")
+AVX_RRM_TEST(VUNPCKHPD, "dqword")
 AVX_RRM_TEST(VANDPS, "dqword")
 AVX_RRM_TEST(VANDPD, "dqword")
 AVX_RRM_TEST(VANDNPS, "dqword")
@@ -1018,6 +1028,52 @@ AVX_RRM_TEST(VPANDN, "dqword")
 AVX_RRM_TEST(VPOR, "dqword")
 AVX_RRM_TEST(VPXOR, "dqword")
 
+// for AVX instructions that take the form op reg, reg, r/m, imm
+#define AVX_RRMI_TEST(Name, sizename)                                                              \
+  TEST_F(x64EmitterTest, Name)                                                                     \
+  {                                                                                                \
+    struct                                                                                         \
+    {                                                                                              \
+      int bits;                                                                                    \
+      std::vector<NamedReg> regs;                                                                  \
+      std::string out_name;                                                                        \
+      std::string size;                                                                            \
+    } regsets[] = {                                                                                \
+        {64, xmmnames, "xmm0", sizename},                                                          \
+    };                                                                                             \
+    for (const auto& regset : regsets)                                                             \
+      for (const auto& r : regset.regs)                                                            \
+      {                                                                                            \
+        emitter->Name(r.reg, XMM0, R(XMM0), 4);                                                    \
+        emitter->Name(XMM0, XMM0, R(r.reg), 4);                                                    \
+        emitter->Name(XMM0, r.reg, MatR(R12), 4);                                                  \
+        ExpectDisassembly(#Name " " + r.name + ", " + regset.out_name + ", " + regset.out_name +   \
+                          ", 0x04 " #Name " " + regset.out_name + ", " + regset.out_name + ", " +  \
+                          r.name + ", 0x04 " #Name " " + regset.out_name + ", " + r.name + ", " +  \
+                          regset.size + " ptr ds:[r12], 0x04 ");                                   \
+      }                                                                                            \
+  }
+
+AVX_RRMI_TEST(VCMPPD, "dqword")
+AVX_RRMI_TEST(VSHUFPD, "dqword")
+
+// for AVX instructions that take the form op reg, reg, r/m, reg
+#define AVX_RRMR_TEST(Name, sizename)                                                              \
+  TEST_F(x64EmitterTest, Name)                                                                     \
+  {                                                                                                \
+    for (const auto& r : xmmnames)                                                                 \
+    {                                                                                              \
+      emitter->Name(r.reg, XMM0, R(XMM0), XMM0);                                                   \
+      emitter->Name(XMM0, XMM0, R(XMM0), r.reg);                                                   \
+      emitter->Name(XMM0, r.reg, MatR(R12), XMM0);                                                 \
+      ExpectDisassembly(#Name " " + r.name + ", xmm0, xmm0, xmm0 " #Name " xmm0, xmm0, xmm0, " +   \
+                        r.name + " " #Name " xmm0, " + r.name + ", " sizename                      \
+                        " ptr ds:[r12], xmm0");                                                    \
+    }                                                                                              \
+  }
+
+AVX_RRMR_TEST(VBLENDVPD, "dqword")
+
 #define FMA3_TEST(Name, P, packed)                                                                 \
   AVX_RRM_TEST(Name##132##P##S, packed ? "dqword" : "dword")                                       \
   AVX_RRM_TEST(Name##213##P##S, packed ? "dqword" : "dword")                                       \
@@ -1079,4 +1135,41 @@ FMA4_TEST(VFNMSUB, S, false)
 FMA4_TEST(VFMADDSUB, P, true)
 FMA4_TEST(VFMSUBADD, P, true)
 
+TEST_F(x64EmitterTest, VEX_Moves)
+{
+  emitter->VMOVD_xmm(XMM0, MatR(R12));
+  emitter->VMOVQ_xmm(XMM9, MDisp(RAX, 8));
+  emitter->VMOVDQU(XMM2, MatR(R12));
+  emitter->VMOVSS(MatR(R12), XMM3);
+  emitter->VMOVLPS(MDisp(RAX, 8), XMM12);
+  emitter->VMOVUPS(MatR(R12), XMM5);
+  emitter->VEXTRACTPS(MDisp(R12, 8), XMM6, 2);
+  ExpectDisassembly("vmovd xmm0, dword ptr ds:[r12] "
+                    "vmovq xmm9, qword ptr ds:[rax+8] "
+                    "vmovdqu xmm2, dqword ptr ds:[r12] "
+                    "vmovss dword ptr ds:[r12], xmm3 "
+                    "vmovlps qword ptr ds:[rax+8], xmm12 "
+                    "vmovups dqword ptr ds:[r12], xmm5 "
+                    "vextractps dword ptr ds:[r12+8], xmm6, 0x02");
+}
+
+// Bochs prints the 128-bit operands of VINSERTI128 and VEXTRACTI128 as ymm.
+TEST_F(x64EmitterTest, AVX2_256)
+{
+  emitter->VPSHUFB(256, YMM0, YMM1, MatR(R12));
+  emitter->VPSRAD(256, YMM2, YMM3, 16);
+  emitter->VCVTDQ2PS(256, YMM4, R(YMM5));
+  emitter->VMULPS(256, YMM6, YMM7, MatR(R12));
+  emitter->VINSERTI128(YMM0, YMM1, R(XMM2), 1);
+  emitter->VEXTRACTI128(R(XMM3), YMM4, 1);
+  emitter->VZEROUPPER();
+  ExpectDisassembly("vpshufb ymm0, ymm1, qqword ptr ds:[r12] "
+                    "vpsrad ymm2, ymm3, 0x10 "
+                    "vcvtdq2ps ymm4, ymm5 "
+                    "vmulps ymm6, ymm7, qqword ptr ds:[r12] "
+                    "vinserti128 ymm0, ymm1, ymm2, 0x01 "
+                    "vextracti128 ymm3, ymm4, 0x01 "
+                    "vzeroupper");
+}
+
 }  // namespace Gen
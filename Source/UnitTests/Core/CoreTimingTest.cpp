@@ -4,9 +4,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
 #include <bitset>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "Common/Config/Config.h"
 #include "Common/FileUtil.h"
@@ -347,3 +350,190 @@ TEST(CoreTiming, Overclocking)
   SConfig::GetInstance().m_OCFactor = 1.0;
   AdvanceAndCheck(4, MAX_SLICE_LENGTH);
 }
+
+namespace ManyEventsTest
+{
+static std::vector<u64> s_order;
+
+static void RecordCallback(u64 userdata, s64 lateness)
+{
+  EXPECT_EQ(0, lateness);
+  s_order.push_back(userdata);
+}
+
+// Runs full slices until the expected number of callbacks has happened.
+static void AdvanceUntil(size_t num_callbacks)
+{
+  for (int i = 0; i < 100000 && s_order.size() < num_callbacks; i++)
+  {
+    PowerPC::ppcState.downcount = 0;
+    CoreTiming::Advance();
+  }
+  EXPECT_EQ(num_callbacks, s_order.size());
+}
+}
+
+TEST(CoreTiming, ManyEvents)
+{
+  using namespace ManyEventsTest;
+
+  ScopeInit guard;
+
+  std::array<CoreTiming::EventType*, 4> types;
+  for (size_t i = 0; i < types.size(); i++)
+    types[i] = CoreTiming::RegisterEvent("callback" + std::to_string(i), RecordCallback);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  // Spread over both levels of the wheel, with some events sharing a time.
+  constexpr u64 NUM_EVENTS = 1000;
+  std::vector<std::pair<s64, u64>> expected;
+  for (u64 i = 0; i < NUM_EVENTS; i++)
+  {
+    const s64 time = i % 10 == 0 ? 5000 : static_cast<s64>(i * 7919 % 600000);
+    CoreTiming::ScheduleEvent(time, types[i % types.size()], i);
+    if (i % types.size() != 3)
+      expected.emplace_back(time, i);
+  }
+  CoreTiming::RemoveEvent(types[3]);
+  std::sort(expected.begin(), expected.end());
+
+  s_order.clear();
+  AdvanceUntil(expected.size());
+  for (size_t i = 0; i < std::min(expected.size(), s_order.size()); i++)
+    EXPECT_EQ(expected[i].second, s_order[i]);
+  EXPECT_EQ(MAX_SLICE_LENGTH, PowerPC::ppcState.downcount);
+}
+
+TEST(CoreTiming, LongIntervals)
+{
+  using namespace ManyEventsTest;
+
+  ScopeInit guard;
+
+  CoreTiming::EventType* cb = CoreTiming::RegisterEvent("callback", RecordCallback);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  // These go into the overflow bucket and have to cascade down twice.
+  CoreTiming::ScheduleEvent(200000000, cb, 4);
+  CoreTiming::ScheduleEvent(70000000, cb, 3);
+  CoreTiming::ScheduleEvent(300000, cb, 2);
+  CoreTiming::ScheduleEvent(100, cb, 1);
+  CoreTiming::ScheduleEvent(70000000, cb, 5);
+
+  s_order.clear();
+  AdvanceUntil(5);
+  EXPECT_EQ((std::vector<u64>{1, 2, 3, 5, 4}), s_order);
+  EXPECT_EQ(200000000, static_cast<s64>(CoreTiming::GetTicks()));
+}
+
+namespace ScheduleFromOtherThreadsTest
+{
+static constexpr u32 NUM_THREADS = 4;
+static constexpr u32 EVENTS_PER_THREAD = 500;
+static std::array<u32, NUM_THREADS> s_next_sequence;
+static u32 s_num_callbacks = 0;
+
+static void ThreadCallback(u64 userdata, s64 lateness)
+{
+  const u32 thread = static_cast<u32>(userdata >> 32);
+  const u32 sequence = static_cast<u32>(userdata);
+  ASSERT_LT(thread, NUM_THREADS);
+  EXPECT_EQ(s_next_sequence[thread], sequence);
+  s_next_sequence[thread] = sequence + 1;
+  ++s_num_callbacks;
+}
+}
+
+TEST(CoreTiming, ScheduleFromOtherThreads)
+{
+  using namespace ScheduleFromOtherThreadsTest;
+
+  ScopeInit guard;
+
+  CoreTiming::EventType* cb = CoreTiming::RegisterEvent("callback", ThreadCallback);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  s_next_sequence.fill(0);
+  s_num_callbacks = 0;
+
+  std::vector<std::thread> threads;
+  for (u64 thread = 0; thread < NUM_THREADS; thread++)
+  {
+    threads.emplace_back([cb, thread] {
+      for (u64 i = 0; i < EVENTS_PER_THREAD; i++)
+        CoreTiming::ScheduleEvent(100, cb, thread << 32 | i, CoreTiming::FromThread::NON_CPU);
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  // Events from the same thread share a time, so they must run in the order they were scheduled.
+  PowerPC::ppcState.downcount = 0;
+  CoreTiming::Advance();
+  PowerPC::ppcState.downcount = 0;
+  CoreTiming::Advance();
+  EXPECT_EQ(NUM_THREADS * EVENTS_PER_THREAD, s_num_callbacks);
+  for (u32 sequence : s_next_sequence)
+    EXPECT_EQ(EVENTS_PER_THREAD, sequence);
+}
+
+namespace ThroughputTest
+{
+static constexpr u32 NUM_PERIODIC_EVENTS = 32;
+static std::array<CoreTiming::EventType*, NUM_PERIODIC_EVENTS> s_periodic_types;
+static CoreTiming::EventType* s_timeout_type;
+static u64 s_num_callbacks = 0;
+
+static s64 GetPeriod(u64 index)
+{
+  return 1000 + static_cast<s64>(index) * 997;
+}
+
+// Like most hardware timers: reschedules itself, and pushes a timeout back.
+static void PeriodicCallback(u64 userdata, s64 lateness)
+{
+  ++s_num_callbacks;
+  CoreTiming::ScheduleEvent(GetPeriod(userdata) - lateness, s_periodic_types[userdata], userdata);
+  CoreTiming::RemoveEvent(s_timeout_type);
+  CoreTiming::ScheduleEvent(500000, s_timeout_type);
+}
+
+static void TimeoutCallback(u64 userdata, s64 lateness)
+{
+  ADD_FAILURE() << "The timeout should always be pushed back";
+}
+}
+
+// Runs the scheduler with a load similar to emulation.
+TEST(CoreTiming, EventSpeed)
+{
+  using namespace ThroughputTest;
+
+  ScopeInit guard;
+
+  for (u64 i = 0; i < NUM_PERIODIC_EVENTS; i++)
+  {
+    s_periodic_types[i] =
+        CoreTiming::RegisterEvent("periodic" + std::to_string(i), PeriodicCallback);
+  }
+  s_timeout_type = CoreTiming::RegisterEvent("timeout", TimeoutCallback);
+
+  // Enter slice 0
+  CoreTiming::Advance();
+
+  for (u64 i = 0; i < NUM_PERIODIC_EVENTS; i++)
+    CoreTiming::ScheduleEvent(GetPeriod(i), s_periodic_types[i], i);
+
+  s_num_callbacks = 0;
+  while (s_num_callbacks < 1000000)
+  {
+    PowerPC::ppcState.downcount = 0;
+    CoreTiming::Advance();
+  }
+}
@@ -0,0 +1,210 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+#include "Core/MemTools.h"
+#include "UICommon/UICommon.h"
+
+class ScopeInit final
+{
+public:
+  ScopeInit() : m_profile_path(File::CreateTempDir())
+  {
+    UICommon::SetUserDirectory(m_profile_path);
+    Config::Init();
+    SConfig::Init();
+    SConfig::GetInstance().bWii = true;
+    Memory::Init();
+    EMM::InstallExceptionHandler();
+  }
+  ~ScopeInit()
+  {
+    EMM::UninstallExceptionHandler();
+    Memory::Shutdown();
+    SConfig::Shutdown();
+    Config::Shutdown();
+    File::DeleteDirRecursively(m_profile_path);
+  }
+
+  const std::string& GetProfilePath() const { return m_profile_path; }
+
+private:
+  std::string m_profile_path;
+};
+
+static u32 ReadSnapshotU32(const Memory::CopyOnWriteSnapshot& snapshot, u32 address)
+{
+  u32 value = 0;
+  EXPECT_TRUE(snapshot.Read(address, &value, sizeof(value)));
+  return value;
+}
+
+TEST(CopyOnWriteSnapshot, KeepsOldContents)
+{
+  ScopeInit guard;
+  Memory::m_pRAM[0x1000] = 1;
+  Memory::m_pEXRAM[0x2000] = 2;
+
+  std::unique_ptr<Memory::CopyOnWriteSnapshot> snapshot = Memory::TakeCopyOnWriteSnapshot();
+  ASSERT_NE(nullptr, snapshot);
+  EXPECT_EQ(nullptr, Memory::TakeCopyOnWriteSnapshot());
+
+  Memory::m_pRAM[0x1000] = 3;
+  Memory::m_pEXRAM[0x2000] = 4;
+  Memory::m_pRAM[0x1000] = 5;
+  EXPECT_EQ(1u, ReadSnapshotU32(*snapshot, 0x1000));
+  EXPECT_EQ(2u, ReadSnapshotU32(*snapshot, 0x10002000));
+  EXPECT_EQ(5, Memory::m_pRAM[0x1000]);
+
+  // Across a page boundary, with only the first page written.
+  Memory::m_pRAM[0x2ffe] = 6;
+  Memory::m_pRAM[0x3000] = 7;
+  snapshot.reset();
+  snapshot = Memory::TakeCopyOnWriteSnapshot();
+  ASSERT_NE(nullptr, snapshot);
+  Memory::m_pRAM[0x2ffe] = 8;
+  u8 bytes[4];
+  EXPECT_TRUE(snapshot->Read(0x2ffe, bytes, sizeof(bytes)));
+  EXPECT_EQ(6, bytes[0]);
+  EXPECT_EQ(7, bytes[2]);
+
+  EXPECT_FALSE(snapshot->Read(Memory::REALRAM_SIZE * 2 - 2, bytes, sizeof(bytes)));
+
+  // Writing after the snapshot is gone.
+  snapshot.reset();
+  Memory::m_pRAM[0x1000] = 9;
+  EXPECT_EQ(9, Memory::m_pRAM[0x1000]);
+}
+
+TEST(CopyOnWriteSnapshot, ConsistentWhileWriting)
+{
+  ScopeInit guard;
+  constexpr u32 SIZE = 0x100000;
+  for (u32 i = 0; i < SIZE; i += 4)
+    *reinterpret_cast<u32*>(&Memory::m_pRAM[i]) = i;
+
+  std::unique_ptr<Memory::CopyOnWriteSnapshot> snapshot = Memory::TakeCopyOnWriteSnapshot();
+  ASSERT_NE(nullptr, snapshot);
+
+  std::vector<u8> image(SIZE);
+  std::thread reader([&] { snapshot->Read(0, image.data(), SIZE); });
+  for (u32 i = 0; i < SIZE; i += 4)
+    *reinterpret_cast<u32*>(&Memory::m_pRAM[i]) = ~i;
+  reader.join();
+
+  for (u32 i = 0; i < SIZE; i += 4)
+    ASSERT_EQ(i, *reinterpret_cast<u32*>(&image[i]));
+  snapshot.reset();
+}
+
+static std::vector<u32> TakeDirtyPageAddresses()
+{
+  std::vector<u32> addresses;
+  std::vector<u8> data;
+  Memory::TakeDirtyPages(&addresses, &data);
+  EXPECT_EQ(addresses.size() * Memory::DIRTY_PAGE_SIZE, data.size());
+  std::sort(addresses.begin(), addresses.end());
+  return addresses;
+}
+
+TEST(DirtyPageTracking, TracksWrites)
+{
+  if (!Memory::IsWriteProtectionSupported())
+    return;
+
+  ScopeInit guard;
+  ASSERT_TRUE(Memory::EnableDirtyPageTracking());
+  Memory::m_pRAM[0x1000] = 1;
+  Memory::m_pRAM[0x1fff] = 1;
+  Memory::m_pEXRAM[0x2000] = 2;
+  std::thread([] { Memory::m_pRAM[0x5000] = 3; }).join();
+  EXPECT_EQ(std::vector<u32>({0x1000, 0x5000, 0x10002000}), TakeDirtyPageAddresses());
+  EXPECT_EQ(std::vector<u32>(), TakeDirtyPageAddresses());
+
+  // The pages were protected again.
+  Memory::m_pRAM[0x1000] = 4;
+  EXPECT_EQ(std::vector<u32>({0x1000}), TakeDirtyPageAddresses());
+
+  Memory::m_pRAM[0x1000] = 5;
+  Memory::ClearDirtyPages();
+  EXPECT_EQ(std::vector<u32>(), TakeDirtyPageAddresses());
+
+  Memory::DisableDirtyPageTracking();
+  Memory::m_pRAM[0x1000] = 6;
+  EXPECT_EQ(6, Memory::m_pRAM[0x1000]);
+}
+
+TEST(DirtyPageTracking, HostWrites)
+{
+  if (!Memory::IsWriteProtectionSupported())
+    return;
+
+  ScopeInit guard;
+  const std::string path = guard.GetProfilePath() + "/data.bin";
+  const std::vector<u8> contents(3 * Memory::DIRTY_PAGE_SIZE, 7);
+  ASSERT_TRUE(File::IOFile(path, "wb").WriteBytes(contents.data(), contents.size()));
+
+  // Reading a file straight into memory fails if it's write-protected.
+  ASSERT_TRUE(Memory::EnableDirtyPageTracking());
+  File::IOFile file(path, "rb");
+  u8* const buffer = &Memory::m_pRAM[0x10800];
+  Memory::PrepareHostWrite(buffer, contents.size());
+  ASSERT_TRUE(file.ReadBytes(buffer, contents.size()));
+  EXPECT_TRUE(std::equal(contents.begin(), contents.end(), buffer));
+  EXPECT_EQ(std::vector<u32>({0x10000, 0x11000, 0x12000, 0x13000}), TakeDirtyPageAddresses());
+}
+
+TEST(DirtyPageTracking, SnapshotChain)
+{
+  if (!Memory::IsWriteProtectionSupported())
+    return;
+
+  ScopeInit guard;
+  ASSERT_TRUE(Memory::EnableDirtyPageTracking());
+  Memory::m_pRAM[0x1000] = 1;
+  Memory::m_pEXRAM[0x3000] = 1;
+
+  struct Snapshot
+  {
+    std::vector<u32> addresses;
+    std::vector<u8> data;
+  };
+  Snapshot keyframe, first, second;
+  Memory::TakeDirtyPages(&keyframe.addresses, &keyframe.data, true);
+  Memory::m_pRAM[0x1000] = 2;
+  Memory::m_pRAM[0x2000] = 2;
+  Memory::TakeDirtyPages(&first.addresses, &first.data);
+  Memory::m_pRAM[0x2000] = 3;
+  Memory::m_pEXRAM[0x3000] = 3;
+  Memory::TakeDirtyPages(&second.addresses, &second.data);
+  EXPECT_EQ(2u, first.addresses.size());
+  EXPECT_EQ(2u, second.addresses.size());
+
+  Memory::m_pRAM[0x1000] = 4;
+  Memory::m_pRAM[0x2000] = 4;
+  Memory::m_pEXRAM[0x3000] = 4;
+  for (const Snapshot* snapshot : {&keyframe, &first})
+    Memory::RestorePages(snapshot->addresses, snapshot->data);
+  EXPECT_EQ(2, Memory::m_pRAM[0x1000]);
+  EXPECT_EQ(2, Memory::m_pRAM[0x2000]);
+  EXPECT_EQ(1, Memory::m_pEXRAM[0x3000]);
+
+  for (const Snapshot* snapshot : {&keyframe, &first, &second})
+    Memory::RestorePages(snapshot->addresses, snapshot->data);
+  EXPECT_EQ(2, Memory::m_pRAM[0x1000]);
+  EXPECT_EQ(3, Memory::m_pRAM[0x2000]);
+  EXPECT_EQ(3, Memory::m_pEXRAM[0x3000]);
+}
@@ -0,0 +1,230 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/JitInterface.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "UICommon/UICommon.h"
+
+namespace
+{
+constexpr u32 CODE_ADDRESS = 0x3000;
+constexpr u32 DATA_ADDRESS = 0x100;
+constexpr u32 DATA_VALUE = 0x12345678;
+
+// Covers the instructions the cached interpreter decodes at compile time, on their own and in
+// every fused pair: compares with each kind of operand, taken and not taken branches on several
+// CR fields, and an addi which depends on the lwz before it.
+const std::vector<u32> s_compare_program = {
+    0x3860FFFB,  // li r3, -5
+    0x38800003,  // li r4, 3
+    0x39400000,  // li r10, 0
+    0x7C832000,  // cmpw cr1, r3, r4
+    0x40840008,  // bge cr1, +8
+    0x614A0001,  // ori r10, r10, 1
+    0x7D032040,  // cmplw cr2, r3, r4
+    0x40890008,  // ble cr2, +8
+    0x614A0002,  // ori r10, r10, 2
+    0x28040003,  // cmplwi r4, 3
+    0x40820008,  // bne +8
+    0x614A0004,  // ori r10, r10, 4
+    0x2F83FFFB,  // cmpwi cr7, r3, -5
+    0x419E0008,  // beq cr7, +8
+    0x614A0008,  // ori r10, r10, 8
+    0x7D841800,  // cmpw cr3, r4, r3
+    0x7DC00026,  // mfcr r14
+    0x81600100,  // lwz r11, 0x100(r0)
+    0x398B0001,  // addi r12, r11, 1
+    0x556D403E,  // rlwinm r13, r11, 8, 0, 31
+    0x55AD463E,  // rlwinm r13, r13, 8, 24, 31
+    0x48000000,  // b .
+};
+
+// A loop of the instructions which are most common in game code.
+const std::vector<u32> s_loop_program = {
+    0x38A00000,  // li r5, 0
+    0x80600100,  // lwz r3, 0x100(r0)
+    0x38630005,  // addi r3, r3, 5
+    0x54662036,  // rlwinm r6, r3, 4, 0, 27
+    0x54C7E43E,  // rlwinm r7, r6, 28, 16, 31
+    0x38A50001,  // addi r5, r5, 1
+    0x2C050FFF,  // cmpwi r5, 0xFFF
+    0x4180FFE8,  // blt -24
+    0x48000000,  // b .
+};
+
+struct CPUState
+{
+  std::array<u32, 32> gpr;
+  u32 cr;
+  u32 pc;
+};
+
+class InterpreterTest : public testing::Test
+{
+protected:
+  void TearDown() override { ShutdownCore(); }
+
+  void InitCore(PowerPC::CPUCore core)
+  {
+    ShutdownCore();
+    m_profile_path = File::CreateTempDir();
+    Core::DeclareAsCPUThread();
+    UICommon::SetUserDirectory(m_profile_path);
+    Config::Init();
+    SConfig::Init();
+    Memory::Init();
+    PowerPC::Init(core);
+    CoreTiming::Init();
+    MSR = 0;
+    m_initialized = true;
+  }
+
+  void ShutdownCore()
+  {
+    if (!m_initialized)
+      return;
+    CoreTiming::Shutdown();
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    SConfig::Shutdown();
+    Config::Shutdown();
+    Core::UndeclareAsCPUThread();
+    File::DeleteDirRecursively(m_profile_path);
+    m_initialized = false;
+  }
+
+  static void LoadProgram(const std::vector<u32>& program)
+  {
+    for (size_t i = 0; i < program.size(); i++)
+      Memory::Write_U32(program[i], CODE_ADDRESS + static_cast<u32>(i * 4));
+    Memory::Write_U32(DATA_VALUE, DATA_ADDRESS);
+  }
+
+  // Runs the program until it reaches its final b . instruction.
+  static CPUState RunProgram(const std::vector<u32>& program)
+  {
+    const u32 end_address = CODE_ADDRESS + static_cast<u32>((program.size() - 1) * 4);
+    PC = CODE_ADDRESS;
+    for (int steps = 0; PC != end_address && steps < 1000000; steps++)
+    {
+      PowerPC::ppcState.downcount = 1000000;
+      PowerPC::SingleStep();
+    }
+    EXPECT_EQ(end_address, PC);
+
+    CPUState state;
+    std::copy(std::begin(PowerPC::ppcState.gpr), std::end(PowerPC::ppcState.gpr),
+              state.gpr.begin());
+    state.cr = GetCR();
+    state.pc = PC;
+    return state;
+  }
+
+  CPUState RunOnCore(PowerPC::CPUCore core, const std::vector<u32>& program)
+  {
+    InitCore(core);
+    LoadProgram(program);
+    return RunProgram(program);
+  }
+
+  static void ExpectSameState(const CPUState& expected, const CPUState& actual)
+  {
+    for (size_t i = 0; i < expected.gpr.size(); i++)
+      EXPECT_EQ(expected.gpr[i], actual.gpr[i]) << "r" << i;
+    EXPECT_EQ(expected.cr, actual.cr);
+    EXPECT_EQ(expected.pc, actual.pc);
+  }
+
+  std::string m_profile_path;
+  bool m_initialized = false;
+};
+}  // namespace
+
+TEST_F(InterpreterTest, CachedInterpreterMatchesInterpreter)
+{
+  for (const std::vector<u32>* program : {&s_compare_program, &s_loop_program})
+  {
+    const CPUState expected = RunOnCore(PowerPC::CORE_INTERPRETER, *program);
+    const CPUState actual = RunOnCore(PowerPC::CORE_CACHEDINTERPRETER, *program);
+    ExpectSameState(expected, actual);
+  }
+}
+
+TEST_F(InterpreterTest, CachedInterpreterCompareAndBranch)
+{
+  const CPUState state = RunOnCore(PowerPC::CORE_CACHEDINTERPRETER, s_compare_program);
+
+  // Only the beq is taken.
+  EXPECT_EQ(7u, state.gpr[10]);
+  // cr3 of the cmpw 3, -5: GT.
+  EXPECT_EQ(0x4u, (state.gpr[14] >> 16) & 0xF);
+  EXPECT_EQ(DATA_VALUE + 1, state.gpr[12]);
+  EXPECT_EQ(0x34u, state.gpr[13]);
+}
+
+TEST_F(InterpreterTest, CachedInterpreterRecompilesModifiedCode)
+{
+  RunOnCore(PowerPC::CORE_CACHEDINTERPRETER, s_compare_program);
+
+  // addi r12, r11, 2
+  Memory::Write_U32(0x398B0002, CODE_ADDRESS + 18 * 4);
+  JitInterface::InvalidateICache(CODE_ADDRESS + 18 * 4, 4, true);
+  EXPECT_EQ(DATA_VALUE + 2, RunProgram(s_compare_program).gpr[12]);
+}
+
+TEST_F(InterpreterTest, InterpreterRunsModifiedCode)
+{
+  // With the instruction cache disabled, code is fetched straight from memory.
+  RunOnCore(PowerPC::CORE_INTERPRETER, s_compare_program);
+
+  // addi r12, r11, 2
+  Memory::Write_U32(0x398B0002, CODE_ADDRESS + 18 * 4);
+  EXPECT_EQ(DATA_VALUE + 2, RunProgram(s_compare_program).gpr[12]);
+}
+
+TEST_F(InterpreterTest, InterpreterRunsCachedCodeUntilIcbi)
+{
+  InitCore(PowerPC::CORE_INTERPRETER);
+  HID0.ICE = 1;
+  LoadProgram(s_compare_program);
+  EXPECT_EQ(DATA_VALUE + 1, RunProgram(s_compare_program).gpr[12]);
+
+  // The emulated instruction cache still has the old instruction.
+  Memory::Write_U32(0x398B0002, CODE_ADDRESS + 18 * 4);
+  EXPECT_EQ(DATA_VALUE + 1, RunProgram(s_compare_program).gpr[12]);
+
+  // What icbi does.
+  PowerPC::ppcState.iCache.Invalidate(CODE_ADDRESS + 18 * 4);
+  EXPECT_EQ(DATA_VALUE + 2, RunProgram(s_compare_program).gpr[12]);
+}
+
+TEST_F(InterpreterTest, InterpreterSpeed)
+{
+  InitCore(PowerPC::CORE_INTERPRETER);
+  LoadProgram(s_loop_program);
+  for (int i = 0; i < 50; i++)
+    RunProgram(s_loop_program);
+}
+
+TEST_F(InterpreterTest, CachedInterpreterSpeed)
+{
+  InitCore(PowerPC::CORE_CACHEDINTERPRETER);
+  LoadProgram(s_loop_program);
+  for (int i = 0; i < 50; i++)
+    RunProgram(s_loop_program);
+}
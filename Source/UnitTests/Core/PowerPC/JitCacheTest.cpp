@@ -0,0 +1,381 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/JitCommon/JitBase.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/JitCommon/JitHotBlockProfile.h"
+
+// include order is important
+#include <gtest/gtest.h>  // NOLINT
+
+namespace
+{
+class FakeBlockCache final : public JitBaseBlockCache
+{
+public:
+  explicit FakeBlockCache(JitBase& jit) : JitBaseBlockCache(jit) {}
+
+  std::vector<std::pair<u32, const JitBlock*>> links;
+  u32 destroyed = 0;
+
+private:
+  void WriteLinkBlock(const JitBlock::LinkData& source, const JitBlock* dest) override
+  {
+    links.emplace_back(source.exitAddress, dest);
+  }
+  void WriteDestroyBlock(const JitBlock& block) override { destroyed++; }
+};
+
+class FakeJit final : public JitBase
+{
+public:
+  FakeJit() : m_block_cache(*this) {}
+
+  // CPUCoreBase methods
+  void Init() override {}
+  void Shutdown() override {}
+  void ClearCache() override {}
+  void Run() override {}
+  void SingleStep() override {}
+  const char* GetName() override { return nullptr; }
+  // JitBase methods
+  JitBaseBlockCache* GetBlockCache() override { return &m_block_cache; }
+  void Jit(u32 em_address) override {}
+  const CommonAsmRoutinesBase* GetAsmRoutines() override { return nullptr; }
+  bool HandleFault(uintptr_t access_address, SContext* ctx) override { return false; }
+
+  FakeBlockCache m_block_cache;
+};
+
+static u8 s_fake_code[16];
+
+// Creates a block covering num_instructions instructions starting at address, optionally
+// with a single exit to exit_address.
+JitBlock* AddBlock(FakeBlockCache& cache, u32 address, u32 num_instructions, u32 exit_address = 0)
+{
+  JitBlock* block = cache.AllocateBlock(address);
+  block->checkedEntry = s_fake_code;
+  block->normalEntry = s_fake_code;
+  block->codeSize = sizeof(s_fake_code);
+  block->originalSize = num_instructions;
+  if (exit_address)
+    block->linkData.push_back({s_fake_code, exit_address, false, false});
+
+  std::set<u32> physical_addresses;
+  for (u32 i = 0; i < num_instructions; i++)
+    physical_addresses.insert(address + i * 4);
+  cache.FinalizeBlock(*block, true, physical_addresses);
+  return block;
+}
+
+size_t CountBlocks(FakeBlockCache& cache)
+{
+  size_t count = 0;
+  cache.RunOnBlocks([&count](const JitBlock&) { count++; });
+  return count;
+}
+}  // Anonymous namespace
+
+TEST(JitCache, LookupAndInvalidate)
+{
+  FakeJit jit;
+  FakeBlockCache& cache = jit.m_block_cache;
+  cache.Clear();
+
+  JitBlock* a = AddBlock(cache, 0x1000, 8);
+  // Spans a page boundary.
+  JitBlock* b = AddBlock(cache, 0x1FF0, 16);
+  JitBlock* c = AddBlock(cache, 0x3000, 4);
+
+  EXPECT_EQ(a, cache.GetBlockFromStartAddress(0x1000, 0));
+  EXPECT_EQ(b, cache.GetBlockFromStartAddress(0x1FF0, 0));
+  EXPECT_EQ(c, cache.GetBlockFromStartAddress(0x3000, 0));
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x1004, 0));
+  EXPECT_EQ(3u, CountBlocks(cache));
+
+  // Doesn't overlap anything.
+  cache.InvalidateICache(0x1020, 0x20, true);
+  EXPECT_EQ(3u, CountBlocks(cache));
+  EXPECT_EQ(0u, cache.destroyed);
+
+  // Only touches the second page of the straddling block.
+  cache.InvalidateICache(0x2020, 0x20, true);
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x1FF0, 0));
+  EXPECT_EQ(a, cache.GetBlockFromStartAddress(0x1000, 0));
+  EXPECT_EQ(2u, CountBlocks(cache));
+
+  cache.ErasePhysicalRange(0, 0x10000);
+  EXPECT_EQ(0u, CountBlocks(cache));
+  EXPECT_EQ(3u, cache.destroyed);
+}
+
+TEST(JitCache, HostAddressLookup)
+{
+  FakeJit jit;
+  FakeBlockCache& cache = jit.m_block_cache;
+  cache.Clear();
+
+  static u8 code[64];
+  JitBlock* blocks[2];
+  for (u32 i = 0; i < 2; i++)
+  {
+    blocks[i] = cache.AllocateBlock(0x1000 + i * 0x100);
+    blocks[i]->checkedEntry = code + i * 32;
+    blocks[i]->normalEntry = code + i * 32;
+    blocks[i]->codeSize = 32;
+    blocks[i]->originalSize = 1;
+    cache.FinalizeBlock(*blocks[i], false, {0x1000 + i * 0x100});
+  }
+
+  // Blocks compiled before the first lookup are found too.
+  EXPECT_EQ(blocks[0], cache.GetBlockFromHostAddress(code + 5));
+  EXPECT_EQ(blocks[1], cache.GetBlockFromHostAddress(code + 32));
+  EXPECT_EQ(nullptr, cache.GetBlockFromHostAddress(code + 64));
+
+  cache.InvalidateICache(0x1000, 4, true);
+  EXPECT_EQ(nullptr, cache.GetBlockFromHostAddress(code + 5));
+  EXPECT_EQ(blocks[1], cache.GetBlockFromHostAddress(code + 40));
+
+  // Without the profiler, compiling a block drops the map, and the next lookup rebuilds it.
+  JitBlock* block = AddBlock(cache, 0x3000, 4);
+  EXPECT_EQ(block, cache.GetBlockFromHostAddress(s_fake_code));
+  EXPECT_EQ(blocks[1], cache.GetBlockFromHostAddress(code + 40));
+}
+
+TEST(JitCache, LinkAndUnlink)
+{
+  FakeJit jit;
+  FakeBlockCache& cache = jit.m_block_cache;
+  cache.Clear();
+
+  JitBlock* a = AddBlock(cache, 0x1000, 4, 0x2000);
+  EXPECT_FALSE(a->linkData[0].linkStatus);
+
+  cache.links.clear();
+  JitBlock* b = AddBlock(cache, 0x2000, 4, 0x1000);
+  EXPECT_TRUE(a->linkData[0].linkStatus);
+  EXPECT_TRUE(b->linkData[0].linkStatus);
+  ASSERT_EQ(2u, cache.links.size());
+
+  // Destroying b must unlink the exit of a which points to it.
+  cache.links.clear();
+  cache.InvalidateICache(0x2000, 0x20, true);
+  EXPECT_FALSE(a->linkData[0].linkStatus);
+  bool unlinked_a = false;
+  for (const auto& link : cache.links)
+    unlinked_a |= link.first == 0x2000 && link.second == nullptr;
+  EXPECT_TRUE(unlinked_a);
+
+  // A new block at the same address gets linked again.
+  b = AddBlock(cache, 0x2000, 4);
+  EXPECT_TRUE(a->linkData[0].linkStatus);
+}
+
+TEST(JitCache, ReplaceBlock)
+{
+  FakeJit jit;
+  FakeBlockCache& cache = jit.m_block_cache;
+  cache.Clear();
+
+  JitBlock* a = AddBlock(cache, 0x1000, 4, 0x2000);
+  JitBlock* b = AddBlock(cache, 0x2000, 4);
+  // Shares its instructions with b, so must survive b being replaced.
+  JitBlock* c = AddBlock(cache, 0x2004, 3);
+  EXPECT_TRUE(a->linkData[0].linkStatus);
+
+  cache.EraseBlock(*b);
+  EXPECT_EQ(1u, cache.destroyed);
+  EXPECT_FALSE(a->linkData[0].linkStatus);
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x2000, 0));
+  EXPECT_EQ(c, cache.GetBlockFromStartAddress(0x2004, 0));
+
+  // The replacement gets linked to again, and invalidation still finds it.
+  JitBlock* replacement = AddBlock(cache, 0x2000, 8);
+  EXPECT_TRUE(a->linkData[0].linkStatus);
+  EXPECT_EQ(replacement, cache.GetBlockFromStartAddress(0x2000, 0));
+  cache.InvalidateICache(0x2010, 4, true);
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x2000, 0));
+  EXPECT_EQ(2u, CountBlocks(cache));
+}
+
+TEST(JitCache, RetargetExit)
+{
+  FakeJit jit;
+  FakeBlockCache& cache = jit.m_block_cache;
+  cache.Clear();
+
+  static u8 s_indirect_exit[5];
+  JitBlock* site = AddBlock(cache, 0x1000, 4);
+  JitBlock* a = AddBlock(cache, 0x2000, 4);
+
+  // The exit isn't part of the block yet, and gets linked to the existing target right away.
+  cache.links.clear();
+  cache.RetargetExit(*site, s_indirect_exit, false, 0x2000);
+  ASSERT_EQ(1u, site->linkData.size());
+  EXPECT_TRUE(site->linkData[0].linkStatus);
+  ASSERT_EQ(1u, cache.links.size());
+  EXPECT_EQ(a, cache.links[0].second);
+
+  // Pointing it somewhere without a block unlinks it, and a block compiled there later gets it.
+  cache.links.clear();
+  cache.RetargetExit(*site, s_indirect_exit, false, 0x3000);
+  ASSERT_EQ(1u, site->linkData.size());
+  EXPECT_FALSE(site->linkData[0].linkStatus);
+  AddBlock(cache, 0x3000, 4);
+  EXPECT_TRUE(site->linkData[0].linkStatus);
+
+  // Invalidating the old target no longer touches the exit; invalidating the new one does.
+  cache.links.clear();
+  cache.InvalidateICache(0x2000, 0x20, true);
+  EXPECT_TRUE(site->linkData[0].linkStatus);
+  cache.InvalidateICache(0x3000, 0x20, true);
+  EXPECT_FALSE(site->linkData[0].linkStatus);
+}
+
+TEST(JitCache, EraseBlocksInCodeRange)
+{
+  FakeJit jit;
+  FakeBlockCache& cache = jit.m_block_cache;
+  cache.Clear();
+
+  // Each block's code goes into its own region of a fake code space.
+  static u8 s_code_space[3][16];
+  JitBlock* a = AddBlock(cache, 0x1000, 4, 0x2000);
+  JitBlock* b = AddBlock(cache, 0x2000, 4, 0x3000);
+  JitBlock* c = AddBlock(cache, 0x3000, 4, 0x1000);
+  a->checkedEntry = s_code_space[0];
+  b->checkedEntry = s_code_space[1];
+  c->checkedEntry = s_code_space[2];
+  EXPECT_TRUE(a->linkData[0].linkStatus);
+  EXPECT_TRUE(c->linkData[0].linkStatus);
+
+  EXPECT_EQ(0u, cache.EraseBlocksInCodeRange(s_code_space[0] + 1, s_code_space[1]));
+  EXPECT_EQ(1u, cache.EraseBlocksInCodeRange(s_code_space[1], s_code_space[2]));
+  EXPECT_EQ(1u, cache.destroyed);
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x2000, 0));
+  EXPECT_EQ(2u, CountBlocks(cache));
+
+  // The block jumping into the evicted code must not do so anymore, and links to the new block
+  // once the address is compiled again.
+  EXPECT_FALSE(a->linkData[0].linkStatus);
+  EXPECT_TRUE(c->linkData[0].linkStatus);
+  AddBlock(cache, 0x2000, 4);
+  EXPECT_TRUE(a->linkData[0].linkStatus);
+
+  // Invalidation still finds the blocks which were kept.
+  cache.InvalidateICache(0x1000, 0x20, true);
+  EXPECT_EQ(nullptr, cache.GetBlockFromStartAddress(0x1000, 0));
+  EXPECT_FALSE(c->linkData[0].linkStatus);
+}
+
+TEST(JitCache, HotBlockProfile)
+{
+  // The profile hashes the code in physical RAM.
+  std::unique_ptr<u8[]> ram(new u8[Memory::REALRAM_SIZE]());
+  Memory::m_pRAM = ram.get();
+  const std::string directory = File::CreateTempDir();
+  const std::string filename = directory + DIR_SEP "profile.bin";
+
+  {
+    FakeJit jit;
+    FakeBlockCache& cache = jit.m_block_cache;
+    cache.Clear();
+    JitHotBlockProfile& profile = jit.GetHotBlockProfile();
+    profile.Load(filename);
+    EXPECT_FALSE(profile.HasPendingEntries());
+
+    // The second block gets evicted before the cache is recorded.
+    ram[0x1000] = 0x48;
+    AddBlock(cache, 0x1000, 8);
+    JitBlock* evicted = AddBlock(cache, 0x2000, 4);
+    profile.RecordBlock(*evicted);
+    cache.EraseBlock(*evicted);
+    profile.RecordBlocks(cache);
+    profile.Save();
+  }
+
+  {
+    FakeJit jit;
+    JitHotBlockProfile& profile = jit.GetHotBlockProfile();
+    profile.Load(filename);
+    ASSERT_TRUE(profile.HasPendingEntries());
+
+    // The code of the second block changed, so only the first one is ready.
+    ram[0x2004] = 0x60;
+    std::vector<JitHotBlockProfile::Entry> entries = profile.TakeLoadedEntries(0);
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ(0x1000u, entries[0].effective_address);
+    EXPECT_EQ(1u, entries[0].physical_runs.size());
+    EXPECT_EQ(8u, entries[0].physical_runs[0].second);
+
+    // Once the original code is back, the second block becomes ready on the next scan.
+    ram[0x2004] = 0;
+    for (u32 i = 1; i < JitHotBlockProfile::SCAN_INTERVAL; i++)
+      EXPECT_TRUE(profile.TakeLoadedEntries(0).empty());
+    entries = profile.TakeLoadedEntries(0);
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ(0x2000u, entries[0].effective_address);
+    EXPECT_FALSE(profile.HasPendingEntries());
+  }
+
+  {
+    FakeJit jit;
+    JitHotBlockProfile& profile = jit.GetHotBlockProfile();
+    profile.Load(filename);
+
+    // Entries whose code doesn't show up are given up on.
+    ram[0x1000] = 0;
+    ram[0x2004] = 0x60;
+    for (u32 i = 1; i < JitHotBlockProfile::MAX_FAILED_SCANS * JitHotBlockProfile::SCAN_INTERVAL;
+         i++)
+    {
+      EXPECT_TRUE(profile.TakeLoadedEntries(0).empty());
+    }
+    EXPECT_TRUE(profile.HasPendingEntries());
+    EXPECT_TRUE(profile.TakeLoadedEntries(0).empty());
+    EXPECT_FALSE(profile.HasPendingEntries());
+  }
+
+  Memory::m_pRAM = nullptr;
+  File::DeleteDirRecursively(directory);
+}
+
+TEST(JitCache, ManyBlocksSpeed)
+{
+  constexpr u32 NUM_BLOCKS = 0x4000;
+  constexpr u32 BLOCK_INSTRUCTIONS = 12;
+  constexpr u32 BLOCK_STRIDE = BLOCK_INSTRUCTIONS * 4;
+  constexpr u32 BASE = 0x00100000;
+
+  FakeJit jit;
+  FakeBlockCache& cache = jit.m_block_cache;
+  cache.Clear();
+
+  // Every block links to the next one, which exercises the link-target index on each
+  // finalization.
+  for (u32 i = 0; i < NUM_BLOCKS; i++)
+    AddBlock(cache, BASE + i * BLOCK_STRIDE, BLOCK_INSTRUCTIONS, BASE + (i + 1) * BLOCK_STRIDE);
+
+  u32 found = 0;
+  for (u32 round = 0; round < 16; round++)
+  {
+    for (u32 i = 0; i < NUM_BLOCKS; i++)
+      found += cache.GetBlockFromStartAddress(BASE + i * BLOCK_STRIDE, 0) != nullptr;
+  }
+  EXPECT_EQ(NUM_BLOCKS * 16, found);
+
+  // Invalidate every block one cache line at a time, as dcbi/icbi would.
+  for (u32 i = 0; i < NUM_BLOCKS; i++)
+    cache.InvalidateICache(BASE + i * BLOCK_STRIDE, 32, true);
+  EXPECT_EQ(0u, CountBlocks(cache));
+}
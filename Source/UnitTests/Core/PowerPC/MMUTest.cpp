@@ -0,0 +1,131 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/FileUtil.h"
+#include "Common/Swap.h"
+#include "Core/ConfigManager.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "UICommon/UICommon.h"
+
+namespace
+{
+// A 64 KiB page table.
+constexpr u32 PAGE_TABLE_ADDRESS = 0x00100000;
+constexpr u32 VSID = 0x123;
+constexpr u32 SEGMENT = 4;
+constexpr u32 EFFECTIVE_ADDRESS = 0x40001000;
+constexpr u32 PHYSICAL_ADDRESS = 0x00200000;
+constexpr u32 OTHER_PHYSICAL_ADDRESS = 0x00300000;
+
+class MMUTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_profile_path = File::CreateTempDir();
+    Core::DeclareAsCPUThread();
+    UICommon::SetUserDirectory(m_profile_path);
+    Config::Init();
+    SConfig::Init();
+    SConfig::GetInstance().bMMU = true;
+    Memory::Init();
+    PowerPC::Init(PowerPC::CORE_INTERPRETER);
+    CoreTiming::Init();
+    MSR = 0;
+
+    PowerPC::ppcState.spr[SPR_SDR] = PAGE_TABLE_ADDRESS;
+    PowerPC::SDRUpdated();
+    MapPage(PHYSICAL_ADDRESS);
+    Memory::Write_U32(0xDEADBEEF, PHYSICAL_ADDRESS + 0x10);
+    Memory::Write_U32(0xCAFEF00D, OTHER_PHYSICAL_ADDRESS + 0x10);
+    PowerPC::ppcState.sr[SEGMENT] = VSID;
+    PowerPC::SRUpdated();
+  }
+  void TearDown() override
+  {
+    CoreTiming::Shutdown();
+    PowerPC::Shutdown();
+    Memory::Shutdown();
+    SConfig::Shutdown();
+    Config::Shutdown();
+    Core::UndeclareAsCPUThread();
+    File::DeleteDirRecursively(m_profile_path);
+  }
+
+  // Writes a referenced and changed read/write PTE for EFFECTIVE_ADDRESS to its primary PTEG.
+  static void MapPage(u32 physical_address)
+  {
+    const u32 page_index = (EFFECTIVE_ADDRESS >> 12) & 0xffff;
+    const u32 pte_address = PAGE_TABLE_ADDRESS + ((VSID ^ page_index) & 0x3ff) * 64;
+    Memory::Write_U32(0x80000000 | (VSID << 7) | ((EFFECTIVE_ADDRESS >> 22) & 0x3f),
+                      pte_address);
+    Memory::Write_U32(physical_address | 0x180 | 2, pte_address + 4);
+  }
+
+  // Reads through the fastmem mapping, like JIT code does.
+  static u32 ReadFastmem(u32 address)
+  {
+    u32 value;
+    std::memcpy(&value, Memory::logical_base + address, sizeof(value));
+    return Common::swap32(value);
+  }
+
+  std::string m_profile_path;
+};
+}  // namespace
+
+TEST_F(MMUTest, SoftwareTLB)
+{
+  MSR = 0x10;  // DR
+  const u64 walks = PowerPC::GetMMUStats().page_walks;
+  EXPECT_EQ(0xDEADBEEFu, PowerPC::Read_U32(EFFECTIVE_ADDRESS + 0x10));
+  EXPECT_EQ(0xDEADBEEFu, PowerPC::Read_U32(EFFECTIVE_ADDRESS + 0x10));
+  PowerPC::Write_U32(0x11223344, EFFECTIVE_ADDRESS + 0x20);
+  EXPECT_EQ(0x11223344u, Memory::Read_U32(PHYSICAL_ADDRESS + 0x20));
+  EXPECT_EQ(walks + 1, PowerPC::GetMMUStats().page_walks);
+
+  // Like on hardware, a changed PTE is only picked up after tlbie.
+  MapPage(OTHER_PHYSICAL_ADDRESS);
+  EXPECT_EQ(0xDEADBEEFu, PowerPC::Read_U32(EFFECTIVE_ADDRESS + 0x10));
+  PowerPC::InvalidateTLBEntry(EFFECTIVE_ADDRESS);
+  EXPECT_EQ(0xCAFEF00Du, PowerPC::Read_U32(EFFECTIVE_ADDRESS + 0x10));
+  EXPECT_EQ(walks + 2, PowerPC::GetMMUStats().page_walks);
+}
+
+TEST_F(MMUTest, FastmemPageTableIsMappedLazily)
+{
+  const u64 rebuilds = PowerPC::GetMMUStats().fastmem_rebuilds;
+
+  // Games write all segment registers in a row, which mustn't rescan the page table each time.
+  for (u32 i = 0; i < 16; i++)
+    PowerPC::SRUpdated();
+  EXPECT_EQ(rebuilds, PowerPC::GetMMUStats().fastmem_rebuilds);
+
+  EXPECT_TRUE(PowerPC::UpdateFastmemPageTable());
+  EXPECT_FALSE(PowerPC::UpdateFastmemPageTable());
+  EXPECT_EQ(rebuilds + 1, PowerPC::GetMMUStats().fastmem_rebuilds);
+  EXPECT_EQ(0xDEADBEEFu, ReadFastmem(EFFECTIVE_ADDRESS + 0x10));
+}
+
+TEST_F(MMUTest, FastmemPageIsUnmappedByTlbie)
+{
+  ASSERT_TRUE(PowerPC::UpdateFastmemPageTable());
+  MapPage(OTHER_PHYSICAL_ADDRESS);
+  PowerPC::InvalidateTLBEntry(EFFECTIVE_ADDRESS);
+
+  // The page walk maps the new translation again.
+  MSR = 0x10;  // DR
+  EXPECT_EQ(0xCAFEF00Du, PowerPC::Read_U32(EFFECTIVE_ADDRESS + 0x10));
+  EXPECT_EQ(0xCAFEF00Du, ReadFastmem(EFFECTIVE_ADDRESS + 0x10));
+}
@@ -0,0 +1,114 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+#include "Core/PowerPC/Interpreter/Interpreter.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+#include "Core/PowerPC/PowerPC.h"
+#include "UICommon/UICommon.h"
+
+namespace
+{
+constexpr u32 BLOCK_ADDRESS = 0x1000;
+constexpr u32 TARGET_ADDRESS = 0x2000;
+
+constexpr u32 ADDIC_R3 = 0x30630001;  // addic r3, r3, 1
+constexpr u32 ADDIC_R4 = 0x30840001;  // addic r4, r4, 1
+constexpr u32 ADDE_R5 = 0x7CA52914;   // adde r5, r5, r5
+constexpr u32 NOP = 0x60000000;       // ori r0, r0, 0
+constexpr u32 BLR = 0x4E800020;
+
+// b from BLOCK_ADDRESS + 4 to TARGET_ADDRESS.
+constexpr u32 B_TO_TARGET = 0x48000000 | (TARGET_ADDRESS - (BLOCK_ADDRESS + 4));
+
+class PPCAnalystTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_profile_path = File::CreateTempDir();
+    UICommon::SetUserDirectory(m_profile_path);
+    Config::Init();
+    SConfig::Init();
+    Memory::Init();
+    Interpreter::getInstance()->Init();
+    PowerPC::ppcState.msr = 0;
+
+    m_block.m_stats = &m_stats;
+    m_block.m_gpa = &m_gpa;
+    m_block.m_fpa = &m_fpa;
+    m_analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_HOST_READS);
+    m_analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_CROSS_BRANCH_LIVENESS);
+
+    // A block which sets the carry flag and jumps to TARGET_ADDRESS.
+    Memory::Write_U32(ADDIC_R3, BLOCK_ADDRESS);
+    Memory::Write_U32(B_TO_TARGET, BLOCK_ADDRESS + 4);
+  }
+  void TearDown() override
+  {
+    Interpreter::getInstance()->Shutdown();
+    Memory::Shutdown();
+    SConfig::Shutdown();
+    Config::Shutdown();
+    File::DeleteDirRecursively(m_profile_path);
+  }
+
+  // Returns whether the carry flag set by the addic has to be stored to XER.
+  bool AnalyzeCarryWanted()
+  {
+    m_analyzer.Analyze(BLOCK_ADDRESS, &m_block, &m_buffer, m_buffer.GetSize());
+    EXPECT_EQ(2u, m_block.m_num_instructions);
+    return m_buffer.codebuffer[0].wantsCA;
+  }
+
+  std::string m_profile_path;
+  PPCAnalyst::PPCAnalyzer m_analyzer;
+  PPCAnalyst::CodeBlock m_block;
+  PPCAnalyst::CodeBuffer m_buffer{32};
+  PPCAnalyst::BlockStats m_stats;
+  PPCAnalyst::BlockRegStats m_gpa;
+  PPCAnalyst::BlockRegStats m_fpa;
+};
+}  // namespace
+
+TEST_F(PPCAnalystTest, CarryOverwrittenAtTarget)
+{
+  Memory::Write_U32(NOP, TARGET_ADDRESS);
+  Memory::Write_U32(ADDIC_R4, TARGET_ADDRESS + 4);
+  EXPECT_FALSE(AnalyzeCarryWanted());
+
+  // The block now depends on the code at the target.
+  EXPECT_EQ(1u, m_block.m_physical_addresses.count(TARGET_ADDRESS));
+  EXPECT_EQ(1u, m_block.m_physical_addresses.count(TARGET_ADDRESS + 4));
+}
+
+TEST_F(PPCAnalystTest, CarryReadAtTarget)
+{
+  Memory::Write_U32(ADDE_R5, TARGET_ADDRESS);
+  EXPECT_TRUE(AnalyzeCarryWanted());
+  EXPECT_EQ(0u, m_block.m_physical_addresses.count(TARGET_ADDRESS));
+}
+
+TEST_F(PPCAnalystTest, CarryLiveAtEndOfTargetBlock)
+{
+  // Nothing is known about the code after another branch.
+  Memory::Write_U32(NOP, TARGET_ADDRESS);
+  Memory::Write_U32(BLR, TARGET_ADDRESS + 4);
+  EXPECT_TRUE(AnalyzeCarryWanted());
+}
+
+TEST_F(PPCAnalystTest, CarryLiveWithoutCrossBranchLiveness)
+{
+  Memory::Write_U32(ADDIC_R4, TARGET_ADDRESS);
+  m_analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_CROSS_BRANCH_LIVENESS);
+  EXPECT_TRUE(AnalyzeCarryWanted());
+}
@@ -0,0 +1,132 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/CommonTypes.h"
+#include "Core/HW/Memmap.h"
+#include "Core/Rewind.h"
+#include "Core/State.h"
+
+namespace
+{
+using PageMap = std::map<u32, std::vector<u8>>;
+
+struct Frame
+{
+  std::vector<u8> state;
+  // The pages written since the frame before.
+  PageMap pages;
+};
+
+State::Snapshot MakeSnapshot(const Frame& frame)
+{
+  State::Snapshot snapshot;
+  snapshot.state = frame.state;
+  for (const auto& page : frame.pages)
+  {
+    snapshot.page_addresses.push_back(page.first);
+    snapshot.page_data.insert(snapshot.page_data.end(), page.second.begin(), page.second.end());
+  }
+  return snapshot;
+}
+
+PageMap GetPages(const State::Snapshot& snapshot)
+{
+  PageMap pages;
+  for (size_t i = 0; i < snapshot.page_addresses.size(); i++)
+  {
+    const auto page = snapshot.page_data.begin() + i * Memory::DIRTY_PAGE_SIZE;
+    pages[snapshot.page_addresses[i]].assign(page, page + Memory::DIRTY_PAGE_SIZE);
+  }
+  return pages;
+}
+
+// Pseudorandom contents, which don't compress.
+std::vector<u8> MakePage(u8 seed)
+{
+  std::vector<u8> page(Memory::DIRTY_PAGE_SIZE);
+  u32 x = seed;
+  for (u8& byte : page)
+  {
+    x = x * 1103515245 + 12345;
+    byte = static_cast<u8>(x >> 16);
+  }
+  return page;
+}
+}  // namespace
+
+TEST(Rewind, DecodesEveryEntryOfTheChain)
+{
+  const std::vector<Frame> frames = {
+      {{1, 2, 3}, {{0x0000, MakePage(1)}, {0x1000, MakePage(2)}}},
+      // Longer state, one changed and one new page.
+      {{4, 5, 6, 7}, {{0x1000, MakePage(3)}, {0x10000000, MakePage(4)}}},
+      // Shorter state, nothing written.
+      {{8}, {}},
+      {{9, 10}, {{0x0000, MakePage(5)}}},
+  };
+
+  Rewind::Encoder encoder;
+  std::deque<Rewind::Entry> entries;
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    entries.emplace_back();
+    ASSERT_TRUE(encoder.Encode(MakeSnapshot(frames[i]), i == 0, i * 100, &entries.back()));
+  }
+
+  PageMap memory;
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    for (const auto& page : frames[i].pages)
+      memory[page.first] = page.second;
+
+    State::Snapshot snapshot;
+    ASSERT_TRUE(Rewind::Decode(entries, i, &snapshot)) << "entry " << i;
+    EXPECT_TRUE(snapshot.keyframe);
+    EXPECT_EQ(frames[i].state, snapshot.state) << "entry " << i;
+    EXPECT_EQ(memory, GetPages(snapshot)) << "entry " << i;
+    EXPECT_EQ(i * 100, entries[i].ticks);
+  }
+}
+
+TEST(Rewind, DecodesFromTheLastKeyframe)
+{
+  Rewind::Encoder encoder;
+  std::deque<Rewind::Entry> entries(3);
+  ASSERT_TRUE(encoder.Encode(MakeSnapshot({{1}, {{0, MakePage(1)}}}), true, 0, &entries[0]));
+  ASSERT_TRUE(encoder.Encode(MakeSnapshot({{2}, {{0, MakePage(2)}}}), true, 0, &entries[1]));
+  ASSERT_TRUE(encoder.Encode(MakeSnapshot({{3}, {{0x1000, MakePage(3)}}}), false, 0, &entries[2]));
+
+  // The first entry isn't needed anymore, as it would be after trimming the ring.
+  entries.front().compressed.clear();
+  State::Snapshot snapshot;
+  ASSERT_TRUE(Rewind::Decode(entries, 2, &snapshot));
+  EXPECT_EQ(PageMap({{0, MakePage(2)}, {0x1000, MakePage(3)}}), GetPages(snapshot));
+
+  // A chain has to start with a keyframe.
+  entries.pop_front();
+  entries.pop_front();
+  EXPECT_FALSE(Rewind::Decode(entries, 0, &snapshot));
+}
+
+TEST(Rewind, DeltasOfUnchangedMemoryAreSmall)
+{
+  // Without dirty page tracking, every snapshot has all pages.
+  Frame frame;
+  frame.state.assign(1000, 1);
+  for (u32 i = 0; i < 64; i++)
+    frame.pages[i * Memory::DIRTY_PAGE_SIZE] = MakePage(static_cast<u8>(i * 7));
+
+  Rewind::Encoder encoder;
+  Rewind::Entry keyframe, delta;
+  ASSERT_TRUE(encoder.Encode(MakeSnapshot(frame), true, 0, &keyframe));
+  frame.pages[0] = MakePage(100);
+  ASSERT_TRUE(encoder.Encode(MakeSnapshot(frame), false, 0, &delta));
+  EXPECT_LT(delta.compressed.size() * 10, keyframe.compressed.size());
+}
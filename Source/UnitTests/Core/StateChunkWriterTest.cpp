@@ -0,0 +1,61 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Common/ChunkFile.h"
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "Core/StateChunkWriter.h"
+
+TEST(StateChunkWriter, BoundsPendingChunks)
+{
+  // Pseudorandom contents, which take the workers the longest to compress.
+  std::vector<u8> data(State::CHUNK_SIZE * 64 + 1234);
+  u32 x = 1;
+  for (u8& byte : data)
+  {
+    x = x * 1103515245 + 12345;
+    byte = static_cast<u8>(x >> 16);
+  }
+
+  State::StateChunkWriter writer(true);
+  ASSERT_GT(writer.GetMaxPendingChunks(), 0u);
+  PointerWrap p(&writer);
+  // Small writes, like DoState's, so that the chunks are written as fast as they can be.
+  for (size_t i = 0; i < data.size(); i += 4096)
+    p.DoArray(&data[i], static_cast<u32>(std::min<size_t>(4096, data.size() - i)));
+  p.Finish();
+  EXPECT_LE(writer.GetPeakPendingChunks(), writer.GetMaxPendingChunks());
+
+  const std::string directory = File::CreateTempDir();
+  const std::string filename = directory + DIR_SEP "state.bin";
+  {
+    File::IOFile f(filename, "wb");
+    writer.WriteTo(f);
+  }
+
+  File::IOFile f(filename, "rb");
+  State::CompressedStateHeader header;
+  ASSERT_TRUE(f.ReadArray(&header, 1));
+  EXPECT_EQ(State::COMPRESSED_STATE_MAGIC, header.magic);
+  EXPECT_EQ(State::CHUNK_SIZE, header.chunk_size);
+  EXPECT_EQ(data.size(), header.uncompressed_size);
+
+  std::vector<State::ChunkInfo> infos(65);
+  ASSERT_TRUE(f.ReadArray(infos.data(), infos.size()));
+  u64 total_size = sizeof(header) + infos.size() * sizeof(State::ChunkInfo);
+  for (const State::ChunkInfo& info : infos)
+    total_size += info.compressed_size & ~State::CHUNK_UNCOMPRESSED_FLAG;
+  EXPECT_EQ(total_size, f.GetSize());
+  f.Close();
+
+  File::DeleteDirRecursively(directory);
+}
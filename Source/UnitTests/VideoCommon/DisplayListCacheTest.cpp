@@ -0,0 +1,142 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstring>
+#include <memory>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/DataReader.h"
+#include "VideoCommon/DisplayListCache.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/VideoConfig.h"
+
+class DisplayListCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    g_ActiveConfig.bDisplayListCache = true;
+    DisplayListCache::Init();
+
+    TVtxDesc vtx_desc;
+    std::memset(&vtx_desc, 0, sizeof(vtx_desc));
+    VAT vat;
+    std::memset(&vat, 0, sizeof(vat));
+    vtx_desc.Position = DIRECT;
+    vat.g0.PosFormat = FORMAT_BYTE;
+    m_direct_loader = VertexLoaderBase::CreateVertexLoader(vtx_desc, vat);
+    vtx_desc.Position = INDEX8;
+    m_indexed_loader = VertexLoaderBase::CreateVertexLoader(vtx_desc, vat);
+
+    for (size_t i = 0; i < m_list.size(); ++i)
+      m_list[i] = static_cast<u8>(i);
+  }
+
+  void TearDown() override { DisplayListCache::Clear(); }
+
+  // Runs the draw at offset through the cache the way VertexLoaderManager does.
+  void RunDraw(VertexLoaderBase* loader, u32 offset, int count, u8* dst)
+  {
+    const u8* src = m_list.data() + offset;
+    const DisplayListCache::Draw* draw =
+        DisplayListCache::FindDraw(loader, OpcodeDecoder::GX_DRAW_POINTS, count, src);
+    m_replayed = draw != nullptr;
+    if (draw)
+    {
+      DisplayListCache::ReplayDraw(draw, DataReader(dst, dst + 256));
+      return;
+    }
+
+    loader->RunVertices(DataReader(m_list.data() + offset, m_list.data() + m_list.size()),
+                        DataReader(dst, dst + 256), count);
+    DisplayListCache::RecordDraw(loader, OpcodeDecoder::GX_DRAW_POINTS, count, src, dst);
+  }
+
+  void RunList(u8* dst)
+  {
+    DisplayListCache::BeginDisplayList(0x1000, m_list.data(), static_cast<u32>(m_list.size()));
+    RunDraw(m_direct_loader.get(), 0, 4, dst);
+    DisplayListCache::EndDisplayList();
+  }
+
+  std::unique_ptr<VertexLoaderBase> m_direct_loader;
+  std::unique_ptr<VertexLoaderBase> m_indexed_loader;
+  std::array<u8, 32> m_list;
+  bool m_replayed = false;
+};
+
+TEST_F(DisplayListCacheTest, ReplaysIdenticalList)
+{
+  std::array<u8, 256> loaded, replayed;
+  RunList(loaded.data());
+  EXPECT_FALSE(m_replayed);
+  RunList(loaded.data());
+  EXPECT_FALSE(m_replayed);
+
+  replayed.fill(0);
+  RunList(replayed.data());
+  EXPECT_TRUE(m_replayed);
+  EXPECT_EQ(0, std::memcmp(loaded.data(), replayed.data(),
+                           4 * m_direct_loader->m_native_vtx_decl.stride));
+}
+
+TEST_F(DisplayListCacheTest, ChangedContentsAreLoadedAgain)
+{
+  std::array<u8, 256> dst;
+  RunList(dst.data());
+  RunList(dst.data());
+
+  m_list[1] = 0x7f;
+  RunList(dst.data());
+  EXPECT_FALSE(m_replayed);
+  RunList(dst.data());
+  EXPECT_TRUE(m_replayed);
+}
+
+TEST_F(DisplayListCacheTest, ChangedLoaderIsLoadedAgain)
+{
+  std::array<u8, 256> dst;
+  RunList(dst.data());
+  RunList(dst.data());
+
+  DisplayListCache::BeginDisplayList(0x1000, m_list.data(), static_cast<u32>(m_list.size()));
+  TVtxDesc vtx_desc;
+  std::memset(&vtx_desc, 0, sizeof(vtx_desc));
+  VAT vat;
+  std::memset(&vat, 0, sizeof(vat));
+  vtx_desc.Position = DIRECT;
+  vat.g0.PosFormat = FORMAT_SHORT;
+  std::unique_ptr<VertexLoaderBase> other_loader =
+      VertexLoaderBase::CreateVertexLoader(vtx_desc, vat);
+  RunDraw(other_loader.get(), 0, 4, dst.data());
+  EXPECT_FALSE(m_replayed);
+  DisplayListCache::EndDisplayList();
+
+  // The list was recorded again with the new loader.
+  DisplayListCache::BeginDisplayList(0x1000, m_list.data(), static_cast<u32>(m_list.size()));
+  RunDraw(other_loader.get(), 0, 4, dst.data());
+  EXPECT_TRUE(m_replayed);
+  DisplayListCache::EndDisplayList();
+}
+
+TEST_F(DisplayListCacheTest, IndexedDrawsAreNotCached)
+{
+  std::array<u8, 256> dst;
+  for (int i = 0; i < 3; ++i)
+  {
+    DisplayListCache::BeginDisplayList(0x1000, m_list.data(), static_cast<u32>(m_list.size()));
+    RunDraw(m_direct_loader.get(), 0, 4, dst.data());
+    EXPECT_EQ(i == 2, m_replayed);
+    DisplayListCache::FindDraw(m_indexed_loader.get(), OpcodeDecoder::GX_DRAW_POINTS, 4,
+                               m_list.data() + 12);
+    RunDraw(m_direct_loader.get(), 16, 4, dst.data());
+    EXPECT_EQ(i == 2, m_replayed);
+    DisplayListCache::EndDisplayList();
+  }
+}
@@ -0,0 +1,137 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CPUDetect.h"
+#include "Common/CommonTypes.h"
+#include "VideoCommon/IndexGenerator.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/VideoConfig.h"
+
+enum class Implementation
+{
+  Scalar,
+  SSE2,
+  AVX2
+};
+
+class IndexGeneratorTest : public testing::TestWithParam<std::tuple<int, bool>>
+{
+protected:
+  void SetUp() override
+  {
+    m_saved_cpu_info = cpu_info;
+    m_saved_primitive_restart = g_Config.backend_info.bSupportsPrimitiveRestart;
+    // Room for the worst case of six indices per vertex.
+    m_indices.resize(6 * 65536);
+  }
+
+  void TearDown() override
+  {
+    cpu_info = m_saved_cpu_info;
+    g_Config.backend_info.bSupportsPrimitiveRestart = m_saved_primitive_restart;
+    IndexGenerator::Init();
+  }
+
+  bool Supported(Implementation implementation) const
+  {
+    return implementation != Implementation::AVX2 || m_saved_cpu_info.bAVX2;
+  }
+
+  void Init(Implementation implementation, bool primitive_restart)
+  {
+    cpu_info = m_saved_cpu_info;
+    cpu_info.bSSE2 = implementation != Implementation::Scalar;
+    cpu_info.bAVX2 = implementation == Implementation::AVX2;
+    g_Config.backend_info.bSupportsPrimitiveRestart = primitive_restart;
+    IndexGenerator::Init();
+  }
+
+  // Generates the indices of one draw of each vertex count, in a single batch.
+  std::vector<u16> Generate(Implementation implementation, int primitive, bool primitive_restart,
+                            const std::vector<u32>& counts)
+  {
+    Init(implementation, primitive_restart);
+    IndexGenerator::Start(m_indices.data());
+    for (u32 count : counts)
+      IndexGenerator::AddIndices(primitive, count);
+    return std::vector<u16>(m_indices.data(), m_indices.data() + IndexGenerator::GetIndexLen());
+  }
+
+  // Generates the indices of a hundred batches of sixty draws with a thousand vertices each.
+  void GenerateRepeatedly(Implementation implementation)
+  {
+    int primitive;
+    bool primitive_restart;
+    std::tie(primitive, primitive_restart) = GetParam();
+
+    Init(implementation, primitive_restart);
+    for (int i = 0; i < 100; ++i)
+    {
+      IndexGenerator::Start(m_indices.data());
+      for (int j = 0; j < 60; ++j)
+        IndexGenerator::AddIndices(primitive, 1000);
+    }
+  }
+
+  CPUInfo m_saved_cpu_info;
+  bool m_saved_primitive_restart;
+  std::vector<u16> m_indices;
+};
+
+// The functions the macro defines need no declarations in an anonymous namespace.
+namespace
+{
+INSTANTIATE_TEST_CASE_P(Primitives, IndexGeneratorTest,
+                        ::testing::Combine(::testing::Values(OpcodeDecoder::GX_DRAW_QUADS,
+                                                             OpcodeDecoder::GX_DRAW_TRIANGLES,
+                                                             OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP,
+                                                             OpcodeDecoder::GX_DRAW_TRIANGLE_FAN,
+                                                             OpcodeDecoder::GX_DRAW_LINES,
+                                                             OpcodeDecoder::GX_DRAW_LINE_STRIP,
+                                                             OpcodeDecoder::GX_DRAW_POINTS),
+                                           ::testing::Bool()  // primitive restart
+                                           ));
+}
+
+TEST_P(IndexGeneratorTest, MatchesScalar)
+{
+  int primitive;
+  bool primitive_restart;
+  std::tie(primitive, primitive_restart) = GetParam();
+
+  // Every count up to a few iterations of the longest pattern, then one large draw.
+  std::vector<u32> counts;
+  for (u32 i = 0; i <= 100; ++i)
+    counts.push_back(i);
+  counts.push_back(40000);
+
+  const std::vector<u16> expected =
+      Generate(Implementation::Scalar, primitive, primitive_restart, counts);
+  EXPECT_EQ(expected, Generate(Implementation::SSE2, primitive, primitive_restart, counts));
+  if (Supported(Implementation::AVX2))
+  {
+    EXPECT_EQ(expected, Generate(Implementation::AVX2, primitive, primitive_restart, counts));
+  }
+}
+
+TEST_P(IndexGeneratorTest, ScalarSpeed)
+{
+  GenerateRepeatedly(Implementation::Scalar);
+}
+
+TEST_P(IndexGeneratorTest, SSE2Speed)
+{
+  GenerateRepeatedly(Implementation::SSE2);
+}
+
+TEST_P(IndexGeneratorTest, AVX2Speed)
+{
+  if (Supported(Implementation::AVX2))
+    GenerateRepeatedly(Implementation::AVX2);
+}
@@ -2,14 +2,18 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <tuple>
 #include <type_traits>
 #include <unordered_set>
+#include <vector>
 
 #include <gtest/gtest.h>  // NOLINT
 
+#include "Common/CPUDetect.h"
 #include "Common/Common.h"
 #include "Common/MathUtil.h"
 #include "VideoCommon/CPMemory.h"
@@ -109,7 +113,10 @@ class VertexLoaderParamTest : public VertexLoaderTest,
                               public ::testing::WithParamInterface<std::tuple<int, int, int, int>>
 {
 };
-extern int gtest_AllCombinationsVertexLoaderParamTest_dummy_;
+
+// In an anonymous namespace, as the functions the macro defines have no declarations.
+namespace
+{
 INSTANTIATE_TEST_CASE_P(AllCombinations, VertexLoaderParamTest,
                         ::testing::Combine(::testing::Values(DIRECT, INDEX8, INDEX16),
                                            ::testing::Values(FORMAT_UBYTE, FORMAT_BYTE,
@@ -118,6 +125,7 @@ INSTANTIATE_TEST_CASE_P(AllCombinations, VertexLoaderParamTest,
                                            ::testing::Values(0, 1),     // elements
                                            ::testing::Values(0, 1, 31)  // frac
                                            ));
+}
 
 TEST_P(VertexLoaderParamTest, PositionAll)
 {
@@ -249,13 +257,15 @@ class VertexLoaderSpeedTest : public VertexLoaderTest,
                               public ::testing::WithParamInterface<std::tuple<int, int>>
 {
 };
-extern int gtest_FormatsAndElementsVertexLoaderSpeedTest_dummy_;
+namespace
+{
 INSTANTIATE_TEST_CASE_P(FormatsAndElements, VertexLoaderSpeedTest,
                         ::testing::Combine(::testing::Values(FORMAT_UBYTE, FORMAT_BYTE,
                                                              FORMAT_USHORT, FORMAT_SHORT,
                                                              FORMAT_FLOAT),
                                            ::testing::Values(0, 1)  // elements
                                            ));
+}
 
 TEST_P(VertexLoaderSpeedTest, PositionDirectAll)
 {
@@ -355,3 +365,151 @@ TEST_F(VertexLoaderTest, LargeFloatVertexSpeed)
   for (int i = 0; i < 100; ++i)
     RunVertices(100000);
 }
+
+class VertexLoaderAVX2Test : public VertexLoaderTest,
+                             public ::testing::WithParamInterface<std::tuple<int, int>>
+{
+protected:
+  void SetUp() override
+  {
+    VertexLoaderTest::SetUp();
+
+    // Keeps the float inputs finite, so both loaders write the same bits.
+    for (size_t i = 0; i < sizeof(input_memory); ++i)
+      input_memory[i] = static_cast<u8>(i * 7 % 127);
+  }
+
+  // Position matrix index, XYZ position, normal, RGBA color and ST texture coordinates.
+  void SetFullLayout(int format)
+  {
+    m_vtx_desc.PosMatIdx = 1;
+    m_vtx_desc.Position = DIRECT;
+    m_vtx_desc.Normal = DIRECT;
+    m_vtx_desc.Color0 = DIRECT;
+    m_vtx_desc.Tex0Coord = DIRECT;
+    m_vtx_attr.g0.ByteDequant = true;
+    m_vtx_attr.g0.PosElements = 1;  // XYZ
+    m_vtx_attr.g0.PosFormat = format;
+    m_vtx_attr.g0.PosFrac = 5;
+    // Normals only come in signed formats.
+    m_vtx_attr.g0.NormalFormat = format == FORMAT_UBYTE ? FORMAT_BYTE : format;
+    m_vtx_attr.g0.Color0Elements = 1;  // Has Alpha
+    m_vtx_attr.g0.Color0Comp = FORMAT_32B_8888;
+    m_vtx_attr.g0.Tex0CoordElements = 1;  // ST
+    m_vtx_attr.g0.Tex0CoordFormat = format;
+    m_vtx_attr.g0.Tex0Frac = 3;
+  }
+
+  // Loads count vertices with the loader for the current CPU features and returns the output,
+  // followed by the zfreeze position cache.
+  std::vector<u8> Load(int count)
+  {
+    m_loader = VertexLoaderBase::CreateVertexLoader(m_vtx_desc, m_vtx_attr);
+    const size_t size = static_cast<size_t>(count) * m_loader->m_native_vtx_decl.stride;
+
+    memset(output_memory, 0xFF, size + 16);
+    RunVertices(count);
+    std::vector<u8> output(output_memory, output_memory + size + 16);
+    output.insert(output.end(), reinterpret_cast<u8*>(VertexLoaderManager::position_cache),
+                  reinterpret_cast<u8*>(VertexLoaderManager::position_cache + 3));
+    return output;
+  }
+
+  // This version of gtest has no GTEST_SKIP, so the skip is reported as a property of the test
+  // and printed.
+  bool SkipWithoutAVX2()
+  {
+    if (cpu_info.bAVX2)
+      return false;
+    RecordProperty("skipped", "The CPU doesn't support AVX2");
+    printf("Skipped: the CPU doesn't support AVX2\n");
+    return true;
+  }
+
+  void ExpectMatchingSSE(int count)
+  {
+    const CPUInfo saved_cpu_info = cpu_info;
+    cpu_info.bAVX2 = false;
+    const std::vector<u8> sse = Load(count);
+    cpu_info = saved_cpu_info;
+    const std::vector<u8> avx2 = Load(count);
+    ASSERT_EQ(sse.size(), avx2.size());
+    EXPECT_EQ(0, memcmp(sse.data(), avx2.data(), sse.size()));
+  }
+
+  // Loads half a million vertices in draws of count, with the loader for the current CPU features.
+  void LoadRepeatedly(int count)
+  {
+    m_loader = VertexLoaderBase::CreateVertexLoader(m_vtx_desc, m_vtx_attr);
+    for (int i = std::max(1, 500000 / count); i > 0; --i)
+      RunVertices(count);
+  }
+};
+namespace
+{
+INSTANTIATE_TEST_CASE_P(FormatsAndCounts, VertexLoaderAVX2Test,
+                        ::testing::Combine(::testing::Values(FORMAT_UBYTE, FORMAT_BYTE,
+                                                             FORMAT_USHORT, FORMAT_SHORT,
+                                                             FORMAT_FLOAT),
+                                           // Around the range the AVX2 loop is used for.
+                                           ::testing::Values(1, 5, 15, 16, 17, 100, 256, 257,
+                                                             1000, 100000)  // count
+                                           ));
+}
+
+TEST_P(VertexLoaderAVX2Test, MatchesSSE)
+{
+  int format, count;
+  std::tie(format, count) = GetParam();
+
+  if (SkipWithoutAVX2())
+    return;
+
+  SetFullLayout(format);
+  ExpectMatchingSSE(count);
+
+  // Only the position, so the first vertex's three components end right before the second's.
+  m_vtx_desc.Hex = 0;
+  m_vtx_desc.Position = DIRECT;
+  ExpectMatchingSSE(count);
+
+  m_vtx_attr.g0.PosElements = 0;  // XY
+  ExpectMatchingSSE(count);
+
+  // Every color format, between the position and a single texture coordinate.
+  m_vtx_attr.g0.PosElements = 1;  // XYZ
+  m_vtx_desc.Color0 = DIRECT;
+  m_vtx_desc.Tex0Coord = DIRECT;
+  m_vtx_attr.g0.Tex0CoordElements = 0;  // S
+  for (int comp : {FORMAT_16B_565, FORMAT_24B_888, FORMAT_32B_888x, FORMAT_16B_4444,
+                   FORMAT_24B_6666, FORMAT_32B_8888})
+  {
+    SCOPED_TRACE(comp);
+    m_vtx_attr.g0.Color0Elements = comp == FORMAT_16B_565 || comp == FORMAT_24B_888 ? 0 : 1;
+    m_vtx_attr.g0.Color0Comp = comp;
+    ExpectMatchingSSE(count);
+  }
+}
+
+TEST_P(VertexLoaderAVX2Test, SSESpeed)
+{
+  int format, count;
+  std::tie(format, count) = GetParam();
+
+  SetFullLayout(format);
+  const CPUInfo saved_cpu_info = cpu_info;
+  cpu_info.bAVX2 = false;
+  LoadRepeatedly(count);
+  cpu_info = saved_cpu_info;
+}
+
+TEST_P(VertexLoaderAVX2Test, AVX2Speed)
+{
+  int format, count;
+  std::tie(format, count) = GetParam();
+  if (SkipWithoutAVX2())
+    return;
+
+  SetFullLayout(format);
+  LoadRepeatedly(count);
+}